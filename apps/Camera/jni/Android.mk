@@ -17,10 +17,14 @@ LOCAL_SRC_FILES := \
         feature_mos/src/mosaic/trsMatrix.cpp \
         feature_mos/src/mosaic/AlignFeatures.cpp \
         feature_mos/src/mosaic/Blend.cpp \
+        feature_mos/src/mosaic/CapturePipeline.cpp \
+        feature_mos/src/mosaic/ColorConvert.cpp \
         feature_mos/src/mosaic/Delaunay.cpp \
+        feature_mos/src/mosaic/FramePool.cpp \
         feature_mos/src/mosaic/ImageUtils.cpp \
         feature_mos/src/mosaic/Mosaic.cpp \
         feature_mos/src/mosaic/Pyramid.cpp \
+        feature_mos/src/mosaic/ScratchFile.cpp \
         feature_mos/src/mosaic_renderer/Renderer.cpp \
         feature_mos/src/mosaic_renderer/WarpRenderer.cpp \
         feature_mos/src/mosaic_renderer/SurfaceTextureRenderer.cpp \
@@ -36,10 +40,25 @@ LOCAL_SRC_FILES := \
         feature_stab/db_vlvm/db_utilities_indexing.cpp \
         feature_stab/db_vlvm/db_utilities_linalg.cpp \
         feature_stab/db_vlvm/db_utilities_poly.cpp \
+        feature_stab/db_vlvm/db_worker_pool.cpp \
         feature_stab/src/dbreg/dbreg.cpp \
         feature_stab/src/dbreg/dbstabsmooth.cpp \
+        feature_stab/src/dbreg/dbwarp.cpp \
         feature_stab/src/dbreg/vp_motionmodel.c
 
+# The SIMD kernels are built with NEON on ARMv7 and only used when the CPU
+# reports NEON support at runtime.
+ifeq ($(ARCH_ARM_HAVE_ARMV7A),true)
+mosaic_simd_suffix := .neon
+else
+mosaic_simd_suffix :=
+endif
+
+LOCAL_SRC_FILES += \
+        feature_mos/src/mosaic/ColorConvertSimd.cpp$(mosaic_simd_suffix) \
+        feature_mos/src/mosaic/PyramidSimd.cpp$(mosaic_simd_suffix) \
+        feature_stab/db_vlvm/db_feature_matching_simd.cpp$(mosaic_simd_suffix)
+
 LOCAL_SHARED_LIBRARIES := liblog libnativehelper libGLESv2
 #LOCAL_LDLIBS := -L$(SYSROOT)/usr/lib -ldl -llog -lGLESv2 -L$(TARGET_OUT)
 
@@ -47,3 +66,148 @@ LOCAL_MODULE_TAGS := optional
 
 LOCAL_MODULE    := libjni_mosaic
 include $(BUILD_SHARED_LIBRARY)
+
+# Color conversion benchmark: scalar against SIMD throughput
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/feature_stab/db_vlvm \
+        $(LOCAL_PATH)/feature_mos/src \
+        $(LOCAL_PATH)/feature_mos/src/mosaic
+
+LOCAL_CFLAGS := -O3 -DNDEBUG
+
+LOCAL_SRC_FILES := \
+        feature_mos/src/mosaictest/colorbench.cpp \
+        feature_mos/src/mosaic/ColorConvert.cpp \
+        feature_mos/src/mosaic/ColorConvertSimd.cpp$(mosaic_simd_suffix) \
+        feature_mos/src/mosaic/ImageUtils.cpp \
+        feature_stab/db_vlvm/db_utilities.cpp
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_MODULE    := mosaic_colorbench
+include $(BUILD_EXECUTABLE)
+
+# Pyramid kernels check: SIMD against scalar, bit for bit
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/feature_stab/db_vlvm \
+        $(LOCAL_PATH)/feature_mos/src \
+        $(LOCAL_PATH)/feature_mos/src/mosaic
+
+LOCAL_CFLAGS := -O3 -DNDEBUG
+
+LOCAL_SRC_FILES := \
+        feature_mos/src/mosaictest/pyramidtest.cpp \
+        feature_mos/src/mosaic/ImageUtils.cpp \
+        feature_mos/src/mosaic/Pyramid.cpp \
+        feature_mos/src/mosaic/PyramidSimd.cpp$(mosaic_simd_suffix) \
+        feature_mos/src/mosaic/ScratchFile.cpp \
+        feature_stab/db_vlvm/db_utilities.cpp
+
+LOCAL_SHARED_LIBRARIES := liblog
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_MODULE    := mosaic_pyramidtest
+include $(BUILD_EXECUTABLE)
+
+# Matching kernels check: SIMD against plain C, bit for bit
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/feature_stab/db_vlvm
+
+LOCAL_CFLAGS := -O3 -DNDEBUG
+
+LOCAL_SRC_FILES := \
+        feature_stab/src/dbregtest/matchtest.cpp \
+        feature_stab/db_vlvm/db_feature_detection.cpp \
+        feature_stab/db_vlvm/db_feature_matching.cpp \
+        feature_stab/db_vlvm/db_feature_matching_simd.cpp$(mosaic_simd_suffix) \
+        feature_stab/db_vlvm/db_utilities.cpp \
+        feature_stab/db_vlvm/db_utilities_indexing.cpp \
+        feature_stab/db_vlvm/db_utilities_linalg.cpp \
+        feature_stab/db_vlvm/db_worker_pool.cpp
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_MODULE    := dbreg_matchtest
+include $(BUILD_EXECUTABLE)
+
+# Homography warp benchmark: look-up tables against the direct warp
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/feature_stab/db_vlvm \
+        $(LOCAL_PATH)/feature_stab/src \
+        $(LOCAL_PATH)/feature_stab/src/dbreg
+
+LOCAL_CFLAGS := -O3 -DNDEBUG
+
+LOCAL_SRC_FILES := \
+        feature_stab/src/dbregtest/warpbench.cpp \
+        feature_stab/src/dbreg/dbwarp.cpp \
+        feature_stab/db_vlvm/db_utilities.cpp \
+        feature_stab/db_vlvm/db_utilities_indexing.cpp \
+        feature_stab/db_vlvm/db_utilities_linalg.cpp
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_MODULE    := dbreg_warpbench
+include $(BUILD_EXECUTABLE)
+
+# Offline panorama benchmark: replays frame sequences through alignment and
+# blending on the build host, reporting per-stage times and a checksum
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES := \
+        $(LOCAL_PATH)/feature_stab/db_vlvm \
+        $(LOCAL_PATH)/feature_stab/src \
+        $(LOCAL_PATH)/feature_stab/src/dbreg \
+        $(LOCAL_PATH)/feature_mos/src \
+        $(LOCAL_PATH)/feature_mos/src/mosaic
+
+LOCAL_CFLAGS := -O3 -DNDEBUG
+
+LOCAL_SRC_FILES := \
+        feature_stab/src/dbregtest/mosaicbench.cpp \
+        feature_stab/src/dbregtest/PgmImage.cpp \
+        feature_mos/src/mosaic/trsMatrix.cpp \
+        feature_mos/src/mosaic/AlignFeatures.cpp \
+        feature_mos/src/mosaic/Blend.cpp \
+        feature_mos/src/mosaic/ColorConvert.cpp \
+        feature_mos/src/mosaic/ColorConvertSimd.cpp \
+        feature_mos/src/mosaic/Delaunay.cpp \
+        feature_mos/src/mosaic/ImageUtils.cpp \
+        feature_mos/src/mosaic/Mosaic.cpp \
+        feature_mos/src/mosaic/Pyramid.cpp \
+        feature_mos/src/mosaic/PyramidSimd.cpp \
+        feature_mos/src/mosaic/ScratchFile.cpp \
+        feature_stab/db_vlvm/db_feature_detection.cpp \
+        feature_stab/db_vlvm/db_feature_matching.cpp \
+        feature_stab/db_vlvm/db_feature_matching_simd.cpp \
+        feature_stab/db_vlvm/db_framestitching.cpp \
+        feature_stab/db_vlvm/db_image_homography.cpp \
+        feature_stab/db_vlvm/db_rob_image_homography.cpp \
+        feature_stab/db_vlvm/db_utilities.cpp \
+        feature_stab/db_vlvm/db_utilities_camera.cpp \
+        feature_stab/db_vlvm/db_utilities_indexing.cpp \
+        feature_stab/db_vlvm/db_utilities_linalg.cpp \
+        feature_stab/db_vlvm/db_utilities_poly.cpp \
+        feature_stab/db_vlvm/db_worker_pool.cpp \
+        feature_stab/src/dbreg/dbreg.cpp \
+        feature_stab/src/dbreg/dbstabsmooth.cpp \
+        feature_stab/src/dbreg/vp_motionmodel.c
+
+# The host build of liblog is a static library writing to stderr; it takes
+# pthread from the host
+LOCAL_STATIC_LIBRARIES := liblog
+LOCAL_LDLIBS := -lpthread
+
+LOCAL_MODULE_TAGS := tests
+
+LOCAL_MODULE    := mosaic_bench
+include $(BUILD_HOST_EXECUTABLE)
@@ -47,9 +47,9 @@ Align::~Align()
     ImageUtils::freeImage(imageGray);
 }
 
-char* Align::getRegProfileString()
+int Align::getRegProfiles(db_RegistrationProfile *profiles, int max_profiles)
 {
-  return reg.profile_string;
+  return reg.GetProfiles(profiles, max_profiles);
 }
 
 int Align::initialize(int width, int height, bool _quarter_res, float _thresh_still)
@@ -83,6 +83,9 @@ int Align::initialize(int width, int height, bool _quarter_res, float _thresh_st
             scale, reference_update_period, false, 0, nrsamples, chunk_size,
             nr_corners, max_disparity, use_smaller_matching_window,
             nrhorz, nrvert);
+    reg.SetNrDetectionThreads(DETECTION_THREADS);
+    reg.SetRansacConfidence(RANSAC_CONFIDENCE);
+    reg.SetTracking(TRACKING_RADIUS);
   }
   this->width = width;
   this->height = height;
@@ -53,6 +53,13 @@ public:
 
   static const int MIN_NR_REF_CORNERS = 25;
   static const int MIN_NR_INLIERS = 10;
+  // Threads for corner detection, 0 for one per CPU
+  static const int DETECTION_THREADS = 0;
+  // RANSAC stops drawing samples at this confidence, 0 to draw them all
+  static const double RANSAC_CONFIDENCE = 0.995;
+  // Search radius for tracking corners between frames, 0 to detect them on
+  // every frame
+  static const int TRACKING_RADIUS = DB_DEFAULT_TRACK_RADIUS;
 
   Align();
   ~Align();
@@ -67,7 +74,11 @@ public:
 
   // Obtain the TRS matrix from the last two frames
   int getLastTRS(double trs[3][3]);
-  char* getRegProfileString();
+
+  // Copy the timings and counters of up to max_profiles of the most recent
+  // frames, oldest first, and return how many were copied. May be called
+  // while another thread adds frames.
+  int getRegProfiles(db_RegistrationProfile *profiles, int max_profiles);
 
 protected:
 
@@ -19,9 +19,12 @@
 // $Id: Blend.cpp,v 1.22 2011/06/24 04:22:14 mbansal Exp $
 
 #include <string.h>
+#include <limits.h>
+#include <sys/time.h>
 
 #include "Interp.h"
 #include "Blend.h"
+#include "ScratchFile.h"
 
 #include "Geometry.h"
 #include "trsMatrix.h"
@@ -29,9 +32,42 @@
 #include "Log.h"
 #define LOG_TAG "BLEND"
 
+// Work handed to the worker pool. Site tasks cover one band of full
+// resolution mosaic rows [bandStart[band], bandStart[band+1]); every pixel of
+// every pyramid level is owned by exactly one band, so the result does not
+// depend on the number of threads. Channel tasks work on the Y, U and V
+// pyramids independently.
+struct BlendTask
+{
+    Blend *blend;
+
+    CSite *csite;
+    MosaicRect *rect;
+    YUVinfo *imgMos;
+    int site_idx;
+    bool compute_mask;
+    int bandStart[db_WorkerPool::MAX_THREADS + 1];
+
+    ImageType src[3];
+    PyramidShort *pyr[3];
+    int nlevs[3];
+    int ret[3];
+};
+
+static double now_ms()
+{
+    struct timeval res;
+    gettimeofday(&res, NULL);
+    return 1000.0 * res.tv_sec + (double) res.tv_usec / 1e3;
+}
+
 Blend::Blend()
 {
   m_wb.blendingType = BLEND_TYPE_NONE;
+  m_incrementalBudget = 0;
+  m_incrementalUsed = 0;
+  m_incrementalFrames = 0;
+  memset(&m_times, 0, sizeof(m_times));
 }
 
 Blend::~Blend()
@@ -41,7 +77,8 @@ Blend::~Blend()
     if (m_pFrameYPyr) free(m_pFrameYPyr);
 }
 
-int Blend::initialize(int blendingType, int stripType, int frame_width, int frame_height)
+int Blend::initialize(int blendingType, int stripType, int frame_width, int frame_height,
+        int numThreads)
 {
     this->width = frame_width;
     this->height = frame_height;
@@ -71,9 +108,131 @@ int Blend::initialize(int blendingType, int stripType, int frame_width, int fram
         return BLEND_RET_ERROR_MEMORY;
     }
 
+    // Falls back to fewer threads (at worst the calling thread alone) on failure
+    int started = m_workers.Init(numThreads);
+    LOGV("Blending on %d threads", started);
+
+    m_incrementalUsed = 0;
+    m_incrementalFrames = 0;
+    memset(&m_times, 0, sizeof(m_times));
+
     return BLEND_RET_OK;
 }
 
+void Blend::setIncrementalBudget(unsigned int budget)
+{
+    m_incrementalBudget = budget;
+}
+
+int Blend::addFrame(MosaicFrame *mb)
+{
+    if (m_incrementalBudget == 0)
+        return BLEND_RET_OK;
+
+    // In WIDE strip mode only the frames picked by SelectRelevantFrames are
+    // blended. It keeps the first frame and each frame far enough from the
+    // previously kept one, which is known as soon as the frame arrives. The
+    // last frame is always kept too; it is handled by runBlend if skipped here.
+    if (m_wb.stripType == STRIP_TYPE_WIDE)
+    {
+        double midX = mb->width / 2.0;
+        double midY = mb->height / 2.0;
+        double z = ProjZ(mb->trs, midX, midY, 1.0);
+        double currX = ProjX(mb->trs, midX, midY, z, 1.0);
+        double currY = ProjY(mb->trs, midX, midY, z, 1.0);
+
+        if (m_incrementalFrames++ > 0 &&
+                fabs(currX - m_prevCenterX) <= STRIP_SEPARATION_THRESHOLD_PXLS &&
+                fabs(currY - m_prevCenterY) <= STRIP_SEPARATION_THRESHOLD_PXLS)
+        {
+            return BLEND_RET_OK;
+        }
+
+        m_prevCenterX = currX;
+        m_prevCenterY = currY;
+    }
+
+    unsigned int bytes = FramePyramidBytes();
+    if (m_incrementalUsed + bytes > m_incrementalBudget)
+        return BLEND_RET_OK;
+
+    double t0 = now_ms();
+
+    mb->pyrY = PyramidShort::allocatePyramidPacked(m_wb.nlevs, (unsigned short) width, (unsigned short) height, BORDER);
+    mb->pyrU = PyramidShort::allocatePyramidPacked(m_wb.nlevsC, (unsigned short) width, (unsigned short) height, BORDER);
+    mb->pyrV = PyramidShort::allocatePyramidPacked(m_wb.nlevsC, (unsigned short) width, (unsigned short) height, BORDER);
+
+    if (!mb->pyrY || !mb->pyrU || !mb->pyrV)
+    {
+        LOGE("Error: Could not allocate pyramids for incremental blending");
+        mb->freePyramids();
+        return BLEND_RET_ERROR_MEMORY;
+    }
+
+    BlendTask task;
+    task.blend = this;
+    task.src[0] = mb->image;
+    task.src[1] = mb->getU();
+    task.src[2] = mb->getV();
+    task.pyr[0] = mb->pyrY;
+    task.pyr[1] = mb->pyrU;
+    task.pyr[2] = mb->pyrV;
+    task.nlevs[0] = m_wb.nlevs;
+    task.nlevs[1] = task.nlevs[2] = m_wb.nlevsC;
+
+    m_workers.Run(FramePyramidTask, &task, 3);
+
+    if (task.ret[0] != BLEND_RET_OK || task.ret[1] != BLEND_RET_OK ||
+            task.ret[2] != BLEND_RET_OK)
+    {
+        LOGE("Error: Could not generate Laplacian pyramids");
+        mb->freePyramids();
+        return BLEND_RET_ERROR;
+    }
+
+    m_incrementalUsed += bytes;
+    m_times.prepareMs += now_ms() - t0;
+
+    return BLEND_RET_OK;
+}
+
+// Memory taken by the Y, U and V pyramids of one frame
+unsigned int Blend::FramePyramidBytes()
+{
+    int lines;
+    unsigned int bytes = 0;
+    int nlevs[3] = { m_wb.nlevs, m_wb.nlevsC, m_wb.nlevsC };
+
+    for (int c = 0; c < 3; c++)
+    {
+        unsigned int size = PyramidShort::calcStorage((unsigned short) width,
+                (unsigned short) height, BORDER << 1, nlevs[c], &lines);
+        bytes += sizeof(PyramidShort) * nlevs[c] + sizeof(short *) * lines +
+                sizeof(short) * size;
+    }
+
+    return bytes;
+}
+
+// Frees the pyramids a frame was prepared with during capture, if any, and
+// gives their memory back to the incremental budget
+void Blend::FreeFramePyramids(MosaicFrame *mb)
+{
+    if (mb->pyrY == NULL)
+        return;
+
+    mb->freePyramids();
+    m_incrementalUsed -= FramePyramidBytes();
+}
+
+void Blend::FreeFramePyramids(MosaicFrame **frames, int frames_size)
+{
+    for (int i = 0; i < frames_size; i++)
+    {
+        FreeFramePyramids(frames[i]);
+    }
+}
+
 inline double max(double a, double b) { return a > b ? a : b; }
 inline double min(double a, double b) { return a < b ? a : b; }
 
@@ -113,8 +272,28 @@ int Blend::runBlend(MosaicFrame **oframes, MosaicFrame **rframes,
     }
     else // For WIDE strip mode, first select the relevant frames to blend.
     {
-        SelectRelevantFrames(oframes, frames_size, rframes, frames_size);
+        int selected_size;
+        SelectRelevantFrames(oframes, frames_size, rframes, selected_size);
+
+        // The selection is in capture order, so the frames left out are the
+        // ones between the selected ones. Those prepared during capture are
+        // not going to be blended.
+        int k = 0;
+        for (int i = 0; i < frames_size; i++)
+        {
+            if (k < selected_size && oframes[i] == rframes[k])
+            {
+                while (k < selected_size && oframes[i] == rframes[k])
+                    k++;
+            }
+            else
+            {
+                FreeFramePyramids(oframes[i]);
+            }
+        }
+
         frames = rframes;
+        frames_size = selected_size;
     }
 
     ComputeBlendParameters(frames, frames_size, true);
@@ -128,6 +307,7 @@ int Blend::runBlend(MosaicFrame **oframes, MosaicFrame **rframes,
 
     if (!(m_AllSites = m_Triangulator.allocMemory(numCenters)))
     {
+        FreeFramePyramids(frames, frames_size);
         return BLEND_RET_ERROR_MEMORY;
     }
 
@@ -213,6 +393,14 @@ int Blend::runBlend(MosaicFrame **oframes, MosaicFrame **rframes,
     fullRect.top = (int) floor(global_rect.bot);  // min-y
     fullRect.right = (int) ceil(global_rect.rgt); // max-x
     fullRect.bottom = (int) ceil(global_rect.top);// max-y
+    if (fullRect.right - fullRect.left >= MAX_MOSAIC_SIZE ||
+        fullRect.bottom - fullRect.top >= MAX_MOSAIC_SIZE)
+    {
+        LOGE("RunBlend: aborting - mosaic extent out of range");
+        FreeFramePyramids(frames, frames_size);
+        return BLEND_RET_ERROR;
+    }
+
     Mwidth = (unsigned short) (fullRect.right - fullRect.left + 1);
     Mheight = (unsigned short) (fullRect.bottom - fullRect.top + 1);
 
@@ -231,6 +419,7 @@ int Blend::runBlend(MosaicFrame **oframes, MosaicFrame **rframes,
         LOGE("RunBlend: aborting -consistency check failed,"
              "(xLeftMost, xRightMost, yTopMost, yBottomMost): (%d, %d, %d, %d)",
              xLeftMost, xRightMost, yTopMost, yBottomMost);
+        FreeFramePyramids(frames, frames_size);
         return BLEND_RET_ERROR;
     }
 
@@ -238,12 +427,16 @@ int Blend::runBlend(MosaicFrame **oframes, MosaicFrame **rframes,
     Mwidth = (unsigned short) ((Mwidth + 3) & ~3);
     Mheight = (unsigned short) ((Mheight + 3) & ~3);    // Round up.
 
-    ret = MosaicSizeCheck(LIMIT_SIZE_MULTIPLIER, LIMIT_HEIGHT_MULTIPLIER);
+    // The mosaic pyramids only need to be resident around the frame being
+    // blended when they are backed by the scratch file.
+    ret = MosaicSizeCheck(ScratchFile::isOpen() ? LIMIT_SIZE_MULTIPLIER_SCRATCH :
+            LIMIT_SIZE_MULTIPLIER, LIMIT_HEIGHT_MULTIPLIER);
     if (ret != BLEND_RET_OK)
     {
        LOGE("RunBlend: aborting - mosaic size check failed, "
             "(frame_width, frame_height) vs (mosaic_width, mosaic_height): "
             "(%d, %d) vs (%d, %d)", width, height, Mwidth, Mheight);
+       FreeFramePyramids(frames, frames_size);
        return ret;
     }
 
@@ -252,6 +445,7 @@ int Blend::runBlend(MosaicFrame **oframes, MosaicFrame **rframes,
     if (imgMos == NULL)
     {
         LOGE("RunBlend: aborting - couldn't alloc %d x %d mosaic image", Mwidth, Mheight);
+        FreeFramePyramids(frames, frames_size);
         return BLEND_RET_ERROR_MEMORY;
     }
 
@@ -285,7 +479,11 @@ int Blend::runBlend(MosaicFrame **oframes, MosaicFrame **rframes,
             cropping_rect, progress, cancelComputation);
 
     if (m_wb.blendingType == BLEND_TYPE_HORZ)
+    {
+        double t0 = now_ms();
         CropFinalMosaic(*imgMos, cropping_rect);
+        m_times.finalMs += now_ms() - t0;
+    }
 
 
     m_Triangulator.freeMemory();    // note: can be called even if delaunay_alloc() wasn't successful
@@ -330,45 +528,124 @@ int Blend::MosaicSizeCheck(float sizeMultiplier, float heightMultiplier) {
 
 int Blend::FillFramePyramid(MosaicFrame *mb)
 {
-    ImageType mbY, mbU, mbV;
-    // Lay this image, centered into the temporary buffer
-    mbY = mb->image;
-    mbU = mb->getU();
-    mbV = mb->getV();
+    BlendTask task;
+    task.blend = this;
 
-    int h, w;
+    // Lay this image, centered into the temporary buffer
+    task.src[0] = mb->image;
+    task.src[1] = mb->getU();
+    task.src[2] = mb->getV();
+    task.pyr[0] = m_pFrameYPyr;
+    task.pyr[1] = m_pFrameUPyr;
+    task.pyr[2] = m_pFrameVPyr;
+    task.nlevs[0] = m_wb.nlevs;
+    task.nlevs[1] = task.nlevs[2] = m_wb.nlevsC;
+
+    m_workers.Run(FramePyramidTask, &task, 3);
+
+    if (task.ret[0] != BLEND_RET_OK || task.ret[1] != BLEND_RET_OK ||
+            task.ret[2] != BLEND_RET_OK)
+    {
+        LOGE("Error: Could not generate Laplacian pyramids");
+        return BLEND_RET_ERROR;
+    }
+    else
+    {
+        return BLEND_RET_OK;
+    }
+}
 
-    for(h=0; h<height; h++)
+int Blend::FillChannelPyramid(ImageType src, PyramidShort *pyr, int nlevs,
+        int width, int height)
+{
+    for(int h=0; h<height; h++)
     {
-        ImageTypeShort yptr = m_pFrameYPyr->ptr[h];
-        ImageTypeShort uptr = m_pFrameUPyr->ptr[h];
-        ImageTypeShort vptr = m_pFrameVPyr->ptr[h];
+        ImageTypeShort ptr = pyr->ptr[h];
 
-        for(w=0; w<width; w++)
+        for(int w=0; w<width; w++)
         {
-            yptr[w] = (short) ((*(mbY++)) << 3);
-            uptr[w] = (short) ((*(mbU++)) << 3);
-            vptr[w] = (short) ((*(mbV++)) << 3);
+            ptr[w] = (short) ((*(src++)) << 3);
         }
     }
 
     // Spread the image through the border
-    PyramidShort::BorderSpread(m_pFrameYPyr, BORDER, BORDER, BORDER, BORDER);
-    PyramidShort::BorderSpread(m_pFrameUPyr, BORDER, BORDER, BORDER, BORDER);
-    PyramidShort::BorderSpread(m_pFrameVPyr, BORDER, BORDER, BORDER, BORDER);
-
-    // Generate Laplacian pyramids
-    if (!PyramidShort::BorderReduce(m_pFrameYPyr, m_wb.nlevs) || !PyramidShort::BorderExpand(m_pFrameYPyr, m_wb.nlevs, -1) ||
-            !PyramidShort::BorderReduce(m_pFrameUPyr, m_wb.nlevsC) || !PyramidShort::BorderExpand(m_pFrameUPyr, m_wb.nlevsC, -1) ||
-            !PyramidShort::BorderReduce(m_pFrameVPyr, m_wb.nlevsC) || !PyramidShort::BorderExpand(m_pFrameVPyr, m_wb.nlevsC, -1))
-    {
-        LOGE("Error: Could not generate Laplacian pyramids");
+    PyramidShort::BorderSpread(pyr, BORDER, BORDER, BORDER, BORDER);
+
+    // Generate Laplacian pyramid
+    if (!PyramidShort::BorderReduce(pyr, nlevs) || !PyramidShort::BorderExpand(pyr, nlevs, -1))
         return BLEND_RET_ERROR;
+
+    return BLEND_RET_OK;
+}
+
+void Blend::FramePyramidTask(void *arg, int channel)
+{
+    BlendTask *task = (BlendTask *) arg;
+    Blend *blend = task->blend;
+
+    task->ret[channel] = FillChannelPyramid(task->src[channel], task->pyr[channel],
+            task->nlevs[channel], blend->width, blend->height);
+}
+
+void Blend::ExpandPyramidTask(void *arg, int channel)
+{
+    BlendTask *task = (BlendTask *) arg;
+
+    task->ret[channel] = PyramidShort::BorderExpand(task->pyr[channel],
+            task->nlevs[channel], 1) ? BLEND_RET_OK : BLEND_RET_ERROR;
+}
+
+void Blend::SiteBandTask(void *arg, int band)
+{
+    BlendTask *task = (BlendTask *) arg;
+    MosaicFrame *mb = task->csite->getMb();
+    int rowStart = task->bandStart[band];
+    int rowEnd = task->bandStart[band + 1];
+
+    if (task->compute_mask)
+    {
+        task->blend->ComputeMask(task->csite, mb->vcrect, mb->brect, *task->rect,
+                *task->imgMos, task->site_idx, rowStart, rowEnd);
     }
     else
     {
-        return BLEND_RET_OK;
+        task->blend->ProcessPyramidForThisFrame(task->csite, mb->vcrect, mb->brect,
+                *task->rect, *task->imgMos, mb->trs, task->site_idx, rowStart, rowEnd);
+    }
+}
+
+void Blend::RunSiteBands(CSite *csite, MosaicRect &rect, YUVinfo &imgMos,
+        int site_idx, bool compute_mask)
+{
+    MosaicFrame *mb = csite->getMb();
+
+    BlendTask task;
+    task.blend = this;
+    task.csite = csite;
+    task.rect = &rect;
+    task.imgMos = &imgMos;
+    task.site_idx = site_idx;
+    task.compute_mask = compute_mask;
+
+    // Split the full resolution rows covered by this site evenly. The outer
+    // bands are open-ended so that border rows of every level are covered.
+    int lo = (int) (mb->vcrect.bot - rect.top) - BORDER;
+    int hi = (int) (mb->vcrect.top - rect.top) + BORDER + 1;
+    if (lo < 0) lo = 0;
+    if (hi > imgMos.Y.height) hi = imgMos.Y.height;
+
+    int nbands = m_workers.NrThreads();
+    if (hi - lo < nbands)
+        nbands = 1;
+
+    task.bandStart[0] = INT_MIN;
+    for (int k = 1; k < nbands; k++)
+    {
+        task.bandStart[k] = lo + (hi - lo) * k / nbands;
     }
+    task.bandStart[nbands] = INT_MAX;
+
+    m_workers.Run(SiteBandTask, &task, nbands);
 }
 
 int Blend::DoMergeAndBlend(MosaicFrame **frames, int nsite,
@@ -379,12 +656,17 @@ int Blend::DoMergeAndBlend(MosaicFrame **frames, int nsite,
     m_pMosaicUPyr = NULL;
     m_pMosaicVPyr = NULL;
 
-    m_pMosaicYPyr = PyramidShort::allocatePyramidPacked(m_wb.nlevs,(unsigned short)rect.Width(),(unsigned short)rect.Height(),BORDER);
-    m_pMosaicUPyr = PyramidShort::allocatePyramidPacked(m_wb.nlevsC,(unsigned short)rect.Width(),(unsigned short)rect.Height(),BORDER);
-    m_pMosaicVPyr = PyramidShort::allocatePyramidPacked(m_wb.nlevsC,(unsigned short)rect.Width(),(unsigned short)rect.Height(),BORDER);
+    bool scratch = ScratchFile::isOpen();
+    m_pMosaicYPyr = PyramidShort::allocatePyramidPacked(m_wb.nlevs,(unsigned short)rect.Width(),(unsigned short)rect.Height(),BORDER,scratch);
+    m_pMosaicUPyr = PyramidShort::allocatePyramidPacked(m_wb.nlevsC,(unsigned short)rect.Width(),(unsigned short)rect.Height(),BORDER,scratch);
+    m_pMosaicVPyr = PyramidShort::allocatePyramidPacked(m_wb.nlevsC,(unsigned short)rect.Width(),(unsigned short)rect.Height(),BORDER,scratch);
     if (!m_pMosaicYPyr || !m_pMosaicUPyr || !m_pMosaicVPyr)
     {
+      PyramidShort::freeImage(m_pMosaicVPyr);
+      PyramidShort::freeImage(m_pMosaicUPyr);
+      PyramidShort::freeImage(m_pMosaicYPyr);
       LOGE("Error: Could not allocate pyramids for blending");
+      FreeFramePyramids(frames, nsite);
       return BLEND_RET_ERROR_MEMORY;
     }
 
@@ -393,15 +675,19 @@ int Blend::DoMergeAndBlend(MosaicFrame **frames, int nsite,
     CSite *esite = m_AllSites + nsite;
     int site_idx;
 
+    m_times.maskMs = m_times.pyramidMs = m_times.finalMs = 0.0;
+    double t0 = now_ms();
+
     // First go through each frame and for each mosaic pixel determine which frame it should come from
     site_idx = 0;
     for(CSite *csite = m_AllSites; csite < esite; csite++)
     {
         if(cancelComputation)
         {
-            if (m_pMosaicVPyr) free(m_pMosaicVPyr);
-            if (m_pMosaicUPyr) free(m_pMosaicUPyr);
-            if (m_pMosaicYPyr) free(m_pMosaicYPyr);
+            PyramidShort::freeImage(m_pMosaicVPyr);
+            PyramidShort::freeImage(m_pMosaicUPyr);
+            PyramidShort::freeImage(m_pMosaicYPyr);
+            FreeFramePyramids(frames, nsite);
             return BLEND_RET_CANCELLED;
         }
 
@@ -410,7 +696,7 @@ int Blend::DoMergeAndBlend(MosaicFrame **frames, int nsite,
         mb->vcrect = mb->brect;
         ClipBlendRect(csite, mb->vcrect);
 
-        ComputeMask(csite, mb->vcrect, mb->brect, rect, imgMos, site_idx);
+        RunSiteBands(csite, rect, imgMos, site_idx, true);
 
         site_idx++;
     }
@@ -550,38 +836,66 @@ int Blend::DoMergeAndBlend(MosaicFrame **frames, int nsite,
 
     }
 
+    double t1 = now_ms();
+    m_times.maskMs = t1 - t0;
+
     // Now perform the actual blending using the frame assignment determined above
     site_idx = 0;
     for(CSite *csite = m_AllSites; csite < esite; csite++)
     {
         if(cancelComputation)
         {
-            if (m_pMosaicVPyr) free(m_pMosaicVPyr);
-            if (m_pMosaicUPyr) free(m_pMosaicUPyr);
-            if (m_pMosaicYPyr) free(m_pMosaicYPyr);
+            PyramidShort::freeImage(m_pMosaicVPyr);
+            PyramidShort::freeImage(m_pMosaicUPyr);
+            PyramidShort::freeImage(m_pMosaicYPyr);
+            // The frames blended so far have had theirs freed already
+            FreeFramePyramids(frames, nsite);
             return BLEND_RET_CANCELLED;
         }
 
         mb = csite->getMb();
 
-
-        if(FillFramePyramid(mb)!=BLEND_RET_OK)
+        // Frames added incrementally already have their pyramids
+        if(mb->pyrY == NULL && FillFramePyramid(mb)!=BLEND_RET_OK)
+        {
+            PyramidShort::freeImage(m_pMosaicVPyr);
+            PyramidShort::freeImage(m_pMosaicUPyr);
+            PyramidShort::freeImage(m_pMosaicYPyr);
+            FreeFramePyramids(frames, nsite);
             return BLEND_RET_ERROR;
+        }
+
+        RunSiteBands(csite, rect, imgMos, site_idx, false);
 
-        ProcessPyramidForThisFrame(csite, mb->vcrect, mb->brect, rect, imgMos, mb->trs, site_idx);
+        FreeFramePyramids(mb);
+
+        // The frame just blended is not touched again, so it can go back to
+        // the scratch file
+        ScratchFile::release(mb->image, width * height * ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
 
         progress += TIME_PERCENT_BLEND/nsite;
 
         site_idx++;
     }
 
+    // The final blending goes through the mosaic pyramids a level at a time,
+    // so only the level being reconstructed needs to be resident
+    ScratchFile::release(m_pMosaicYPyr);
+    ScratchFile::release(m_pMosaicUPyr);
+    ScratchFile::release(m_pMosaicVPyr);
+
+
+    double t2 = now_ms();
+    m_times.pyramidMs = t2 - t1;
 
     // Blend
     PerformFinalBlending(imgMos, cropping_rect);
 
-    if (m_pMosaicVPyr) free(m_pMosaicVPyr);
-    if (m_pMosaicUPyr) free(m_pMosaicUPyr);
-    if (m_pMosaicYPyr) free(m_pMosaicYPyr);
+    PyramidShort::freeImage(m_pMosaicVPyr);
+    PyramidShort::freeImage(m_pMosaicUPyr);
+    PyramidShort::freeImage(m_pMosaicYPyr);
+
+    m_times.finalMs = now_ms() - t2;
 
     progress += TIME_PERCENT_FINAL;
 
@@ -629,8 +943,18 @@ void Blend::CropFinalMosaic(YUVinfo &imgMos, MosaicRect &cropping_rect)
 
 int Blend::PerformFinalBlending(YUVinfo &imgMos, MosaicRect &cropping_rect)
 {
-    if (!PyramidShort::BorderExpand(m_pMosaicYPyr, m_wb.nlevs, 1) || !PyramidShort::BorderExpand(m_pMosaicUPyr, m_wb.nlevsC, 1) ||
-        !PyramidShort::BorderExpand(m_pMosaicVPyr, m_wb.nlevsC, 1))
+    BlendTask task;
+    task.blend = this;
+    task.pyr[0] = m_pMosaicYPyr;
+    task.pyr[1] = m_pMosaicUPyr;
+    task.pyr[2] = m_pMosaicVPyr;
+    task.nlevs[0] = m_wb.nlevs;
+    task.nlevs[1] = task.nlevs[2] = m_wb.nlevsC;
+
+    m_workers.Run(ExpandPyramidTask, &task, 3);
+
+    if (task.ret[0] != BLEND_RET_OK || task.ret[1] != BLEND_RET_OK ||
+            task.ret[2] != BLEND_RET_OK)
     {
       LOGE("Error: Could not BorderExpand!");
       return BLEND_RET_ERROR;
@@ -797,7 +1121,8 @@ int Blend::PerformFinalBlending(YUVinfo &imgMos, MosaicRect &cropping_rect)
     return BLEND_RET_OK;
 }
 
-void Blend::ComputeMask(CSite *csite, BlendRect &vcrect, BlendRect &brect, MosaicRect &rect, YUVinfo &imgMos, int site_idx)
+void Blend::ComputeMask(CSite *csite, BlendRect &vcrect, BlendRect &brect, MosaicRect &rect, YUVinfo &imgMos, int site_idx,
+        int rowStart, int rowEnd)
 {
     PyramidShort *dptr = m_pMosaicYPyr;
 
@@ -827,6 +1152,9 @@ void Blend::ComputeMask(CSite *csite, BlendRect &vcrect, BlendRect &brect, Mosai
     else if (t >= dptr->height + BORDER)
         t = dptr->height + BORDER - 1;
 
+    if (b < rowStart) b = rowStart;
+    if (t >= rowEnd) t = rowEnd - 1;
+
     // Walk the Region of interest and populate the pyramid
     for (int j = b; j <= t; j++)
     {
@@ -867,16 +1195,18 @@ void Blend::ComputeMask(CSite *csite, BlendRect &vcrect, BlendRect &brect, Mosai
     }
 }
 
-void Blend::ProcessPyramidForThisFrame(CSite *csite, BlendRect &vcrect, BlendRect &brect, MosaicRect &rect, YUVinfo &imgMos, double trs[3][3], int site_idx)
+void Blend::ProcessPyramidForThisFrame(CSite *csite, BlendRect &vcrect, BlendRect &brect, MosaicRect &rect, YUVinfo &imgMos, double trs[3][3], int site_idx,
+        int rowStart, int rowEnd)
 {
     // Put the Region of interest (for all levels) into m_pMosaicYPyr
     double inv_trs[3][3];
     inv33d(trs, inv_trs);
 
-    // Process each pyramid level
-    PyramidShort *sptr = m_pFrameYPyr;
-    PyramidShort *suptr = m_pFrameUPyr;
-    PyramidShort *svptr = m_pFrameVPyr;
+    // Process each pyramid level, using the pyramids built during capture if any
+    MosaicFrame *mb = csite->getMb();
+    PyramidShort *sptr = (mb->pyrY != NULL) ? mb->pyrY : m_pFrameYPyr;
+    PyramidShort *suptr = (mb->pyrY != NULL) ? mb->pyrU : m_pFrameUPyr;
+    PyramidShort *svptr = (mb->pyrY != NULL) ? mb->pyrV : m_pFrameVPyr;
 
     PyramidShort *dptr = m_pMosaicYPyr;
     PyramidShort *duptr = m_pMosaicUPyr;
@@ -915,6 +1245,10 @@ void Blend::ProcessPyramidForThisFrame(CSite *csite, BlendRect &vcrect, BlendRec
         for (int j = b; j <= t; j++)
         {
             int jj = (j << dscale);
+            // Rows outside [rowStart, rowEnd) belong to another worker
+            if (jj < rowStart || jj >= rowEnd)
+                continue;
+
             double sj = jj + rect.top;
 
             for (int i = l; i <= r; i++)
@@ -24,10 +24,15 @@
 #include "MosaicTypes.h"
 #include "Pyramid.h"
 #include "Delaunay.h"
+#include "db_worker_pool.h"
 
 #define BLEND_RANGE_DEFAULT 6
 #define BORDER 8
 
+// Number of threads used for blending. 0 selects one thread per online CPU,
+// 1 runs the original single-threaded blend.
+#define BLEND_THREADS_DEFAULT 0
+
 // Percent of total mosaicing time spent on each of the following operations
 const float TIME_PERCENT_ALIGN = 20.0;
 const float TIME_PERCENT_BLEND = 75.0;
@@ -71,11 +76,44 @@ public:
   Blend();
   ~Blend();
 
-  int initialize(int blendingType, int stripType, int frame_width, int frame_height);
+  int initialize(int blendingType, int stripType, int frame_width, int frame_height,
+        int numThreads = BLEND_THREADS_DEFAULT);
 
   int runBlend(MosaicFrame **frames, MosaicFrame **rframes, int frames_size, ImageType &imageMosaicYVU,
         int &mosaicWidth, int &mosaicHeight, float &progress, bool &cancelComputation);
 
+  /**
+   *  Enables incremental blending. Frames passed to addFrame() during capture
+   *  get their Laplacian pyramids built right away, so runBlend() only has to
+   *  warp them into the mosaic. The mosaic coordinate system depends on the
+   *  last frame, so warping and seam computation still happen in runBlend().
+   *  \param budget       Maximum memory in bytes held by pyramids built ahead
+   *                      of time; frames over the budget are handled by
+   *                      runBlend() as before. 0 disables incremental blending.
+   */
+  void setIncrementalBudget(unsigned int budget);
+
+  /**
+   *  Prepares a frame accepted by the aligner for blending. The frame's
+   *  trs must already be set.
+   */
+  int addFrame(MosaicFrame *mb);
+
+  /**
+   *  Wall-clock time in milliseconds spent in each stage of blending.
+   *  prepareMs accumulates over addFrame() calls since initialize(); the
+   *  other stages cover the last runBlend().
+   */
+  struct StageTimes
+  {
+    double prepareMs;   // frame pyramids built by addFrame()
+    double maskMs;      // seam masks of all frames
+    double pyramidMs;   // frame pyramids built and merged into the mosaic
+    double finalMs;     // collapsing the mosaic pyramid and cropping
+  };
+
+  void getStageTimes(StageTimes &times) { times = m_times; }
+
 protected:
 
   PyramidShort *m_pFrameYPyr;
@@ -94,6 +132,18 @@ protected:
   // Height and width of individual frames
   int width, height;
 
+  // Threads used to blend disjoint bands of mosaic rows in parallel
+  db_WorkerPool m_workers;
+
+  // Incremental blending state
+  unsigned int m_incrementalBudget;
+  unsigned int m_incrementalUsed;
+  int m_incrementalFrames;
+  // Projected center of the last frame kept for a WIDE strip
+  double m_prevCenterX, m_prevCenterY;
+
+  StageTimes m_times;
+
    // Height and width of mosaic
   unsigned short Mwidth, Mheight;
 
@@ -105,10 +155,20 @@ protected:
   void AlignToMiddleFrame(MosaicFrame **frames, int frames_size);
 
   int  DoMergeAndBlend(MosaicFrame **frames, int nsite,  int width, int height, YUVinfo &imgMos, MosaicRect &rect, MosaicRect &cropping_rect, float &progress, bool &cancelComputation);
-  void ComputeMask(CSite *csite, BlendRect &vcrect, BlendRect &brect, MosaicRect &rect, YUVinfo &imgMos, int site_idx);
-  void ProcessPyramidForThisFrame(CSite *csite, BlendRect &vcrect, BlendRect &brect, MosaicRect &rect, YUVinfo &imgMos, double trs[3][3], int site_idx);
+  void ComputeMask(CSite *csite, BlendRect &vcrect, BlendRect &brect, MosaicRect &rect, YUVinfo &imgMos, int site_idx,
+        int rowStart, int rowEnd);
+  void ProcessPyramidForThisFrame(CSite *csite, BlendRect &vcrect, BlendRect &brect, MosaicRect &rect, YUVinfo &imgMos, double trs[3][3], int site_idx,
+        int rowStart, int rowEnd);
+
+  // Splits the rows touched by csite into one band per worker and runs
+  // ComputeMask (compute_mask true) or ProcessPyramidForThisFrame on them.
+  void RunSiteBands(CSite *csite, MosaicRect &rect, YUVinfo &imgMos, int site_idx, bool compute_mask);
 
   int  FillFramePyramid(MosaicFrame *mb);
+  unsigned int FramePyramidBytes();
+  void FreeFramePyramids(MosaicFrame *mb);
+  void FreeFramePyramids(MosaicFrame **frames, int frames_size);
+  static int FillChannelPyramid(ImageType src, PyramidShort *pyr, int nlevs, int width, int height);
 
   // TODO: need to add documentation about the parameters
   void ComputeBlendParameters(MosaicFrame **frames, int frames_size, int is360);
@@ -119,7 +179,16 @@ protected:
   void CropFinalMosaic(YUVinfo &imgMos, MosaicRect &cropping_rect);
 
 private:
+   // Worker entry points; arg points to a BlendTask (see Blend.cpp)
+   static void SiteBandTask(void *arg, int band);
+   static void FramePyramidTask(void *arg, int channel);
+   static void ExpandPyramidTask(void *arg, int channel);
+
    static const float LIMIT_SIZE_MULTIPLIER = 5.0f * 2.0f;
+   // Limit when the mosaic pyramids are backed by the scratch file
+   static const float LIMIT_SIZE_MULTIPLIER_SCRATCH = 5.0f * 8.0f;
+   // Largest mosaic side whose padded pyramid pitch still fits an unsigned short
+   static const int MAX_MOSAIC_SIZE = 65535 - 2 * BORDER - 3;
    static const float LIMIT_HEIGHT_MULTIPLIER = 2.5f;
    int MosaicSizeCheck(float sizeMultiplier, float heightMultiplier);
 };
@@ -0,0 +1,204 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+///////////////////////////////////////////////////
+// CapturePipeline.cpp
+
+#include <string.h>
+#include <sys/time.h>
+
+#include "CapturePipeline.h"
+
+#include "Log.h"
+#define LOG_TAG "CAPTURE_PIPELINE"
+
+static double now_ms()
+{
+    struct timeval res;
+    gettimeofday(&res, NULL);
+    return 1000.0 * res.tv_sec + (double) res.tv_usec / 1e3;
+}
+
+CapturePipeline::CapturePipeline()
+{
+    running = quit = false;
+    func = NULL;
+    arg = NULL;
+    numSlots = 1;
+    next = used = ready = 0;
+    memset(&stats, 0, sizeof(stats));
+
+    pthread_mutex_init(&lock, NULL);
+    pthread_cond_init(&queued, NULL);
+    pthread_cond_init(&finished, NULL);
+}
+
+CapturePipeline::~CapturePipeline()
+{
+    stop();
+
+    pthread_cond_destroy(&finished);
+    pthread_cond_destroy(&queued);
+    pthread_mutex_destroy(&lock);
+}
+
+int CapturePipeline::start(int slots, ProcessFunc processFunc, void *processArg)
+{
+    stop();
+
+    if (slots < 1)
+        slots = 1;
+    if (slots > MAX_SLOTS)
+        slots = MAX_SLOTS;
+
+    func = processFunc;
+    arg = processArg;
+    numSlots = slots;
+    next = used = ready = 0;
+    quit = false;
+
+    running = (pthread_create(&thread, NULL, threadEntry, this) == 0);
+    if (!running)
+    {
+        LOGE("Could not start the capture worker; processing frames inline");
+        return PIPELINE_RET_ERROR;
+    }
+
+    LOGV("Capture pipeline running with %d slots", numSlots);
+    return PIPELINE_RET_OK;
+}
+
+void CapturePipeline::stop()
+{
+    if (!running)
+        return;
+
+    flush();
+
+    pthread_mutex_lock(&lock);
+    quit = true;
+    pthread_cond_signal(&queued);
+    pthread_mutex_unlock(&lock);
+
+    pthread_join(thread, NULL);
+    running = false;
+}
+
+int CapturePipeline::acquireSlot()
+{
+    int slot = -1;
+
+    pthread_mutex_lock(&lock);
+    if (used < numSlots)
+    {
+        slot = (next + used) % numSlots;
+        used++;
+    }
+    else
+    {
+        stats.dropped++;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return slot;
+}
+
+void CapturePipeline::submitSlot(int slot)
+{
+    if (!running)
+    {
+        // No worker: behave like the synchronous code path
+        double t0 = now_ms();
+        func(arg, slot);
+
+        pthread_mutex_lock(&lock);
+        stats.submitted++;
+        stats.processed++;
+        stats.processMs += now_ms() - t0;
+        if (stats.maxQueued < 1)
+            stats.maxQueued = 1;
+        next = (next + 1) % numSlots;
+        used--;
+        pthread_mutex_unlock(&lock);
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    ready++;
+    stats.submitted++;
+    if (ready > stats.maxQueued)
+        stats.maxQueued = ready;
+    pthread_cond_signal(&queued);
+    pthread_mutex_unlock(&lock);
+}
+
+void CapturePipeline::flush()
+{
+    pthread_mutex_lock(&lock);
+    while (ready > 0)
+        pthread_cond_wait(&finished, &lock);
+    pthread_mutex_unlock(&lock);
+}
+
+void CapturePipeline::getStats(Stats &out)
+{
+    pthread_mutex_lock(&lock);
+    out = stats;
+    pthread_mutex_unlock(&lock);
+}
+
+void CapturePipeline::resetStats()
+{
+    pthread_mutex_lock(&lock);
+    memset(&stats, 0, sizeof(stats));
+    pthread_mutex_unlock(&lock);
+}
+
+void *CapturePipeline::threadEntry(void *pipeline)
+{
+    ((CapturePipeline *) pipeline)->workerLoop();
+    return NULL;
+}
+
+void CapturePipeline::workerLoop()
+{
+    pthread_mutex_lock(&lock);
+    while (true)
+    {
+        while (!quit && ready == 0)
+            pthread_cond_wait(&queued, &lock);
+
+        if (ready == 0)
+            break;
+
+        // Submitted slots are always the oldest acquired ones
+        int slot = next;
+        pthread_mutex_unlock(&lock);
+
+        double t0 = now_ms();
+        func(arg, slot);
+        double t1 = now_ms();
+
+        pthread_mutex_lock(&lock);
+        stats.processed++;
+        stats.processMs += t1 - t0;
+        next = (next + 1) % numSlots;
+        used--;
+        ready--;
+        pthread_cond_broadcast(&finished);
+    }
+    pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+///////////////////////////////////////////////////
+// CapturePipeline.h
+
+#ifndef CAPTURE_PIPELINE_H
+#define CAPTURE_PIPELINE_H
+
+#include <pthread.h>
+
+/**
+ *  Single producer, single consumer pipeline over a bounded ring of frame
+ *  slots. The capture thread fills a slot and submits it; a dedicated worker
+ *  thread processes the submitted slots in order. When every slot is in use
+ *  the producer is told to drop the frame instead of waiting, so the camera
+ *  callback never blocks on processing.
+ *
+ *  The pipeline only hands out slot indices; the frame buffers belong to the
+ *  caller.
+ */
+class CapturePipeline
+{
+
+public:
+
+  typedef void (*ProcessFunc)(void *arg, int slot);
+
+  static const int PIPELINE_RET_OK    = 0;
+  static const int PIPELINE_RET_ERROR = -1;
+
+  // Upper bound on the ring size
+  static const int MAX_SLOTS = 8;
+
+  typedef struct
+  {
+    int submitted;      // frames handed to the worker
+    int processed;      // frames the worker finished
+    int dropped;        // frames refused because the ring was full
+    int maxQueued;      // deepest the queue got
+    double processMs;   // total time spent in the process function
+  } Stats;
+
+  CapturePipeline();
+  ~CapturePipeline();
+
+  /**
+   *  Starts the worker thread.
+   *  \param numSlots   Number of frame slots in the ring.
+   *  \param func       Called on the worker thread for each submitted slot.
+   *  \return           PIPELINE_RET_OK, or PIPELINE_RET_ERROR if the thread
+   *                    could not be started; submitted slots are then
+   *                    processed inline.
+   */
+  int start(int numSlots, ProcessFunc func, void *arg);
+
+  /**
+   *  Processes whatever is queued and stops the worker thread.
+   */
+  void stop();
+
+  /**
+   *  Returns the next slot to fill, or -1 if the frame must be dropped.
+   *  Every slot acquired must be submitted.
+   */
+  int acquireSlot();
+
+  void submitSlot(int slot);
+
+  /**
+   *  Waits until every submitted slot has been processed.
+   */
+  void flush();
+
+  void getStats(Stats &stats);
+  void resetStats();
+
+protected:
+
+  static void *threadEntry(void *pipeline);
+  void workerLoop();
+
+  pthread_t thread;
+  bool running;
+  bool quit;
+
+  pthread_mutex_t lock;
+  pthread_cond_t queued;
+  pthread_cond_t finished;
+
+  ProcessFunc func;
+  void *arg;
+
+  // Slots [next, next + used) are acquired, in order; the first 'ready' of
+  // them have been submitted and not yet processed.
+  int numSlots;
+  int next;
+  int used;
+  int ready;
+
+  Stats stats;
+};
+
+#endif
@@ -0,0 +1,168 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// ColorConvert.cpp
+
+#include <string.h>
+
+#include "ColorConvert.h"
+
+static inline unsigned char Clamp255(int x)
+{
+    return (unsigned char) ((x < 0) ? 0 : ((x > 255) ? 255 : x));
+}
+
+// Scalar reference kernels
+
+static void RgbToYvuRowC(unsigned char *y, unsigned char *v, unsigned char *u,
+        const unsigned char *in, int step, int n)
+{
+    for (int i = 0; i < n; i++, in += step) {
+        int r = in[0], g = in[1], b = in[2];
+        y[i] = (unsigned char) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        v[i] = (unsigned char) (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        u[i] = (unsigned char) (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    }
+}
+
+static void YvuToRgbRowC(unsigned char *out, const unsigned char *y,
+        const unsigned char *v, const unsigned char *u, bool bgr, int n)
+{
+    int ri = bgr ? 2 : 0, bi = bgr ? 0 : 2;
+
+    for (int i = 0; i < n; i++, out += 3) {
+        int yy = y[i] - 16;
+        if (yy < 0) yy = 0;
+        int vv = v[i] - 128;
+        int uu = u[i] - 128;
+
+        int y1192 = 1192 * yy;
+        out[ri] = Clamp255((y1192 + 1634 * vv) >> 10);
+        out[1] = Clamp255((y1192 - 833 * vv - 400 * uu) >> 10);
+        out[bi] = Clamp255((y1192 + 2066 * uu) >> 10);
+    }
+}
+
+static void RgbToGrayRowC(unsigned char *out, const unsigned char *in, int n)
+{
+    for (int i = 0; i < n; i++, in += 3)
+        out[i] = (unsigned char) ((77 * in[0] + 151 * in[1] + 28 * in[2] + 128) >> 8);
+}
+
+static void YvuaToYvuRowC(unsigned char *y, unsigned char *v, unsigned char *u,
+        const unsigned char *in, int n)
+{
+    for (int i = 0; i < n; i++, in += 4) {
+        y[i] = in[0];
+        v[i] = in[1];
+        u[i] = in[2];
+    }
+}
+
+static void VuToVuRowC(unsigned char *v, unsigned char *u, const unsigned char *vu, int n)
+{
+    for (int i = 0; i < n; i++) {
+        v[i] = vu[i & ~1];
+        u[i] = vu[i | 1];
+    }
+}
+
+static const ColorKernels gKernelsC = {
+    RgbToYvuRowC,
+    YvuToRgbRowC,
+    RgbToGrayRowC,
+    YvuaToYvuRowC,
+    VuToVuRowC
+};
+
+// The SIMD kernels, with the scalar ones where there is no SIMD version
+static ColorKernels gKernelsMixed;
+
+static const ColorKernels *SelectKernels(bool simd)
+{
+    const ColorKernels *k = simd ? GetColorKernelsSimd() : NULL;
+    if (k == NULL)
+        return &gKernelsC;
+
+    gKernelsMixed = *k;
+    if (gKernelsMixed.rgbToYvuRow == NULL) gKernelsMixed.rgbToYvuRow = gKernelsC.rgbToYvuRow;
+    if (gKernelsMixed.yvuToRgbRow == NULL) gKernelsMixed.yvuToRgbRow = gKernelsC.yvuToRgbRow;
+    if (gKernelsMixed.rgbToGrayRow == NULL) gKernelsMixed.rgbToGrayRow = gKernelsC.rgbToGrayRow;
+    if (gKernelsMixed.yvuaToYvuRow == NULL) gKernelsMixed.yvuaToYvuRow = gKernelsC.yvuaToYvuRow;
+    if (gKernelsMixed.vuToVuRow == NULL) gKernelsMixed.vuToVuRow = gKernelsC.vuToVuRow;
+    return &gKernelsMixed;
+}
+
+const ColorKernels *ColorConvert::kernels = SelectKernels(true);
+
+void ColorConvert::setSimdEnabled(bool enable)
+{
+    kernels = SelectKernels(enable);
+}
+
+bool ColorConvert::isSimdEnabled()
+{
+    return kernels != &gKernelsC;
+}
+
+// The planes are contiguous, so the per-pixel conversions treat the whole
+// image as one long row.
+
+void ColorConvert::rgbToYvu(ImageType out, ImageType in, int width, int height, int inChannels)
+{
+    int planeSize = width * height;
+    kernels->rgbToYvuRow(out, out + planeSize, out + 2 * planeSize, in, inChannels, planeSize);
+}
+
+void ColorConvert::yvuToRgb(ImageType out, ImageType in, int width, int height, bool bgr)
+{
+    int planeSize = width * height;
+    kernels->yvuToRgbRow(out, in, in + planeSize, in + 2 * planeSize, bgr, planeSize);
+}
+
+void ColorConvert::rgbToGray(ImageType out, ImageType in, int width, int height)
+{
+    kernels->rgbToGrayRow(out, in, width * height);
+}
+
+void ColorConvert::yvuaToYvu(ImageType out, ImageType in, int width, int height)
+{
+    int planeSize = width * height;
+    kernels->yvuaToYvuRow(out, out + planeSize, out + 2 * planeSize, in, planeSize);
+}
+
+void ColorConvert::nv21ToYvu(ImageType out, ImageType in, int width, int height)
+{
+    int planeSize = width * height;
+    ImageType vuPlane = in + planeSize;
+
+    memcpy(out, in, planeSize);
+
+    // Each VU row covers two rows of the output
+    for (int j = 0; j < height; j += 2)
+    {
+        ImageType v = out + planeSize + j * width;
+        ImageType u = v + planeSize;
+
+        kernels->vuToVuRow(v, u, vuPlane + (j >> 1) * width, width);
+
+        if (j + 1 < height)
+        {
+            memcpy(v + width, v, width);
+            memcpy(u + width, u, width);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// ColorConvert.h
+
+#ifndef COLOR_CONVERT_H
+#define COLOR_CONVERT_H
+
+#include "ImageUtils.h"
+
+//  Row kernels of the color conversions. The arithmetic is fixed-point and
+//  every implementation gives bit-identical results:
+//    Y = ((66 R + 129 G + 25 B + 128) >> 8) + 16
+//    V = ((112 R - 94 G - 18 B + 128) >> 8) + 128
+//    U = ((-38 R - 74 G + 112 B + 128) >> 8) + 128
+//    R = (1192 Y' + 1634 V') >> 10, G = (1192 Y' - 833 V' - 400 U') >> 10,
+//    B = (1192 Y' + 2066 U') >> 10, clamped to [0, 255], where
+//    Y' = max(Y - 16, 0), V' = V - 128 and U' = U - 128
+//    gray = (77 R + 151 G + 28 B + 128) >> 8
+
+typedef struct
+{
+  // Interleaved RGB (step 3) or RGBA (step 4) to planar Y, V and U, n pixels
+  void (*rgbToYvuRow)(unsigned char *y, unsigned char *v, unsigned char *u,
+        const unsigned char *in, int step, int n);
+  // Planar Y, V and U to interleaved RGB, or BGR when bgr is set
+  void (*yvuToRgbRow)(unsigned char *out, const unsigned char *y,
+        const unsigned char *v, const unsigned char *u, bool bgr, int n);
+  // Interleaved RGB to gray
+  void (*rgbToGrayRow)(unsigned char *out, const unsigned char *in, int n);
+  // Interleaved YVUA to planar Y, V and U
+  void (*yvuaToYvuRow)(unsigned char *y, unsigned char *v, unsigned char *u,
+        const unsigned char *in, int n);
+  // Interleaved VU pairs at half horizontal resolution to full width V and U
+  void (*vuToVuRow)(unsigned char *v, unsigned char *u, const unsigned char *vu, int n);
+} ColorKernels;
+
+// Returns the SIMD kernels if this build and the CPU support them, or NULL
+// (see ColorConvertSimd.cpp). Kernels without a SIMD version are NULL.
+const ColorKernels *GetColorKernelsSimd();
+
+//  Whole-image conversions between the formats used by the mosaicing code.
+//  Planar YVU images hold the Y, V and U planes back to back.
+
+class ColorConvert
+{
+
+public:
+
+  // Interleaved RGB (or RGBA when inChannels is 4) to planar YVU
+  static void rgbToYvu(ImageType out, ImageType in, int width, int height, int inChannels = 3);
+
+  // Planar YVU to interleaved RGB, or BGR when bgr is set
+  static void yvuToRgb(ImageType out, ImageType in, int width, int height, bool bgr = false);
+
+  // Interleaved RGB to a single gray plane
+  static void rgbToGray(ImageType out, ImageType in, int width, int height);
+
+  // Interleaved YVUA, as read back from the GPU, to planar YVU
+  static void yvuaToYvu(ImageType out, ImageType in, int width, int height);
+
+  // NV21 (YUV420 semi-planar camera preview) to planar YVU at full resolution
+  static void nv21ToYvu(ImageType out, ImageType in, int width, int height);
+
+  // Switches between the SIMD and the scalar reference kernels; used for
+  // benchmarking and comparing the two.
+  static void setSimdEnabled(bool enable);
+  static bool isSimdEnabled();
+
+protected:
+
+  static const ColorKernels *kernels;
+};
+
+#endif
@@ -0,0 +1,347 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// ColorConvertSimd.cpp
+//
+// NEON and SSE2 versions of the color conversion row kernels, built and
+// selected the same way as PyramidSimd.cpp. Products that fit in 16 bits are
+// computed with wrapping 16-bit arithmetic, the YVU to RGB products in 32
+// bits, so the results match the reference kernels in ColorConvert.cpp.
+// There are none for RGB to gray and YVUA to YVU: the compiler does as well
+// on the scalar loops, and the hand-written SSE2 ones were measured slower.
+
+#include "ColorConvert.h"
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__SSE2__)
+
+static inline unsigned char Clamp255(int x)
+{
+    return (unsigned char) ((x < 0) ? 0 : ((x > 255) ? 255 : x));
+}
+
+// Scalar tails, identical to the reference kernels
+
+static void RgbToYvuTail(unsigned char *y, unsigned char *v, unsigned char *u,
+        const unsigned char *in, int step, int i, int n)
+{
+    for (in += i * step; i < n; i++, in += step) {
+        int r = in[0], g = in[1], b = in[2];
+        y[i] = (unsigned char) (((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        v[i] = (unsigned char) (((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        u[i] = (unsigned char) (((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    }
+}
+
+static void YvuToRgbTail(unsigned char *out, const unsigned char *y,
+        const unsigned char *v, const unsigned char *u, bool bgr, int i, int n)
+{
+    int ri = bgr ? 2 : 0, bi = bgr ? 0 : 2;
+
+    for (out += 3 * i; i < n; i++, out += 3) {
+        int yy = y[i] - 16;
+        if (yy < 0) yy = 0;
+        int vv = v[i] - 128;
+        int uu = u[i] - 128;
+
+        int y1192 = 1192 * yy;
+        out[ri] = Clamp255((y1192 + 1634 * vv) >> 10);
+        out[1] = Clamp255((y1192 - 833 * vv - 400 * uu) >> 10);
+        out[bi] = Clamp255((y1192 + 2066 * uu) >> 10);
+    }
+}
+
+static void VuToVuTail(unsigned char *v, unsigned char *u, const unsigned char *vu,
+        int i, int n)
+{
+    for (; i < n; i++) {
+        v[i] = vu[i & ~1];
+        u[i] = vu[i | 1];
+    }
+}
+
+#endif
+
+#if defined(__ARM_NEON__)
+
+static inline void RgbToYvu8(unsigned char *y, unsigned char *v, unsigned char *u,
+        uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+    uint16x8_t ty = vmull_u8(r, vdup_n_u8(66));
+    ty = vmlal_u8(ty, g, vdup_n_u8(129));
+    ty = vmlal_u8(ty, b, vdup_n_u8(25));
+    ty = vaddq_u16(ty, vdupq_n_u16(128));
+    vst1_u8(y, vadd_u8(vshrn_n_u16(ty, 8), vdup_n_u8(16)));
+
+    // The chroma sums may be negative; they wrap in 16 bits and are read
+    // back as signed
+    uint16x8_t tv = vmull_u8(r, vdup_n_u8(112));
+    tv = vmlsl_u8(tv, g, vdup_n_u8(94));
+    tv = vmlsl_u8(tv, b, vdup_n_u8(18));
+    tv = vaddq_u16(tv, vdupq_n_u16(128));
+    int16x8_t sv = vaddq_s16(vshrq_n_s16(vreinterpretq_s16_u16(tv), 8), vdupq_n_s16(128));
+    vst1_u8(v, vqmovun_s16(sv));
+
+    uint16x8_t tu = vmull_u8(b, vdup_n_u8(112));
+    tu = vmlsl_u8(tu, r, vdup_n_u8(38));
+    tu = vmlsl_u8(tu, g, vdup_n_u8(74));
+    tu = vaddq_u16(tu, vdupq_n_u16(128));
+    int16x8_t su = vaddq_s16(vshrq_n_s16(vreinterpretq_s16_u16(tu), 8), vdupq_n_s16(128));
+    vst1_u8(u, vqmovun_s16(su));
+}
+
+static void RgbToYvuRowNeon(unsigned char *y, unsigned char *v, unsigned char *u,
+        const unsigned char *in, int step, int n)
+{
+    int i = 0;
+
+    if (step == 4) {
+        for (; i + 8 <= n; i += 8) {
+            uint8x8x4_t p = vld4_u8(in + 4 * i);
+            RgbToYvu8(y + i, v + i, u + i, p.val[0], p.val[1], p.val[2]);
+        }
+    } else if (step == 3) {
+        for (; i + 8 <= n; i += 8) {
+            uint8x8x3_t p = vld3_u8(in + 3 * i);
+            RgbToYvu8(y + i, v + i, u + i, p.val[0], p.val[1], p.val[2]);
+        }
+    }
+
+    RgbToYvuTail(y, v, u, in, step, i, n);
+}
+
+// ((c0 a + c1 b) >> 10) on eight lanes, narrowed to short. The sums stay
+// within +-2^19, so the narrowed values fit.
+static inline int16x8_t Dot10(int16x8_t a, int16x8_t b, short c0, short c1)
+{
+    int32x4_t lo = vmlal_n_s16(vmull_n_s16(vget_low_s16(a), c0), vget_low_s16(b), c1);
+    int32x4_t hi = vmlal_n_s16(vmull_n_s16(vget_high_s16(a), c0), vget_high_s16(b), c1);
+    return vcombine_s16(vshrn_n_s32(lo, 10), vshrn_n_s32(hi, 10));
+}
+
+static void YvuToRgbRowNeon(unsigned char *out, const unsigned char *y,
+        const unsigned char *v, const unsigned char *u, bool bgr, int n)
+{
+    int ri = bgr ? 2 : 0, bi = bgr ? 0 : 2;
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t yy = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + i)));
+        int16x8_t vv = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + i)));
+        int16x8_t uu = vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + i)));
+        yy = vmaxq_s16(vsubq_s16(yy, vdupq_n_s16(16)), vdupq_n_s16(0));
+        vv = vsubq_s16(vv, vdupq_n_s16(128));
+        uu = vsubq_s16(uu, vdupq_n_s16(128));
+
+        int32x4_t glo = vmull_n_s16(vget_low_s16(yy), 1192);
+        int32x4_t ghi = vmull_n_s16(vget_high_s16(yy), 1192);
+        glo = vmlsl_n_s16(vmlsl_n_s16(glo, vget_low_s16(vv), 833), vget_low_s16(uu), 400);
+        ghi = vmlsl_n_s16(vmlsl_n_s16(ghi, vget_high_s16(vv), 833), vget_high_s16(uu), 400);
+
+        uint8x8x3_t p;
+        p.val[ri] = vqmovun_s16(Dot10(yy, vv, 1192, 1634));
+        p.val[1] = vqmovun_s16(vcombine_s16(vshrn_n_s32(glo, 10), vshrn_n_s32(ghi, 10)));
+        p.val[bi] = vqmovun_s16(Dot10(yy, uu, 1192, 2066));
+        vst3_u8(out + 3 * i, p);
+    }
+
+    YvuToRgbTail(out, y, v, u, bgr, i, n);
+}
+
+static void VuToVuRowNeon(unsigned char *v, unsigned char *u, const unsigned char *vu, int n)
+{
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        uint8x8x2_t p = vld2_u8(vu + i);
+        uint8x8x2_t vz = vzip_u8(p.val[0], p.val[0]);
+        uint8x8x2_t uz = vzip_u8(p.val[1], p.val[1]);
+        vst1_u8(v + i, vz.val[0]);
+        vst1_u8(v + i + 8, vz.val[1]);
+        vst1_u8(u + i, uz.val[0]);
+        vst1_u8(u + i + 8, uz.val[1]);
+    }
+
+    VuToVuTail(v, u, vu, i, n);
+}
+
+static const ColorKernels gKernelsSimd = {
+    RgbToYvuRowNeon,
+    YvuToRgbRowNeon,
+    NULL,
+    NULL,
+    VuToVuRowNeon
+};
+
+static bool CpuSupportsSimd()
+{
+    return ImageUtils::cpuHasNeon();
+}
+
+#elif defined(__SSE2__)
+
+static inline __m128i Set16(short c)
+{
+    return _mm_set1_epi16(c);
+}
+
+// Channel c of eight pixels step bytes apart, widened to shorts
+static inline __m128i Gather8(const unsigned char *p, int step, int c)
+{
+    if (step == 4) {
+        __m128i mask = _mm_set1_epi32(0xff);
+        __m128i lo = _mm_and_si128(_mm_srli_epi32(
+                _mm_loadu_si128((const __m128i *) p), 8 * c), mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi32(
+                _mm_loadu_si128((const __m128i *) (p + 16)), 8 * c), mask);
+        return _mm_packs_epi32(lo, hi);
+    }
+
+    p += c;
+    return _mm_setr_epi16(p[0], p[step], p[2 * step], p[3 * step],
+            p[4 * step], p[5 * step], p[6 * step], p[7 * step]);
+}
+
+static inline void Store8(unsigned char *p, __m128i x)
+{
+    _mm_storel_epi64((__m128i *) p, _mm_packus_epi16(x, x));
+}
+
+static void RgbToYvuRowSse2(unsigned char *y, unsigned char *v, unsigned char *u,
+        const unsigned char *in, int step, int n)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        const unsigned char *p = in + step * i;
+        __m128i r = Gather8(p, step, 0);
+        __m128i g = Gather8(p, step, 1);
+        __m128i b = Gather8(p, step, 2);
+
+        // The luma sum stays below 2^16, so a logical shift is exact
+        __m128i ty = _mm_add_epi16(_mm_mullo_epi16(r, Set16(66)), _mm_mullo_epi16(g, Set16(129)));
+        ty = _mm_add_epi16(ty, _mm_add_epi16(_mm_mullo_epi16(b, Set16(25)), Set16(128)));
+        Store8(y + i, _mm_add_epi16(_mm_srli_epi16(ty, 8), Set16(16)));
+
+        __m128i tv = _mm_sub_epi16(_mm_mullo_epi16(r, Set16(112)), _mm_mullo_epi16(g, Set16(94)));
+        tv = _mm_add_epi16(_mm_sub_epi16(tv, _mm_mullo_epi16(b, Set16(18))), Set16(128));
+        Store8(v + i, _mm_add_epi16(_mm_srai_epi16(tv, 8), Set16(128)));
+
+        __m128i tu = _mm_sub_epi16(_mm_mullo_epi16(b, Set16(112)), _mm_mullo_epi16(r, Set16(38)));
+        tu = _mm_add_epi16(_mm_sub_epi16(tu, _mm_mullo_epi16(g, Set16(74))), Set16(128));
+        Store8(u + i, _mm_add_epi16(_mm_srai_epi16(tu, 8), Set16(128)));
+    }
+
+    RgbToYvuTail(y, v, u, in, step, i, n);
+}
+
+// (c0 a + c1 b) >> 10 on eight lanes, computed in 32 bits and packed back
+// to shorts with saturation
+static inline __m128i Dot10(__m128i a, __m128i b, short c0, short c1)
+{
+    __m128i c = _mm_setr_epi16(c0, c1, c0, c1, c0, c1, c0, c1);
+    __m128i lo = _mm_srai_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), c), 10);
+    __m128i hi = _mm_srai_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(a, b), c), 10);
+    return _mm_packs_epi32(lo, hi);
+}
+
+static void YvuToRgbRowSse2(unsigned char *out, const unsigned char *y,
+        const unsigned char *v, const unsigned char *u, bool bgr, int n)
+{
+    int ri = bgr ? 2 : 0, bi = bgr ? 0 : 2;
+    __m128i zero = _mm_setzero_si128();
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i yy = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (y + i)), zero);
+        __m128i vv = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (v + i)), zero);
+        __m128i uu = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (u + i)), zero);
+        yy = _mm_max_epi16(_mm_sub_epi16(yy, Set16(16)), zero);
+        vv = _mm_sub_epi16(vv, Set16(128));
+        uu = _mm_sub_epi16(uu, Set16(128));
+
+        // G has three terms: 1192 Y' - 833 V' - 400 U', summed in 32 bits
+        __m128i c = _mm_setr_epi16(1192, -833, 1192, -833, 1192, -833, 1192, -833);
+        __m128i cu = _mm_setr_epi16(-400, 0, -400, 0, -400, 0, -400, 0);
+        __m128i glo = _mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(yy, vv), c),
+                _mm_madd_epi16(_mm_unpacklo_epi16(uu, zero), cu));
+        __m128i ghi = _mm_add_epi32(_mm_madd_epi16(_mm_unpackhi_epi16(yy, vv), c),
+                _mm_madd_epi16(_mm_unpackhi_epi16(uu, zero), cu));
+        __m128i g = _mm_packs_epi32(_mm_srai_epi32(glo, 10), _mm_srai_epi32(ghi, 10));
+
+        unsigned char ch[3][16];
+        _mm_storeu_si128((__m128i *) ch[ri], _mm_packus_epi16(Dot10(yy, vv, 1192, 1634), zero));
+        _mm_storeu_si128((__m128i *) ch[1], _mm_packus_epi16(g, zero));
+        _mm_storeu_si128((__m128i *) ch[bi], _mm_packus_epi16(Dot10(yy, uu, 1192, 2066), zero));
+
+        // SSE2 has no interleaving store
+        unsigned char *o = out + 3 * i;
+        for (int k = 0; k < 8; k++, o += 3) {
+            o[0] = ch[0][k];
+            o[1] = ch[1][k];
+            o[2] = ch[2][k];
+        }
+    }
+
+    YvuToRgbTail(out, y, v, u, bgr, i, n);
+}
+
+static void VuToVuRowSse2(unsigned char *v, unsigned char *u, const unsigned char *vu, int n)
+{
+    __m128i mask = _mm_set1_epi16(0xff);
+    int i = 0;
+
+    for (; i + 16 <= n; i += 16) {
+        __m128i p = _mm_loadu_si128((const __m128i *) (vu + i));
+        __m128i vv = _mm_and_si128(p, mask);
+        __m128i uu = _mm_srli_epi16(p, 8);
+        _mm_storeu_si128((__m128i *) (v + i), _mm_or_si128(vv, _mm_slli_epi16(vv, 8)));
+        _mm_storeu_si128((__m128i *) (u + i), _mm_or_si128(uu, _mm_slli_epi16(uu, 8)));
+    }
+
+    VuToVuTail(v, u, vu, i, n);
+}
+
+static const ColorKernels gKernelsSimd = {
+    RgbToYvuRowSse2,
+    YvuToRgbRowSse2,
+    NULL,
+    NULL,
+    VuToVuRowSse2
+};
+
+// SSE2 is part of every CPU this can be compiled for
+static bool CpuSupportsSimd()
+{
+    return true;
+}
+
+#endif
+
+const ColorKernels *GetColorKernelsSimd()
+{
+#if defined(__ARM_NEON__) || defined(__SSE2__)
+    static const bool supported = CpuSupportsSimd();
+    return supported ? &gKernelsSimd : NULL;
+#else
+    return NULL;
+#endif
+}
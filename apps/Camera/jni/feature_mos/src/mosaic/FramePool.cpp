@@ -0,0 +1,108 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+///////////////////////////////////////////////////
+// FramePool.cpp
+
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "FramePool.h"
+#include "ScratchFile.h"
+
+#include "Log.h"
+#define LOG_TAG "FRAME_POOL"
+
+FramePool::FramePool()
+{
+    block = ImageUtils::IMAGE_TYPE_NOIMAGE;
+    blockSize = frameStride = 0;
+    scratch = false;
+    width = height = count = 0;
+}
+
+FramePool::~FramePool()
+{
+    release();
+}
+
+int FramePool::initialize(int _width, int _height, int _count)
+{
+    if (block != ImageUtils::IMAGE_TYPE_NOIMAGE && _width == width &&
+            _height == height && _count == count)
+    {
+        return POOL_RET_OK;
+    }
+
+    release();
+
+    // Frames start on a page boundary so each one can be recycled on its own
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    frameStride = ((size_t) _width * _height * ImageUtils::IMAGE_TYPE_NUM_CHANNELS
+            + page - 1) & ~(page - 1);
+    blockSize = frameStride * _count;
+
+    block = (ImageType) ScratchFile::allocate(blockSize);
+    scratch = (block != ImageUtils::IMAGE_TYPE_NOIMAGE);
+
+    if (!scratch)
+    {
+        void *addr = mmap(NULL, blockSize, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (addr == MAP_FAILED)
+        {
+            LOGE("Could not reserve %d frames of %d x %d", _count, _width, _height);
+            blockSize = frameStride = 0;
+            return POOL_RET_ERROR;
+        }
+        block = (ImageType) addr;
+    }
+
+    width = _width;
+    height = _height;
+    count = _count;
+
+    LOGV("Reserved %d frames of %d x %d (%s)", count, width, height,
+            scratch ? "scratch file" : "memory");
+
+    return POOL_RET_OK;
+}
+
+void FramePool::recycle()
+{
+    if (block == ImageUtils::IMAGE_TYPE_NOIMAGE)
+        return;
+
+    if (scratch)
+        ScratchFile::discard(block);
+    else
+        madvise(block, blockSize, MADV_DONTNEED);
+}
+
+void FramePool::release()
+{
+    if (block == ImageUtils::IMAGE_TYPE_NOIMAGE)
+        return;
+
+    if (scratch)
+        ScratchFile::free(block);
+    else
+        munmap(block, blockSize);
+
+    block = ImageUtils::IMAGE_TYPE_NOIMAGE;
+    blockSize = frameStride = 0;
+    width = height = count = 0;
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+///////////////////////////////////////////////////
+// FramePool.h
+
+#ifndef FRAME_POOL_H
+#define FRAME_POOL_H
+
+#include <stddef.h>
+
+#include "ImageUtils.h"
+
+/**
+ *  Fixed set of same-sized YVU frame buffers carved from one reserved block.
+ *  The block is mapped once and kept across capture sessions: pages are only
+ *  committed when a frame is first written, and recycle() hands them back to
+ *  the system without giving up the mapping, so the next session starts
+ *  without allocating or clearing anything.
+ *
+ *  The block comes from the ScratchFile when it is open, otherwise from
+ *  anonymous memory.
+ */
+class FramePool
+{
+
+public:
+
+  static const int POOL_RET_OK    = 0;
+  static const int POOL_RET_ERROR = -1;
+
+  FramePool();
+  ~FramePool();
+
+  /**
+   *  Sizes the pool for count frames of width x height. Keeps the current
+   *  block if it already has that geometry.
+   */
+  int initialize(int width, int height, int count);
+
+  /**
+   *  Drops the physical pages of every frame; the frames stay valid but their
+   *  contents are undefined until written again.
+   */
+  void recycle();
+
+  /**
+   *  Unmaps the block.
+   */
+  void release();
+
+  inline ImageType getFrame(int index)
+  {
+      return (index >= 0 && index < count) ? block + index * frameStride :
+              ImageUtils::IMAGE_TYPE_NOIMAGE;
+  }
+
+  inline int getCount() { return count; }
+
+protected:
+
+  ImageType block;
+  size_t blockSize;
+  size_t frameStride;
+  bool scratch;
+
+  int width, height, count;
+};
+
+#endif
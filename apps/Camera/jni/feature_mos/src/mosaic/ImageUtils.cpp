@@ -21,156 +21,38 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <sys/time.h>
 
 #include "ImageUtils.h"
+#include "ColorConvert.h"
+#include "db_utilities.h"
 
 void ImageUtils::rgba2yvu(ImageType out, ImageType in, int width, int height)
 {
-  int r,g,b, a;
-  ImageType yimg = out;
-  ImageType vimg = yimg + width*height;
-  ImageType uimg = vimg + width*height;
-  ImageType image = in;
-
-  for (int ii = 0; ii < height; ii++) {
-    for (int ij = 0; ij < width; ij++) {
-      r = (*image++);
-      g = (*image++);
-      b = (*image++);
-      a = (*image++);
-
-      if (r < 0) r = 0;
-      if (r > 255) r = 255;
-      if (g < 0) g = 0;
-      if (g > 255) g = 255;
-      if (b < 0) b = 0;
-      if (b > 255) b = 255;
-
-      int val = (int) (REDY * r + GREENY * g + BLUEY * b) / 1000 + 16;
-      if (val < 0) val = 0;
-      if (val > 255) val = 255;
-      *(yimg) = val;
-
-      val = (int) (REDV * r - GREENV * g - BLUEV * b) / 1000 + 128;
-      if (val < 0) val = 0;
-      if (val > 255) val = 255;
-      *(vimg) = val;
-
-      val = (int) (-REDU * r - GREENU * g + BLUEU * b) / 1000 + 128;
-      if (val < 0) val = 0;
-      if (val > 255) val = 255;
-      *(uimg) = val;
-
-      yimg++;
-      uimg++;
-      vimg++;
-    }
-  }
+  ColorConvert::rgbToYvu(out, in, width, height, 4);
 }
 
 
 void ImageUtils::rgb2yvu(ImageType out, ImageType in, int width, int height)
 {
-  int r,g,b;
-  ImageType yimg = out;
-  ImageType vimg = yimg + width*height;
-  ImageType uimg = vimg + width*height;
-  ImageType image = in;
-
-  for (int ii = 0; ii < height; ii++) {
-    for (int ij = 0; ij < width; ij++) {
-      r = (*image++);
-      g = (*image++);
-      b = (*image++);
-
-      if (r < 0) r = 0;
-      if (r > 255) r = 255;
-      if (g < 0) g = 0;
-      if (g > 255) g = 255;
-      if (b < 0) b = 0;
-      if (b > 255) b = 255;
-
-      int val = (int) (REDY * r + GREENY * g + BLUEY * b) / 1000 + 16;
-      if (val < 0) val = 0;
-      if (val > 255) val = 255;
-      *(yimg) = val;
-
-      val = (int) (REDV * r - GREENV * g - BLUEV * b) / 1000 + 128;
-      if (val < 0) val = 0;
-      if (val > 255) val = 255;
-      *(vimg) = val;
-
-      val = (int) (-REDU * r - GREENU * g + BLUEU * b) / 1000 + 128;
-      if (val < 0) val = 0;
-      if (val > 255) val = 255;
-      *(uimg) = val;
-
-      yimg++;
-      uimg++;
-      vimg++;
-    }
-  }
+  ColorConvert::rgbToYvu(out, in, width, height, 3);
 }
 
 ImageType ImageUtils::rgb2gray(ImageType in, int width, int height)
 {
-  int r,g,b, nr, ng, nb, val;
-  ImageType gray = NULL;
-  ImageType image = in;
   ImageType out = ImageUtils::allocateImage(width, height, 1);
-  ImageType outCopy = out;
-
-  for (int ii = 0; ii < height; ii++) {
-    for (int ij = 0; ij < width; ij++) {
-      r = (*image++);
-      g = (*image++);
-      b = (*image++);
-
-      if (r < 0) r = 0;
-      if (r > 255) r = 255;
-      if (g < 0) g = 0;
-      if (g > 255) g = 255;
-      if (b < 0) b = 0;
-      if (b > 255) b = 255;
-
-      (*outCopy) = ( 0.3*r + 0.59*g + 0.11*b);
-
-      outCopy++;
-    }
-  }
+  if (out != IMAGE_TYPE_NOIMAGE)
+    ColorConvert::rgbToGray(out, in, width, height);
 
   return out;
 }
 
 ImageType ImageUtils::rgb2gray(ImageType out, ImageType in, int width, int height)
 {
-  int r,g,b, nr, ng, nb, val;
-  ImageType gray = out;
-  ImageType image = in;
-  ImageType outCopy = out;
-
-  for (int ii = 0; ii < height; ii++) {
-    for (int ij = 0; ij < width; ij++) {
-      r = (*image++);
-      g = (*image++);
-      b = (*image++);
-
-      if (r < 0) r = 0;
-      if (r > 255) r = 255;
-      if (g < 0) g = 0;
-      if (g > 255) g = 255;
-      if (b < 0) b = 0;
-      if (b > 255) b = 255;
-
-      (*outCopy) = ( 0.3*r + 0.59*g + 0.11*b);
-
-      outCopy++;
-    }
-  }
+  ColorConvert::rgbToGray(out, in, width, height);
 
   return out;
-
 }
 
 ImageType *ImageUtils::imageTypeToRowPointers(ImageType in, int width, int height)
@@ -187,94 +69,19 @@ ImageType *ImageUtils::imageTypeToRowPointers(ImageType in, int width, int heigh
   return m_rows;
 }
 
-void ImageUtils::yvu2rgb(ImageType out, ImageType in, int width, int height)
+bool ImageUtils::cpuHasNeon()
 {
-  int y,v,u, r, g, b;
-  unsigned char *yimg = in;
-  unsigned char *vimg = yimg + width*height;
-  unsigned char *uimg = vimg + width*height;
-  unsigned char *image = out;
-
-  for (int i = 0; i < height; i++) {
-    for (int j = 0; j < width; j++) {
-
-      y = (*yimg);
-      v = (*vimg);
-      u = (*uimg);
-
-      if (y < 0) y = 0;
-      if (y > 255) y = 255;
-      if (u < 0) u = 0;
-      if (u > 255) u = 255;
-      if (v < 0) v = 0;
-      if (v > 255) v = 255;
-
-      b = (int) ( 1.164*(y - 16) + 2.018*(u-128));
-      g = (int) ( 1.164*(y - 16) - 0.813*(v-128) - 0.391*(u-128));
-      r = (int) ( 1.164*(y - 16) + 1.596*(v-128));
-
-      if (r < 0) r = 0;
-      if (r > 255) r = 255;
-      if (g < 0) g = 0;
-      if (g > 255) g = 255;
-      if (b < 0) b = 0;
-      if (b > 255) b = 255;
-
-      *(image++) = r;
-      *(image++) = g;
-      *(image++) = b;
-
-      yimg++;
-      uimg++;
-      vimg++;
+  return db_CpuHasNeon();
+}
 
-    }
-  }
+void ImageUtils::yvu2rgb(ImageType out, ImageType in, int width, int height)
+{
+  ColorConvert::yvuToRgb(out, in, width, height, false);
 }
 
 void ImageUtils::yvu2bgr(ImageType out, ImageType in, int width, int height)
 {
-  int y,v,u, r, g, b;
-  unsigned char *yimg = in;
-  unsigned char *vimg = yimg + width*height;
-  unsigned char *uimg = vimg + width*height;
-  unsigned char *image = out;
-
-  for (int i = 0; i < height; i++) {
-    for (int j = 0; j < width; j++) {
-
-      y = (*yimg);
-      v = (*vimg);
-      u = (*uimg);
-
-      if (y < 0) y = 0;
-      if (y > 255) y = 255;
-      if (u < 0) u = 0;
-      if (u > 255) u = 255;
-      if (v < 0) v = 0;
-      if (v > 255) v = 255;
-
-      b = (int) ( 1.164*(y - 16) + 2.018*(u-128));
-      g = (int) ( 1.164*(y - 16) - 0.813*(v-128) - 0.391*(u-128));
-      r = (int) ( 1.164*(y - 16) + 1.596*(v-128));
-
-      if (r < 0) r = 0;
-      if (r > 255) r = 255;
-      if (g < 0) g = 0;
-      if (g > 255) g = 255;
-      if (b < 0) b = 0;
-      if (b > 255) b = 255;
-
-      *(image++) = b;
-      *(image++) = g;
-      *(image++) = r;
-
-      yimg++;
-      uimg++;
-      vimg++;
-
-    }
-  }
+  ColorConvert::yvuToRgb(out, in, width, height, true);
 }
 
 
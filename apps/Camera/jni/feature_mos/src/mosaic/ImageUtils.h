@@ -112,26 +112,16 @@ public:
   static void freeImage(ImageType image);
 
   static ImageType *imageTypeToRowPointers(ImageType out, int width, int height);
+
   /**
-   *  Get time.
+   *  Whether the CPU reports NEON support. Always false off ARM.
    */
-  static double getTime();
-
-protected:
+  static bool cpuHasNeon();
 
   /**
-  *  Constants for YVU/RGB conversion
-  */
-  static const int REDY = 257;
-  static const int REDV = 439;
-  static const int REDU = 148;
-  static const int GREENY = 504;
-  static const int GREENV = 368;
-  static const int GREENU = 291;
-  static const int BLUEY = 98;
-  static const int BLUEV = 71;
-  static const int BLUEU = 439;
-
+   *  Get time.
+   */
+  static double getTime();
 };
 
 /**
@@ -35,11 +35,15 @@ Mosaic::Mosaic()
     imageMosaicYVU = NULL;
     frames_size = 0;
     max_frames = 200;
+    frames = rframes = NULL;
+    aligner = NULL;
+    blender = NULL;
 }
 
 Mosaic::~Mosaic()
 {
-    for (int i = 0; i < frames_size; i++)
+    // Slots past frames_size may hold preallocated or rejected frames
+    for (int i = 0; frames != NULL && i < max_frames; i++)
     {
         if (frames[i])
             delete frames[i];
@@ -75,21 +79,17 @@ int Mosaic::initialize(int blendingType, int stripType, int width, int height, i
     frames = new MosaicFrame *[max_frames];
     rframes = new MosaicFrame *[max_frames];
 
-    if(nframes>-1)
+    for(int i=0; i<max_frames; i++)
     {
-        for(int i=0; i<nframes; i++)
-        {
-            frames[i] = new MosaicFrame(this->width,this->height,false); // Do no allocate memory for YUV data
-        }
+        frames[i] = NULL;
     }
-    else
+
+    if(nframes>-1)
     {
-        for(int i=0; i<max_frames; i++)
+        for(int i=0; i<nframes && i<max_frames; i++)
         {
-            frames[i] = NULL;
+            frames[i] = new MosaicFrame(this->width,this->height,false); // Do no allocate memory for YUV data
         }
-
-
     }
 
     LOGV("Initialize %d %d", width, height);
@@ -116,6 +116,12 @@ int Mosaic::initialize(int blendingType, int stripType, int width, int height, i
     return MOSAIC_RET_OK;
 }
 
+void Mosaic::setIncrementalBlending(unsigned int budget)
+{
+    if (blender != NULL)
+        blender->setIncrementalBudget(budget);
+}
+
 int Mosaic::addFrameRGB(ImageType imageRGB)
 {
     ImageType imageYVU;
@@ -170,6 +176,16 @@ int Mosaic::addFrame(ImageType imageYVU)
             default:
                 break;
         }
+
+        // Prepare accepted frames for blending while capture goes on. A
+        // failure here only means the work is left to createMosaic().
+        if (blender != NULL &&
+                (ret == MOSAIC_RET_OK || ret == MOSAIC_RET_FEW_INLIERS) &&
+                blender->addFrame(frame) != Blend::BLEND_RET_OK)
+        {
+            LOGV("Frame %d will be prepared for blending in createMosaic()",
+                    frames_size - 1);
+        }
     }
 
     return ret;
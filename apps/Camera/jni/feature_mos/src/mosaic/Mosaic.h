@@ -97,6 +97,15 @@ public:
     */
   int initialize(int blendingType, int stripType, int width, int height, int nframes = -1, bool quarter_res = false, float thresh_still = 0.0);
 
+   /*!
+    *   Enables incremental blending: each frame accepted by the aligner is
+    *   prepared for blending right away, shortening createMosaic().
+    *   Must be called after initialize() and before the first frame.
+    *   \param budget       Memory in bytes that may be held by frames prepared
+    *                       ahead of time; 0 (default) disables it.
+    */
+  void setIncrementalBlending(unsigned int budget);
+
    /*!
     *   Adds a YVU frame to the mosaic.
     *   \param imageYVU     Pointer to a YVU image.
@@ -132,6 +141,12 @@ public:
     */
   Align* getAligner() { return aligner; }
 
+    /*!
+    *   Provides access to the internal blender object pointer.
+    *   \return             Pointer to the blender object.
+    */
+  Blend* getBlender() { return blender; }
+
     /*!
     *   Obtain initialization state.
     *
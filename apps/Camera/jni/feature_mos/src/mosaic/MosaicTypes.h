@@ -25,6 +25,7 @@
 #define MOSAIC_TYPES_H
 
 #include "ImageUtils.h"
+#include "Pyramid.h"
 
 /**
  *  Definition of rectangle in a mosaic.
@@ -74,7 +75,11 @@ public:
   BlendRect vcrect; // brect clipped using the voronoi neighbors
   bool internal_allocation;
 
-  MosaicFrame() { };
+  // Laplacian pyramids of the Y, U and V planes built while capturing
+  // (see Blend::addFrame), or NULL if they are built at blending time.
+  PyramidShort *pyrY, *pyrU, *pyrV;
+
+  MosaicFrame() { pyrY = pyrU = pyrV = NULL; };
   MosaicFrame(int _width, int _height, bool allocate=true)
   {
     width = _width;
@@ -82,6 +87,7 @@ public:
     internal_allocation = allocate;
     if(internal_allocation)
         image = ImageUtils::allocateImage(width, height, ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
+    pyrY = pyrU = pyrV = NULL;
   }
 
 
@@ -90,6 +96,18 @@ public:
     if(internal_allocation)
         if (image)
         free(image);
+    freePyramids();
+  }
+
+  /**
+  *  Release the pyramids built during capture.
+  */
+  inline void freePyramids()
+  {
+    PyramidShort::freeImage(pyrY);
+    PyramidShort::freeImage(pyrU);
+    PyramidShort::freeImage(pyrV);
+    pyrY = pyrU = pyrV = NULL;
   }
 
   /**
@@ -20,19 +20,96 @@
 #include <string.h>
 
 #include "Pyramid.h"
+#include "ScratchFile.h"
+
+// Scalar reference kernels
+
+static void ReduceRowC(short *s, const short *p, int n)
+{
+    for (int w = n; w--; s++, p += 2) {
+        *s = (short)((((int) p[-2]) + ((int) p[2]) + 8 +    // 1
+                    ((((int) p[-1]) + ((int) p[1])) << 2) + // 4
+                    ((int) *p) * 6) >> 4);          // 6
+    }
+}
+
+static void ReduceColC(short *s, const short *p, int pitch, int n)
+{
+    int pitch2 = pitch << 1;
+    for (int w = n; w--; s++, p++) {
+        *s = (short)((((int) p[-pitch2]) + ((int) p[pitch2]) + 8 + // 1
+                    ((((int) p[-pitch]) + ((int) p[pitch])) << 2) + // 4
+                    ((int) *p) * 6) >> 4);              // 6
+    }
+}
+
+static void ExpandColC(short *even, short *odd, const short *prev, const short *cur,
+        const short *next, int n)
+{
+    for (int i = 0; i < n; i++) {
+        even[i] = (short) ((6 * cur[i] + (prev[i] + next[i]) + 4) >> 3);
+        odd[i] = (short) ((cur[i] + next[i] + 1) >> 1);
+    }
+}
+
+static void ExpandRowC(short *out, const short *s, int n, int mode)
+{
+    for (int i = 0; i < n; i++) {
+        int i2 = i * 2;
+        out[i2] = (short) (out[i2] +
+                (mode * ((6 * s[i] + s[i-1] + s[i+1] + 4) >> 3)));
+        out[i2+1] = (short) (out[i2+1] +
+                (mode * ((s[i] + s[i+1] + 1) >> 1)));
+    }
+}
+
+static const PyramidKernels gKernelsC = {
+    ReduceRowC,
+    ReduceColC,
+    ExpandColC,
+    ExpandRowC
+};
+
+const PyramidKernels *GetPyramidKernelsC()
+{
+    return &gKernelsC;
+}
+
+static const PyramidKernels *SelectKernels(bool simd)
+{
+    const PyramidKernels *k = simd ? GetPyramidKernelsSimd() : NULL;
+    return (k != NULL) ? k : &gKernelsC;
+}
+
+const PyramidKernels *PyramidShort::kernels = SelectKernels(true);
+
+void PyramidShort::setSimdEnabled(bool enable)
+{
+    kernels = SelectKernels(enable);
+}
+
+bool PyramidShort::isSimdEnabled()
+{
+    return kernels != &gKernelsC;
+}
 
 // We allocate the entire pyramid into one contiguous storage. This makes
 // cleanup easier than fragmented stuff. In addition, we added a "pitch"
 // field, so pointer manipulation is much simpler when it would be faster.
 PyramidShort *PyramidShort::allocatePyramidPacked(real levels,
-        real width, real height, real border)
+        real width, real height, real border, bool scratch)
 {
     real border2 = (real) (border << 1);
     int lines, size = calcStorage(width, height, border2, levels, &lines);
-
-    PyramidShort *img = (PyramidShort *) calloc(sizeof(PyramidShort) * levels
+    size_t bytes = sizeof(PyramidShort) * levels
             + sizeof(short *) * lines +
-            + sizeof(short) * size, 1);
+            + sizeof(short) * size;
+
+    PyramidShort *img = NULL;
+    if (scratch)
+        img = (PyramidShort *) ScratchFile::allocate(bytes);
+    if (img == NULL)
+        img = (PyramidShort *) calloc(bytes, 1);
 
     if (img) {
         PyramidShort *curr, *last;
@@ -88,7 +165,7 @@ PyramidShort *PyramidShort::allocateImage(real width, real height, real border)
 // Free the images
 void PyramidShort::freeImage(PyramidShort *image)
 {
-    if (image != NULL)
+    if (image != NULL && !ScratchFile::free(image))
         free(image);
 }
 
@@ -148,31 +225,26 @@ void PyramidShort::BorderSpread(PyramidShort *pyr, int left, int right,
 void PyramidShort::BorderExpandOdd(PyramidShort *in, PyramidShort *out, PyramidShort *scr,
         int mode)
 {
-    int i,j;
+    int j;
     int off = in->border / 2;
 
     // Vertical Filter
+    int first = -scr->border;
+    int count = scr->width + 2 * scr->border;
     for (j = -off; j < in->height + off; j++) {
         int j2 = j * 2;
-        for (i = -scr->border; i < scr->width + scr->border; i++) {
-            scr->ptr[j2][i] = (short)
-                ((6 * in->ptr[j][i] + (in->ptr[j-1][i] + in->ptr[j+1][i]) + 4) >> 3);
-            scr->ptr[j2+1][i] = (short)((in->ptr[j][i] + in->ptr[j+1][i] + 1) >> 1);
-        }
+        kernels->expandCol(scr->ptr[j2] + first, scr->ptr[j2+1] + first,
+                in->ptr[j-1] + first, in->ptr[j] + first, in->ptr[j+1] + first, count);
     }
 
     BorderSpread(scr, 0, 0, 3, 3);
 
-    // Horizontal Filter
-    for (i = -off; i < scr->width + off; i++) {
-        int i2 = i * 2;
-        for (j = -out->border; j < out->height + out->border; j++) {
-            out->ptr[j][i2] = (short) (out->ptr[j][i2] +
-                    (mode * ((6 * scr->ptr[j][i] +
-                              scr->ptr[j][i-1] + scr->ptr[j][i+1] + 4) >> 3)));
-            out->ptr[j][i2+1] = (short) (out->ptr[j][i2+1] +
-                    (mode * ((scr->ptr[j][i] + scr->ptr[j][i+1] + 1) >> 1)));
-        }
+    // Horizontal Filter. Every output is written once, so it is computed a
+    // row at a time.
+    first = -off;
+    count = scr->width + 2 * off;
+    for (j = -out->border; j < out->height + out->border; j++) {
+        kernels->expandRow(out->ptr[j] + 2 * first, scr->ptr[j] + first, count, mode);
     }
 
 }
@@ -218,11 +290,7 @@ void PyramidShort::BorderReduceOdd(PyramidShort *in, PyramidShort *out, PyramidS
 
     // treat it as if the whole thing were the image
     for (; s < ls; s = ns, ns += scr->pitch, p = np, np += in->pitch) {
-        for (int w = width; w--; s++, p += 2) {
-            *s = (short)((((int) p[-2]) + ((int) p[2]) + 8 +    // 1
-                        ((((int) p[-1]) + ((int) p[1])) << 2) + // 4
-                        ((int) *p) * 6) >> 4);          // 6
-        }
+        kernels->reduceRow(s, p, width);
     }
 
     BorderSpread(scr, 5, 4 + ((in->width ^ 1) & 1), 0, 0); //
@@ -235,11 +303,7 @@ void PyramidShort::BorderReduceOdd(PyramidShort *in, PyramidShort *out, PyramidS
     int pitch2 = pitch << 1;
     np = p + pitch2;
     for (; s < ls; s = ns, ns += out->pitch, p = np, np += pitch2) {
-        for (int w = out->pitch; w--; s++, p++) {
-            *s = (short)((((int) p[-pitch2]) + ((int) p[pitch2]) + 8 + // 1
-                        ((((int) p[-pitch]) + ((int) p[pitch])) << 2) + // 4
-                        ((int) *p) * 6) >> 4);              // 6
-        }
+        kernels->reduceCol(s, p, pitch, out->pitch);
     }
     BorderSpread(out, 0, 0, 5, 5);
 
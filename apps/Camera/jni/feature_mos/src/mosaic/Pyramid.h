@@ -23,6 +23,30 @@
 
 typedef unsigned short int real;
 
+//  Row kernels of the 1-4-6-4-1 reduce and expand filters. All intermediate
+//  sums are computed in 32 bits and truncated to short, exactly as the scalar
+//  code does, so every implementation gives bit-identical results.
+
+typedef struct
+{
+  // s[w] = (p[2w-2] + 4 p[2w-1] + 6 p[2w] + 4 p[2w+1] + p[2w+2] + 8) >> 4, w < n
+  void (*reduceRow)(short *s, const short *p, int n);
+  // Same filter applied down the columns of p, rows being pitch apart
+  void (*reduceCol)(short *s, const short *p, int pitch, int n);
+  // even[i] = (prev[i] + 6 cur[i] + next[i] + 4) >> 3, odd[i] = (cur[i] + next[i] + 1) >> 1
+  void (*expandCol)(short *even, short *odd, const short *prev, const short *cur,
+        const short *next, int n);
+  // out[2i] += mode * ((s[i-1] + 6 s[i] + s[i+1] + 4) >> 3),
+  // out[2i+1] += mode * ((s[i] + s[i+1] + 1) >> 1), mode being 1 or -1
+  void (*expandRow)(short *out, const short *s, int n, int mode);
+} PyramidKernels;
+
+// Returns the SIMD kernels if this build and the CPU support them, or NULL
+// (see PyramidSimd.cpp).
+const PyramidKernels *GetPyramidKernelsSimd();
+// Returns the scalar reference kernels
+const PyramidKernels *GetPyramidKernelsC();
+
 //  Structure containing a packed pyramid of type ImageTypeShort.  Used for pyramid
 //  blending, among other things.
 
@@ -37,7 +61,9 @@ public:
   real border;                      // border size
   real pitch;                       // Pitch.  Used for moving through image efficiently.
 
-  static PyramidShort *allocatePyramidPacked(real width, real height, real levels, real border = 0);
+  // With scratch set, the storage comes from the ScratchFile when it is open
+  static PyramidShort *allocatePyramidPacked(real width, real height, real levels, real border = 0,
+          bool scratch = false);
   static PyramidShort *allocateImage(real width, real height, real border);
   static void createPyramid(ImageType image, PyramidShort *pyramid, int last = 3 );
   static void freeImage(PyramidShort *image);
@@ -49,6 +75,14 @@ public:
   static int BorderExpand(PyramidShort *pyr, int nlev, int mode);
   static int BorderReduce(PyramidShort *pyr, int nlev);
   static void BorderReduceOdd(PyramidShort *in, PyramidShort *out, PyramidShort *scr);
+
+  // SIMD kernels are used whenever available; disabling them forces the
+  // scalar reference kernels. Not meant to be toggled while pyramids are built.
+  static void setSimdEnabled(bool enable);
+  static bool isSimdEnabled();
+
+private:
+  static const PyramidKernels *kernels;
 };
 
 #endif
@@ -0,0 +1,346 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// PyramidSimd.cpp
+//
+// NEON and SSE2 versions of the pyramid row kernels. On ARM this file is
+// built with NEON enabled while the rest of the library is not, so the NEON
+// kernels are only handed out after checking the CPU supports them. Each
+// kernel vectorizes the bulk of a row and leaves the tail to scalar code
+// that matches the reference kernels in Pyramid.cpp.
+
+#include "Pyramid.h"
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__ARM_NEON__) || defined(__SSE2__)
+
+static inline short ReduceTap(const short *p, int step)
+{
+    return (short)((((int) p[-2 * step]) + ((int) p[2 * step]) + 8 +
+                ((((int) p[-step]) + ((int) p[step])) << 2) +
+                ((int) *p) * 6) >> 4);
+}
+
+#endif
+
+#if defined(__ARM_NEON__)
+
+// (a + 4 (b + c) + 6 d + e + 8) >> 4 on eight lanes, truncated to short
+static inline int16x8_t Filter14641(int16x8_t a, int16x8_t b, int16x8_t c,
+        int16x8_t d, int16x8_t e)
+{
+    int32x4_t lo = vaddl_s16(vget_low_s16(a), vget_low_s16(e));
+    int32x4_t hi = vaddl_s16(vget_high_s16(a), vget_high_s16(e));
+    lo = vaddq_s32(lo, vshlq_n_s32(vaddl_s16(vget_low_s16(b), vget_low_s16(c)), 2));
+    hi = vaddq_s32(hi, vshlq_n_s32(vaddl_s16(vget_high_s16(b), vget_high_s16(c)), 2));
+    lo = vmlal_n_s16(lo, vget_low_s16(d), 6);
+    hi = vmlal_n_s16(hi, vget_high_s16(d), 6);
+    return vcombine_s16(vrshrn_n_s32(lo, 4), vrshrn_n_s32(hi, 4));
+}
+
+// (a + 6 b + c + 4) >> 3 on eight lanes, truncated to short
+static inline int16x8_t Filter161(int16x8_t a, int16x8_t b, int16x8_t c)
+{
+    int32x4_t lo = vaddl_s16(vget_low_s16(a), vget_low_s16(c));
+    int32x4_t hi = vaddl_s16(vget_high_s16(a), vget_high_s16(c));
+    lo = vmlal_n_s16(lo, vget_low_s16(b), 6);
+    hi = vmlal_n_s16(hi, vget_high_s16(b), 6);
+    return vcombine_s16(vrshrn_n_s32(lo, 3), vrshrn_n_s32(hi, 3));
+}
+
+static void ReduceRowNeon(short *s, const short *p, int n)
+{
+    int w = 0;
+
+    // The last vector reads up to p[2w+17]; keep it within p[2n-1]
+    for (; w + 8 < n; w += 8, s += 8, p += 16) {
+        int16x8x2_t m2 = vld2q_s16(p - 2);
+        int16x8x2_t c0 = vld2q_s16(p);
+        int16x8x2_t p2 = vld2q_s16(p + 2);
+        vst1q_s16(s, Filter14641(m2.val[0], m2.val[1], c0.val[1], c0.val[0], p2.val[0]));
+    }
+
+    for (; w < n; w++, s++, p += 2)
+        *s = ReduceTap(p, 1);
+}
+
+static void ReduceColNeon(short *s, const short *p, int pitch, int n)
+{
+    int pitch2 = pitch << 1;
+    int w = 0;
+
+    for (; w + 8 <= n; w += 8, s += 8, p += 8) {
+        vst1q_s16(s, Filter14641(vld1q_s16(p - pitch2), vld1q_s16(p - pitch),
+                vld1q_s16(p + pitch), vld1q_s16(p), vld1q_s16(p + pitch2)));
+    }
+
+    for (; w < n; w++, s++, p++)
+        *s = ReduceTap(p, pitch);
+}
+
+static void ExpandColNeon(short *even, short *odd, const short *prev, const short *cur,
+        const short *next, int n)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t c = vld1q_s16(cur + i);
+        int16x8_t nx = vld1q_s16(next + i);
+        vst1q_s16(even + i, Filter161(vld1q_s16(prev + i), c, nx));
+        // Halving add keeps the intermediate sum exact
+        vst1q_s16(odd + i, vrhaddq_s16(c, nx));
+    }
+
+    for (; i < n; i++) {
+        even[i] = (short) ((6 * cur[i] + (prev[i] + next[i]) + 4) >> 3);
+        odd[i] = (short) ((cur[i] + next[i] + 1) >> 1);
+    }
+}
+
+static void ExpandRowNeon(short *out, const short *s, int n, int mode)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        int16x8_t c = vld1q_s16(s + i);
+        int16x8_t nx = vld1q_s16(s + i + 1);
+        int16x8_t ev = Filter161(vld1q_s16(s + i - 1), c, nx);
+        int16x8_t od = vrhaddq_s16(c, nx);
+        int16x8x2_t o = vld2q_s16(out + 2 * i);
+        if (mode > 0) {
+            o.val[0] = vaddq_s16(o.val[0], ev);
+            o.val[1] = vaddq_s16(o.val[1], od);
+        } else {
+            o.val[0] = vsubq_s16(o.val[0], ev);
+            o.val[1] = vsubq_s16(o.val[1], od);
+        }
+        vst2q_s16(out + 2 * i, o);
+    }
+
+    for (; i < n; i++) {
+        int i2 = i * 2;
+        out[i2] = (short) (out[i2] +
+                (mode * ((6 * s[i] + s[i-1] + s[i+1] + 4) >> 3)));
+        out[i2+1] = (short) (out[i2+1] +
+                (mode * ((s[i] + s[i+1] + 1) >> 1)));
+    }
+}
+
+static const PyramidKernels gKernelsSimd = {
+    ReduceRowNeon,
+    ReduceColNeon,
+    ExpandColNeon,
+    ExpandRowNeon
+};
+
+// NEON is optional on ARMv7, so ask the kernel.
+static bool CpuSupportsSimd()
+{
+    return ImageUtils::cpuHasNeon();
+}
+
+#elif defined(__SSE2__)
+
+// Sign-extends the even and odd shorts of v into 32-bit lanes
+static inline __m128i EvenLanes(__m128i v)
+{
+    return _mm_srai_epi32(_mm_slli_epi32(v, 16), 16);
+}
+
+static inline __m128i OddLanes(__m128i v)
+{
+    return _mm_srai_epi32(v, 16);
+}
+
+// Truncates two vectors of 32-bit lanes to eight shorts
+static inline __m128i PackTruncate(__m128i lo, __m128i hi)
+{
+    return _mm_packs_epi32(EvenLanes(lo), EvenLanes(hi));
+}
+
+static inline __m128i Times6(__m128i v)
+{
+    return _mm_add_epi32(_mm_slli_epi32(v, 2), _mm_slli_epi32(v, 1));
+}
+
+// (a + 4 (b + c) + 6 d + e + 8) >> 4 on four 32-bit lanes
+static inline __m128i Filter14641(__m128i a, __m128i b, __m128i c, __m128i d, __m128i e)
+{
+    __m128i acc = _mm_add_epi32(_mm_add_epi32(a, e), _mm_set1_epi32(8));
+    acc = _mm_add_epi32(acc, _mm_slli_epi32(_mm_add_epi32(b, c), 2));
+    acc = _mm_add_epi32(acc, Times6(d));
+    return _mm_srai_epi32(acc, 4);
+}
+
+// (a + 6 b + c + 4) >> 3 on four 32-bit lanes
+static inline __m128i Filter161(__m128i a, __m128i b, __m128i c)
+{
+    __m128i acc = _mm_add_epi32(_mm_add_epi32(a, c), _mm_set1_epi32(4));
+    return _mm_srai_epi32(_mm_add_epi32(acc, Times6(b)), 3);
+}
+
+static inline __m128i Low32(__m128i v)
+{
+    return _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+}
+
+static inline __m128i High32(__m128i v)
+{
+    return _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+}
+
+static inline __m128i Load(const short *p)
+{
+    return _mm_loadu_si128((const __m128i *) p);
+}
+
+static inline void Store(short *p, __m128i v)
+{
+    _mm_storeu_si128((__m128i *) p, v);
+}
+
+// Four outputs of the horizontal reduce filter as 32-bit lanes
+static inline __m128i ReduceRow4(const short *p)
+{
+    __m128i m2 = Load(p - 2);
+    __m128i c0 = Load(p);
+    __m128i p2 = Load(p + 2);
+    return Filter14641(EvenLanes(m2), OddLanes(m2), OddLanes(c0), EvenLanes(c0),
+            EvenLanes(p2));
+}
+
+static void ReduceRowSse2(short *s, const short *p, int n)
+{
+    int w = 0;
+
+    // The last vector reads up to p[2w+17]; keep it within p[2n-1]
+    for (; w + 8 < n; w += 8, s += 8, p += 16)
+        Store(s, PackTruncate(ReduceRow4(p), ReduceRow4(p + 8)));
+
+    for (; w < n; w++, s++, p += 2)
+        *s = ReduceTap(p, 1);
+}
+
+static void ReduceColSse2(short *s, const short *p, int pitch, int n)
+{
+    int pitch2 = pitch << 1;
+    int w = 0;
+
+    for (; w + 8 <= n; w += 8, s += 8, p += 8) {
+        __m128i a = Load(p - pitch2), b = Load(p - pitch), c = Load(p + pitch);
+        __m128i d = Load(p), e = Load(p + pitch2);
+        Store(s, PackTruncate(
+                Filter14641(Low32(a), Low32(b), Low32(c), Low32(d), Low32(e)),
+                Filter14641(High32(a), High32(b), High32(c), High32(d), High32(e))));
+    }
+
+    for (; w < n; w++, s++, p++)
+        *s = ReduceTap(p, pitch);
+}
+
+// (a + b + 1) >> 1 on eight shorts without losing the carry
+static inline __m128i HalvingAdd(__m128i a, __m128i b)
+{
+    __m128i lo = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(Low32(a), Low32(b)),
+            _mm_set1_epi32(1)), 1);
+    __m128i hi = _mm_srai_epi32(_mm_add_epi32(_mm_add_epi32(High32(a), High32(b)),
+            _mm_set1_epi32(1)), 1);
+    return PackTruncate(lo, hi);
+}
+
+static inline __m128i Filter161x8(__m128i a, __m128i b, __m128i c)
+{
+    return PackTruncate(Filter161(Low32(a), Low32(b), Low32(c)),
+            Filter161(High32(a), High32(b), High32(c)));
+}
+
+static void ExpandColSse2(short *even, short *odd, const short *prev, const short *cur,
+        const short *next, int n)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i c = Load(cur + i);
+        __m128i nx = Load(next + i);
+        Store(even + i, Filter161x8(Load(prev + i), c, nx));
+        Store(odd + i, HalvingAdd(c, nx));
+    }
+
+    for (; i < n; i++) {
+        even[i] = (short) ((6 * cur[i] + (prev[i] + next[i]) + 4) >> 3);
+        odd[i] = (short) ((cur[i] + next[i] + 1) >> 1);
+    }
+}
+
+static void ExpandRowSse2(short *out, const short *s, int n, int mode)
+{
+    int i = 0;
+
+    for (; i + 8 <= n; i += 8) {
+        __m128i c = Load(s + i);
+        __m128i nx = Load(s + i + 1);
+        __m128i ev = Filter161x8(Load(s + i - 1), c, nx);
+        __m128i od = HalvingAdd(c, nx);
+        __m128i lo = _mm_unpacklo_epi16(ev, od);
+        __m128i hi = _mm_unpackhi_epi16(ev, od);
+        short *o = out + 2 * i;
+        if (mode > 0) {
+            Store(o, _mm_add_epi16(Load(o), lo));
+            Store(o + 8, _mm_add_epi16(Load(o + 8), hi));
+        } else {
+            Store(o, _mm_sub_epi16(Load(o), lo));
+            Store(o + 8, _mm_sub_epi16(Load(o + 8), hi));
+        }
+    }
+
+    for (; i < n; i++) {
+        int i2 = i * 2;
+        out[i2] = (short) (out[i2] +
+                (mode * ((6 * s[i] + s[i-1] + s[i+1] + 4) >> 3)));
+        out[i2+1] = (short) (out[i2+1] +
+                (mode * ((s[i] + s[i+1] + 1) >> 1)));
+    }
+}
+
+static const PyramidKernels gKernelsSimd = {
+    ReduceRowSse2,
+    ReduceColSse2,
+    ExpandColSse2,
+    ExpandRowSse2
+};
+
+// SSE2 is part of every CPU this can be compiled for
+static bool CpuSupportsSimd()
+{
+    return true;
+}
+
+#endif
+
+const PyramidKernels *GetPyramidKernelsSimd()
+{
+#if defined(__ARM_NEON__) || defined(__SSE2__)
+    static const bool supported = CpuSupportsSimd();
+    return supported ? &gKernelsSimd : NULL;
+#else
+    return NULL;
+#endif
+}
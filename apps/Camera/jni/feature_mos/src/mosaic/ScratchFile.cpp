@@ -0,0 +1,216 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+///////////////////////////////////////////////////
+// ScratchFile.cpp
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/mman.h>
+
+#include "ScratchFile.h"
+
+#include "Log.h"
+#define LOG_TAG "SCRATCH_FILE"
+
+typedef struct
+{
+    char *addr;
+    size_t offset;
+    size_t size;
+} ScratchBlock;
+
+// Live blocks, in allocation order. These and gFd are only accessed with
+// gLock held, except by isOpen(), as close() may run on another thread.
+static ScratchBlock gBlocks[ScratchFile::MAX_BLOCKS];
+static int gNumBlocks = 0;
+static size_t gFileEnd = 0;
+static int gFd = -1;
+static pthread_mutex_t gLock = PTHREAD_MUTEX_INITIALIZER;
+
+static inline size_t PageRound(size_t size)
+{
+    size_t page = (size_t) sysconf(_SC_PAGESIZE);
+    return (size + page - 1) & ~(page - 1);
+}
+
+// Index of the block containing ptr, or -1. Called with gLock held.
+static int FindBlock(void *ptr)
+{
+    char *p = (char *) ptr;
+    for (int i = 0; i < gNumBlocks; i++)
+    {
+        if (p >= gBlocks[i].addr && p < gBlocks[i].addr + gBlocks[i].size)
+            return i;
+    }
+    return -1;
+}
+
+int ScratchFile::open(const char *dir)
+{
+    close();
+
+    char path[512];
+    snprintf(path, sizeof(path), "%s/mosaic_scratch_XXXXXX", dir);
+
+    pthread_mutex_lock(&gLock);
+    gFd = mkstemp(path);
+    if (gFd >= 0)
+        unlink(path);
+    pthread_mutex_unlock(&gLock);
+
+    if (gFd < 0)
+    {
+        LOGE("Could not create scratch file in %s", dir);
+        return SCRATCH_RET_ERROR;
+    }
+
+    LOGV("Opened scratch file in %s", dir);
+    return SCRATCH_RET_OK;
+}
+
+void ScratchFile::close()
+{
+    pthread_mutex_lock(&gLock);
+    if (gFd >= 0)
+    {
+        for (int i = 0; i < gNumBlocks; i++)
+            munmap(gBlocks[i].addr, gBlocks[i].size);
+        gNumBlocks = 0;
+        gFileEnd = 0;
+
+        ::close(gFd);
+        gFd = -1;
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+bool ScratchFile::isOpen()
+{
+    return gFd >= 0;
+}
+
+void *ScratchFile::allocate(size_t size)
+{
+    void *addr = NULL;
+
+    pthread_mutex_lock(&gLock);
+    if (gFd >= 0 && gNumBlocks < MAX_BLOCKS)
+    {
+        size = PageRound(size);
+        size_t offset = gFileEnd;
+
+        // Growing the file hands out zero-filled pages
+        if (ftruncate(gFd, offset + size) == 0)
+        {
+            addr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, gFd, offset);
+            if (addr == MAP_FAILED)
+            {
+                addr = NULL;
+                ftruncate(gFd, gFileEnd);
+            }
+            else
+            {
+                gBlocks[gNumBlocks].addr = (char *) addr;
+                gBlocks[gNumBlocks].offset = offset;
+                gBlocks[gNumBlocks].size = size;
+                gNumBlocks++;
+                gFileEnd = offset + size;
+            }
+        }
+
+        if (addr == NULL)
+            LOGE("Could not map %d bytes of scratch file", (int) size);
+    }
+    pthread_mutex_unlock(&gLock);
+
+    return addr;
+}
+
+bool ScratchFile::free(void *ptr)
+{
+    if (ptr == NULL)
+        return false;
+
+    pthread_mutex_lock(&gLock);
+    int i = (gFd >= 0) ? FindBlock(ptr) : -1;
+    if (i >= 0)
+    {
+        munmap(gBlocks[i].addr, gBlocks[i].size);
+        gBlocks[i] = gBlocks[--gNumBlocks];
+
+        // Give back the tail of the file past the last live block. This also
+        // discards the freed data, so the space is zero-filled when reused.
+        gFileEnd = 0;
+        for (int k = 0; k < gNumBlocks; k++)
+        {
+            if (gBlocks[k].offset + gBlocks[k].size > gFileEnd)
+                gFileEnd = gBlocks[k].offset + gBlocks[k].size;
+        }
+        ftruncate(gFd, gFileEnd);
+    }
+    pthread_mutex_unlock(&gLock);
+
+    return i >= 0;
+}
+
+void ScratchFile::release(void *ptr, size_t size)
+{
+    if (ptr == NULL)
+        return;
+
+    pthread_mutex_lock(&gLock);
+    int i = (gFd >= 0) ? FindBlock(ptr) : -1;
+    if (i >= 0)
+    {
+        char *start = gBlocks[i].addr;
+        char *end = gBlocks[i].addr + gBlocks[i].size;
+
+        // Widening the range to whole pages is harmless: the mapping is
+        // shared, so dirty pages go back to the file rather than being
+        // discarded.
+        if (size > 0)
+        {
+            size_t page = (size_t) sysconf(_SC_PAGESIZE);
+            size_t lo = ((char *) ptr - start) & ~(page - 1);
+            size_t hi = PageRound(((char *) ptr - start) + size);
+            if (hi < gBlocks[i].size)
+                end = start + hi;
+            start += lo;
+        }
+
+        madvise(start, end - start, MADV_DONTNEED);
+    }
+    pthread_mutex_unlock(&gLock);
+}
+
+void ScratchFile::discard(void *ptr)
+{
+    if (ptr == NULL)
+        return;
+
+    pthread_mutex_lock(&gLock);
+    int i = (gFd >= 0) ? FindBlock(ptr) : -1;
+    if (i >= 0)
+    {
+        // Punches a hole in the file where supported
+        if (madvise(gBlocks[i].addr, gBlocks[i].size, MADV_REMOVE) != 0)
+            madvise(gBlocks[i].addr, gBlocks[i].size, MADV_DONTNEED);
+    }
+    pthread_mutex_unlock(&gLock);
+}
@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+///////////////////////////////////////////////////
+// ScratchFile.h
+
+#ifndef SCRATCH_FILE_H
+#define SCRATCH_FILE_H
+
+#include <stddef.h>
+
+/**
+ *  Memory-mapped scratch file used to keep the large mosaicing buffers
+ *  (captured frames, mosaic pyramids) out of anonymous memory. Pages of a
+ *  shared file mapping can be written back and dropped by the kernel, and
+ *  release() drops them explicitly once a buffer is not needed for a while,
+ *  so the resident size stays bounded no matter how long the sweep is.
+ *
+ *  Blocks are carved from the end of the file. Freeing the last blocks
+ *  shrinks the file again, so buffers allocated once per session followed
+ *  by per-blend temporaries reuse the same file space.
+ */
+class ScratchFile
+{
+
+public:
+
+  static const int SCRATCH_RET_OK    = 0;
+  static const int SCRATCH_RET_ERROR = -1;
+
+  // Maximum number of live allocations
+  static const int MAX_BLOCKS = 512;
+
+  /**
+   *  Creates the scratch file in the given directory. The file is unlinked
+   *  right away so it never outlives the process.
+   */
+  static int open(const char *dir);
+
+  /**
+   *  Unmaps every block and closes the file.
+   */
+  static void close();
+
+  static bool isOpen();
+
+  /**
+   *  Maps a zero-filled block of the given size, or returns NULL if the
+   *  scratch file is not open or out of space.
+   */
+  static void *allocate(size_t size);
+
+  /**
+   *  Frees a block from allocate(). Returns false, doing nothing, if ptr does
+   *  not belong to the scratch file.
+   */
+  static bool free(void *ptr);
+
+  /**
+   *  Drops the resident pages of [ptr, ptr + size), or of the whole block
+   *  containing ptr if size is 0; the contents are kept in the file and
+   *  faulted back in on the next access. No-op for memory not from the
+   *  scratch file.
+   */
+  static void release(void *ptr, size_t size = 0);
+
+  /**
+   *  Like release(), for a block whose contents are no longer needed: the
+   *  file space is given back where the file system allows it. The block
+   *  stays mapped but its contents are undefined until written again.
+   */
+  static void discard(void *ptr);
+};
+
+#endif
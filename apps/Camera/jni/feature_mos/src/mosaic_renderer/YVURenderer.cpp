@@ -34,9 +34,16 @@ const int VERTEX_STRIDE = 6 * sizeof(GLfloat);
 GLushort g_iIndices3[] = { 0, 1, 2, 3 };
 
 YVURenderer::YVURenderer() : Renderer()
+                   , mInputSizeLoc(-1)
+                   , mPlanar(false)
                    {
 }
 
+void YVURenderer::SetPlanarOutput(bool planar)
+{
+    mPlanar = planar;
+}
+
 YVURenderer::~YVURenderer() {
 }
 
@@ -44,6 +51,17 @@ bool YVURenderer::InitializeGLProgram()
 {
     bool succeeded = false;
     do {
+        // The planar shader computes rows up to 3 * height as floats, which
+        // mediump only holds exactly up to 2048
+        if (mPlanar) {
+            GLint range[2];
+            GLint precision = 0;
+            glGetShaderPrecisionFormat(GL_FRAGMENT_SHADER, GL_HIGH_FLOAT, range, &precision);
+            if (precision == 0) {
+                break;
+            }
+        }
+
         GLuint glProgram;
         glProgram = createProgram(VertexShaderSource(),
                 FragmentShaderSource());
@@ -60,6 +78,7 @@ bool YVURenderer::InitializeGLProgram()
 
         // Get sampler location
         mSamplerLoc      = glGetUniformLocation(glProgram, "s_texture");
+        mInputSizeLoc    = glGetUniformLocation(glProgram, "u_inputSize");
 
         mGlProgram = glProgram;
         succeeded = true;
@@ -97,6 +116,12 @@ bool YVURenderer::DrawTexture()
         // Set the sampler texture unit to 0
         glUniform1i(mSamplerLoc, 0);
 
+        if (mPlanar)
+        {
+            glUniform2f(mInputSizeLoc, (GLfloat) mInputTextureWidth,
+                    (GLfloat) mInputTextureHeight);
+        }
+
         // Load the vertex position
         glVertexAttribPointer(mPositionLoc, 4, GL_FLOAT,
                 GL_FALSE, VERTEX_STRIDE, g_vVertices);
@@ -137,6 +162,33 @@ const char* YVURenderer::VertexShaderSource() const
 
 const char* YVURenderer::FragmentShaderSource() const
 {
+    // Output row r holds row (r % height) of plane (r / height), Y, V then
+    // U; output column x holds input columns 4x to 4x+3. Reading the target
+    // back gives the planar YVU layout the mosaic code works on.
+    static const char gPlanarFragmentShader[] =
+        "precision highp float;\n"
+        "uniform sampler2D s_texture;\n"
+        "uniform vec2 u_inputSize;\n"
+        "const vec4 coeff_y = vec4(0.257, 0.594, 0.098, 0.063);\n"
+        "const vec4 coeff_v = vec4(0.439, -0.368, -0.071, 0.500);\n"
+        "const vec4 coeff_u = vec4(-0.148, -0.291, 0.439, 0.500);\n"
+        "void main() {\n"
+        "  float x = floor(gl_FragCoord.x) * 4.0 + 0.5;\n"
+        "  float row = floor(gl_FragCoord.y);\n"
+        "  float plane = floor((row + 0.5) / u_inputSize.y);\n"
+        "  float t = (row - plane * u_inputSize.y + 0.5) / u_inputSize.y;\n"
+        "  vec4 coeff = (plane < 0.5) ? coeff_y :\n"
+        "               ((plane < 1.5) ? coeff_v : coeff_u);\n"
+        "  gl_FragColor[0] = dot(texture2D(s_texture,\n"
+        "          vec2(x / u_inputSize.x, t)), coeff);\n"
+        "  gl_FragColor[1] = dot(texture2D(s_texture,\n"
+        "          vec2((x + 1.0) / u_inputSize.x, t)), coeff);\n"
+        "  gl_FragColor[2] = dot(texture2D(s_texture,\n"
+        "          vec2((x + 2.0) / u_inputSize.x, t)), coeff);\n"
+        "  gl_FragColor[3] = dot(texture2D(s_texture,\n"
+        "          vec2((x + 3.0) / u_inputSize.x, t)), coeff);\n"
+        "}\n";
+
     static const char gFragmentShader[] =
         "precision mediump float;\n"
         "uniform sampler2D s_texture;\n"
@@ -156,5 +208,5 @@ const char* YVURenderer::FragmentShaderSource() const
         "  gl_FragColor[3] = dot(p, coeff_y);\n"
         "}\n";
 
-    return gFragmentShader;
+    return mPlanar ? gPlanarFragmentShader : gFragmentShader;
 }
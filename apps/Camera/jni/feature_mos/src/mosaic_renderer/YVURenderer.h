@@ -20,6 +20,15 @@ class YVURenderer: public Renderer {
 
     bool DrawTexture();
 
+    // Pack the output as planar YVU instead of interleaved YVUA: each RGBA
+    // texel holds 4 horizontally adjacent samples of one plane, so the
+    // target must be (width / 4) x (3 * height) of the input texture given
+    // to SetInputTextureDimensions(). Call before InitializeGLProgram(),
+    // which fails for the planar output when the fragment shaders have no
+    // highp floats.
+    void SetPlanarOutput(bool planar);
+    bool IsPlanarOutput() const { return mPlanar; }
+
  private:
     // Source code for shaders.
     const char* VertexShaderSource() const;
@@ -31,5 +40,10 @@ class YVURenderer: public Renderer {
 
     // Sampler location
     GLint mSamplerLoc;
+
+    // Input texture size location, planar output only
+    GLint mInputSizeLoc;
+
+    bool mPlanar;
 };
 
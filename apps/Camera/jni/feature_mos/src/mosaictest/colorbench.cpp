@@ -0,0 +1,185 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// colorbench.cpp
+//
+// Measures the throughput of the ColorConvert kernels, scalar reference
+// against SIMD, in megapixels per second, and checks both give the same
+// output. Conversions with no SIMD kernel are listed as scalar only.
+//
+// Usage: mosaic_colorbench [width height [iterations]]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "mosaic/ColorConvert.h"
+
+enum
+{
+    CONV_RGB_TO_YVU,
+    CONV_RGBA_TO_YVU,
+    CONV_YVU_TO_RGB,
+    CONV_YVU_TO_BGR,
+    CONV_RGB_TO_GRAY,
+    CONV_YVUA_TO_YVU,
+    CONV_NV21_TO_YVU,
+    NUM_CONVERSIONS
+};
+
+static const char *convNames[NUM_CONVERSIONS] =
+{
+    "rgb -> yvu",
+    "rgba -> yvu",
+    "yvu -> rgb",
+    "yvu -> bgr",
+    "rgb -> gray",
+    "yvua -> yvu",
+    "nv21 -> yvu"
+};
+
+static double now_ms()
+{
+    struct timeval res;
+    gettimeofday(&res, NULL);
+    return 1000.0 * res.tv_sec + (double) res.tv_usec / 1e3;
+}
+
+static void Convert(int conv, ImageType out, ImageType in, int width, int height)
+{
+    switch (conv)
+    {
+        case CONV_RGB_TO_YVU:  ColorConvert::rgbToYvu(out, in, width, height, 3); break;
+        case CONV_RGBA_TO_YVU: ColorConvert::rgbToYvu(out, in, width, height, 4); break;
+        case CONV_YVU_TO_RGB:  ColorConvert::yvuToRgb(out, in, width, height, false); break;
+        case CONV_YVU_TO_BGR:  ColorConvert::yvuToRgb(out, in, width, height, true); break;
+        case CONV_RGB_TO_GRAY: ColorConvert::rgbToGray(out, in, width, height); break;
+        case CONV_YVUA_TO_YVU: ColorConvert::yvuaToYvu(out, in, width, height); break;
+        case CONV_NV21_TO_YVU: ColorConvert::nv21ToYvu(out, in, width, height); break;
+    }
+}
+
+// Whether the SIMD kernel table has its own kernel for the conversion
+static bool HasSimdKernel(int conv, const ColorKernels *k)
+{
+    if (k == NULL)
+        return false;
+
+    switch (conv)
+    {
+        case CONV_RGB_TO_YVU:
+        case CONV_RGBA_TO_YVU: return k->rgbToYvuRow != NULL;
+        case CONV_YVU_TO_RGB:
+        case CONV_YVU_TO_BGR:  return k->yvuToRgbRow != NULL;
+        case CONV_RGB_TO_GRAY: return k->rgbToGrayRow != NULL;
+        case CONV_YVUA_TO_YVU: return k->yvuaToYvuRow != NULL;
+        case CONV_NV21_TO_YVU: return k->vuToVuRow != NULL;
+    }
+    return false;
+}
+
+// Megapixels per second over the given number of conversions
+static double Measure(int conv, bool simd, ImageType out, ImageType in,
+        int width, int height, int iterations)
+{
+    ColorConvert::setSimdEnabled(simd);
+
+    // Warm the caches and fault in the output
+    Convert(conv, out, in, width, height);
+
+    double t0 = now_ms();
+    for (int i = 0; i < iterations; i++)
+        Convert(conv, out, in, width, height);
+    double t1 = now_ms();
+
+    return (double) width * height * iterations / ((t1 - t0) * 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+    int width = 1280, height = 720, iterations = 50;
+
+    if (argc >= 3)
+    {
+        width = atoi(argv[1]);
+        height = atoi(argv[2]);
+    }
+    if (argc >= 4)
+        iterations = atoi(argv[3]);
+
+    if (width <= 0 || height <= 0 || iterations <= 0)
+    {
+        fprintf(stderr, "Usage: %s [width height [iterations]]\n", argv[0]);
+        return 1;
+    }
+
+    // Large enough for every input and output format
+    int size = width * height * 4;
+    ImageType in = ImageUtils::allocateImage(width, height, 4);
+    ImageType outC = ImageUtils::allocateImage(width, height, 4);
+    ImageType outSimd = ImageUtils::allocateImage(width, height, 4);
+    if (in == NULL || outC == NULL || outSimd == NULL)
+    {
+        fprintf(stderr, "Could not allocate %d x %d images\n", width, height);
+        return 1;
+    }
+
+    srand(1);
+    for (int i = 0; i < size; i++)
+        in[i] = (unsigned char) (rand() & 0xff);
+
+    ColorConvert::setSimdEnabled(true);
+    bool haveSimd = ColorConvert::isSimdEnabled();
+    const ColorKernels *simdKernels = GetColorKernelsSimd();
+
+    printf("%d x %d, %d iterations, SIMD %s\n", width, height, iterations,
+            haveSimd ? "available" : "not available");
+    printf("%-14s %12s %12s %8s\n", "conversion", "scalar MP/s", "simd MP/s", "speedup");
+
+    int mismatches = 0;
+    for (int conv = 0; conv < NUM_CONVERSIONS; conv++)
+    {
+        double mpsC = Measure(conv, false, outC, in, width, height, iterations);
+
+        if (!haveSimd)
+        {
+            printf("%-14s %12.1f %12s %8s\n", convNames[conv], mpsC, "-", "-");
+            continue;
+        }
+
+        // Both settings run the same scalar kernel
+        if (!HasSimdKernel(conv, simdKernels))
+        {
+            printf("%-14s %12.1f %12s %8s\n", convNames[conv], mpsC, "scalar only", "-");
+            continue;
+        }
+
+        double mpsSimd = Measure(conv, true, outSimd, in, width, height, iterations);
+        bool same = memcmp(outC, outSimd, size) == 0;
+        if (!same)
+            mismatches++;
+
+        printf("%-14s %12.1f %12.1f %7.2fx%s\n", convNames[conv], mpsC, mpsSimd,
+                mpsSimd / mpsC, same ? "" : "  MISMATCH");
+    }
+
+    ImageUtils::freeImage(outSimd);
+    ImageUtils::freeImage(outC);
+    ImageUtils::freeImage(in);
+
+    return (mismatches == 0) ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// pyramidtest.cpp
+//
+// Checks that the SIMD pyramid reduce and expand kernels give exactly the
+// results of the scalar ones, kernel by kernel on random rows of every
+// length and alignment, and through a whole Laplacian pyramid build and
+// reconstruction. Exits with 0 when everything agrees or no SIMD is
+// available.
+//
+// Usage: mosaic_pyramidtest [width height]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "mosaic/Pyramid.h"
+
+static const int KERNEL_TRIALS = 2000;
+static const int MAX_ROW = 96;
+// Room on each side of a row for the filter taps and the alignment offsets
+static const int PAD = 16;
+static const int PYRAMID_LEVELS = 4;
+static const int PYRAMID_BORDER = 16;
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what, int trial)
+{
+    if (!ok)
+    {
+        if (failures < 20)
+            printf("MISMATCH %s (trial %d)\n", what, trial);
+        failures++;
+    }
+}
+
+// Full range values half of the time, pixel and Laplacian range values
+// otherwise
+static void FillRandom(short *p, int n, bool fullRange)
+{
+    for (int i = 0; i < n; i++)
+    {
+        p[i] = fullRange ? (short) (rand() & 0xffff) : (short) ((rand() % 1024) - 512);
+    }
+}
+
+static void TestKernels(const PyramidKernels *c, const PyramidKernels *simd)
+{
+    static const int PITCH = 2 * MAX_ROW + 2 * PAD;
+    short src[5 * PITCH];
+    short outC[2 * MAX_ROW + 2 * PAD], outS[2 * MAX_ROW + 2 * PAD];
+    short oddC[2 * MAX_ROW + 2 * PAD], oddS[2 * MAX_ROW + 2 * PAD];
+
+    for (int t = 0; t < KERNEL_TRIALS; t++)
+    {
+        int n = 1 + rand() % MAX_ROW;
+        int align = rand() % 8;
+        int mode = (rand() & 1) ? 1 : -1;
+        FillRandom(src, 5 * PITCH, (t & 1) != 0);
+
+        // Reduce along a row: reads p[-2] to p[2n]
+        const short *p = src + PAD + align;
+        memset(outC, 0x55, sizeof(outC));
+        memset(outS, 0x55, sizeof(outS));
+        c->reduceRow(outC + align, p, n);
+        simd->reduceRow(outS + align, p, n);
+        Check(memcmp(outC, outS, sizeof(outC)) == 0, "reduceRow", t);
+
+        // Reduce down the columns of five rows, the middle one being p
+        p = src + 2 * PITCH + PAD + align;
+        memset(outC, 0x55, sizeof(outC));
+        memset(outS, 0x55, sizeof(outS));
+        c->reduceCol(outC + align, p, PITCH, n);
+        simd->reduceCol(outS + align, p, PITCH, n);
+        Check(memcmp(outC, outS, sizeof(outC)) == 0, "reduceCol", t);
+
+        // Expand down the columns of three rows
+        memset(outC, 0x55, sizeof(outC));
+        memset(outS, 0x55, sizeof(outS));
+        memset(oddC, 0x33, sizeof(oddC));
+        memset(oddS, 0x33, sizeof(oddS));
+        c->expandCol(outC + align, oddC + align, src + PAD + align, src + PITCH + PAD + align,
+                src + 2 * PITCH + PAD + align, n);
+        simd->expandCol(outS + align, oddS + align, src + PAD + align,
+                src + PITCH + PAD + align, src + 2 * PITCH + PAD + align, n);
+        Check(memcmp(outC, outS, sizeof(outC)) == 0 && memcmp(oddC, oddS, sizeof(oddC)) == 0,
+                "expandCol", t);
+
+        // Expand along a row, adding to or subtracting from 2n outputs:
+        // reads s[-1] to s[n]
+        FillRandom(outC, 2 * MAX_ROW + 2 * PAD, (t & 2) != 0);
+        memcpy(outS, outC, sizeof(outS));
+        c->expandRow(outC + PAD + align, src + PAD + align, n, mode);
+        simd->expandRow(outS + PAD + align, src + PAD + align, n, mode);
+        Check(memcmp(outC, outS, sizeof(outC)) == 0, "expandRow", t);
+    }
+}
+
+// Builds the Laplacian pyramid of a random image the way Blend does, then
+// reconstructs the image from it
+static PyramidShort *BuildPyramid(const unsigned char *image, int w, int h, bool simd)
+{
+    PyramidShort::setSimdEnabled(simd);
+
+    PyramidShort *pyr = PyramidShort::allocatePyramidPacked(PYRAMID_LEVELS,
+            (unsigned short) w, (unsigned short) h, PYRAMID_BORDER);
+    if (pyr == NULL)
+        return NULL;
+
+    for (int i = 0; i < h; i++)
+    {
+        short *row = pyr->ptr[i];
+        for (int j = 0; j < w; j++)
+            row[j] = image[i * w + j];
+    }
+
+    PyramidShort::BorderReduce(pyr, PYRAMID_LEVELS);
+    PyramidShort::BorderExpand(pyr, PYRAMID_LEVELS, -1);
+    return pyr;
+}
+
+static bool SamePyramids(PyramidShort *a, PyramidShort *b)
+{
+    for (int l = 0; l < PYRAMID_LEVELS; l++)
+    {
+        for (int i = -a[l].border; i < a[l].height + a[l].border; i++)
+        {
+            if (memcmp(a[l].ptr[i] - a[l].border, b[l].ptr[i] - b[l].border,
+                    a[l].pitch * sizeof(short)) != 0)
+                return false;
+        }
+    }
+    return true;
+}
+
+static void TestPyramid(int w, int h)
+{
+    unsigned char *image = new unsigned char[w * h];
+    for (int i = 0; i < w * h; i++)
+        image[i] = (unsigned char) (rand() & 0xff);
+
+    PyramidShort *pc = BuildPyramid(image, w, h, false);
+    PyramidShort *ps = BuildPyramid(image, w, h, true);
+    if (pc == NULL || ps == NULL)
+    {
+        printf("Could not allocate the pyramids\n");
+        failures++;
+    }
+    else
+    {
+        Check(SamePyramids(pc, ps), "Laplacian pyramid", 0);
+
+        PyramidShort::setSimdEnabled(false);
+        PyramidShort::BorderExpand(pc, PYRAMID_LEVELS, 1);
+        PyramidShort::setSimdEnabled(true);
+        PyramidShort::BorderExpand(ps, PYRAMID_LEVELS, 1);
+        Check(SamePyramids(pc, ps), "reconstruction", 0);
+    }
+
+    PyramidShort::freeImage(ps);
+    PyramidShort::freeImage(pc);
+    delete [] image;
+}
+
+int main(int argc, char *argv[])
+{
+    int w = 320, h = 240;
+
+    if (argc >= 3)
+    {
+        w = atoi(argv[1]);
+        h = atoi(argv[2]);
+    }
+    if (w < 64 || h < 64)
+    {
+        fprintf(stderr, "Usage: %s [width height], at least 64 x 64\n", argv[0]);
+        return 1;
+    }
+
+    const PyramidKernels *simd = GetPyramidKernelsSimd();
+    if (simd == NULL)
+    {
+        printf("No SIMD pyramid kernels on this CPU, nothing to compare\n");
+        return 0;
+    }
+
+    srand(1);
+    TestKernels(GetPyramidKernelsC(), simd);
+    TestPyramid(w, h);
+    // Odd sizes leave a partial vector at the end of every row
+    TestPyramid(w + 13, h + 7);
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -22,11 +22,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <sys/time.h>
+#include <limits.h>
+#include <pthread.h>
 #include <db_utilities_camera.h>
 
 #include "mosaic/AlignFeatures.h"
 #include "mosaic/Blend.h"
+#include "mosaic/CapturePipeline.h"
+#include "mosaic/ColorConvert.h"
+#include "mosaic/FramePool.h"
 #include "mosaic/Mosaic.h"
+#include "mosaic/ScratchFile.h"
 #include "mosaic/Log.h"
 #define LOG_TAG "FEATURE_MOS_JNI"
 
@@ -39,6 +46,10 @@ extern "C" {
 char buffer[1024];
 
 const int MAX_FRAMES = 100;
+// Captured frames waiting to be aligned
+const int CAPTURE_SLOTS = 3;
+// Pool frame the GPU reads the next preview frame into
+const int READBACK_FRAME = MAX_FRAMES + CAPTURE_SLOTS;
 
 static double mTx;
 
@@ -46,10 +57,30 @@ int tWidth[NR];
 int tHeight[NR];
 
 ImageType tImage[NR][MAX_FRAMES];// = {{ImageUtils::IMAGE_TYPE_NOIMAGE}}; // YVU24 format image
+// Backing store of tImage and captureImage, kept from one capture session
+// to the next
+FramePool framePool[NR];
+// Frames handed to the alignment worker. A slot's buffers are swapped into
+// tImage when its frame is kept, so frame data is never copied.
+ImageType captureImage[NR][CAPTURE_SLOTS];
+CapturePipeline capturePipeline;
 Mosaic *mosaic[NR] = {NULL,NULL};
 ImageType resultYVU = ImageUtils::IMAGE_TYPE_NOIMAGE;
 ImageType resultBGR = ImageUtils::IMAGE_TYPE_NOIMAGE;
-float gTRS[11]; // 9 elements of the transformation, 1 for frame-number, 1 for alignment error code.
+// 9 elements of the transformation, 1 for frame-number, 1 for alignment error code, 1 for
+// the capture time of the frame it was aligned from, in ms since reset, or -1 before the first.
+const int TRS_SIZE = 12;
+const int TRS_TIME = 11;
+float gTRS[TRS_SIZE];
+// Translation and capture time of the kept frame before the one in gTRS,
+// to extrapolate the preview transformation to the current frame
+float gPrevTx = 0.0f, gPrevTy = 0.0f, gPrevTime = -1.0f;
+// Guards gTRS, gPrev* and the frame counters, which the alignment worker
+// updates
+pthread_mutex_t gTRS_lock = PTHREAD_MUTEX_INITIALIZER;
+// Start of the capture session, and when the frame in each slot was captured
+double gCaptureStartMs = 0.0;
+float captureTimeMs[CAPTURE_SLOTS];
 // Variables to keep track of the mosaic computation progress for both LR & HR.
 float gProgress[NR];
 // Variables to be able to cancel the mosaic computation when the GUI says so.
@@ -66,6 +97,13 @@ int stripType = Blend::STRIP_TYPE_THIN;
 bool high_res = false;
 bool quarter_res[NR] = {false,false};
 float thresh_still[NR] = {5.0f,0.0f};
+// Memory that may be spent preparing frames for blending during capture.
+// Only the low-res mosaic is aligned while capturing, so the high-res one
+// gains nothing from it.
+unsigned int incremental_budget[NR] = {32 << 20, 0};
+// Directory for the scratch file backing the frame buffers and mosaic
+// pyramids, or empty to keep them all in memory.
+char scratch_dir[PATH_MAX] = "";
 
 /* return current time in milliseconds*/
 
@@ -110,6 +148,7 @@ int Init(int mID, int nmax)
         {
                 mosaic[mID]->initialize(blendingType, stripType, tWidth[mID], tHeight[mID],
                         nmax, quarter_res[mID], thresh_still[mID]);
+                mosaic[mID]->setIncrementalBlending(incremental_budget[mID]);
         }
 
         t1 = now_ms();
@@ -170,6 +209,10 @@ int AddFrame(int mID, int k, float* trs1d)
 
     int ret_code = mosaic[mID]->addFrame(tImage[mID][k]);
 
+    // The frame is only read again when blending
+    ScratchFile::release(tImage[mID][k],
+            tWidth[mID] * tHeight[mID] * ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
+
     mosaic[mID]->getAligner()->getLastTRS(trs);
 
     if(trs1d!=NULL)
@@ -208,73 +251,90 @@ int Finalize(int mID)
 
 void YUV420toYVU24(ImageType yvu24, ImageType yuv420sp, int width, int height)
 {
-    int frameSize = width * height;
-
-    ImageType oyp = yvu24;
-    ImageType ovp = yvu24+frameSize;
-    ImageType oup = yvu24+frameSize+frameSize;
-
-    for (int j = 0, yp = 0; j < height; j++)
-    {
-        unsigned char u = 0, v = 0;
-        int uvp = frameSize + (j >> 1) * width;
-        for (int i = 0; i < width; i++, yp++)
-        {
-            *oyp++ = yuv420sp[yp];
-            //int y = (0xff & (int)yuv420sp[yp]) -16;
-            //yvu24p[yp] = (y<0)?0:y;
-
-            if ((i & 1) == 0)
-            {
-                v = yuv420sp[uvp++];
-                u = yuv420sp[uvp++];
-            }
-
-            *ovp++ = v;
-            *oup++ = u;
-        }
-    }
+    ColorConvert::nv21ToYvu(yvu24, yuv420sp, width, height);
 }
 
 void YUV420toYVU24_NEW(ImageType yvu24, ImageType yuv420sp, int width,
         int height)
 {
-    int frameSize = width * height;
+    ColorConvert::nv21ToYvu(yvu24, yuv420sp, width, height);
+}
+
+
+// Runs on the capture worker thread: aligns the frame in the given slot and
+// keeps it as the next frame of the low-res mosaic if alignment succeeds.
+static void AlignCapturedFrame(void *arg, int slot)
+{
+    // Only this thread changes the counters while capturing
+    int k = frame_number_LR;
 
-    ImageType oyp = yvu24;
-    ImageType ovp = yvu24 + frameSize;
-    ImageType oup = yvu24 + frameSize + frameSize;
+    // Frames queued before the limit was reached
+    if(k >= MAX_FRAMES || frame_number_HR >= MAX_FRAMES)
+        return;
 
-    memcpy(yvu24, yuv420sp, frameSize * sizeof(unsigned char));
+    ImageType image = tImage[LR][k];
+    tImage[LR][k] = captureImage[LR][slot];
+    captureImage[LR][slot] = image;
 
-    for (int j = 0; j < height; j += 2)
-    {
-        unsigned char u = 0, v = 0;
-        int uvp = frameSize + (j >> 1) * width;
-        ovp = yvu24 + frameSize + j * width;
-        oup = ovp + frameSize;
+    image = tImage[HR][k];
+    tImage[HR][k] = captureImage[HR][slot];
+    captureImage[HR][slot] = image;
 
-        ImageType iuvp = yuv420sp + uvp;
+    float trs[9];
+    int ret_code = AddFrame(LR, k, trs);
 
-        for (int i = 0; i < width; i += 2)
+    pthread_mutex_lock(&gTRS_lock);
+    if(ret_code == Mosaic::MOSAIC_RET_OK || ret_code == Mosaic::MOSAIC_RET_FEW_INLIERS)
+    {
+        frame_number_LR++;
+        frame_number_HR++;
+        if(gTRS[TRS_TIME] >= 0.0f)
         {
-            v = *iuvp++;
-            u = *iuvp++;
+            gPrevTx = gTRS[2];
+            gPrevTy = gTRS[5];
+            gPrevTime = gTRS[TRS_TIME];
+        }
+    }
+    memcpy(gTRS, trs, sizeof(trs));
+    gTRS[9] = frame_number_HR;
+    gTRS[10] = ret_code;
+    gTRS[TRS_TIME] = captureTimeMs[slot];
+    pthread_mutex_unlock(&gTRS_lock);
+}
+
+static void LogCaptureStats()
+{
+    CapturePipeline::Stats stats;
+    capturePipeline.getStats(stats);
 
-            *ovp++ = v;
-            *oup++ = u;
+    if(stats.submitted > 0 || stats.dropped > 0)
+    {
+        LOGV("Capture: %d frames aligned, %d dropped on a full queue, "
+                "max queue depth %d, %g ms per alignment", stats.processed,
+                stats.dropped, stats.maxQueued,
+                stats.processMs / (stats.processed > 0 ? stats.processed : 1));
+    }
+    capturePipeline.resetStats();
+}
 
-            *ovp++ = v;
-            *oup++ = u;
+JNIEXPORT void JNICALL Java_com_android_camera_panorama_Mosaic_setScratchDirectory(
+        JNIEnv* env, jobject thiz, jstring path)
+{
+    scratch_dir[0] = '\0';
 
+    if (path != NULL)
+    {
+        const char *dir = env->GetStringUTFChars(path, NULL);
+        if (dir != NULL)
+        {
+            strncpy(scratch_dir, dir, sizeof(scratch_dir) - 1);
+            scratch_dir[sizeof(scratch_dir) - 1] = '\0';
+            env->ReleaseStringUTFChars(path, dir);
         }
-        memcpy(ovp, ovp - width, width * sizeof(unsigned char));
-        memcpy(oup, oup - width, width * sizeof(unsigned char));
     }
 }
 
-
-JNIEXPORT void JNICALL Java_com_android_camera_panorama_Mosaic_allocateMosaicMemory(
+JNIEXPORT jboolean JNICALL Java_com_android_camera_panorama_Mosaic_allocateMosaicMemory(
         JNIEnv* env, jobject thiz, jint width, jint height)
 {
     tWidth[HR] = width;
@@ -282,25 +342,53 @@ JNIEXPORT void JNICALL Java_com_android_camera_panorama_Mosaic_allocateMosaicMem
     tWidth[LR] = int(width / H2L_FACTOR);
     tHeight[LR] = int(height / H2L_FACTOR);
 
+    // The scratch file lives as long as the frame pools it may back.
+    // Anything it cannot hold falls back to memory.
+    if (scratch_dir[0] != '\0' && !ScratchFile::isOpen())
+        ScratchFile::open(scratch_dir);
+
+    // Instant when the pools already have this size
+    if (framePool[LR].initialize(tWidth[LR], tHeight[LR], READBACK_FRAME + 1) !=
+            FramePool::POOL_RET_OK ||
+            framePool[HR].initialize(tWidth[HR], tHeight[HR], READBACK_FRAME + 1) !=
+            FramePool::POOL_RET_OK)
+    {
+        LOGE("Could not allocate the mosaic frames of %d x %d", width, height);
+        return JNI_FALSE;
+    }
+
     for(int i=0; i<MAX_FRAMES; i++)
     {
-            tImage[LR][i] = ImageUtils::allocateImage(tWidth[LR], tHeight[LR],
-                    ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
-            tImage[HR][i] = ImageUtils::allocateImage(tWidth[HR], tHeight[HR],
-                    ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
+            tImage[LR][i] = framePool[LR].getFrame(i);
+            tImage[HR][i] = framePool[HR].getFrame(i);
+    }
+
+    for(int i=0; i<CAPTURE_SLOTS; i++)
+    {
+            captureImage[LR][i] = framePool[LR].getFrame(MAX_FRAMES + i);
+            captureImage[HR][i] = framePool[HR].getFrame(MAX_FRAMES + i);
     }
 
+    capturePipeline.start(CAPTURE_SLOTS, AlignCapturedFrame, NULL);
+
     AllocateTextureMemory(tWidth[HR], tHeight[HR], tWidth[LR], tHeight[LR]);
+
+    sem_wait(&gPreviewImage_semaphore);
+    gPreviewPlanarImage[LR] = framePool[LR].getFrame(READBACK_FRAME);
+    gPreviewPlanarImage[HR] = framePool[HR].getFrame(READBACK_FRAME);
+    sem_post(&gPreviewImage_semaphore);
+
+    return JNI_TRUE;
 }
 
 JNIEXPORT void JNICALL Java_com_android_camera_panorama_Mosaic_freeMosaicMemory(
         JNIEnv* env, jobject thiz)
 {
-    for(int i = 0; i < MAX_FRAMES; i++)
-    {
-        ImageUtils::freeImage(tImage[LR][i]);
-        ImageUtils::freeImage(tImage[HR][i]);
-    }
+    capturePipeline.stop();
+
+    // Keep the pools mapped for the next session, but give their pages back
+    framePool[LR].recycle();
+    framePool[HR].recycle();
 
     FreeTextureMemory();
 }
@@ -309,37 +397,7 @@ JNIEXPORT void JNICALL Java_com_android_camera_panorama_Mosaic_freeMosaicMemory(
 void decodeYUV444SP(unsigned char* rgb, unsigned char* yuv420sp, int width,
         int height)
 {
-    int frameSize = width * height;
-
-    for (int j = 0, yp = 0; j < height; j++)
-    {
-        int vp = frameSize + j * width, u = 0, v = 0;
-        int up = vp + frameSize;
-
-        for (int i = 0; i < width; i++, yp++, vp++, up++)
-        {
-            int y = (0xff & ((int) yuv420sp[yp])) - 16;
-            if (y < 0) y = 0;
-
-            v = (0xff & yuv420sp[vp]) - 128;
-            u = (0xff & yuv420sp[up]) - 128;
-
-            int y1192 = 1192 * y;
-            int r = (y1192 + 1634 * v);
-            int g = (y1192 - 833 * v - 400 * u);
-            int b = (y1192 + 2066 * u);
-
-            if (r < 0) r = 0; else if (r > 262143) r = 262143;
-            if (g < 0) g = 0; else if (g > 262143) g = 262143;
-            if (b < 0) b = 0; else if (b > 262143) b = 262143;
-
-            //rgb[yp] = 0xff000000 | ((r << 6) & 0xff0000) | ((g >> 2) & 0xff00) | ((b >> 10) & 0xff);
-            int p = j*width*3+i*3;
-            rgb[p+0] = (r<<6 & 0xFF0000)>>16;
-            rgb[p+1] = (g>>2 & 0xFF00)>>8;
-            rgb[p+2] =  b>>10 & 0xFF;
-        }
-    }
+    ColorConvert::yvuToRgb(rgb, yuv420sp, width, height);
 }
 
 static int count = 0;
@@ -347,68 +405,105 @@ static int count = 0;
 void ConvertYVUAiToPlanarYVU(unsigned char *planar, unsigned char *in, int width,
         int height)
 {
-    int planeSize = width * height;
-    unsigned char* Yptr = planar;
-    unsigned char* Vptr = planar + planeSize;
-    unsigned char* Uptr = Vptr + planeSize;
+    ColorConvert::yvuaToYvu(planar, in, width, height);
+}
 
-    for (int i = 0; i < planeSize; i++)
-    {
-        *Yptr++ = *in++;
-        *Vptr++ = *in++;
-        *Uptr++ = *in++;
-        in++;   // Alpha
-    }
+// Whether another frame may be captured. Frames still in the pipeline may
+// fill the remaining slots; the worker drops whatever does not fit.
+static bool FramesAvailable()
+{
+    pthread_mutex_lock(&gTRS_lock);
+    bool available = (frame_number_HR < MAX_FRAMES && frame_number_LR < MAX_FRAMES);
+    pthread_mutex_unlock(&gTRS_lock);
+
+    return available;
 }
 
-JNIEXPORT jfloatArray JNICALL Java_com_android_camera_panorama_Mosaic_setSourceImageFromGPU(
-        JNIEnv* env, jobject thiz)
+// Returns the latest alignment result to Java, with the capture time of the
+// frame it belongs to: frames still in the pipeline are not reflected yet.
+// The renderer draws the current frame, so it gets the translation moved on
+// at the rate of the last two kept frames, to the current time.
+static jfloatArray ReportLatestTRS(JNIEnv* env)
 {
-    double  t0, t1, time_c;
-    t0 = now_ms();
-    int ret_code;
+    float trs[TRS_SIZE];
+    float warp[9];
 
-    if(frame_number_HR<MAX_FRAMES && frame_number_LR<MAX_FRAMES)
+    pthread_mutex_lock(&gTRS_lock);
+    if(frame_number_HR >= MAX_FRAMES || frame_number_LR >= MAX_FRAMES)
+    {
+        gTRS[1] = gTRS[2] = gTRS[3] = gTRS[5] = gTRS[6] = gTRS[7] = 0.0f;
+        gTRS[0] = gTRS[4] = gTRS[8] = 1.0f;
+        gPrevTime = -1.0f;
+    }
+    memcpy(trs, gTRS, sizeof(trs));
+    memcpy(warp, gTRS, sizeof(warp));
+    if(gPrevTime >= 0.0f && trs[TRS_TIME] > gPrevTime)
     {
-        double last_tx = mTx;
+        float elapsed = (float) (now_ms() - gCaptureStartMs) - trs[TRS_TIME];
+        float scale = elapsed / (trs[TRS_TIME] - gPrevTime);
+        warp[2] += (trs[2] - gPrevTx) * scale;
+        warp[5] += (trs[5] - gPrevTy) * scale;
+    }
+    pthread_mutex_unlock(&gTRS_lock);
 
-        sem_wait(&gPreviewImage_semaphore);
-        ConvertYVUAiToPlanarYVU(tImage[LR][frame_number_LR], gPreviewImage[LR],
-                tWidth[LR], tHeight[LR]);
+    UpdateWarpTransformation(warp);
 
-        sem_post(&gPreviewImage_semaphore);
+    jfloatArray bytes = env->NewFloatArray(TRS_SIZE);
+    if(bytes != 0)
+    {
+        env->SetFloatArrayRegion(bytes, 0, TRS_SIZE, (jfloat*) trs);
+    }
+    return bytes;
+}
+
+JNIEXPORT jfloatArray JNICALL Java_com_android_camera_panorama_Mosaic_setSourceImageFromGPU(
+        JNIEnv* env, jobject thiz)
+{
+    bool available = FramesAvailable();
 
-        ret_code = AddFrame(LR, frame_number_LR, gTRS);
+    sem_wait(&gPreviewImage_semaphore);
+    // The planar readback does not write gPreviewImage, so there is nothing
+    // to capture until it has read a new frame back
+    if(gPlanarReadback && !gPreviewPlanarReady)
+        available = false;
+    int slot = available ? capturePipeline.acquireSlot() : -1;
 
-        if(ret_code == Mosaic::MOSAIC_RET_OK || ret_code == Mosaic::MOSAIC_RET_FEW_INLIERS)
+    if(slot >= 0)
+    {
+        if(gPlanarReadback)
+        {
+            // The GPU already read the frame back as planar YVU: take its
+            // buffers and leave the slot's idle ones for the next readback.
+            for(int mID = 0; mID < NR; mID++)
+            {
+                ImageType image = captureImage[mID][slot];
+                captureImage[mID][slot] = gPreviewPlanarImage[mID];
+                gPreviewPlanarImage[mID] = image;
+            }
+            gPreviewPlanarReady = false;
+        }
+        else
         {
-            // Copy into HR buffer only if this is a valid frame
-            sem_wait(&gPreviewImage_semaphore);
-            ConvertYVUAiToPlanarYVU(tImage[HR][frame_number_HR], gPreviewImage[HR],
+            // The HR frame is converted right away too: the preview buffers
+            // will have moved on by the time the worker knows it is kept.
+            ConvertYVUAiToPlanarYVU(captureImage[LR][slot], gPreviewImage[LR],
+                    tWidth[LR], tHeight[LR]);
+            ConvertYVUAiToPlanarYVU(captureImage[HR][slot], gPreviewImage[HR],
                     tWidth[HR], tHeight[HR]);
-            sem_post(&gPreviewImage_semaphore);
-
-            frame_number_LR++;
-            frame_number_HR++;
         }
     }
-    else
-    {
-        gTRS[1] = gTRS[2] = gTRS[3] = gTRS[5] = gTRS[6] = gTRS[7] = 0.0f;
-        gTRS[0] = gTRS[4] = gTRS[8] = 1.0f;
-    }
-
-    UpdateWarpTransformation(gTRS);
-
-    gTRS[9] = frame_number_HR;
-    gTRS[10] = ret_code;
+    sem_post(&gPreviewImage_semaphore);
 
-    jfloatArray bytes = env->NewFloatArray(11);
-    if(bytes != 0)
+    if(slot >= 0)
     {
-        env->SetFloatArrayRegion(bytes, 0, 11, (jfloat*) gTRS);
+        ScratchFile::release(captureImage[HR][slot],
+                tWidth[HR] * tHeight[HR] * ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
+
+        captureTimeMs[slot] = (float) (now_ms() - gCaptureStartMs);
+        capturePipeline.submitSlot(slot);
     }
-    return bytes;
+
+    return ReportLatestTRS(env);
 }
 
 
@@ -416,58 +511,32 @@ JNIEXPORT jfloatArray JNICALL Java_com_android_camera_panorama_Mosaic_setSourceI
 JNIEXPORT jfloatArray JNICALL Java_com_android_camera_panorama_Mosaic_setSourceImage(
         JNIEnv* env, jobject thiz, jbyteArray photo_data)
 {
-    double  t0, t1, time_c;
-    t0 = now_ms();
+    int slot = FramesAvailable() ? capturePipeline.acquireSlot() : -1;
 
-    int ret_code;
-
-    if(frame_number_HR<MAX_FRAMES && frame_number_LR<MAX_FRAMES)
+    if(slot >= 0)
     {
         jbyte *pixels = env->GetByteArrayElements(photo_data, 0);
 
-        YUV420toYVU24_NEW(tImage[HR][frame_number_HR], (ImageType)pixels,
+        YUV420toYVU24_NEW(captureImage[HR][slot], (ImageType)pixels,
                 tWidth[HR], tHeight[HR]);
 
         env->ReleaseByteArrayElements(photo_data, pixels, 0);
 
-        double last_tx = mTx;
-
-        t0 = now_ms();
-        GenerateQuarterResImagePlanar(tImage[HR][frame_number_HR], tWidth[HR],
-                tHeight[HR], tImage[LR][frame_number_LR]);
-
+        GenerateQuarterResImagePlanar(captureImage[HR][slot], tWidth[HR],
+                tHeight[HR], captureImage[LR][slot]);
+        ScratchFile::release(captureImage[HR][slot],
+                tWidth[HR] * tHeight[HR] * ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
 
         sem_wait(&gPreviewImage_semaphore);
-        decodeYUV444SP(gPreviewImage[LR], tImage[LR][frame_number_LR],
+        decodeYUV444SP(gPreviewImage[LR], captureImage[LR][slot],
                 gPreviewImageWidth[LR], gPreviewImageHeight[LR]);
         sem_post(&gPreviewImage_semaphore);
 
-        ret_code = AddFrame(LR, frame_number_LR, gTRS);
-
-        if(ret_code == Mosaic::MOSAIC_RET_OK || ret_code == Mosaic::MOSAIC_RET_FEW_INLIERS)
-        {
-            frame_number_LR++;
-            frame_number_HR++;
-        }
-
+        captureTimeMs[slot] = (float) (now_ms() - gCaptureStartMs);
+        capturePipeline.submitSlot(slot);
     }
-    else
-    {
-        gTRS[1] = gTRS[2] = gTRS[3] = gTRS[5] = gTRS[6] = gTRS[7] = 0.0f;
-        gTRS[0] = gTRS[4] = gTRS[8] = 1.0f;
-    }
-
-    UpdateWarpTransformation(gTRS);
-
-    gTRS[9] = frame_number_HR;
-    gTRS[10] = ret_code;
 
-    jfloatArray bytes = env->NewFloatArray(11);
-    if(bytes != 0)
-    {
-        env->SetFloatArrayRegion(bytes, 0, 11, (jfloat*) gTRS);
-    }
-    return bytes;
+    return ReportLatestTRS(env);
 }
 
 JNIEXPORT void JNICALL Java_com_android_camera_panorama_Mosaic_setBlendingType(
@@ -485,8 +554,21 @@ JNIEXPORT void JNICALL Java_com_android_camera_panorama_Mosaic_setStripType(
 JNIEXPORT void JNICALL Java_com_android_camera_panorama_Mosaic_reset(
         JNIEnv* env, jobject thiz)
 {
+    // The worker must be idle before the mosaic is replaced
+    capturePipeline.flush();
+    LogCaptureStats();
+
+    pthread_mutex_lock(&gTRS_lock);
     frame_number_HR = 0;
     frame_number_LR = 0;
+    gTRS[1] = gTRS[2] = gTRS[3] = gTRS[5] = gTRS[6] = gTRS[7] = 0.0f;
+    gTRS[0] = gTRS[4] = gTRS[8] = 1.0f;
+    gTRS[9] = 0.0f;
+    gTRS[10] = Mosaic::MOSAIC_RET_OK;
+    gTRS[TRS_TIME] = -1.0f;
+    gPrevTime = -1.0f;
+    gCaptureStartMs = now_ms();
+    pthread_mutex_unlock(&gTRS_lock);
 
     gProgress[LR] = 0.0;
     gProgress[HR] = 0.0;
@@ -494,7 +576,8 @@ JNIEXPORT void JNICALL Java_com_android_camera_panorama_Mosaic_reset(
     gCancelComputation[LR] = false;
     gCancelComputation[HR] = false;
 
-    Init(LR,MAX_FRAMES);
+    // Frame headers are created as frames arrive
+    Init(LR,-1);
 }
 
 JNIEXPORT jint JNICALL Java_com_android_camera_panorama_Mosaic_reportProgress(
@@ -511,6 +594,44 @@ JNIEXPORT jint JNICALL Java_com_android_camera_panorama_Mosaic_reportProgress(
         return (jint) gProgress[LR];
 }
 
+// Flattens the alignment profiles of the LR mosaic, oldest frame first, in
+// the field order documented on Mosaic.getAlignmentProfile().
+JNIEXPORT jfloatArray JNICALL Java_com_android_camera_panorama_Mosaic_getAlignmentProfile(
+        JNIEnv* env, jobject thiz)
+{
+    static const int FIELDS = 10;
+    db_RegistrationProfile profiles[db_FrameToReferenceRegistration::PROFILE_HISTORY];
+    int count = 0;
+
+    if(mosaic[LR] != NULL && mosaic[LR]->isInitialized())
+        count = mosaic[LR]->getAligner()->getRegProfiles(profiles,
+                db_FrameToReferenceRegistration::PROFILE_HISTORY);
+
+    float *values = new float[count * FIELDS + 1];
+    for(int i = 0; i < count; i++)
+    {
+        float *v = values + i * FIELDS;
+        v[0] = (float) profiles[i].frame;
+        v[1] = (float) profiles[i].detect_ms;
+        v[2] = (float) profiles[i].match_ms;
+        v[3] = (float) profiles[i].ransac_ms;
+        v[4] = (float) profiles[i].total_ms;
+        v[5] = (float) profiles[i].nr_corners;
+        v[6] = (float) profiles[i].nr_matches;
+        v[7] = (float) profiles[i].nr_inliers;
+        v[8] = (float) profiles[i].nr_hypotheses;
+        v[9] = (float) profiles[i].tracked;
+    }
+
+    jfloatArray result = env->NewFloatArray(count * FIELDS);
+    if(result != 0)
+    {
+        env->SetFloatArrayRegion(result, 0, count * FIELDS, (jfloat*) values);
+    }
+    delete[] values;
+    return result;
+}
+
 JNIEXPORT jint JNICALL Java_com_android_camera_panorama_Mosaic_createMosaic(
         JNIEnv* env, jobject thiz, jboolean value)
 {
@@ -518,6 +639,9 @@ JNIEXPORT jint JNICALL Java_com_android_camera_panorama_Mosaic_createMosaic(
 
     int ret;
 
+    // Finish aligning the frames still in the pipeline
+    capturePipeline.flush();
+
     if(high_res)
     {
         LOGV("createMosaic() - High-Res Mode");
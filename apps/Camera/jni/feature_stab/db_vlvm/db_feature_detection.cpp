@@ -22,6 +22,7 @@
 
 #include "db_utilities.h"
 #include "db_feature_detection.h"
+#include "db_worker_pool.h"
 #ifdef _VERBOSE_
 #include <iostream>
 #endif
@@ -1489,78 +1490,167 @@ inline void db_SubPixel(float **strength, const double xd, const double yd, doub
     return;
 }
 
-/*Extract corners from the image part from (left,top) to (right,bottom).
-Store in x and y, extracting at most satnr corners in each block of size (bw,bh).
-The pointer temp_d should point to at least 5*bw*bh positions.
-area_factor holds how many corners max to extract per 10000 pixels*/
-void db_ExtractCornersSaturated(float **strength,int left,int top,int right,int bottom,
-                                int bw,int bh,unsigned long area_factor,
+/*Shrink the region (left,top) to (right,bottom) to the part actually searched for corners*/
+inline void db_CornerSearchRegion(int *left,int *top,int *right,int *bottom)
+{
+#ifdef DB_SUB_PIXEL
+    // subpixel processing may sometimes push the corner ourside the real border
+    // increasing border size:
+    (*left)++;
+    (*top)++;
+    (*bottom)--;
+    (*right)--;
+#endif /*DB_SUB_PIXEL*/
+}
+
+/*Extract corners from the row of blocks from (left,top) to (right,bottom), at most
+saturation corners in each block of width bw. Store in x and y and return the number
+of corners. The pointer temp_d should point to at least 5*bw*bh positions, where bh
+is at least bottom-top+1*/
+inline int db_ExtractCornersSaturatedBlockRow(float **strength,int left,int top,int right,int bottom,
+                                int bw,unsigned long bwbh,unsigned long area_factor,
                                 float threshold,double *temp_d,
-                                double *x_coord,double *y_coord,int *nr_corners)
+                                double *x_coord,double *y_coord)
 {
     double *x_temp,*y_temp,*s_temp,*select_temp;
     double loc_thresh;
-    unsigned long bwbh,area,saturation;
+    unsigned long area,saturation;
     int x,next_x,last_x;
-    int y,next_y,last_y;
     int nr,nr_points,i,stop;
 
-    bwbh=bw*bh;
     x_temp=temp_d;
     y_temp=x_temp+bwbh;
     s_temp=y_temp+bwbh;
     select_temp=s_temp+bwbh;
 
-#ifdef DB_SUB_PIXEL
-    // subpixel processing may sometimes push the corner ourside the real border
-    // increasing border size:
-    left++;
-    top++;
-    bottom--;
-    right--;
-#endif /*DB_SUB_PIXEL*/
-
     nr_points=0;
-    for(y=top;y<=bottom;y=next_y)
+    for(x=left;x<=right;x=next_x)
     {
-        next_y=y+bh;
-        last_y=next_y-1;
-        if(last_y>bottom) last_y=bottom;
-        for(x=left;x<=right;x=next_x)
+        next_x=x+bw;
+        last_x=next_x-1;
+        if(last_x>right) last_x=right;
+
+        area=(last_x-x+1)*(bottom-top+1);
+        saturation=(area*area_factor)/10000;
+        nr=db_CornersFromChunk(strength,x,top,last_x,bottom,threshold,x_temp,y_temp,s_temp);
+        if(nr)
         {
-            next_x=x+bw;
-            last_x=next_x-1;
-            if(last_x>right) last_x=right;
-
-            area=(last_x-x+1)*(last_y-y+1);
-            saturation=(area*area_factor)/10000;
-            nr=db_CornersFromChunk(strength,x,y,last_x,last_y,threshold,x_temp,y_temp,s_temp);
-            if(nr)
-            {
-                if(((unsigned long)nr)>saturation) loc_thresh=db_LeanQuickSelect(s_temp,nr,nr-saturation,select_temp);
-                else loc_thresh=threshold;
+            if(((unsigned long)nr)>saturation) loc_thresh=db_LeanQuickSelect(s_temp,nr,nr-saturation,select_temp);
+            else loc_thresh=threshold;
 
-                stop=nr_points+saturation;
-                for(i=0;(i<nr)&&(nr_points<stop);i++)
+            stop=nr_points+saturation;
+            for(i=0;(i<nr)&&(nr_points<stop);i++)
+            {
+                if(s_temp[i]>=loc_thresh)
                 {
-                    if(s_temp[i]>=loc_thresh)
-                    {
-                        #ifdef DB_SUB_PIXEL
-                               db_SubPixel(strength, x_temp[i], y_temp[i], x_coord[nr_points], y_coord[nr_points]);
-                        #else
-                               x_coord[nr_points]=x_temp[i];
-                               y_coord[nr_points]=y_temp[i];
-                        #endif
-
-                        nr_points++;
-                    }
+                    #ifdef DB_SUB_PIXEL
+                           db_SubPixel(strength, x_temp[i], y_temp[i], x_coord[nr_points], y_coord[nr_points]);
+                    #else
+                           x_coord[nr_points]=x_temp[i];
+                           y_coord[nr_points]=y_temp[i];
+                    #endif
+
+                    nr_points++;
                 }
             }
         }
     }
+    return(nr_points);
+}
+
+/*Extract corners from the image part from (left,top) to (right,bottom).
+Store in x and y, extracting at most satnr corners in each block of size (bw,bh).
+The pointer temp_d should point to at least 5*bw*bh positions.
+area_factor holds how many corners max to extract per 10000 pixels*/
+void db_ExtractCornersSaturated(float **strength,int left,int top,int right,int bottom,
+                                int bw,int bh,unsigned long area_factor,
+                                float threshold,double *temp_d,
+                                double *x_coord,double *y_coord,int *nr_corners)
+{
+    int y,next_y,last_y;
+    int nr_points;
+
+    db_CornerSearchRegion(&left,&top,&right,&bottom);
+
+    nr_points=0;
+    for(y=top;y<=bottom;y=next_y)
+    {
+        next_y=y+bh;
+        last_y=next_y-1;
+        if(last_y>bottom) last_y=bottom;
+        nr_points+=db_ExtractCornersSaturatedBlockRow(strength,left,y,right,last_y,bw,bw*bh,area_factor,
+            threshold,temp_d,x_coord+nr_points,y_coord+nr_points);
+    }
     *nr_corners=nr_points;
 }
 
+/*State shared by the tasks of a threaded db_CornerDetector_u::DetectCorners()*/
+typedef struct
+{
+    float **strength;
+    const unsigned char * const *img;
+    int w,h,nr_bands;
+    int *temp_i;
+    /*Maximum strength of each band, if find_max*/
+    bool find_max;
+    float *band_max;
+
+    /*Corner search region and blocks*/
+    int left,top,right,bottom,bw,bh;
+    unsigned long area_factor;
+    float threshold;
+    double *temp_d;
+    int nr_block_rows,row_capacity;
+    double *row_x,*row_y;
+    int *row_nr;
+} db_CornerDetectionJob;
+
+/*Compute the Harris strength, and optionally its maximum, for one band of the rows 3 to h-4.
+Each band runs all the column chunks of db_HarrisStrength_u over its own rows*/
+static void db_HarrisStrengthBandTask(void *arg,int band)
+{
+    db_CornerDetectionJob *job=(db_CornerDetectionJob*)arg;
+    int x,next_x,last,nc,top,bottom,nr_rows;
+
+    nr_rows=job->h-6;
+    top=3+(nr_rows*band)/job->nr_bands;
+    bottom=2+(nr_rows*(band+1))/job->nr_bands;
+
+    last=job->w-4;
+    for(x=3;x<=last;x=next_x)
+    {
+        next_x=x+124;
+        nc=db_mini(128,last-x+1);
+        db_HarrisStrengthChunk_u(job->strength,job->img,x,top,bottom,job->temp_i+band*18*128,nc);
+    }
+
+    if(job->find_max)
+        job->band_max[band]=db_MaxImage_Aligned16_f(job->strength,3,top,job->w-6,bottom-top+1);
+}
+
+/*Extract the corners of every nr_bands-th row of blocks, starting with row band*/
+static void db_ExtractCornersBandTask(void *arg,int band)
+{
+    db_CornerDetectionJob *job=(db_CornerDetectionJob*)arg;
+    int r,y,last_y;
+    unsigned long bwbh;
+
+    bwbh=job->bw*job->bh;
+    for(r=band;r<job->nr_block_rows;r+=job->nr_bands)
+    {
+        y=job->top+r*job->bh;
+        if(y>job->bottom)
+        {
+            job->row_nr[r]=0;
+            continue;
+        }
+        last_y=db_mini(y+job->bh-1,job->bottom);
+        job->row_nr[r]=db_ExtractCornersSaturatedBlockRow(job->strength,job->left,y,job->right,last_y,
+            job->bw,bwbh,job->area_factor,job->threshold,job->temp_d+band*5*bwbh,
+            job->row_x+r*job->row_capacity,job->row_y+r*job->row_capacity);
+    }
+}
+
 db_CornerDetector_f::db_CornerDetector_f()
 {
     m_w=0; m_h=0;
@@ -1646,6 +1736,8 @@ void db_CornerDetector_f::DetectCorners(const float * const *img,double *x_coord
 db_CornerDetector_u::db_CornerDetector_u()
 {
     m_w=0; m_h=0;
+    m_nr_threads=1;
+    m_pool=NULL;
 }
 
 db_CornerDetector_u::~db_CornerDetector_u()
@@ -1655,6 +1747,9 @@ db_CornerDetector_u::~db_CornerDetector_u()
 
 db_CornerDetector_u::db_CornerDetector_u(const db_CornerDetector_u& cd)
 {
+    m_w=0; m_h=0;
+    m_nr_threads=cd.m_nr_threads;
+    m_pool=NULL;
     Start(cd.m_w, cd.m_h, cd.m_bw, cd.m_bh, cd.m_area_factor,
         cd.m_a_thresh, cd.m_r_thresh);
 }
@@ -1665,6 +1760,7 @@ db_CornerDetector_u& db_CornerDetector_u::operator=(const db_CornerDetector_u& c
 
     Clean();
 
+    m_nr_threads=cd.m_nr_threads;
     Start(cd.m_w, cd.m_h, cd.m_bw, cd.m_bh, cd.m_area_factor,
         cd.m_a_thresh, cd.m_r_thresh);
 
@@ -1675,6 +1771,7 @@ void db_CornerDetector_u::Clean()
 {
     if(m_w!=0)
     {
+        CleanThreads();
         delete [] m_temp_i;
         delete [] m_temp_d;
         db_FreeStrengthImage_f(m_strength_mem,m_strength,m_h);
@@ -1682,6 +1779,58 @@ void db_CornerDetector_u::Clean()
     m_w=0; m_h=0;
 }
 
+void db_CornerDetector_u::SetNrThreads(int nr_threads)
+{
+    m_nr_threads=(nr_threads<=0)?db_WorkerPool::NrCpus():nr_threads;
+    if(m_w!=0)
+    {
+        CleanThreads();
+        StartThreads();
+    }
+}
+
+void db_CornerDetector_u::StartThreads()
+{
+    int nr_bands;
+
+    m_pool=NULL;
+    if(m_nr_threads<=1) return;
+
+    m_pool=new db_WorkerPool;
+    nr_bands=m_pool->Init(m_nr_threads);
+    if(nr_bands<=1)
+    {
+        delete m_pool;
+        m_pool=NULL;
+        return;
+    }
+
+    /*Upper bounds on the rows of blocks and the corners in each*/
+    m_nr_block_rows=db_maxi(1,m_h-2*BORDER)/m_bh+1;
+    m_row_capacity=(db_maxi(1,m_w-2*BORDER)/m_bw+1)*
+        (int)(((unsigned long)(m_bw*m_bh)*m_area_factor)/10000);
+
+    m_band_temp_i=new int[nr_bands*18*128];
+    m_band_temp_d=new double[nr_bands*5*m_bw*m_bh];
+    m_row_x=new double[m_nr_block_rows*m_row_capacity];
+    m_row_y=new double[m_nr_block_rows*m_row_capacity];
+    m_row_nr=new int[m_nr_block_rows];
+}
+
+void db_CornerDetector_u::CleanThreads()
+{
+    if(m_pool)
+    {
+        delete m_pool;
+        delete [] m_band_temp_i;
+        delete [] m_band_temp_d;
+        delete [] m_row_x;
+        delete [] m_row_y;
+        delete [] m_row_nr;
+    }
+    m_pool=NULL;
+}
+
 unsigned long db_CornerDetector_u::Init(int im_width,int im_height,int target_nr_corners,
                             int nr_horizontal_blocks,int nr_vertical_blocks,
                             double absolute_threshold,double relative_threshold)
@@ -1721,6 +1870,8 @@ unsigned long db_CornerDetector_u::Start(int im_width,int im_height,
     m_temp_d=new double[5*m_bw*m_bh];
     m_strength=db_AllocStrengthImage_f(&m_strength_mem,m_w,m_h);
 
+    StartThreads();
+
     return(m_max_nr);
 }
 
@@ -1729,18 +1880,25 @@ void db_CornerDetector_u::DetectCorners(const unsigned char * const *img,double
 {
     float max_val,threshold;
 
-    db_HarrisStrength_u(m_strength,img,m_w,m_h,m_temp_i);
-
-
-    if(m_r_thresh)
+    if(m_pool && m_h>6+m_pool->NrThreads())
     {
-        max_val=db_MaxImage_Aligned16_f(m_strength,3,3,m_w-6,m_h-6);
-        threshold= (float) db_maxd(m_a_thresh,max_val*m_r_thresh);
+        DetectCornersThreaded(img,x_coord,y_coord,nr_corners);
     }
-    else threshold= (float) m_a_thresh;
+    else
+    {
+        db_HarrisStrength_u(m_strength,img,m_w,m_h,m_temp_i);
 
-    db_ExtractCornersSaturated(m_strength,BORDER,BORDER,m_w-BORDER-1,m_h-BORDER-1,m_bw,m_bh,m_area_factor,threshold,
-        m_temp_d,x_coord,y_coord,nr_corners);
+
+        if(m_r_thresh)
+        {
+            max_val=db_MaxImage_Aligned16_f(m_strength,3,3,m_w-6,m_h-6);
+            threshold= (float) db_maxd(m_a_thresh,max_val*m_r_thresh);
+        }
+        else threshold= (float) m_a_thresh;
+
+        db_ExtractCornersSaturated(m_strength,BORDER,BORDER,m_w-BORDER-1,m_h-BORDER-1,m_bw,m_bh,m_area_factor,threshold,
+            m_temp_d,x_coord,y_coord,nr_corners);
+    }
 
 
     if ( msk )
@@ -1762,6 +1920,65 @@ void db_CornerDetector_u::DetectCorners(const unsigned char * const *img,double
     }
 }
 
+/*Same as the sequential path of DetectCorners(), with the strength computed in bands of
+rows and the corners extracted per row of blocks on the worker pool. The rows of blocks are
+concatenated in order, so the output is identical*/
+void db_CornerDetector_u::DetectCornersThreaded(const unsigned char * const *img,double *x_coord,double *y_coord,int *nr_corners) const
+{
+    db_CornerDetectionJob job;
+    float band_max[db_WorkerPool::MAX_THREADS];
+    float max_val;
+    int i,r,nr_points;
+
+    job.strength=m_strength;
+    job.img=img;
+    job.w=m_w;
+    job.h=m_h;
+    job.nr_bands=m_pool->NrThreads();
+    job.temp_i=m_band_temp_i;
+    job.find_max=(m_r_thresh!=0.0);
+    job.band_max=band_max;
+
+    m_pool->Run(db_HarrisStrengthBandTask,&job,job.nr_bands);
+
+    if(job.find_max)
+    {
+        max_val=band_max[0];
+        for(i=1;i<job.nr_bands;i++) if(band_max[i]>max_val) max_val=band_max[i];
+        job.threshold= (float) db_maxd(m_a_thresh,max_val*m_r_thresh);
+    }
+    else job.threshold= (float) m_a_thresh;
+
+    job.left=BORDER;
+    job.top=BORDER;
+    job.right=m_w-BORDER-1;
+    job.bottom=m_h-BORDER-1;
+    db_CornerSearchRegion(&job.left,&job.top,&job.right,&job.bottom);
+    job.bw=m_bw;
+    job.bh=m_bh;
+    job.area_factor=m_area_factor;
+    job.temp_d=m_band_temp_d;
+    job.nr_block_rows=db_mini(m_nr_block_rows,db_maxi(0,(job.bottom-job.top)/m_bh+1));
+    job.row_capacity=m_row_capacity;
+    job.row_x=m_row_x;
+    job.row_y=m_row_y;
+    job.row_nr=m_row_nr;
+
+    m_pool->Run(db_ExtractCornersBandTask,&job,job.nr_bands);
+
+    nr_points=0;
+    for(r=0;r<job.nr_block_rows;r++)
+    {
+        for(i=0;i<m_row_nr[r];i++)
+        {
+            x_coord[nr_points]=m_row_x[r*m_row_capacity+i];
+            y_coord[nr_points]=m_row_y[r*m_row_capacity+i];
+            nr_points++;
+        }
+    }
+    *nr_corners=nr_points;
+}
+
 void db_CornerDetector_u::ExtractCorners(float ** strength, double *x_coord, double *y_coord, int *nr_corners) {
     if ( m_w!=0 )
         db_ExtractCornersSaturated(strength,BORDER,BORDER,m_w-BORDER-1,m_h-BORDER-1,m_bw,m_bh,m_area_factor,float(m_a_thresh),
@@ -29,6 +29,8 @@
 #include "db_utilities_constants.h"
 #include <stdlib.h> //for NULL
 
+class db_WorkerPool;
+
 /*!
  * \class db_CornerDetector_f
  * \ingroup FeatureDetection
@@ -158,8 +160,19 @@ public:
      \param nr_corners  actual number of corners computed
      */
     virtual void ExtractCorners(float ** strength, double *x_coord, double *y_coord, int *nr_corners);
+
+    /*!
+     Detect corners on nr_threads threads, <=0 for one per online CPU.
+     The strength image is computed and searched in bands of rows, so the
+     corners found and their order do not depend on the number of threads.
+     */
+    virtual void SetNrThreads(int nr_threads);
+    int NrThreads() const { return(m_nr_threads); }
 protected:
     virtual void Clean();
+    void StartThreads();
+    void CleanThreads();
+    void DetectCornersThreaded(const unsigned char * const *img,double *x_coord,double *y_coord,int *nr_corners) const;
     /*The absolute threshold to this function should be 16.0 times
     normal*/
     unsigned long Start(int im_width,int im_height,
@@ -174,6 +187,18 @@ protected:
     int *m_temp_i;
     double *m_temp_d;
     float **m_strength,*m_strength_mem;
+
+    /*Threaded detection, only allocated for more than one thread*/
+    int m_nr_threads;
+    db_WorkerPool *m_pool;
+    /*Per-band versions of m_temp_i and m_temp_d*/
+    int *m_band_temp_i;
+    double *m_band_temp_d;
+    /*Corners of each row of blocks, m_row_capacity per row, before
+    they are concatenated in order*/
+    int m_nr_block_rows,m_row_capacity;
+    double *m_row_x,*m_row_y;
+    int *m_row_nr;
 };
 
 #endif /*DB_FEATURE_DETECTION_H*/
@@ -22,6 +22,7 @@
 
 #include "db_utilities.h"
 #include "db_feature_matching.h"
+#include "db_feature_matching_simd.h"
 #ifdef _VERBOSE_
 #include <iostream>
 #endif
@@ -645,11 +646,11 @@ inline void db_SignedSquareNormCorr21x21_PreAlign_u(short *patch,const unsigned
         }
     }
 
-    for(int i=442; i<512; i++)
+    for(int i=441; i<512; i++)
         (*patch++)=0;
 
     *sum= (float) fsum;
-    den=(441.0f*f2sum-fsum*fsum);
+    den=(441.0f*f2sum-(float)fsum*(float)fsum);
     *recip= (float)((den!=0.0)?1.0/den:0.0);
 
 
@@ -1263,11 +1264,69 @@ inline float db_SignedSquareNormCorr11x11_Post_u(unsigned char **f_img,unsigned
     return(-fg_corr*fg_corr*f_recip_g_recip);
 }
 
+static void db_SignedSquareNormCorr11x11_PreAlign_u_c(short *patch,const unsigned char * const *f_img,int x_f,int y_f,float *sum,float *recip)
+{
+    db_SignedSquareNormCorr11x11_PreAlign_u(patch,f_img,x_f,y_f,sum,recip);
+}
+
+static void db_SignedSquareNormCorr21x21_PreAlign_u_c(short *patch,const unsigned char * const *f_img,int x_f,int y_f,float *sum,float *recip)
+{
+    db_SignedSquareNormCorr21x21_PreAlign_u(patch,f_img,x_f,y_f,sum,recip);
+}
+
+static int db_ScalarProduct32_s_c(const short *f,const short *g)
+{
+    return(db_ScalarProduct32_s(f,g));
+}
+
+static int db_ScalarProduct128_s_c(const short *f,const short *g)
+{
+    return(db_ScalarProduct128_s(f,g));
+}
+
+static int db_ScalarProduct512_s_c(const short *f,const short *g)
+{
+    return(db_ScalarProduct512_s(f,g));
+}
+
+static const db_MatchingKernels_u db_matching_kernels_c=
+{
+    db_SignedSquareNormCorr11x11_PreAlign_u_c,
+    db_SignedSquareNormCorr21x21_PreAlign_u_c,
+    db_ScalarProduct32_s_c,
+    db_ScalarProduct128_s_c,
+    db_ScalarProduct512_s_c
+};
+
+const db_MatchingKernels_u *db_GetMatchingKernels_u()
+{
+    return(&db_matching_kernels_c);
+}
+
+static const db_MatchingKernels_u *db_SelectMatchingKernels_u(bool simd)
+{
+    const db_MatchingKernels_u *kernels=simd?db_GetMatchingKernelsSimd_u():NULL;
+    return(kernels?kernels:&db_matching_kernels_c);
+}
+
+/*Kernels used by db_Matcher_u, SIMD where available*/
+static const db_MatchingKernels_u *db_matching_kernels=db_SelectMatchingKernels_u(true);
+
+void db_SetMatchingSimdEnabled(bool enable)
+{
+    db_matching_kernels=db_SelectMatchingKernels_u(enable);
+}
+
+bool db_MatchingSimdEnabled()
+{
+    return(db_matching_kernels!=&db_matching_kernels_c);
+}
+
 float db_SignedSquareNormCorr21x21Aligned_Post_s(const short *f_patch,const short *g_patch,float fsum_gsum,float f_recip_g_recip)
 {
     float fgsum,fg_corr;
 
-    fgsum= (float) db_ScalarProduct512_s(f_patch,g_patch);
+    fgsum= (float) db_matching_kernels->ScalarProduct512_s(f_patch,g_patch);
 
     fg_corr=441.0f*fgsum-fsum_gsum;
     if(fg_corr>=0.0) return(fg_corr*fg_corr*f_recip_g_recip);
@@ -1279,7 +1338,7 @@ float db_SignedSquareNormCorr11x11Aligned_Post_s(const short *f_patch,const shor
 {
     float fgsum,fg_corr;
 
-    fgsum= (float) db_ScalarProduct128_s(f_patch,g_patch);
+    fgsum= (float) db_matching_kernels->ScalarProduct128_s(f_patch,g_patch);
 
     fg_corr=121.0f*fgsum-fsum_gsum;
     if(fg_corr>=0.0) return(fg_corr*fg_corr*f_recip_g_recip);
@@ -1290,7 +1349,7 @@ float db_SignedSquareNormCorr5x5Aligned_Post_s(const short *f_patch,const short
 {
     float fgsum,fg_corr;
 
-    fgsum= (float) db_ScalarProduct32_s(f_patch,g_patch);
+    fgsum= (float) db_matching_kernels->ScalarProduct32_s(f_patch,g_patch);
 
     fg_corr=25.0f*fgsum-fsum_gsum;
     if(fg_corr>=0.0) return(fg_corr*fg_corr*f_recip_g_recip);
@@ -2758,14 +2817,14 @@ short* db_FillBuckets_u(short *patch_space,const unsigned char * const *f_img,db
 
                 if(use_21)
                 {
-                    db_SignedSquareNormCorr21x21_PreAlign_u(patch_space,f_img,xi,yi,&(pir->sum),&(pir->recip));
+                    db_matching_kernels->SignedSquareNormCorr21x21_PreAlign_u(patch_space,f_img,xi,yi,&(pir->sum),&(pir->recip));
                     patch_space+=512;
                 }
                 else
                 {
                 if(!use_smaller_matching_window)
                 {
-                    db_SignedSquareNormCorr11x11_PreAlign_u(patch_space,f_img,xi,yi,&(pir->sum),&(pir->recip));
+                    db_matching_kernels->SignedSquareNormCorr11x11_PreAlign_u(patch_space,f_img,xi,yi,&(pir->sum),&(pir->recip));
                     patch_space+=128;
                 }
                 else
@@ -2860,7 +2919,7 @@ short* db_FillBucketsPrewarped_u(short *patch_space,const unsigned char * const
                 pir->patch=patch_space;
                 br->nr=nr+1;
 
-                db_SignedSquareNormCorr11x11_PreAlign_u(patch_space,f_img,xi,yi,&(pir->sum),&(pir->recip));
+                db_matching_kernels->SignedSquareNormCorr11x11_PreAlign_u(patch_space,f_img,xi,yi,&(pir->sum),&(pir->recip));
                 patch_space+=128;
             }
         }
@@ -3408,3 +3467,93 @@ int db_Matcher_u::IsAllocated()
 {
     return (int)(m_w != 0);
 }
+
+/*Scores are in [-1,1]*/
+#define DB_TRACK_NOT_SCORED -3.0f
+
+/*Offset of the peak of the parabola through (-1,a),(0,b),(1,c)*/
+inline double db_ParabolaPeak(float a,float b,float c)
+{
+    float den=a-2.0f*b+c;
+
+    if(den>=0.0f) return(0.0);
+    return(db_maxd(-0.5,db_mind(0.5,0.5*(a-c)/den)));
+}
+
+int db_TrackFeatures_u(const unsigned char * const *l_img,const unsigned char * const *r_img,int im_width,int im_height,
+    const double *x_l,const double *y_l,int nr_l,const double H[9],int radius,float min_score,
+    int *id_l,double *x_r,double *y_r)
+{
+    int i,k,nr,side,xi,yi,xp,yp,cx,cy,dx,dy,best_dx,best_dy;
+    double xh,yh,zh,xd,yd;
+    float f_sum,f_recip,g_sum,g_recip,best_score;
+    float scores[(2*DB_MAX_TRACK_RADIUS+1)*(2*DB_MAX_TRACK_RADIUS+1)];
+    short patch_space[2*128+8];
+    short *f_patch,*g_patch;
+
+    f_patch=db_AlignPointer_s(patch_space,16);
+    g_patch=f_patch+128;
+    radius=db_maxi(0,db_mini(radius,DB_MAX_TRACK_RADIUS));
+    side=2*radius+1;
+
+    for(i=0,nr=0;i<nr_l;i++)
+    {
+        /*The patch is centered on the nearest pixel, the fraction
+        is added back to the tracked position*/
+        xi=db_roundi(x_l[i]);
+        yi=db_roundi(y_l[i]);
+        if(xi<5 || yi<5 || xi>im_width-6 || yi>im_height-6) continue;
+
+        zh=H[6]*xi+H[7]*yi+H[8];
+        if(zh==0.0) continue;
+        xh=(H[0]*xi+H[1]*yi+H[2])/zh;
+        yh=(H[3]*xi+H[4]*yi+H[5])/zh;
+        if(xh<-radius || yh<-radius || xh>im_width+radius || yh>im_height+radius) continue;
+        xp=db_roundi(xh);
+        yp=db_roundi(yh);
+        if(xp-radius<5 || yp-radius<5 || xp+radius>im_width-6 || yp+radius>im_height-6) continue;
+
+        db_matching_kernels->SignedSquareNormCorr11x11_PreAlign_u(f_patch,l_img,xi,yi,&f_sum,&f_recip);
+
+        /*Climb from the prediction to the best neighbour until none is
+        better, scoring each position at most once*/
+        for(k=0;k<side*side;k++) scores[k]=DB_TRACK_NOT_SCORED;
+        best_dx=best_dy=0;
+        best_score= -2.0f;
+        for(;;)
+        {
+            cx=best_dx;
+            cy=best_dy;
+            for(dy=db_maxi(cy-1,-radius);dy<=db_mini(cy+1,radius);dy++) for(dx=db_maxi(cx-1,-radius);dx<=db_mini(cx+1,radius);dx++)
+            {
+                k=(dy+radius)*side+dx+radius;
+                if(scores[k]==DB_TRACK_NOT_SCORED)
+                {
+                    db_matching_kernels->SignedSquareNormCorr11x11_PreAlign_u(g_patch,r_img,xp+dx,yp+dy,&g_sum,&g_recip);
+                    scores[k]=db_SignedSquareNormCorr11x11Aligned_Post_s(f_patch,g_patch,f_sum*g_sum,f_recip*g_recip);
+                }
+                if(scores[k]>best_score)
+                {
+                    best_score=scores[k];
+                    best_dx=dx;
+                    best_dy=dy;
+                }
+            }
+            if(best_dx==cx && best_dy==cy) break;
+        }
+        if(best_score<min_score) continue;
+
+        /*Sub-pixel refinement unless the peak is on the border of the search*/
+        k=(best_dy+radius)*side+best_dx+radius;
+        xd=(double)(xp+best_dx);
+        yd=(double)(yp+best_dy);
+        if(best_dx> -radius && best_dx<radius) xd+=db_ParabolaPeak(scores[k-1],scores[k],scores[k+1]);
+        if(best_dy> -radius && best_dy<radius) yd+=db_ParabolaPeak(scores[k-side],scores[k],scores[k+side]);
+
+        id_l[nr]=i;
+        x_r[nr]=xd+(x_l[i]-xi);
+        y_r[nr]=yd+(y_l[i]-yi);
+        nr++;
+    }
+    return(nr);
+}
@@ -255,6 +255,35 @@ protected:
     int m_use_21;
 };
 
+/*!
+ * Track features into a nearby image by a local search instead of detecting
+ * and matching them from scratch. Each feature (x_l[i],y_l[i]) of l_img is
+ * moved by the homography H to predict its position in r_img. From there the
+ * search climbs to the neighbouring pixel of highest 11x11 normalized
+ * correlation with l_img until none is better, staying within radius pixels
+ * of the prediction. The peak is refined to sub-pixel accuracy by fitting a
+ * parabola to the neighbouring scores.
+ * Features whose best score is below min_score, or whose search window
+ * leaves the image, are dropped.
+ * \param l_img     image the features were found in
+ * \param r_img     image to track them into
+ * \param im_width  width of both images
+ * \param im_height height of both images
+ * \param x_l       x coordinates of the features
+ * \param y_l       y coordinates of the features
+ * \param nr_l      number of features
+ * \param H         homography predicting the feature positions in r_img
+ * \param radius    search radius in pixels, at most DB_MAX_TRACK_RADIUS
+ * \param min_score minimum signed squared correlation, in [-1,1]
+ * \param id_l      indices of the features tracked, at least nr_l entries
+ * \param x_r       x coordinates of the tracked features in r_img
+ * \param y_r       y coordinates of the tracked features in r_img
+ * \return number of features tracked
+ */
+DB_API int db_TrackFeatures_u(const unsigned char * const *l_img,const unsigned char * const *r_img,int im_width,int im_height,
+    const double *x_l,const double *y_l,int nr_l,const double H[9],int radius,float min_score,
+    int *id_l,double *x_r,double *y_r);
+
 
 
 #endif /*DB_FEATURE_MATCHING_H*/
@@ -0,0 +1,315 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+/*NEON and SSE2 versions of the patch layout and patch correlation kernels of
+db_Matcher_u. On ARM this file is built with NEON enabled while the rest of the
+library is not, so the NEON kernels are only handed out after checking that the
+CPU supports them. The windows are loaded in pieces that stay inside the
+window, so no pixel beyond the plain C reads is touched*/
+
+#include "db_feature_matching_simd.h"
+#include <stdio.h>
+#include <string.h>
+
+#if defined(__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+
+
+/*****************************************************************
+*    Lean and mean begins here                                   *
+*****************************************************************/
+
+#if defined(__ARM_NEON__)
+
+inline int db_HorizontalSum_neon(uint32x4_t v)
+{
+    uint64x2_t s=vpaddlq_u32(v);
+    return((int)(vgetq_lane_u64(s,0)+vgetq_lane_u64(s,1)));
+}
+
+inline int db_HorizontalSum_neon(int32x4_t v)
+{
+    int64x2_t s=vpaddlq_s32(v);
+    return((int)(vgetq_lane_s64(s,0)+vgetq_lane_s64(s,1)));
+}
+
+/*Square of each lane of v accumulated into acc*/
+inline uint32x4_t db_AccumulateSquares_neon(uint32x4_t acc,uint16x8_t v)
+{
+    acc=vmlal_u16(acc,vget_low_u16(v),vget_low_u16(v));
+    return(vmlal_u16(acc,vget_high_u16(v),vget_high_u16(v)));
+}
+
+static void db_SignedSquareNormCorr11x11_PreAlign_u_neon(short *patch,const unsigned char * const *f_img,int x_f,int y_f,float *sum,float *recip)
+{
+    float den;
+    int f2sum,fsum,r;
+    int xm_f=x_f-5;
+    const unsigned char *pf;
+    const uint8x8_t zero=vdup_n_u8(0);
+    uint16x8_t lo,hi,acc=vdupq_n_u16(0);
+    uint32x4_t acc2=vdupq_n_u32(0);
+
+    for(r=0;r<11;r++)
+    {
+        pf=f_img[y_f-5+r]+xm_f;
+        /*Pixels 0-7, and 8-10 followed by zeros*/
+        lo=vmovl_u8(vld1_u8(pf));
+        hi=vmovl_u8(vext_u8(vld1_u8(pf+3),zero,5));
+
+        /*The zeros are overwritten by the next row*/
+        vst1q_s16(patch+11*r,vreinterpretq_s16_u16(lo));
+        vst1q_s16(patch+11*r+8,vreinterpretq_s16_u16(hi));
+
+        acc=vaddq_u16(acc,vaddq_u16(lo,hi));
+        acc2=db_AccumulateSquares_neon(acc2,lo);
+        acc2=db_AccumulateSquares_neon(acc2,hi);
+    }
+    patch[126]=0;
+    patch[127]=0;
+
+    fsum=db_HorizontalSum_neon(vpaddlq_u16(acc));
+    f2sum=db_HorizontalSum_neon(acc2);
+
+    *sum= (float) fsum;
+    den=(121.0f*f2sum-fsum*fsum);
+    *recip= (float)((den!=0.0)?1.0/den:0.0);
+}
+
+static void db_SignedSquareNormCorr21x21_PreAlign_u_neon(short *patch,const unsigned char * const *f_img,int x_f,int y_f,float *sum,float *recip)
+{
+    float den;
+    int f2sum,fsum,r,i;
+    int xm_f=x_f-10;
+    const unsigned char *pf;
+    const uint8x8_t zero=vdup_n_u8(0);
+    uint8x16_t v;
+    uint16x8_t a,b,c,acc=vdupq_n_u16(0);
+    uint32x4_t acc2=vdupq_n_u32(0);
+
+    for(r=0;r<21;r++)
+    {
+        pf=f_img[y_f-10+r]+xm_f;
+        /*Pixels 0-15, and 16-20 followed by zeros*/
+        v=vld1q_u8(pf);
+        a=vmovl_u8(vget_low_u8(v));
+        b=vmovl_u8(vget_high_u8(v));
+        c=vmovl_u8(vext_u8(vld1_u8(pf+13),zero,3));
+
+        /*The zeros are overwritten by the next row*/
+        vst1q_s16(patch+21*r,vreinterpretq_s16_u16(a));
+        vst1q_s16(patch+21*r+8,vreinterpretq_s16_u16(b));
+        vst1q_s16(patch+21*r+16,vreinterpretq_s16_u16(c));
+
+        acc=vaddq_u16(acc,vaddq_u16(vaddq_u16(a,b),c));
+        acc2=db_AccumulateSquares_neon(acc2,a);
+        acc2=db_AccumulateSquares_neon(acc2,b);
+        acc2=db_AccumulateSquares_neon(acc2,c);
+    }
+    for(i=441;i<512;i++) patch[i]=0;
+
+    fsum=db_HorizontalSum_neon(vpaddlq_u16(acc));
+    f2sum=db_HorizontalSum_neon(acc2);
+
+    *sum= (float) fsum;
+    den=(441.0f*f2sum-(float)fsum*(float)fsum);
+    *recip= (float)((den!=0.0)?1.0/den:0.0);
+}
+
+/*Scalar product of short vectors of length n, a multiple of 8*/
+inline int db_ScalarProduct_s_neon(const short *f,const short *g,int n)
+{
+    int i;
+    int16x8_t a,b;
+    int32x4_t acc=vdupq_n_s32(0);
+
+    for(i=0;i<n;i+=8)
+    {
+        a=vld1q_s16(f+i);
+        b=vld1q_s16(g+i);
+        acc=vmlal_s16(acc,vget_low_s16(a),vget_low_s16(b));
+        acc=vmlal_s16(acc,vget_high_s16(a),vget_high_s16(b));
+    }
+    return(db_HorizontalSum_neon(acc));
+}
+
+static int db_ScalarProduct32_s_neon(const short *f,const short *g)
+{
+    return(db_ScalarProduct_s_neon(f,g,32));
+}
+
+static int db_ScalarProduct128_s_neon(const short *f,const short *g)
+{
+    return(db_ScalarProduct_s_neon(f,g,128));
+}
+
+static int db_ScalarProduct512_s_neon(const short *f,const short *g)
+{
+    return(db_ScalarProduct_s_neon(f,g,512));
+}
+
+static const db_MatchingKernels_u db_matching_kernels_neon=
+{
+    db_SignedSquareNormCorr11x11_PreAlign_u_neon,
+    db_SignedSquareNormCorr21x21_PreAlign_u_neon,
+    db_ScalarProduct32_s_neon,
+    db_ScalarProduct128_s_neon,
+    db_ScalarProduct512_s_neon
+};
+
+const db_MatchingKernels_u *db_GetMatchingKernelsSimd_u()
+{
+    static const bool neon=db_CpuHasNeon();
+    return(neon?&db_matching_kernels_neon:NULL);
+}
+
+#elif defined(__SSE2__)
+
+inline int db_HorizontalSum_sse2(__m128i v)
+{
+    v=_mm_add_epi32(v,_mm_shuffle_epi32(v,_MM_SHUFFLE(1,0,3,2)));
+    v=_mm_add_epi32(v,_mm_shuffle_epi32(v,_MM_SHUFFLE(2,3,0,1)));
+    return(_mm_cvtsi128_si32(v));
+}
+
+static void db_SignedSquareNormCorr11x11_PreAlign_u_sse2(short *patch,const unsigned char * const *f_img,int x_f,int y_f,float *sum,float *recip)
+{
+    float den;
+    int f2sum,fsum,r;
+    int xm_f=x_f-5;
+    const unsigned char *pf;
+    const __m128i zero=_mm_setzero_si128();
+    __m128i lo,hi,acc=zero,acc2=zero;
+
+    for(r=0;r<11;r++)
+    {
+        pf=f_img[y_f-5+r]+xm_f;
+        /*Pixels 0-7, and 8-10 followed by zeros*/
+        lo=_mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)pf),zero);
+        hi=_mm_unpacklo_epi8(_mm_srli_si128(_mm_loadl_epi64((const __m128i*)(pf+3)),5),zero);
+
+        /*The zeros are overwritten by the next row*/
+        _mm_storeu_si128((__m128i*)(patch+11*r),lo);
+        _mm_storeu_si128((__m128i*)(patch+11*r+8),hi);
+
+        acc=_mm_add_epi16(acc,_mm_add_epi16(lo,hi));
+        acc2=_mm_add_epi32(acc2,_mm_madd_epi16(lo,lo));
+        acc2=_mm_add_epi32(acc2,_mm_madd_epi16(hi,hi));
+    }
+    patch[126]=0;
+    patch[127]=0;
+
+    fsum=db_HorizontalSum_sse2(_mm_madd_epi16(acc,_mm_set1_epi16(1)));
+    f2sum=db_HorizontalSum_sse2(acc2);
+
+    *sum= (float) fsum;
+    den=(121.0f*f2sum-fsum*fsum);
+    *recip= (float)((den!=0.0)?1.0/den:0.0);
+}
+
+static void db_SignedSquareNormCorr21x21_PreAlign_u_sse2(short *patch,const unsigned char * const *f_img,int x_f,int y_f,float *sum,float *recip)
+{
+    float den;
+    int f2sum,fsum,r,i;
+    int xm_f=x_f-10;
+    const unsigned char *pf;
+    const __m128i zero=_mm_setzero_si128();
+    __m128i v,a,b,c,acc=zero,acc2=zero;
+
+    for(r=0;r<21;r++)
+    {
+        pf=f_img[y_f-10+r]+xm_f;
+        /*Pixels 0-15, and 16-20 followed by zeros*/
+        v=_mm_loadu_si128((const __m128i*)pf);
+        a=_mm_unpacklo_epi8(v,zero);
+        b=_mm_unpackhi_epi8(v,zero);
+        c=_mm_unpacklo_epi8(_mm_srli_si128(_mm_loadl_epi64((const __m128i*)(pf+13)),3),zero);
+
+        /*The zeros are overwritten by the next row*/
+        _mm_storeu_si128((__m128i*)(patch+21*r),a);
+        _mm_storeu_si128((__m128i*)(patch+21*r+8),b);
+        _mm_storeu_si128((__m128i*)(patch+21*r+16),c);
+
+        acc=_mm_add_epi16(acc,_mm_add_epi16(_mm_add_epi16(a,b),c));
+        acc2=_mm_add_epi32(acc2,_mm_madd_epi16(a,a));
+        acc2=_mm_add_epi32(acc2,_mm_madd_epi16(b,b));
+        acc2=_mm_add_epi32(acc2,_mm_madd_epi16(c,c));
+    }
+    for(i=441;i<512;i++) patch[i]=0;
+
+    fsum=db_HorizontalSum_sse2(_mm_madd_epi16(acc,_mm_set1_epi16(1)));
+    f2sum=db_HorizontalSum_sse2(acc2);
+
+    *sum= (float) fsum;
+    den=(441.0f*f2sum-(float)fsum*(float)fsum);
+    *recip= (float)((den!=0.0)?1.0/den:0.0);
+}
+
+/*Scalar product of short vectors of length n, a multiple of 8*/
+inline int db_ScalarProduct_s_sse2(const short *f,const short *g,int n)
+{
+    int i;
+    __m128i acc=_mm_setzero_si128();
+
+    for(i=0;i<n;i+=8)
+    {
+        acc=_mm_add_epi32(acc,_mm_madd_epi16(_mm_loadu_si128((const __m128i*)(f+i)),
+            _mm_loadu_si128((const __m128i*)(g+i))));
+    }
+    return(db_HorizontalSum_sse2(acc));
+}
+
+static int db_ScalarProduct32_s_sse2(const short *f,const short *g)
+{
+    return(db_ScalarProduct_s_sse2(f,g,32));
+}
+
+static int db_ScalarProduct128_s_sse2(const short *f,const short *g)
+{
+    return(db_ScalarProduct_s_sse2(f,g,128));
+}
+
+static int db_ScalarProduct512_s_sse2(const short *f,const short *g)
+{
+    return(db_ScalarProduct_s_sse2(f,g,512));
+}
+
+static const db_MatchingKernels_u db_matching_kernels_sse2=
+{
+    db_SignedSquareNormCorr11x11_PreAlign_u_sse2,
+    db_SignedSquareNormCorr21x21_PreAlign_u_sse2,
+    db_ScalarProduct32_s_sse2,
+    db_ScalarProduct128_s_sse2,
+    db_ScalarProduct512_s_sse2
+};
+
+const db_MatchingKernels_u *db_GetMatchingKernelsSimd_u()
+{
+    return(&db_matching_kernels_sse2);
+}
+
+#else
+
+const db_MatchingKernels_u *db_GetMatchingKernelsSimd_u()
+{
+    return(NULL);
+}
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DB_FEATURE_MATCHING_SIMD_H
+#define DB_FEATURE_MATCHING_SIMD_H
+
+/*****************************************************************
+*    Lean and mean begins here                                   *
+*****************************************************************/
+
+#include "db_utilities.h"
+
+/*!
+ * \ingroup FeatureMatching
+ * \brief Kernels of the correlation matching of unsigned char images.
+ *
+ * The patch layout kernels copy a square window around (x_f,y_f) into a
+ * zero padded patch of shorts and compute its sum and the reciprocal of its
+ * normalized energy. The scalar products correlate two such patches. All
+ * the arithmetic is integer until the final float conversion, so every
+ * implementation gives bit-identical results.
+ */
+typedef struct
+{
+    void (*SignedSquareNormCorr11x11_PreAlign_u)(short *patch,const unsigned char * const *f_img,int x_f,int y_f,float *sum,float *recip);
+    void (*SignedSquareNormCorr21x21_PreAlign_u)(short *patch,const unsigned char * const *f_img,int x_f,int y_f,float *sum,float *recip);
+    int (*ScalarProduct32_s)(const short *f,const short *g);
+    int (*ScalarProduct128_s)(const short *f,const short *g);
+    int (*ScalarProduct512_s)(const short *f,const short *g);
+} db_MatchingKernels_u;
+
+/*!
+ Plain C kernels
+ */
+DB_API const db_MatchingKernels_u *db_GetMatchingKernels_u();
+/*!
+ NEON or SSE2 kernels, or NULL if neither is compiled in or the CPU lacks them.
+ On ARM the file holding them is the only one built with NEON enabled.
+ */
+DB_API const db_MatchingKernels_u *db_GetMatchingKernelsSimd_u();
+
+/*!
+ Choose between the SIMD and the plain C kernels for db_Matcher_u. SIMD is
+ used by default where available. Scores are the same either way.
+ */
+DB_API void db_SetMatchingSimdEnabled(bool enable);
+DB_API bool db_MatchingSimdEnabled();
+
+#endif /*DB_FEATURE_MATCHING_SIMD_H*/
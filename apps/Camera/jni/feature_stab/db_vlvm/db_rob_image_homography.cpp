@@ -620,6 +620,214 @@ void db_RobCamRotation_Polish_Generic(double H[9],int point_count,int homography
         }
     }
 }
+
+/*Draw nr_samples minimal samples from the first point_count points and
+store the hypotheses they give at hyp_H_array. Return the number of
+hypotheses, which can differ from nr_samples for the focal length models*/
+inline int db_RobImageHomography_Hypotheses(double *hyp_H_array,int nr_samples,int homography_type,int point_count,
+                                            double *x_h,double *xp_h,double *x_i,double *xp_i,int &r_seed)
+{
+    int i,hyp_count;
+    /*Random sample*/
+    int s[4];
+    /*Array of pointers to inhomogenous coordinates*/
+    double *X[3],*Xp[3];
+    /*Similarity parameters*/
+    int orientation_preserving,allow_scaling,allow_rotation,allow_translation,sample_size;
+
+    hyp_count=0;
+    switch(homography_type)
+    {
+    case DB_HOMOGRAPHY_TYPE_SIMILARITY:
+    case DB_HOMOGRAPHY_TYPE_SIMILARITY_U:
+    case DB_HOMOGRAPHY_TYPE_TRANSLATION:
+    case DB_HOMOGRAPHY_TYPE_ROTATION:
+    case DB_HOMOGRAPHY_TYPE_ROTATION_U:
+    case DB_HOMOGRAPHY_TYPE_SCALING:
+    case DB_HOMOGRAPHY_TYPE_S_T:
+    case DB_HOMOGRAPHY_TYPE_R_T:
+    case DB_HOMOGRAPHY_TYPE_R_S:
+
+        switch(homography_type)
+        {
+        case DB_HOMOGRAPHY_TYPE_SIMILARITY:
+            orientation_preserving=1;
+            allow_scaling=1;
+            allow_rotation=1;
+            allow_translation=1;
+            sample_size=2;
+            break;
+        case DB_HOMOGRAPHY_TYPE_SIMILARITY_U:
+            orientation_preserving=0;
+            allow_scaling=1;
+            allow_rotation=1;
+            allow_translation=1;
+            sample_size=3;
+            break;
+        case DB_HOMOGRAPHY_TYPE_TRANSLATION:
+            orientation_preserving=1;
+            allow_scaling=0;
+            allow_rotation=0;
+            allow_translation=1;
+            sample_size=1;
+            break;
+        case DB_HOMOGRAPHY_TYPE_ROTATION:
+            orientation_preserving=1;
+            allow_scaling=0;
+            allow_rotation=1;
+            allow_translation=0;
+            sample_size=1;
+            break;
+        case DB_HOMOGRAPHY_TYPE_ROTATION_U:
+            orientation_preserving=0;
+            allow_scaling=0;
+            allow_rotation=1;
+            allow_translation=0;
+            sample_size=2;
+            break;
+        case DB_HOMOGRAPHY_TYPE_SCALING:
+            orientation_preserving=1;
+            allow_scaling=1;
+            allow_rotation=0;
+            allow_translation=0;
+            sample_size=1;
+            break;
+        case DB_HOMOGRAPHY_TYPE_S_T:
+            orientation_preserving=1;
+            allow_scaling=1;
+            allow_rotation=0;
+            allow_translation=1;
+            sample_size=2;
+            break;
+        case DB_HOMOGRAPHY_TYPE_R_T:
+            orientation_preserving=1;
+            allow_scaling=0;
+            allow_rotation=1;
+            allow_translation=1;
+            sample_size=2;
+            break;
+        case DB_HOMOGRAPHY_TYPE_R_S:
+            orientation_preserving=1;
+            allow_scaling=1;
+            allow_rotation=0;
+            allow_translation=0;
+            sample_size=1;
+            break;
+        }
+
+        if(point_count>=sample_size) for(i=0;i<nr_samples;i++)
+        {
+            db_RandomSample(s,3,point_count,r_seed);
+            X[0]= &x_i[s[0]<<1];
+            X[1]= &x_i[s[1]<<1];
+            X[2]= &x_i[s[2]<<1];
+            Xp[0]= &xp_i[s[0]<<1];
+            Xp[1]= &xp_i[s[1]<<1];
+            Xp[2]= &xp_i[s[2]<<1];
+            db_StitchSimilarity2D(&hyp_H_array[9*hyp_count],Xp,X,sample_size,orientation_preserving,
+                                  allow_scaling,allow_rotation,allow_translation);
+            hyp_count++;
+        }
+        break;
+
+    case DB_HOMOGRAPHY_TYPE_CAMROTATION:
+        if(point_count>=2) for(i=0;i<nr_samples;i++)
+        {
+            db_RandomSample(s,2,point_count,r_seed);
+            db_StitchCameraRotation_2Points(&hyp_H_array[9*hyp_count],
+                                      &x_h[3*s[0]],&x_h[3*s[1]],
+                                      &xp_h[3*s[0]],&xp_h[3*s[1]]);
+            hyp_count++;
+        }
+        break;
+
+    case DB_HOMOGRAPHY_TYPE_CAMROTATION_F:
+        if(point_count>=3) for(i=0;i<nr_samples;i++)
+        {
+            db_RandomSample(s,3,point_count,r_seed);
+            hyp_count+=db_StitchRotationCommonFocalLength_3Points(&hyp_H_array[9*hyp_count],
+                                      &x_h[3*s[0]],&x_h[3*s[1]],&x_h[3*s[2]],
+                                      &xp_h[3*s[0]],&xp_h[3*s[1]],&xp_h[3*s[2]]);
+        }
+        break;
+
+    case DB_HOMOGRAPHY_TYPE_CAMROTATION_F_UD:
+        if(point_count>=3) for(i=0;i<nr_samples;i++)
+        {
+            db_RandomSample(s,3,point_count,r_seed);
+            hyp_count+=db_StitchRotationCommonFocalLength_3Points(&hyp_H_array[9*hyp_count],
+                                      &x_h[3*s[0]],&x_h[3*s[1]],&x_h[3*s[2]],
+                                      &xp_h[3*s[0]],&xp_h[3*s[1]],&xp_h[3*s[2]],NULL,0);
+        }
+        break;
+
+    case DB_HOMOGRAPHY_TYPE_AFFINE:
+        if(point_count>=3) for(i=0;i<nr_samples;i++)
+        {
+            db_RandomSample(s,3,point_count,r_seed);
+            db_StitchAffine2D_3Points(&hyp_H_array[9*hyp_count],
+                                      &x_h[3*s[0]],&x_h[3*s[1]],&x_h[3*s[2]],
+                                      &xp_h[3*s[0]],&xp_h[3*s[1]],&xp_h[3*s[2]]);
+            hyp_count++;
+        }
+        break;
+
+    case DB_HOMOGRAPHY_TYPE_PROJECTIVE:
+    default:
+        if(point_count>=4) for(i=0;i<nr_samples;i++)
+        {
+            db_RandomSample(s,4,point_count,r_seed);
+            db_StitchProjective2D_4Points(&hyp_H_array[9*hyp_count],
+                                      &x_h[3*s[0]],&x_h[3*s[1]],&x_h[3*s[2]],&x_h[3*s[3]],
+                                      &xp_h[3*s[0]],&xp_h[3*s[1]],&xp_h[3*s[2]],&xp_h[3*s[3]]);
+            hyp_count++;
+        }
+    }
+
+    return(hyp_count);
+}
+
+/*Number of correspondences in a minimal sample*/
+inline int db_RobImageHomography_SampleSize(int homography_type)
+{
+    switch(homography_type)
+    {
+    case DB_HOMOGRAPHY_TYPE_TRANSLATION:
+    case DB_HOMOGRAPHY_TYPE_ROTATION:
+    case DB_HOMOGRAPHY_TYPE_SCALING:
+    case DB_HOMOGRAPHY_TYPE_R_S:
+        return(1);
+    case DB_HOMOGRAPHY_TYPE_SIMILARITY:
+    case DB_HOMOGRAPHY_TYPE_ROTATION_U:
+    case DB_HOMOGRAPHY_TYPE_S_T:
+    case DB_HOMOGRAPHY_TYPE_R_T:
+    case DB_HOMOGRAPHY_TYPE_CAMROTATION:
+        return(2);
+    case DB_HOMOGRAPHY_TYPE_SIMILARITY_U:
+    case DB_HOMOGRAPHY_TYPE_CAMROTATION_F:
+    case DB_HOMOGRAPHY_TYPE_CAMROTATION_F_UD:
+    case DB_HOMOGRAPHY_TYPE_AFFINE:
+        return(3);
+    case DB_HOMOGRAPHY_TYPE_PROJECTIVE:
+    default:
+        return(4);
+    }
+}
+
+/*Number of samples to draw so that at least one is free of outliers
+with probability confidence, given an inlier fraction of inliers/nr_points*/
+inline double db_RobImageHomography_RequiredSamples(int inliers,int nr_points,int sample_size,double confidence)
+{
+    double p;
+
+    if(inliers<=0 || confidence>=1.0) return(HUGE_VAL);
+    /*Probability that a sample is all inliers*/
+    p=pow(((double)inliers)/((double)db_maxi(nr_points,1)),sample_size);
+    if(p>=1.0) return(1.0);
+    return(log(1.0-confidence)/log(1.0-p));
+}
+
+
 void db_RobImageHomography(
                               /*Best homography*/
                               double H[9],
@@ -664,7 +872,9 @@ void db_RobImageHomography(
                               // raw image coordinates
                               double *im_raw, double *im_raw_p,
                               // final matches
-                              int *finalNumE)
+                              int *finalNumE,
+                              double confidence,
+                              int *nr_hypotheses)
 {
     /*Random seed*/
     int r_seed;
@@ -678,8 +888,6 @@ void db_RobImageHomography(
     double acc;
     /*Hypothesis pointer*/
     double *hyp_point;
-    /*Random sample*/
-    int s[4];
     /*Pivot for hypothesis pruning*/
     double pivot;
     /*Best hypothesis position*/
@@ -698,10 +906,9 @@ void db_RobImageHomography(
     double H_temp[9],H_temp2[9];
     /*Pointers to homogenous coordinates*/
     double *x_h_point,*xp_h_point;
-    /*Array of pointers to inhomogenous coordinates*/
-    double *X[3],*Xp[3];
-    /*Similarity parameters*/
-    int orientation_preserving,allow_scaling,allow_rotation,allow_translation,sample_size;
+    /*Adaptive stopping*/
+    int sample_size,batch_size,new_hyp_count,test_count,inliers,best_inliers;
+    double t2;
 
     /*Homogenous coordinates of image points in first image*/
     double *x_h;
@@ -778,151 +985,37 @@ void db_RobImageHomography(
 
     /*Generate Hypotheses*/
     hyp_count=0;
-    switch(homography_type)
+    if(confidence<=0.0)
     {
-    case DB_HOMOGRAPHY_TYPE_SIMILARITY:
-    case DB_HOMOGRAPHY_TYPE_SIMILARITY_U:
-    case DB_HOMOGRAPHY_TYPE_TRANSLATION:
-    case DB_HOMOGRAPHY_TYPE_ROTATION:
-    case DB_HOMOGRAPHY_TYPE_ROTATION_U:
-    case DB_HOMOGRAPHY_TYPE_SCALING:
-    case DB_HOMOGRAPHY_TYPE_S_T:
-    case DB_HOMOGRAPHY_TYPE_R_T:
-    case DB_HOMOGRAPHY_TYPE_R_S:
-
-        switch(homography_type)
-        {
-        case DB_HOMOGRAPHY_TYPE_SIMILARITY:
-            orientation_preserving=1;
-            allow_scaling=1;
-            allow_rotation=1;
-            allow_translation=1;
-            sample_size=2;
-            break;
-        case DB_HOMOGRAPHY_TYPE_SIMILARITY_U:
-            orientation_preserving=0;
-            allow_scaling=1;
-            allow_rotation=1;
-            allow_translation=1;
-            sample_size=3;
-            break;
-        case DB_HOMOGRAPHY_TYPE_TRANSLATION:
-            orientation_preserving=1;
-            allow_scaling=0;
-            allow_rotation=0;
-            allow_translation=1;
-            sample_size=1;
-            break;
-        case DB_HOMOGRAPHY_TYPE_ROTATION:
-            orientation_preserving=1;
-            allow_scaling=0;
-            allow_rotation=1;
-            allow_translation=0;
-            sample_size=1;
-            break;
-        case DB_HOMOGRAPHY_TYPE_ROTATION_U:
-            orientation_preserving=0;
-            allow_scaling=0;
-            allow_rotation=1;
-            allow_translation=0;
-            sample_size=2;
-            break;
-        case DB_HOMOGRAPHY_TYPE_SCALING:
-            orientation_preserving=1;
-            allow_scaling=1;
-            allow_rotation=0;
-            allow_translation=0;
-            sample_size=1;
-            break;
-        case DB_HOMOGRAPHY_TYPE_S_T:
-            orientation_preserving=1;
-            allow_scaling=1;
-            allow_rotation=0;
-            allow_translation=1;
-            sample_size=2;
-            break;
-        case DB_HOMOGRAPHY_TYPE_R_T:
-            orientation_preserving=1;
-            allow_scaling=0;
-            allow_rotation=1;
-            allow_translation=1;
-            sample_size=2;
-            break;
-        case DB_HOMOGRAPHY_TYPE_R_S:
-            orientation_preserving=1;
-            allow_scaling=1;
-            allow_rotation=0;
-            allow_translation=0;
-            sample_size=1;
-            break;
-        }
-
-        if(point_count>=sample_size) for(i=0;i<nr_samples;i++)
-        {
-            db_RandomSample(s,3,point_count,r_seed);
-            X[0]= &x_i[s[0]<<1];
-            X[1]= &x_i[s[1]<<1];
-            X[2]= &x_i[s[2]<<1];
-            Xp[0]= &xp_i[s[0]<<1];
-            Xp[1]= &xp_i[s[1]<<1];
-            Xp[2]= &xp_i[s[2]<<1];
-            db_StitchSimilarity2D(&hyp_H_array[9*hyp_count],Xp,X,sample_size,orientation_preserving,
-                                  allow_scaling,allow_rotation,allow_translation);
-            hyp_count++;
-        }
-        break;
-
-    case DB_HOMOGRAPHY_TYPE_CAMROTATION:
-        if(point_count>=2) for(i=0;i<nr_samples;i++)
-        {
-            db_RandomSample(s,2,point_count,r_seed);
-            db_StitchCameraRotation_2Points(&hyp_H_array[9*hyp_count],
-                                      &x_h[3*s[0]],&x_h[3*s[1]],
-                                      &xp_h[3*s[0]],&xp_h[3*s[1]]);
-            hyp_count++;
-        }
-        break;
-
-    case DB_HOMOGRAPHY_TYPE_CAMROTATION_F:
-        if(point_count>=3) for(i=0;i<nr_samples;i++)
-        {
-            db_RandomSample(s,3,point_count,r_seed);
-            hyp_count+=db_StitchRotationCommonFocalLength_3Points(&hyp_H_array[9*hyp_count],
-                                      &x_h[3*s[0]],&x_h[3*s[1]],&x_h[3*s[2]],
-                                      &xp_h[3*s[0]],&xp_h[3*s[1]],&xp_h[3*s[2]]);
-        }
-        break;
-
-    case DB_HOMOGRAPHY_TYPE_CAMROTATION_F_UD:
-        if(point_count>=3) for(i=0;i<nr_samples;i++)
+        hyp_count=db_RobImageHomography_Hypotheses(hyp_H_array,nr_samples,homography_type,point_count,x_h,xp_h,x_i,xp_i,r_seed);
+    }
+    else
+    {
+        /*Draw batches and score each hypothesis on the first chunk of the
+        permuted points. Stop when the best inlier fraction so far makes
+        an outlier free sample likely enough*/
+        sample_size=db_RobImageHomography_SampleSize(homography_type);
+        test_count=db_mini(point_count,chunk_size);
+        t2=DB_OUTLIER_THRESHOLD*DB_OUTLIER_THRESHOLD;
+        best_inliers=0;
+        for(i=0;(i<nr_samples) && (point_count>=sample_size);)
         {
-            db_RandomSample(s,3,point_count,r_seed);
-            hyp_count+=db_StitchRotationCommonFocalLength_3Points(&hyp_H_array[9*hyp_count],
-                                      &x_h[3*s[0]],&x_h[3*s[1]],&x_h[3*s[2]],
-                                      &xp_h[3*s[0]],&xp_h[3*s[1]],&xp_h[3*s[2]],NULL,0);
-        }
-        break;
+            batch_size=db_mini(DB_DEFAULT_BATCH_SIZE,nr_samples-i);
+            new_hyp_count=db_RobImageHomography_Hypotheses(hyp_H_array+9*hyp_count,batch_size,homography_type,point_count,x_h,xp_h,x_i,xp_i,r_seed);
+            i+=batch_size;
 
-    case DB_HOMOGRAPHY_TYPE_AFFINE:
-        if(point_count>=3) for(i=0;i<nr_samples;i++)
-        {
-            db_RandomSample(s,3,point_count,r_seed);
-            db_StitchAffine2D_3Points(&hyp_H_array[9*hyp_count],
-                                      &x_h[3*s[0]],&x_h[3*s[1]],&x_h[3*s[2]],
-                                      &xp_h[3*s[0]],&xp_h[3*s[1]],&xp_h[3*s[2]]);
-            hyp_count++;
-        }
-        break;
+            for(j=hyp_count;j<hyp_count+new_hyp_count;j++)
+            {
+                hyp_point=hyp_H_array+9*j;
+                for(inliers=0,c=0;c<test_count;c++)
+                {
+                    inliers+=(db_SquaredInhomogenousHomographyError(xp_i+(c<<1),hyp_point,x_i+(c<<1))*one_over_scale2<=t2)?1:0;
+                }
+                best_inliers=db_maxi(best_inliers,inliers);
+            }
+            hyp_count+=new_hyp_count;
 
-    case DB_HOMOGRAPHY_TYPE_PROJECTIVE:
-    default:
-        if(point_count>=4) for(i=0;i<nr_samples;i++)
-        {
-            db_RandomSample(s,4,point_count,r_seed);
-            db_StitchProjective2D_4Points(&hyp_H_array[9*hyp_count],
-                                      &x_h[3*s[0]],&x_h[3*s[1]],&x_h[3*s[2]],&x_h[3*s[3]],
-                                      &xp_h[3*s[0]],&xp_h[3*s[1]],&xp_h[3*s[2]],&xp_h[3*s[3]]);
-            hyp_count++;
+            if(i>=db_RobImageHomography_RequiredSamples(best_inliers,test_count,sample_size,confidence)) break;
         }
     }
 
@@ -1070,7 +1163,12 @@ void db_RobImageHomography(
         break;
     }
 
-    db_RobImageHomography_Statistics(H_temp,db_mini(point_count,max_points),x_i,xp_i,one_over_scale2,stat);
+    if(nr_hypotheses) *nr_hypotheses=hyp_count;
+    if(stat)
+    {
+        stat->nr_hypotheses=hyp_count;
+        db_RobImageHomography_Statistics(H_temp,db_mini(point_count,max_points),x_i,xp_i,one_over_scale2,stat);
+    }
 
     /*Put on the calibration matrices*/
     db_Multiply3x3_3x3(H_temp2,H_temp,K_inv);
@@ -81,8 +81,12 @@ Calibration matrices:
  \param max_iterations  max number of polishing steps
  \param max_points      only use this many points
  \param scale           Cauchy scale coefficient (see db_ExpCauchyReprojectionError() )
- \param nr_samples      number of times to compute a hypothesis
+ \param nr_samples      number of times to compute a hypothesis, the maximum if confidence>0
  \param chunk_size      size of cost chunks
+ \param confidence      if >0, stop drawing samples once one free of outliers has been drawn
+                        with this probability, as estimated from the best inlier fraction on
+                        the first chunk
+ \param nr_hypotheses   if not NULL, receives the number of hypotheses scored
 */
 DB_API void db_RobImageHomography(
                               /*Best homography*/
@@ -127,7 +131,11 @@ DB_API void db_RobImageHomography(
                               // raw image coordinates
                               double *im_raw=NULL, double *im_raw_p=NULL,
                               // final matches
-                              int *final_NumE=0);
+                              int *final_NumE=0,
+                              // adaptive number of samples
+                              double confidence=0.0,
+                              // number of hypotheses scored
+                              int *nr_hypotheses=NULL);
 
 DB_API double db_RobImageHomography_Cost(double H[9],int point_count,double *x_i,
                                                 double *xp_i,double one_over_scale2);
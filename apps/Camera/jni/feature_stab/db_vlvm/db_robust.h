@@ -55,6 +55,7 @@
      int posecov_inliercount;
      int posecovready;
      double median_reprojection_error;
+     int nr_hypotheses;
  };
  typedef db_stat_struct db_Statistics;
 
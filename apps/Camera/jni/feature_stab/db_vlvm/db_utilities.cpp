@@ -164,6 +164,22 @@ void db_PrintDoubleVector(double *a,long size)
     printf("]");
 }
 
+bool db_CpuHasNeon()
+{
+    char line[512];
+    bool neon=false;
+    FILE *fp=fopen("/proc/cpuinfo","r");
+
+    if(fp==NULL) return(false);
+    while(!neon && fgets(line,sizeof(line),fp)!=NULL)
+    {
+        if(strncmp(line,"Features",8)==0 &&
+            (strstr(line," neon")!=NULL || strstr(line,"\tneon")!=NULL)) neon=true;
+    }
+    fclose(fp);
+    return(neon);
+}
+
 void db_PrintDoubleMatrix(double *a,long rows,long cols)
 {
     printf("[\n");
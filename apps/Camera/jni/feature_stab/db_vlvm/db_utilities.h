@@ -555,6 +555,11 @@ DB_API void db_WarpImageLut_u(const unsigned char * const * src,unsigned char **
 DB_API void db_PrintDoubleVector(double *a,long size);
 DB_API void db_PrintDoubleMatrix(double *a,long rows,long cols);
 
+/*!
+ Whether /proc/cpuinfo lists NEON among the CPU features
+ */
+DB_API bool db_CpuHasNeon();
+
 #include "db_utilities_constants.h"
 #include "db_utilities_algebra.h"
 #include "db_utilities_indexing.h"
@@ -47,6 +47,7 @@
 #define DB_DEFAULT_NR_SAMPLES 500
 #define DB_DEFAULT_CHUNK_SIZE 100
 #define DB_DEFAULT_GROUP_SIZE 10
+#define DB_DEFAULT_BATCH_SIZE 20 /*Hypotheses drawn between adaptive stopping tests*/
 
 /*Optimisation parameters*/
 #define DB_DEFAULT_MAX_POINTS 1000
@@ -64,6 +65,9 @@
 #define DB_DEFAULT_ABS_CORNER_THRESHOLD 50000000.0
 #define DB_DEFAULT_REL_CORNER_THRESHOLD 0.00005
 #define DB_DEFAULT_MAX_DISPARITY 0.1
+#define DB_MAX_TRACK_RADIUS 8
+#define DB_DEFAULT_TRACK_RADIUS 4
+#define DB_DEFAULT_TRACK_MIN_SCORE 0.5f
 #define DB_DEFAULT_NO_DISPARITY -1.0
 #define DB_DEFAULT_MAX_TRACK_LENGTH 300
 
@@ -121,6 +125,21 @@
  * \def DB_DEFAULT_NO_DISPARITY
  * \ingroup FeatureMatching
  * \brief Indicates that vertical disparity is the same as horizontal disparity.
+*/
+ /*!
+ * \def DB_MAX_TRACK_RADIUS
+ * \ingroup FeatureMatching
+ * \brief Largest search radius (in pixels) of db_TrackFeatures_u().
+*/
+ /*!
+ * \def DB_DEFAULT_TRACK_RADIUS
+ * \ingroup FeatureMatching
+ * \brief Default search radius (in pixels) around the predicted position of a tracked feature.
+*/
+ /*!
+ * \def DB_DEFAULT_TRACK_MIN_SCORE
+ * \ingroup FeatureMatching
+ * \brief Minimum signed squared normalized correlation of a tracked feature.
 */
 ///////////////////////////////////////////////////////////////////////////////////
  /*!
@@ -0,0 +1,160 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "db_worker_pool.h"
+#include <unistd.h>
+
+
+
+/*****************************************************************
+*    Lean and mean begins here                                   *
+*****************************************************************/
+
+db_WorkerPool::db_WorkerPool()
+{
+    m_nr_threads=1;
+    m_func=NULL;
+    m_arg=NULL;
+    m_count=m_next=m_done=m_generation=0;
+    m_quit=false;
+
+    pthread_mutex_init(&m_lock,NULL);
+    pthread_cond_init(&m_wake,NULL);
+    pthread_cond_init(&m_finished,NULL);
+}
+
+db_WorkerPool::~db_WorkerPool()
+{
+    Clean();
+
+    pthread_cond_destroy(&m_finished);
+    pthread_cond_destroy(&m_wake);
+    pthread_mutex_destroy(&m_lock);
+}
+
+int db_WorkerPool::NrCpus()
+{
+    long ncpu=sysconf(_SC_NPROCESSORS_ONLN);
+    return((ncpu>0)?(int)ncpu:1);
+}
+
+int db_WorkerPool::Init(int nr_threads)
+{
+    int i;
+
+    Clean();
+
+    if(nr_threads<=0) nr_threads=NrCpus();
+    nr_threads=db_mini(nr_threads,MAX_THREADS);
+
+    m_quit=false;
+    m_nr_threads=1;
+
+    /*The calling thread is the first member of the pool*/
+    for(i=1;i<nr_threads;i++)
+    {
+        if(pthread_create(&m_threads[i],NULL,ThreadEntry,this)!=0) break;
+        m_nr_threads++;
+    }
+    return(m_nr_threads);
+}
+
+void db_WorkerPool::Clean()
+{
+    int i;
+
+    if(m_nr_threads<=1) return;
+
+    pthread_mutex_lock(&m_lock);
+    m_quit=true;
+    pthread_cond_broadcast(&m_wake);
+    pthread_mutex_unlock(&m_lock);
+
+    for(i=1;i<m_nr_threads;i++) pthread_join(m_threads[i],NULL);
+
+    m_nr_threads=1;
+}
+
+void db_WorkerPool::Run(db_TaskFunction func,void *arg,int count)
+{
+    int i;
+
+    if(m_nr_threads<=1 || count<=1)
+    {
+        for(i=0;i<count;i++) func(arg,i);
+        return;
+    }
+
+    pthread_mutex_lock(&m_lock);
+    m_func=func;
+    m_arg=arg;
+    m_count=count;
+    m_next=0;
+    m_done=0;
+    m_generation++;
+    pthread_cond_broadcast(&m_wake);
+
+    DrainTasks();
+
+    while(m_done<m_count) pthread_cond_wait(&m_finished,&m_lock);
+    pthread_mutex_unlock(&m_lock);
+}
+
+void *db_WorkerPool::ThreadEntry(void *pool)
+{
+    ((db_WorkerPool*)pool)->WorkerLoop();
+    return(NULL);
+}
+
+void db_WorkerPool::WorkerLoop()
+{
+    int seen;
+
+    pthread_mutex_lock(&m_lock);
+    seen=m_generation;
+    for(;;)
+    {
+        while(!m_quit && m_generation==seen) pthread_cond_wait(&m_wake,&m_lock);
+
+        if(m_quit) break;
+
+        seen=m_generation;
+        DrainTasks();
+    }
+    pthread_mutex_unlock(&m_lock);
+}
+
+/*Claim and run tasks of the current job until none are left. Called with
+m_lock held; the lock is dropped while a task executes*/
+void db_WorkerPool::DrainTasks()
+{
+    int index;
+    db_TaskFunction func;
+    void *arg;
+
+    while(m_next<m_count)
+    {
+        index=m_next++;
+        func=m_func;
+        arg=m_arg;
+
+        pthread_mutex_unlock(&m_lock);
+        func(arg,index);
+        pthread_mutex_lock(&m_lock);
+
+        if(++m_done==m_count) pthread_cond_broadcast(&m_finished);
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef DB_WORKER_POOL_H
+#define DB_WORKER_POOL_H
+
+/*****************************************************************
+*    Lean and mean begins here                                   *
+*****************************************************************/
+
+#include "db_utilities.h"
+#include <pthread.h>
+
+/*!
+ * \defgroup LMThreading (LM) Threading Utilities
+ */
+/*\{*/
+
+/*!
+ Task run by db_WorkerPool::Run() for each index of a job
+ */
+typedef void (*db_TaskFunction)(void *arg,int index);
+
+/*!
+ * \class db_WorkerPool
+ * \ingroup LMThreading
+ * \brief Fixed set of worker threads splitting a job of indexed tasks.
+ *
+ * The thread calling Run() takes part in the work, so a pool of n threads
+ * spawns n-1 workers. A pool of one thread runs every task inline.
+ */
+class DB_API db_WorkerPool
+{
+public:
+    db_WorkerPool();
+    ~db_WorkerPool();
+
+    /*!
+     Start the worker threads. Return the number of threads actually running,
+     including the caller.
+     \param nr_threads  total number of threads, <=0 for one per online CPU
+     */
+    int Init(int nr_threads);
+    /*!
+     Stop and join the worker threads
+     */
+    void Clean();
+    /*!
+     Run func(arg,i) for i in [0,count) and return once all calls are done.
+     Tasks may run in any order and on any thread.
+     */
+    void Run(db_TaskFunction func,void *arg,int count);
+
+    int NrThreads() const { return(m_nr_threads); }
+
+    /*!
+     Number of online CPUs
+     */
+    static int NrCpus();
+
+    /*Upper bound on the number of threads in a pool*/
+    static const int MAX_THREADS=8;
+
+protected:
+    static void *ThreadEntry(void *pool);
+    void WorkerLoop();
+    void DrainTasks();
+
+    pthread_t m_threads[MAX_THREADS];
+    int m_nr_threads;
+
+    pthread_mutex_t m_lock;
+    pthread_cond_t m_wake;
+    pthread_cond_t m_finished;
+
+    /*Current job, protected by m_lock*/
+    db_TaskFunction m_func;
+    void *m_arg;
+    int m_count,m_next,m_done,m_generation;
+    bool m_quit;
+
+private:
+    /*Not copyable*/
+    db_WorkerPool(const db_WorkerPool&);
+    db_WorkerPool& operator=(const db_WorkerPool&);
+};
+
+/*\}*/
+
+#endif /*DB_WORKER_POOL_H*/
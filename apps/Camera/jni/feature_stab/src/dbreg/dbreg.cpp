@@ -18,13 +18,18 @@
 #include "dbreg.h"
 #include <string.h>
 #include <stdio.h>
-
-
-#if PROFILE
-#endif
+#include <sys/time.h>
 
 //#include <iostream>
 
+/* return current time in milliseconds */
+static double now_ms(void)
+{
+  struct timeval res;
+  gettimeofday(&res, NULL);
+  return 1000.0*res.tv_sec + (double)res.tv_usec/1e3;
+}
+
 db_FrameToReferenceRegistration::db_FrameToReferenceRegistration() :
   m_initialized(false),m_nr_matches(0),m_over_allocation(256),m_nr_bins(20),m_max_cost_pix(30), m_quarter_resolution(false)
 {
@@ -56,7 +61,14 @@ db_FrameToReferenceRegistration::db_FrameToReferenceRegistration() :
   m_sq_cost = NULL;
   m_cost_histogram = NULL;
 
-  profile_string = NULL;
+  m_ransac_confidence = 0.0;
+  m_track_radius = 0;
+  m_track_min_inlier_fraction = 0.5;
+  m_detected_inlier_count = 0;
+  db_Identity3x3(m_H_track_pred);
+
+  m_nr_profiles = 0;
+  pthread_mutex_init(&m_profile_lock, NULL);
 
   db_Identity3x3(m_K);
   db_Identity3x3(m_H_ref_to_ins);
@@ -74,6 +86,7 @@ db_FrameToReferenceRegistration::db_FrameToReferenceRegistration() :
 db_FrameToReferenceRegistration::~db_FrameToReferenceRegistration()
 {
   Clean();
+  pthread_mutex_destroy(&m_profile_lock);
 }
 
 void db_FrameToReferenceRegistration::Clean()
@@ -114,9 +127,6 @@ void db_FrameToReferenceRegistration::Clean()
 
   delete [] m_inlier_indices;
 
-  if(profile_string)
-    delete [] profile_string;
-
   m_reference_image = NULL;
   m_aligned_ins_image = NULL;
 
@@ -174,7 +184,7 @@ void db_FrameToReferenceRegistration::Init(int width, int height,
 
   m_quarter_resolution = quarter_resolution;
 
-  profile_string = new char[10240];
+  ResetProfiles();
 
   if (m_quarter_resolution == true)
   {
@@ -244,6 +254,8 @@ void db_FrameToReferenceRegistration::Init(int width, int height,
   m_initialized = true;
 
   m_max_inlier_count = 0;
+  m_detected_inlier_count = 0;
+  db_Identity3x3(m_H_track_pred);
 }
 
 
@@ -343,6 +355,13 @@ bool db_FrameToReferenceRegistration::NeedReferenceUpdate()
 
 int db_FrameToReferenceRegistration::AddFrame(const unsigned char * const * im, double H[9],bool force_reference,bool prewarp)
 {
+  db_RegistrationProfile profile;
+  double t_start, t0;
+
+  memset(&profile,0,sizeof(profile));
+  profile.frame = m_nr_frames_processed;
+  t_start = now_ms();
+
   m_current_is_reference = false;
   if(!m_reference_set || force_reference)
     {
@@ -350,6 +369,12 @@ int db_FrameToReferenceRegistration::AddFrame(const unsigned char * const * im,
       db_Copy9(H,m_H_ref_to_ins);
 
       UpdateReference(im,true,true);
+      m_detected_inlier_count = 0;
+      db_Identity3x3(m_H_track_pred);
+
+      profile.total_ms = profile.detect_ms = now_ms() - t_start;
+      profile.nr_corners = m_nr_corners_ref;
+      RecordProfile(profile);
       return 0;
     }
 
@@ -371,85 +396,90 @@ int db_FrameToReferenceRegistration::AddFrame(const unsigned char * const * im,
 
   m_sq_cost_computed = false;
 
-  // detect corners on inspection image and match to reference image features:s
-
-  // @jke - Adding code to time the functions.  TODO: Remove after test
-#if PROFILE
-  double iTimer1, iTimer2;
-  char str[255];
-  strcpy(profile_string,"\n");
-  sprintf(str,"[%dx%d] %p\n",m_im_width,m_im_height,im);
-  strcat(profile_string, str);
-#endif
+  // Track the reference corners from where the last homography puts them
+  // while that keeps enough inliers, otherwise detect and match afresh
+  bool track = (m_track_radius > 0 && m_detected_inlier_count > 0);
+  int nr_hypotheses = 0;
 
-  // @jke - Adding code to time the functions.  TODO: Remove after test
-#if PROFILE
-  iTimer1 = now_ms();
-#endif
-  m_cd.DetectCorners(imptr, m_x_corners_ins,m_y_corners_ins,&m_nr_corners_ins);
-  // @jke - Adding code to time the functions.  TODO: Remove after test
-# if PROFILE
-  iTimer2 = now_ms();
-  double elapsedTimeCorner = iTimer2 - iTimer1;
-  sprintf(str,"Corner Detection [%d corners] = %g ms\n",m_nr_corners_ins, elapsedTimeCorner);
-  strcat(profile_string, str);
-#endif
+  for (;;)
+  {
+    if (track)
+    {
+      double H_pred[9];
+      db_Copy9(H_pred,m_H_track_pred);
+      if (m_quarter_resolution)
+      {
+        H_pred[2] *= 0.5;
+        H_pred[5] *= 0.5;
+      }
 
-  // @jke - Adding code to time the functions.  TODO: Remove after test
-#if PROFILE
-  iTimer1 = now_ms();
-#endif
-    if(prewarp)
-  m_cm.Match(m_reference_image,imptr,m_x_corners_ref,m_y_corners_ref,m_nr_corners_ref,
-         m_x_corners_ins,m_y_corners_ins,m_nr_corners_ins,
-         m_match_index_ref,m_match_index_ins,&m_nr_matches,H,0);
+      t0 = now_ms();
+      m_nr_corners_ins = db_TrackFeatures_u(m_reference_image,imptr,m_im_width,m_im_height,
+             m_x_corners_ref,m_y_corners_ref,db_mini(m_nr_corners_ref,(int)m_max_nr_matches),
+             H_pred,m_track_radius,DB_DEFAULT_TRACK_MIN_SCORE,
+             m_match_index_ref,m_x_corners_ins,m_y_corners_ins);
+      m_nr_matches = m_nr_corners_ins;
+      for ( int i = 0; i < m_nr_matches; ++i )
+        m_match_index_ins[i] = i;
+      profile.match_ms += now_ms() - t0;
+    }
     else
-  m_cm.Match(m_reference_image,imptr,m_x_corners_ref,m_y_corners_ref,m_nr_corners_ref,
-         m_x_corners_ins,m_y_corners_ins,m_nr_corners_ins,
-         m_match_index_ref,m_match_index_ins,&m_nr_matches);
-  // @jke - Adding code to time the functions.  TODO: Remove after test
-# if PROFILE
-  iTimer2 = now_ms();
-  double elapsedTimeMatch = iTimer2 - iTimer1;
-  sprintf(str,"Matching [%d] = %g ms\n",m_nr_matches,elapsedTimeMatch);
-  strcat(profile_string, str);
-#endif
-
-
-  // copy out matching features:
-  for ( int i = 0; i < m_nr_matches; ++i )
     {
-      int offset = 3*i;
-      m_corners_ref[offset  ] = m_x_corners_ref[m_match_index_ref[i]];
-      m_corners_ref[offset+1] = m_y_corners_ref[m_match_index_ref[i]];
-      m_corners_ref[offset+2] = 1.0;
-
-      m_corners_ins[offset  ] = m_x_corners_ins[m_match_index_ins[i]];
-      m_corners_ins[offset+1] = m_y_corners_ins[m_match_index_ins[i]];
-      m_corners_ins[offset+2] = 1.0;
+      // detect corners on inspection image and match to reference image features:s
+      t0 = now_ms();
+      m_cd.DetectCorners(imptr, m_x_corners_ins,m_y_corners_ins,&m_nr_corners_ins);
+      profile.detect_ms += now_ms() - t0;
+
+      t0 = now_ms();
+        if(prewarp)
+      m_cm.Match(m_reference_image,imptr,m_x_corners_ref,m_y_corners_ref,m_nr_corners_ref,
+             m_x_corners_ins,m_y_corners_ins,m_nr_corners_ins,
+             m_match_index_ref,m_match_index_ins,&m_nr_matches,H,0);
+        else
+      m_cm.Match(m_reference_image,imptr,m_x_corners_ref,m_y_corners_ref,m_nr_corners_ref,
+             m_x_corners_ins,m_y_corners_ins,m_nr_corners_ins,
+             m_match_index_ref,m_match_index_ins,&m_nr_matches);
+      profile.match_ms += now_ms() - t0;
     }
 
-  // @jke - Adding code to time the functions.  TODO: Remove after test
-#if PROFILE
-  iTimer1 = now_ms();
-#endif
-  // perform the alignment:
-  db_RobImageHomography(m_H_ref_to_ins, m_corners_ref, m_corners_ins, m_nr_matches, m_K, m_K, m_temp_double, m_temp_int,
-            m_homography_type,NULL,m_max_iterations,m_max_nr_matches,m_scale,
-            m_nr_samples, m_chunk_size);
-  // @jke - Adding code to time the functions.  TODO: Remove after test
-# if PROFILE
-  iTimer2 = now_ms();
-  double elapsedTimeHomography = iTimer2 - iTimer1;
-  sprintf(str,"Homography = %g ms\n",elapsedTimeHomography);
-  strcat(profile_string, str);
-#endif
+    // copy out matching features:
+    for ( int i = 0; i < m_nr_matches; ++i )
+      {
+        int offset = 3*i;
+        m_corners_ref[offset  ] = m_x_corners_ref[m_match_index_ref[i]];
+        m_corners_ref[offset+1] = m_y_corners_ref[m_match_index_ref[i]];
+        m_corners_ref[offset+2] = 1.0;
+
+        m_corners_ins[offset  ] = m_x_corners_ins[m_match_index_ins[i]];
+        m_corners_ins[offset+1] = m_y_corners_ins[m_match_index_ins[i]];
+        m_corners_ins[offset+2] = 1.0;
+      }
+
+    // perform the alignment:
+    t0 = now_ms();
+    db_RobImageHomography(m_H_ref_to_ins, m_corners_ref, m_corners_ins, m_nr_matches, m_K, m_K, m_temp_double, m_temp_int,
+              m_homography_type,NULL,m_max_iterations,m_max_nr_matches,m_scale,
+              m_nr_samples, m_chunk_size, 0, NULL, NULL, NULL, NULL, NULL, m_ransac_confidence);
+    profile.ransac_ms += now_ms() - t0;
 
 
-  SetOutlierThreshold();
+    SetOutlierThreshold();
 
-  // Compute the inliers for the db compute m_H_ref_to_ins
-  ComputeInliers(m_H_ref_to_ins);
+    // Compute the inliers for the db compute m_H_ref_to_ins
+    ComputeInliers(m_H_ref_to_ins);
+
+    if (!track)
+    {
+      m_detected_inlier_count = m_num_inlier_indices;
+      break;
+    }
+    if (m_num_inlier_indices >= m_track_min_inlier_fraction*m_detected_inlier_count)
+    {
+      profile.tracked = 1;
+      break;
+    }
+    track = false;
+  }
 
   // Update the max inlier count
   m_max_inlier_count = (m_max_inlier_count > m_num_inlier_indices)?m_max_inlier_count:m_num_inlier_indices;
@@ -464,10 +494,10 @@ int db_FrameToReferenceRegistration::AddFrame(const unsigned char * const * im,
     m_H_ref_to_ins[5] *= 2.0;
   }
 
-#if PROFILE
-  sprintf(str,"#Inliers = %d \n",m_num_inlier_indices);
-  strcat(profile_string, str);
-#endif
+  // UpdateReference() resets m_H_ref_to_ins; when the reference moves on to
+  // this frame, the next one is predicted to move by the same step
+  db_Copy9(m_H_track_pred, m_H_ref_to_ins);
+
 /*
   ///// CHECK IF CURRENT TRANSFORMATION GOOD OR BAD ////
   ///// IF BAD, then update reference to the last correctly aligned inspection frame;
@@ -485,8 +515,6 @@ int db_FrameToReferenceRegistration::AddFrame(const unsigned char * const * im,
   if(m_do_motion_smoothing)
     SmoothMotion();
 
-   db_PrintDoubleMatrix(m_H_ref_to_ins,3,3);
-
   db_Copy9(H, m_H_ref_to_ins);
 
   m_nr_frames_processed++;
@@ -505,11 +533,42 @@ int db_FrameToReferenceRegistration::AddFrame(const unsigned char * const * im,
 
   }
 
-
+  profile.total_ms = now_ms() - t_start;
+  profile.nr_corners = m_nr_corners_ins;
+  profile.nr_matches = m_nr_matches;
+  profile.nr_inliers = m_num_inlier_indices;
+  profile.nr_hypotheses = nr_hypotheses;
+  RecordProfile(profile);
 
   return 1;
 }
 
+void db_FrameToReferenceRegistration::RecordProfile(const db_RegistrationProfile &profile)
+{
+  pthread_mutex_lock(&m_profile_lock);
+  m_profiles[m_nr_profiles % PROFILE_HISTORY] = profile;
+  m_nr_profiles++;
+  pthread_mutex_unlock(&m_profile_lock);
+}
+
+int db_FrameToReferenceRegistration::GetProfiles(db_RegistrationProfile *profiles, int max_profiles)
+{
+  pthread_mutex_lock(&m_profile_lock);
+  int count = db_mini(db_mini(m_nr_profiles, PROFILE_HISTORY), max_profiles);
+  for (int i = 0; i < count; i++)
+    profiles[i] = m_profiles[(m_nr_profiles - count + i) % PROFILE_HISTORY];
+  pthread_mutex_unlock(&m_profile_lock);
+
+  return count;
+}
+
+void db_FrameToReferenceRegistration::ResetProfiles()
+{
+  pthread_mutex_lock(&m_profile_lock);
+  m_nr_profiles = 0;
+  pthread_mutex_unlock(&m_profile_lock);
+}
+
 //void db_FrameToReferenceRegistration::ComputeInliers(double H[9],std::vector<int> &inlier_indices)
 void db_FrameToReferenceRegistration::ComputeInliers(double H[9])
 {
@@ -591,7 +650,7 @@ void db_FrameToReferenceRegistration::EstimateSecondaryModel(double H[9])
   // perform the alignment:
   db_RobImageHomography(m_H_ref_to_ins, m_corners_ref, m_corners_ins, m_nr_matches, m_K, m_K, m_temp_double, m_temp_int,
             m_homography_type,NULL,m_max_iterations,m_max_nr_matches,m_scale,
-            m_nr_samples, m_chunk_size);
+            m_nr_samples, m_chunk_size, 0, NULL, NULL, NULL, NULL, NULL, m_ransac_confidence);
 
   db_Copy9(H,m_H_ref_to_ins);
 }
@@ -27,18 +27,13 @@
 #define DBREG_API
 #endif
 
-// @jke - the next few lines are for extracting timing data.  TODO: Remove after test
-#define PROFILE 0
-
 #include "dbstabsmooth.h"
 
 #include <db_feature_detection.h>
 #include <db_feature_matching.h>
 #include <db_rob_image_homography.h>
 
-#if PROFILE
-    #include <sys/time.h>
-#endif
+#include <pthread.h>
 
 /*! \mainpage db_FrameToReferenceRegistration
 
@@ -122,6 +117,25 @@
 
  */
 
+/*!
+ * Timings in milliseconds and counters of one call to
+ * db_FrameToReferenceRegistration::AddFrame(). A frame that becomes the
+ * reference only has its corners detected.
+ */
+struct db_RegistrationProfile
+{
+    int    frame;           //!< index of the frame since Init(), from 0
+    double detect_ms;       //!< corner detection
+    double match_ms;        //!< matching against the reference corners
+    double ransac_ms;       //!< robust homography estimation
+    double total_ms;        //!< whole AddFrame() call
+    int    nr_corners;      //!< corners detected in the frame
+    int    nr_matches;      //!< correspondences with the reference
+    int    nr_inliers;      //!< matches consistent with the homography
+    int    nr_hypotheses;   //!< RANSAC hypotheses scored
+    int    tracked;         //!< 1 if the corners were tracked rather than detected
+};
+
 /*!
  * Performs feature-based frame to reference image registration.
  */
@@ -180,6 +194,31 @@ public:
     */
     void ResetSmoothing(bool enable) { m_do_motion_smoothing = enable; }
 
+    /*!
+     * Set the number of threads used for corner detection. The corners found do not depend on it.
+     * \param nr_threads    number of threads, <=0 for one per online CPU.
+    */
+    void SetNrDetectionThreads(int nr_threads) { m_cd.SetNrThreads(nr_threads); }
+
+    /*!
+     * Let RANSAC stop drawing samples once an outlier free one has been drawn with the given probability, instead of always drawing nr_samples.
+     * \param confidence    probability in (0,1), or 0 to always draw nr_samples.
+    */
+    void SetRansacConfidence(double confidence) { m_ransac_confidence = confidence; }
+
+    /*!
+     * Track the reference corners into the inspection image instead of detecting and matching corners on every frame.
+     * Corners are searched for around the position predicted by the last homography. A frame falls back to detection
+     * when tracking keeps fewer inliers than the given fraction of those found by the last detection.
+     * \param search_radius         radius of the search in pixels, at most DB_MAX_TRACK_RADIUS, or 0 to always detect.
+     * \param min_inlier_fraction   fraction of the inliers of the last detection that tracking must keep.
+    */
+    void SetTracking(int search_radius, double min_inlier_fraction=0.5)
+    {
+      m_track_radius = search_radius;
+      m_track_min_inlier_fraction = min_inlier_fraction;
+    }
+
     /*!
      * Align an inspection image to an existing reference image, update the reference image if due and perform motion smoothing if enabled.
      * \param im                new inspection image
@@ -288,7 +327,23 @@ public:
     */
     void SelectOutliers();
 
-    char *profile_string;
+    /*!
+     * Number of AddFrame() calls whose profile is kept.
+    */
+    static const int PROFILE_HISTORY = 64;
+
+    /*!
+     * Copy the profiles of the most recent AddFrame() calls, oldest first. Safe to call while another thread is in AddFrame().
+     * \param profiles      array of at least max_profiles entries
+     * \param max_profiles  maximum number of profiles to copy
+     * \return the number of profiles copied
+    */
+    int GetProfiles(db_RegistrationProfile *profiles, int max_profiles);
+
+    /*!
+     * Discard the profile history. Init() does this too.
+    */
+    void ResetProfiles();
 
 protected:
     void Clean();
@@ -303,6 +358,15 @@ protected:
     double  m_scale;
     int     m_nr_samples;
     int     m_chunk_size;
+    double  m_ransac_confidence;
+
+    // Corner tracking parameters, and the number of inliers found by the
+    // last frame whose corners were detected (0 if tracking can't start)
+    int     m_track_radius;
+    double  m_track_min_inlier_fraction;
+    int     m_detected_inlier_count;
+    // Predicts where the reference corners are in the next inspection image
+    double  m_H_track_pred[9];
     double  m_outlier_t2;
 
     // Whether to fit a linear model to just the inliers at the end
@@ -367,6 +431,13 @@ protected:
     int * m_inlier_indices;
     int m_num_inlier_indices;
 
+    // Ring of the last PROFILE_HISTORY frame profiles; m_nr_profiles counts
+    // every profile recorded since the last reset
+    db_RegistrationProfile m_profiles[PROFILE_HISTORY];
+    int m_nr_profiles;
+    pthread_mutex_t m_profile_lock;
+    void RecordProfile(const db_RegistrationProfile &profile);
+
     //void ComputeInliers(double H[9], std::vector<int> &inlier_indices);
     void ComputeInliers(double H[9]);
 
@@ -550,6 +621,33 @@ inline void db_WarpImageLutBilinear_rgb(const unsigned char * const * src, unsig
         }
 }
 
+/*!
+ * Pixel layouts of db_WarpImageHomography().
+ */
+typedef enum {
+    DB_WARP_LAYOUT_GRAY = 0,        //!< one byte per pixel, h rows of w bytes
+    DB_WARP_LAYOUT_RGB = 1,         //!< packed rgbrgb..., h rows of 3*w bytes
+    DB_WARP_LAYOUT_YVU_PLANAR = 2   //!< Y then V then U planes, 3*h rows of w bytes
+} db_WarpLayout;
+
+/*!
+ * Warp an image by a homography without look-up tables. Destination pixel
+ * (x_d,y_d) is sampled from the source at H*(x_d,y_d), as with the tables of
+ * db_GenerateHomographyLut(). Source positions are stepped along each row
+ * in 16.16 fixed point and interpolated with 8 bit weights, and the
+ * destination is processed in tiles whose source footprint stays in the
+ * data cache. Pixels that map outside the source are set to 0.
+ * \param src     source rows, see db_WarpLayout
+ * \param dst     destination rows, same layout and size as the source
+ * \param w       width in pixels
+ * \param h       height in pixels
+ * \param layout  one of db_WarpLayout
+ * \param H       homography from destination to source coordinates
+ * \param type    DB_WARP_BILINEAR, or DB_WARP_FAST for the nearest pixel
+ */
+DBREG_API void db_WarpImageHomography(const unsigned char * const * src, unsigned char ** dst, int w, int h,
+                                      int layout, const double H[9], int type=DB_WARP_BILINEAR);
+
 inline double SquaredInhomogenousHomographyError(double y[3],double H[9],double x[3]){
     double x0,x1,x2,mult;
     double sd;
@@ -564,18 +662,3 @@ inline double SquaredInhomogenousHomographyError(double y[3],double H[9],double
 }
 
 
-// functions related to profiling
-#if PROFILE
-
-/* return current time in milliseconds */
-static double
-now_ms(void)
-{
-    //struct timespec res;
-    struct timeval res;
-    //clock_gettime(CLOCK_REALTIME, &res);
-    gettimeofday(&res, NULL);
-    return 1000.0*res.tv_sec + (double)res.tv_usec/1e3;
-}
-
-#endif
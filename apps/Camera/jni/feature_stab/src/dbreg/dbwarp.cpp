@@ -0,0 +1,174 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// dbwarp.cpp
+//
+// Homography warping of gray, RGB and planar YVU images in fixed point,
+// one destination tile at a time.
+
+#include "dbreg.h"
+#include <math.h>
+
+// A 64 x 16 destination tile reads at most a few KB of a source that is
+// roughly aligned with it, which stays in L1 while the tile is filled
+static const int TILE_WIDTH = 64;
+static const int TILE_HEIGHT = 16;
+
+// Source coordinates are 16.16 fixed point; interpolation uses the top 8
+// bits of the fraction
+static const int FIX_SHIFT = 16;
+static const double FIX_ONE = 65536.0;
+// Coordinates beyond this can't be represented and are outside any image
+static const double FIX_LIMIT = 32767.0;
+
+// Marks a destination pixel whose source is outside the image
+static const int OUTSIDE = -1;
+
+// Fills xs and ys with the fixed point source positions of the n pixels
+// starting at destination (x,y), or OUTSIDE
+static void RowSourcePositions(int *xs, int *ys, int n, int x, int y, int w, int h, const double H[9])
+{
+  double X = H[0]*x + H[1]*y + H[2];
+  double Y = H[3]*x + H[4]*y + H[5];
+  double Z = H[6]*x + H[7]*y + H[8];
+  int max_x = (w-1) << FIX_SHIFT;
+  int max_y = (h-1) << FIX_SHIFT;
+
+  if (H[6] == 0.0 && H[7] == 0.0 && Z != 0.0)
+  {
+    // Affine: the position moves by a constant step along the row
+    double sx = X/Z, sy = Y/Z;
+    double ex = sx + (n-1)*H[0]/Z, ey = sy + (n-1)*H[3]/Z;
+
+    if (fabs(sx) < FIX_LIMIT && fabs(sy) < FIX_LIMIT && fabs(ex) < FIX_LIMIT && fabs(ey) < FIX_LIMIT)
+    {
+      int fx = (int) floor(sx*FIX_ONE + 0.5);
+      int fy = (int) floor(sy*FIX_ONE + 0.5);
+      int dfx = (int) floor(H[0]/Z*FIX_ONE + 0.5);
+      int dfy = (int) floor(H[3]/Z*FIX_ONE + 0.5);
+
+      for (int i = 0; i < n; i++, fx += dfx, fy += dfy)
+      {
+        if (fx < 0 || fy < 0 || fx > max_x || fy > max_y)
+          xs[i] = OUTSIDE;
+        else
+        {
+          xs[i] = fx;
+          ys[i] = fy;
+        }
+      }
+      return;
+    }
+  }
+
+  // Projective, or too far out for fixed point steps: one division per pixel
+  for (int i = 0; i < n; i++, X += H[0], Y += H[3], Z += H[6])
+  {
+    double sx = db_SafeDivision(X,Z);
+    double sy = db_SafeDivision(Y,Z);
+
+    if (sx < 0.0 || sy < 0.0 || sx > w-1 || sy > h-1)
+      xs[i] = OUTSIDE;
+    else
+    {
+      xs[i] = db_mini((int) (sx*FIX_ONE + 0.5), max_x);
+      ys[i] = db_mini((int) (sy*FIX_ONE + 0.5), max_y);
+    }
+  }
+}
+
+// Interpolates channels bytes per pixel; the last row and column are
+// repeated so that positions on the far edges need no special case
+static inline void SampleBilinear(unsigned char *d, const unsigned char * const * src, const int *xs, const int *ys,
+                                  int n, int w, int h, int channels)
+{
+  for (int i = 0; i < n; i++, d += channels)
+  {
+    if (xs[i] == OUTSIDE)
+    {
+      for (int c = 0; c < channels; c++)
+        d[c] = 0;
+      continue;
+    }
+
+    int x0 = xs[i] >> FIX_SHIFT;
+    int y0 = ys[i] >> FIX_SHIFT;
+    int ax = (xs[i] >> 8) & 0xff;
+    int ay = (ys[i] >> 8) & 0xff;
+    const unsigned char *r0 = src[y0] + channels*x0;
+    const unsigned char *r1 = src[y0 + (y0 < h-1)] + channels*x0;
+    int dx = (x0 < w-1) ? channels : 0;
+
+    for (int c = 0; c < channels; c++)
+    {
+      int top = (r0[c] << 8) + (r0[c+dx] - r0[c])*ax;
+      int bottom = (r1[c] << 8) + (r1[c+dx] - r1[c])*ax;
+      d[c] = (unsigned char) (((top << 8) + (bottom - top)*ay + 32768) >> 16);
+    }
+  }
+}
+
+static inline void SampleNearest(unsigned char *d, const unsigned char * const * src, const int *xs, const int *ys,
+                                 int n, int channels)
+{
+  for (int i = 0; i < n; i++, d += channels)
+  {
+    if (xs[i] == OUTSIDE)
+    {
+      for (int c = 0; c < channels; c++)
+        d[c] = 0;
+      continue;
+    }
+
+    const unsigned char *s = src[(ys[i] + 32768) >> FIX_SHIFT] + channels*((xs[i] + 32768) >> FIX_SHIFT);
+    for (int c = 0; c < channels; c++)
+      d[c] = s[c];
+  }
+}
+
+void db_WarpImageHomography(const unsigned char * const * src, unsigned char ** dst, int w, int h,
+                            int layout, const double H[9], int type)
+{
+  int xs[TILE_WIDTH], ys[TILE_WIDTH];
+  int channels = (layout == DB_WARP_LAYOUT_RGB) ? 3 : 1;
+  int planes = (layout == DB_WARP_LAYOUT_YVU_PLANAR) ? 3 : 1;
+
+  for (int ty = 0; ty < h; ty += TILE_HEIGHT)
+  {
+    int tile_h = db_mini(TILE_HEIGHT, h - ty);
+
+    for (int tx = 0; tx < w; tx += TILE_WIDTH)
+    {
+      int tile_w = db_mini(TILE_WIDTH, w - tx);
+
+      for (int y = ty; y < ty + tile_h; y++)
+      {
+        // The planes share the mapping
+        RowSourcePositions(xs, ys, tile_w, tx, y, w, h, H);
+
+        for (int p = 0; p < planes; p++)
+        {
+          unsigned char *d = dst[p*h + y] + channels*tx;
+
+          if (type == DB_WARP_FAST)
+            SampleNearest(d, src + p*h, xs, ys, tile_w, channels);
+          else
+            SampleBilinear(d, src + p*h, xs, ys, tile_w, w, h, channels);
+        }
+      }
+    }
+  }
+}
@@ -24,9 +24,7 @@
 #include <iostream>
 #include <iomanip>
 
-#if PROFILE
-    #include <sys/time.h>
-#endif
+#include <sys/time.h>
 
 
 using namespace std;
@@ -109,9 +107,8 @@ int main(int argc, char* argv[])
   string progname(argv[0]);
   string image_list_file_name;
 
-#if PROFILE
-  timeval ts1, ts2, ts3, ts4;
-#endif
+  timeval ts1, ts2;
+  db_RegistrationProfile profile;
 
   // put the options and image list file name into the cmdline stringstream
   for (int c = 1; c < argc; c++)
@@ -137,9 +134,6 @@ int main(int argc, char* argv[])
   // input file name:
   string file_name;
 
-  // look-up tables for image warping:
-  float ** lut_x = NULL, **lut_y = NULL;
-
   // if the images are color, the input is saved in color_ref:
   PgmImage color_ref(0,0);
 
@@ -174,9 +168,6 @@ int main(int argc, char* argv[])
     if ( !reg.Initialized() )
     {
       reg.Init(w,h,motion_model_type,DEFAULT_MAX_ITERATIONS,linear_polish,quarter_resolution,DB_POINT_STANDARDDEV,reference_update_period,do_motion_smoothing,motion_smoothing_gain,default_nr_samples,DB_DEFAULT_CHUNK_SIZE,nr_corners,max_disparity,use_smaller_matching_window);
-      lut_x = db_AllocImage_f(w,h);
-      lut_y = db_AllocImage_f(w,h);
-
     }
 
     if ( color )
@@ -195,20 +186,17 @@ int main(int argc, char* argv[])
 
     bool force_reference = false;
 
-#if PROFILE
-    gettimeofday(&ts1, NULL);
-#endif
-
     reg.AddFrame(ref.GetRowPointers(),H,false,false);
-    cout << reg.profile_string << std::endl;
 
-#if PROFILE
-    gettimeofday(&ts2, NULL);
-
-    double elapsedTime = (ts2.tv_sec - ts1.tv_sec)*1000.0; // sec to ms
-    elapsedTime += (ts2.tv_usec - ts1.tv_usec)/1000.0; // us to ms
-    cout <<"\nelapsedTime for Reg<< "<<elapsedTime<<" ms >>>>>>>>>>>>>\n";
-#endif
+    // the registration keeps a short history, the last entry is this frame
+    if (reg.GetProfiles(&profile,1) == 1)
+    {
+      printf("[%d] detect %.2f ms, match %.2f ms, ransac %.2f ms, total %.2f ms\n",
+             frame_number,profile.detect_ms,profile.match_ms,profile.ransac_ms,profile.total_ms);
+      printf("[%d] #Corners = %d%s, #Matches = %d, #Hypotheses = %d\n",
+             frame_number,profile.nr_corners,profile.tracked ? " (tracked)" : "",
+             profile.nr_matches,profile.nr_hypotheses);
+    }
 
     if (frame_number == 0)
     {
@@ -223,26 +211,20 @@ int main(int argc, char* argv[])
 
     reg.Get_H_dref_to_ins(H);
 
-    db_GenerateHomographyLut(lut_x,lut_y,w,h,H);
-
     // create a new image and warp:
     PgmImage warped(w,h,format);
 
-#if PROFILE
-    gettimeofday(&ts3, NULL);
-#endif
+    gettimeofday(&ts1, NULL);
 
     if ( color )
-      db_WarpImageLutBilinear_rgb(color_ref.GetRowPointers(),warped.GetRowPointers(),w,h,lut_x,lut_y);
+      db_WarpImageHomography(color_ref.GetRowPointers(),warped.GetRowPointers(),w,h,DB_WARP_LAYOUT_RGB,H);
     else
-      db_WarpImageLut_u(ref.GetRowPointers(),warped.GetRowPointers(),w,h,lut_x,lut_y,DB_WARP_FAST);
+      db_WarpImageHomography(ref.GetRowPointers(),warped.GetRowPointers(),w,h,DB_WARP_LAYOUT_GRAY,H,DB_WARP_FAST);
 
-#if PROFILE
-    gettimeofday(&ts4, NULL);
-    elapsedTime = (ts4.tv_sec - ts3.tv_sec)*1000.0; // sec to ms
-    elapsedTime += (ts4.tv_usec - ts3.tv_usec)/1000.0;     // us to ms
-    cout <<"\nelapsedTime for Warp <<"<<elapsedTime<<" ms >>>>>>>>>>>>>\n";
-#endif
+    gettimeofday(&ts2, NULL);
+    double elapsedTime = (ts2.tv_sec - ts1.tv_sec)*1000.0; // sec to ms
+    elapsedTime += (ts2.tv_usec - ts1.tv_usec)/1000.0;     // us to ms
+    printf("[%d] warp %.2f ms\n",frame_number,elapsedTime);
 
     // write aligned image: name is aligned_<corresponding input file name>
     stringstream s;
@@ -292,12 +274,6 @@ int main(int argc, char* argv[])
     frame_number++;
   }
 
-  if ( reg.Initialized() )
-  {
-    db_FreeImage_f(lut_x,h);
-    db_FreeImage_f(lut_y,h);
-  }
-
   return 0;
 }
 
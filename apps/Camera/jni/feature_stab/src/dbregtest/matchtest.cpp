@@ -0,0 +1,201 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// matchtest.cpp
+//
+// Checks that the SIMD matching kernels give exactly the results of the
+// plain C ones, kernel by kernel and through db_Matcher_u on a synthetic
+// image pair. Exits with 0 when everything agrees or no SIMD is available.
+//
+// Usage: dbreg_matchtest [width height]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <db_utilities.h>
+#include <db_feature_detection.h>
+#include <db_feature_matching.h>
+#include <db_feature_matching_simd.h>
+
+static const int KERNEL_TRIALS = 2000;
+
+static int failures = 0;
+
+static void Check(bool ok, const char *what, int trial)
+{
+    if (!ok)
+    {
+        if (failures < 20)
+            printf("MISMATCH %s (trial %d)\n", what, trial);
+        failures++;
+    }
+}
+
+// Smooth random texture so that the detector finds corners, plus a copy
+// shifted by (dx,dy) with a little noise
+static void MakeImages(unsigned char **l, unsigned char **r, int w, int h, int dx, int dy)
+{
+    int i, j, x, y;
+
+    for (i = 0; i < h; i++)
+        for (j = 0; j < w; j++)
+            l[i][j] = (unsigned char) (rand() & 0xff);
+
+    for (i = 1; i < h - 1; i++)
+        for (j = 1; j < w - 1; j++)
+            l[i][j] = (unsigned char) ((l[i - 1][j] + l[i + 1][j] + l[i][j - 1] + l[i][j + 1] + 4 * l[i][j]) >> 3);
+
+    for (i = 0; i < h; i++)
+    {
+        for (j = 0; j < w; j++)
+        {
+            y = db_maxi(0, db_mini(h - 1, i - dy));
+            x = db_maxi(0, db_mini(w - 1, j - dx));
+            r[i][j] = (unsigned char) db_maxi(0, db_mini(255, l[y][x] + (rand() % 5) - 2));
+        }
+    }
+}
+
+static void TestKernels(const db_MatchingKernels_u *c, const db_MatchingKernels_u *simd,
+        unsigned char **img, int w, int h)
+{
+    short pc[512], ps[512], qc[512];
+    float sum_c, sum_s, recip_c, recip_s;
+    int t, x, y;
+
+    for (t = 0; t < KERNEL_TRIALS; t++)
+    {
+        // Any position whose window fits, including the image borders
+        x = 10 + rand() % (w - 20);
+        y = 10 + rand() % (h - 20);
+
+        memset(pc, 0x55, sizeof(pc));
+        memset(ps, 0xaa, sizeof(ps));
+        c->SignedSquareNormCorr11x11_PreAlign_u(pc, img, x, y, &sum_c, &recip_c);
+        simd->SignedSquareNormCorr11x11_PreAlign_u(ps, img, x, y, &sum_s, &recip_s);
+        Check(memcmp(pc, ps, 128 * sizeof(short)) == 0, "11x11 patch", t);
+        Check(sum_c == sum_s && recip_c == recip_s, "11x11 sum/recip", t);
+
+        c->SignedSquareNormCorr11x11_PreAlign_u(qc, img, 10 + rand() % (w - 20), 10 + rand() % (h - 20),
+                &sum_c, &recip_c);
+        Check(c->ScalarProduct128_s(pc, qc) == simd->ScalarProduct128_s(pc, qc), "product 128", t);
+        Check(c->ScalarProduct32_s(pc, qc) == simd->ScalarProduct32_s(pc, qc), "product 32", t);
+
+        memset(pc, 0x55, sizeof(pc));
+        memset(ps, 0xaa, sizeof(ps));
+        c->SignedSquareNormCorr21x21_PreAlign_u(pc, img, x, y, &sum_c, &recip_c);
+        simd->SignedSquareNormCorr21x21_PreAlign_u(ps, img, x, y, &sum_s, &recip_s);
+        Check(memcmp(pc, ps, 512 * sizeof(short)) == 0, "21x21 patch", t);
+        Check(sum_c == sum_s && recip_c == recip_s, "21x21 sum/recip", t);
+
+        c->SignedSquareNormCorr21x21_PreAlign_u(qc, img, 10 + rand() % (w - 20), 10 + rand() % (h - 20),
+                &sum_c, &recip_c);
+        Check(c->ScalarProduct512_s(pc, qc) == simd->ScalarProduct512_s(pc, qc), "product 512", t);
+    }
+}
+
+static void Match(unsigned char **l, unsigned char **r, int w, int h, int use_21,
+        const double *x_l, const double *y_l, int nr_l, const double *x_r, const double *y_r, int nr_r,
+        int *id_l, int *id_r, int *nr_matches)
+{
+    db_Matcher_u matcher;
+
+    matcher.Init(w, h, 0.1, DB_DEFAULT_TARGET_NR_CORNERS, DB_DEFAULT_NO_DISPARITY, false, use_21);
+    matcher.Match(l, r, x_l, y_l, nr_l, x_r, y_r, nr_r, id_l, id_r, nr_matches);
+}
+
+static void TestMatcher(unsigned char **l, unsigned char **r, int w, int h)
+{
+    db_CornerDetector_u detector;
+    int nr_l, nr_r, nr_c, nr_s, use_21;
+
+    int max_corners = (int) detector.Init(w, h, DB_DEFAULT_TARGET_NR_CORNERS);
+    double *x_l = new double[max_corners];
+    double *y_l = new double[max_corners];
+    double *x_r = new double[max_corners];
+    double *y_r = new double[max_corners];
+    int *id_l_c = new int[max_corners];
+    int *id_r_c = new int[max_corners];
+    int *id_l_s = new int[max_corners];
+    int *id_r_s = new int[max_corners];
+
+    detector.DetectCorners(l, x_l, y_l, &nr_l);
+    detector.DetectCorners(r, x_r, y_r, &nr_r);
+
+    for (use_21 = 0; use_21 <= 1; use_21++)
+    {
+        db_SetMatchingSimdEnabled(false);
+        Match(l, r, w, h, use_21, x_l, y_l, nr_l, x_r, y_r, nr_r, id_l_c, id_r_c, &nr_c);
+        db_SetMatchingSimdEnabled(true);
+        Match(l, r, w, h, use_21, x_l, y_l, nr_l, x_r, y_r, nr_r, id_l_s, id_r_s, &nr_s);
+
+        printf("%s window: %d/%d corners, %d matches C, %d matches SIMD\n",
+                use_21 ? "21x21" : "11x11", nr_l, nr_r, nr_c, nr_s);
+
+        Check(nr_c == nr_s &&
+                memcmp(id_l_c, id_l_s, nr_c * sizeof(int)) == 0 &&
+                memcmp(id_r_c, id_r_s, nr_c * sizeof(int)) == 0,
+                use_21 ? "matches 21x21" : "matches 11x11", 0);
+    }
+
+    delete [] id_r_s;
+    delete [] id_l_s;
+    delete [] id_r_c;
+    delete [] id_l_c;
+    delete [] y_r;
+    delete [] x_r;
+    delete [] y_l;
+    delete [] x_l;
+}
+
+int main(int argc, char *argv[])
+{
+    int w = 320, h = 240;
+
+    if (argc >= 3)
+    {
+        w = atoi(argv[1]);
+        h = atoi(argv[2]);
+    }
+    if (w < 64 || h < 64)
+    {
+        fprintf(stderr, "Usage: %s [width height], at least 64 x 64\n", argv[0]);
+        return 1;
+    }
+
+    const db_MatchingKernels_u *simd = db_GetMatchingKernelsSimd_u();
+    if (simd == NULL)
+    {
+        printf("No SIMD matching kernels on this CPU, nothing to compare\n");
+        return 0;
+    }
+
+    unsigned char **l = db_AllocImage_u(w, h);
+    unsigned char **r = db_AllocImage_u(w, h);
+
+    srand(1);
+    MakeImages(l, r, w, h, 7, -3);
+
+    TestKernels(db_GetMatchingKernels_u(), simd, l, w, h);
+    TestMatcher(l, r, w, h);
+
+    db_FreeImage_u(r, h);
+    db_FreeImage_u(l, h);
+
+    printf("%s\n", failures ? "FAILED" : "PASSED");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,528 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// mosaicbench.cpp
+//
+// Replays a frame sequence through Mosaic::addFrame (alignment) and
+// Mosaic::createMosaic (blending) off-device and reports the time spent in
+// each stage, the peak memory and a checksum of the panorama. The input is
+// loaded before the clock starts, so only the mosaicing code is measured.
+// Every run of a sequence must give the same checksum; -x compares it with
+// a known value so that output changes are caught along with slowdowns.
+//
+// Usage: mosaicbench [options] [frames.yvu | -l image_list.txt]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include <string>
+#include <fstream>
+
+#include "PgmImage.h"
+#include "mosaic/Mosaic.h"
+
+static const int MAX_BENCH_FRAMES = 200;
+
+// Stages reported for every run; detect, match and RANSAC are the parts of
+// align timed by the registration itself
+enum
+{
+    STAGE_ALIGN,
+    STAGE_DETECT,
+    STAGE_MATCH,
+    STAGE_RANSAC,
+    STAGE_PREPARE,
+    STAGE_MASK,
+    STAGE_PYRAMID,
+    STAGE_FINAL,
+    STAGE_TOTAL,
+    NUM_STAGES
+};
+
+static const char *stageNames[NUM_STAGES] =
+{
+    "align",
+    "  detect",
+    "  match",
+    "  ransac",
+    "prepare",
+    "mask",
+    "pyramid",
+    "final blend",
+    "total"
+};
+
+struct BenchOptions
+{
+    int width, height;
+    int blendingType, stripType;
+    bool quarterRes;
+    float threshStill;
+    unsigned int incrementalBudget;
+    int runs;
+
+    // Synthetic sequence, used when no input is given
+    int synthFrames, synthStep;
+
+    const char *yvuFile;
+    const char *listFile;
+    const char *outFile;
+    const char *expected;
+};
+
+struct RunResult
+{
+    double stageMs[NUM_STAGES];
+    double alignMaxMs;
+    int accepted;
+    int tracked;
+    int mosaicWidth, mosaicHeight;
+    unsigned int checksum;
+};
+
+static double now_ms()
+{
+    struct timeval res;
+    gettimeofday(&res, NULL);
+    return 1000.0 * res.tv_sec + (double) res.tv_usec / 1e3;
+}
+
+// Peak resident set size of the process in kilobytes
+static long PeakMemoryKb()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return -1;
+    return usage.ru_maxrss;
+}
+
+// FNV-1a, so checksums are the same on every platform
+static unsigned int Checksum(const unsigned char *data, int size)
+{
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < size; i++)
+        hash = (hash ^ data[i]) * 16777619u;
+    return hash;
+}
+
+// Portable generator for the synthetic scene; rand() differs between libcs
+static unsigned int randomState;
+
+static unsigned int NextRandom()
+{
+    randomState = randomState * 1664525u + 1013904223u;
+    return randomState >> 8;
+}
+
+// Three passes of a horizontal and vertical box filter of radius r
+static void Smooth(unsigned char *img, int w, int h, int r)
+{
+    unsigned char *tmp = new unsigned char[w > h ? w : h];
+
+    for (int pass = 0; pass < 3; pass++)
+    {
+        for (int y = 0; y < h; y++)
+        {
+            unsigned char *row = img + y * w;
+            for (int x = 0; x < w; x++)
+            {
+                int sum = 0, n = 0;
+                for (int k = x - r; k <= x + r; k++)
+                    if (k >= 0 && k < w) { sum += row[k]; n++; }
+                tmp[x] = (unsigned char) (sum / n);
+            }
+            memcpy(row, tmp, w);
+        }
+        for (int x = 0; x < w; x++)
+        {
+            for (int y = 0; y < h; y++)
+            {
+                int sum = 0, n = 0;
+                for (int k = y - r; k <= y + r; k++)
+                    if (k >= 0 && k < h) { sum += img[k * w + x]; n++; }
+                tmp[y] = (unsigned char) (sum / n);
+            }
+            for (int y = 0; y < h; y++)
+                img[y * w + x] = tmp[y];
+        }
+    }
+
+    delete[] tmp;
+}
+
+// A wide textured scene panned across by opts.synthStep pixels per frame
+static int MakeSyntheticFrames(const BenchOptions &opts, ImageType *frames)
+{
+    int w = opts.width, h = opts.height;
+    int sceneWidth = w + opts.synthStep * (opts.synthFrames - 1);
+    unsigned char *scene[3];
+
+    randomState = 1;
+    for (int c = 0; c < 3; c++)
+    {
+        scene[c] = new unsigned char[sceneWidth * h];
+        for (int i = 0; i < sceneWidth * h; i++)
+            scene[c][i] = (unsigned char) (c == 0 ? NextRandom() & 0xff : 64 + (NextRandom() & 0x7f));
+        Smooth(scene[c], sceneWidth, h, c == 0 ? 1 : 4);
+    }
+
+    // Flat blocks give the corner detector strong, unambiguous features
+    for (int i = 0; i < sceneWidth * h / 2000; i++)
+    {
+        int bw = 4 + NextRandom() % 24, bh = 4 + NextRandom() % 24;
+        int bx = NextRandom() % (sceneWidth - bw), by = NextRandom() % (h - bh);
+        unsigned char value = (unsigned char) (NextRandom() & 0xff);
+        for (int y = by; y < by + bh; y++)
+            memset(scene[0] + y * sceneWidth + bx, value, bw);
+    }
+
+    for (int f = 0; f < opts.synthFrames; f++)
+    {
+        frames[f] = ImageUtils::allocateImage(w, h, ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
+        for (int c = 0; c < 3; c++)
+            for (int y = 0; y < h; y++)
+                memcpy(frames[f] + (c * h + y) * w,
+                        scene[c] + y * sceneWidth + f * opts.synthStep, w);
+    }
+
+    for (int c = 0; c < 3; c++)
+        delete[] scene[c];
+
+    return opts.synthFrames;
+}
+
+// Raw planar YVU frames of opts.width x opts.height, back to back
+static int ReadYvuFrames(const BenchOptions &opts, ImageType *frames)
+{
+    FILE *fp = fopen(opts.yvuFile, "rb");
+    if (fp == NULL)
+    {
+        fprintf(stderr, "Could not open %s\n", opts.yvuFile);
+        return -1;
+    }
+
+    int size = opts.width * opts.height * ImageUtils::IMAGE_TYPE_NUM_CHANNELS;
+    int count = 0;
+    while (count < MAX_BENCH_FRAMES)
+    {
+        frames[count] = ImageUtils::allocateImage(opts.width, opts.height,
+                ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
+        if (fread(frames[count], 1, size, fp) != (size_t) size)
+        {
+            ImageUtils::freeImage(frames[count]);
+            break;
+        }
+        count++;
+    }
+    fclose(fp);
+
+    return count;
+}
+
+// PGM or PPM images listed one per line, as taken by dbregtest. Gray
+// images get neutral chroma.
+static int ReadImageList(BenchOptions &opts, ImageType *frames)
+{
+    std::ifstream in(opts.listFile);
+    if (!in.is_open())
+    {
+        fprintf(stderr, "Could not open %s\n", opts.listFile);
+        return -1;
+    }
+
+    std::string fileName;
+    int count = 0;
+    while (count < MAX_BENCH_FRAMES && std::getline(in, fileName))
+    {
+        if (fileName.empty())
+            continue;
+
+        PgmImage image(fileName);
+        if (image.GetDataPointer() == NULL)
+        {
+            fprintf(stderr, "Could not read %s\n", fileName.c_str());
+            return -1;
+        }
+
+        int w = image.GetWidth(), h = image.GetHeight();
+        if (count == 0)
+        {
+            opts.width = w;
+            opts.height = h;
+        }
+        else if (w != opts.width || h != opts.height)
+        {
+            fprintf(stderr, "%s is %d x %d, expected %d x %d\n", fileName.c_str(),
+                    w, h, opts.width, opts.height);
+            return -1;
+        }
+
+        frames[count] = ImageUtils::allocateImage(w, h, ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
+        if (image.GetFormat() == PgmImage::PGM_BINARY_PIXMAP)
+        {
+            ImageUtils::rgb2yvu(frames[count], image.GetDataPointer(), w, h);
+        }
+        else
+        {
+            memcpy(frames[count], image.GetDataPointer(), w * h);
+            memset(frames[count] + w * h, 128, 2 * w * h);
+        }
+        count++;
+    }
+
+    return count;
+}
+
+static int RunOnce(const BenchOptions &opts, ImageType *frames, int numFrames,
+        RunResult &result, bool keepOutput)
+{
+    Mosaic mosaic;
+    Blend::StageTimes before, after;
+    db_RegistrationProfile profile;
+    float progress = 0.0f;
+    bool cancel = false;
+
+    memset(&result, 0, sizeof(result));
+
+    if (mosaic.initialize(opts.blendingType, opts.stripType, opts.width, opts.height,
+            numFrames, opts.quarterRes, opts.threshStill) != Mosaic::MOSAIC_RET_OK)
+    {
+        fprintf(stderr, "Could not initialize the mosaic\n");
+        return -1;
+    }
+    mosaic.setIncrementalBlending(opts.incrementalBudget);
+
+    double t0 = now_ms();
+    for (int i = 0; i < numFrames; i++)
+    {
+        mosaic.getBlender()->getStageTimes(before);
+        double f0 = now_ms();
+        int ret = mosaic.addFrame(frames[i]);
+        double frameMs = now_ms() - f0;
+        mosaic.getBlender()->getStageTimes(after);
+
+        // addFrame also prepares accepted frames for blending
+        double prepareMs = after.prepareMs - before.prepareMs;
+        double alignMs = frameMs - prepareMs;
+        result.stageMs[STAGE_ALIGN] += alignMs;
+        if (alignMs > result.alignMaxMs)
+            result.alignMaxMs = alignMs;
+
+        // Every addFrame registers the frame once, so the newest profile
+        // is this frame's
+        if (mosaic.getAligner()->getRegProfiles(&profile, 1) == 1)
+        {
+            result.stageMs[STAGE_DETECT] += profile.detect_ms;
+            result.stageMs[STAGE_MATCH] += profile.match_ms;
+            result.stageMs[STAGE_RANSAC] += profile.ransac_ms;
+            result.tracked += profile.tracked;
+        }
+
+        if (ret == Mosaic::MOSAIC_RET_OK || ret == Mosaic::MOSAIC_RET_FEW_INLIERS)
+            result.accepted++;
+    }
+
+    if (mosaic.createMosaic(progress, cancel) != Mosaic::MOSAIC_RET_OK)
+    {
+        fprintf(stderr, "Could not create the mosaic\n");
+        return -1;
+    }
+    result.stageMs[STAGE_TOTAL] = now_ms() - t0;
+
+    mosaic.getBlender()->getStageTimes(after);
+    result.stageMs[STAGE_PREPARE] = after.prepareMs;
+    result.stageMs[STAGE_MASK] = after.maskMs;
+    result.stageMs[STAGE_PYRAMID] = after.pyramidMs;
+    result.stageMs[STAGE_FINAL] = after.finalMs;
+
+    ImageType yvu = mosaic.getMosaic(result.mosaicWidth, result.mosaicHeight);
+    int size = result.mosaicWidth * result.mosaicHeight * ImageUtils::IMAGE_TYPE_NUM_CHANNELS;
+    result.checksum = Checksum(yvu, size);
+
+    if (keepOutput && opts.outFile != NULL)
+    {
+        ImageType rgb = ImageUtils::allocateImage(result.mosaicWidth, result.mosaicHeight,
+                ImageUtils::IMAGE_TYPE_NUM_CHANNELS);
+        ImageUtils::yvu2rgb(rgb, yvu, result.mosaicWidth, result.mosaicHeight);
+        ImageUtils::writeBinaryPPM(rgb, opts.outFile, result.mosaicWidth, result.mosaicHeight);
+        ImageUtils::freeImage(rgb);
+    }
+
+    ImageUtils::freeImage(yvu);
+    return 0;
+}
+
+static void Usage(const char *name)
+{
+    fprintf(stderr,
+        "Usage: %s [options] [frames.yvu | -l image_list.txt]\n"
+        "  frames.yvu : raw planar YVU frames of -w x -h, back to back\n"
+        "  -l <file>  : list of PGM/PPM images, one per line (as for dbregtest)\n"
+        "  -w <int>   : frame width (default 320)\n"
+        "  -h <int>   : frame height (default 240)\n"
+        "  -b <int>   : blending type, 0 full, 1 pan, 2 cylpan, 3 horz (default 3)\n"
+        "  -s <int>   : strip type, 0 thin, 1 wide (default 0)\n"
+        "  -q         : align at quarter resolution\n"
+        "  -t <float> : still camera threshold in pixels (default 5)\n"
+        "  -i <int>   : incremental blending budget in MB (default 0)\n"
+        "  -r <int>   : number of runs (default 5)\n"
+        "  -n <int>   : frames of the synthetic sequence (default 40)\n"
+        "  -p <int>   : pan in pixels per synthetic frame (default 8)\n"
+        "  -o <file>  : write the panorama of the first run as PPM\n"
+        "  -x <hex>   : expected checksum; fail if the panorama differs\n",
+        name);
+}
+
+int main(int argc, char *argv[])
+{
+    BenchOptions opts;
+    memset(&opts, 0, sizeof(opts));
+    opts.width = 320;
+    opts.height = 240;
+    opts.blendingType = Blend::BLEND_TYPE_HORZ;
+    opts.stripType = Blend::STRIP_TYPE_THIN;
+    opts.threshStill = 5.0f;
+    opts.runs = 5;
+    opts.synthFrames = 40;
+    opts.synthStep = 8;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (strcmp(arg, "-q") == 0) opts.quarterRes = true;
+        else if (strcmp(arg, "-l") == 0 && hasValue) opts.listFile = argv[++i];
+        else if (strcmp(arg, "-w") == 0 && hasValue) opts.width = atoi(argv[++i]);
+        else if (strcmp(arg, "-h") == 0 && hasValue) opts.height = atoi(argv[++i]);
+        else if (strcmp(arg, "-b") == 0 && hasValue) opts.blendingType = atoi(argv[++i]);
+        else if (strcmp(arg, "-s") == 0 && hasValue) opts.stripType = atoi(argv[++i]);
+        else if (strcmp(arg, "-t") == 0 && hasValue) opts.threshStill = (float) atof(argv[++i]);
+        else if (strcmp(arg, "-i") == 0 && hasValue) opts.incrementalBudget = atoi(argv[++i]) << 20;
+        else if (strcmp(arg, "-r") == 0 && hasValue) opts.runs = atoi(argv[++i]);
+        else if (strcmp(arg, "-n") == 0 && hasValue) opts.synthFrames = atoi(argv[++i]);
+        else if (strcmp(arg, "-p") == 0 && hasValue) opts.synthStep = atoi(argv[++i]);
+        else if (strcmp(arg, "-o") == 0 && hasValue) opts.outFile = argv[++i];
+        else if (strcmp(arg, "-x") == 0 && hasValue) opts.expected = argv[++i];
+        else if (arg[0] != '-' && opts.yvuFile == NULL) opts.yvuFile = arg;
+        else
+        {
+            Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (opts.width <= 0 || opts.height <= 0 || opts.runs <= 0 ||
+            opts.synthFrames <= 0 || opts.synthFrames > MAX_BENCH_FRAMES ||
+            opts.synthStep < 0)
+    {
+        Usage(argv[0]);
+        return 1;
+    }
+
+    ImageType frames[MAX_BENCH_FRAMES];
+    int numFrames;
+    const char *source;
+
+    if (opts.listFile != NULL)
+    {
+        numFrames = ReadImageList(opts, frames);
+        source = opts.listFile;
+    }
+    else if (opts.yvuFile != NULL)
+    {
+        numFrames = ReadYvuFrames(opts, frames);
+        source = opts.yvuFile;
+    }
+    else
+    {
+        numFrames = MakeSyntheticFrames(opts, frames);
+        source = "synthetic pan";
+    }
+
+    if (numFrames <= 0)
+    {
+        fprintf(stderr, "No frames to mosaic\n");
+        return 1;
+    }
+
+    printf("%s: %d frames of %d x %d, %d runs\n", source, numFrames,
+            opts.width, opts.height, opts.runs);
+
+    RunResult first = RunResult();
+    RunResult result;
+    double bestMs[NUM_STAGES], sumMs[NUM_STAGES];
+    double alignMaxMs = 0.0;
+    bool deterministic = true;
+
+    for (int s = 0; s < NUM_STAGES; s++)
+    {
+        bestMs[s] = 1e30;
+        sumMs[s] = 0.0;
+    }
+
+    for (int run = 0; run < opts.runs; run++)
+    {
+        if (RunOnce(opts, frames, numFrames, result, run == 0) != 0)
+            return 1;
+
+        if (run == 0)
+            first = result;
+        else if (result.checksum != first.checksum || result.accepted != first.accepted ||
+                result.mosaicWidth != first.mosaicWidth || result.mosaicHeight != first.mosaicHeight)
+            deterministic = false;
+
+        for (int s = 0; s < NUM_STAGES; s++)
+        {
+            if (result.stageMs[s] < bestMs[s])
+                bestMs[s] = result.stageMs[s];
+            sumMs[s] += result.stageMs[s];
+        }
+        if (result.alignMaxMs > alignMaxMs)
+            alignMaxMs = result.alignMaxMs;
+    }
+
+    printf("%-12s %10s %10s\n", "stage", "best ms", "mean ms");
+    for (int s = 0; s < NUM_STAGES; s++)
+        printf("%-12s %10.2f %10.2f\n", stageNames[s], bestMs[s], sumMs[s] / opts.runs);
+    printf("align per frame: %.2f ms mean, %.2f ms worst\n",
+            sumMs[STAGE_ALIGN] / (opts.runs * numFrames), alignMaxMs);
+
+    printf("frames accepted: %d of %d, %d tracked\n", first.accepted, numFrames, first.tracked);
+    printf("peak memory: %ld KB\n", PeakMemoryKb());
+    printf("panorama: %d x %d, checksum %08x\n", first.mosaicWidth, first.mosaicHeight,
+            first.checksum);
+
+    int ret = 0;
+    if (!deterministic)
+    {
+        printf("FAILED: runs gave different panoramas\n");
+        ret = 1;
+    }
+    if (opts.expected != NULL && strtoul(opts.expected, NULL, 16) != first.checksum)
+    {
+        printf("FAILED: expected checksum %s\n", opts.expected);
+        ret = 1;
+    }
+
+    for (int i = 0; i < numFrames; i++)
+        ImageUtils::freeImage(frames[i]);
+
+    return ret;
+}
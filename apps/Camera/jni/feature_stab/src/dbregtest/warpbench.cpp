@@ -0,0 +1,221 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// warpbench.cpp
+//
+// Measures db_WarpImageHomography against the look-up table warps it
+// replaces (table generation included), for gray, RGB and planar YVU
+// images under an affine and a projective homography, and reports the
+// largest difference between the two away from the image border.
+//
+// Usage: dbreg_warpbench [width height [iterations]]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+
+#include "dbreg.h"
+
+// Both warps interpolate the same four pixels, the fixed point weights
+// may round differently by a level or two
+static const int MAX_DIFFERENCE = 2;
+
+enum
+{
+    WARP_GRAY_FAST,
+    WARP_GRAY,
+    WARP_RGB,
+    WARP_YVU,
+    NUM_WARPS
+};
+
+static const char *warpNames[NUM_WARPS] =
+{
+    "gray nearest",
+    "gray bilinear",
+    "rgb bilinear",
+    "yvu bilinear"
+};
+
+static const int warpLayouts[NUM_WARPS] =
+{
+    DB_WARP_LAYOUT_GRAY,
+    DB_WARP_LAYOUT_GRAY,
+    DB_WARP_LAYOUT_RGB,
+    DB_WARP_LAYOUT_YVU_PLANAR
+};
+
+static double now_ms()
+{
+    struct timeval res;
+    gettimeofday(&res, NULL);
+    return 1000.0 * res.tv_sec + (double) res.tv_usec / 1e3;
+}
+
+// The warp as it was done before: a table per frame, then a lookup pass
+// per plane
+static void WarpLut(int warp, unsigned char **src, unsigned char **dst, int w, int h,
+        float **lut_x, float **lut_y, const double H[9])
+{
+    db_GenerateHomographyLut(lut_x, lut_y, w, h, H);
+
+    switch (warp)
+    {
+        case WARP_GRAY_FAST:
+            db_WarpImageLut_u(src, dst, w, h, lut_x, lut_y, DB_WARP_FAST);
+            break;
+        case WARP_GRAY:
+            db_WarpImageLut_u(src, dst, w, h, lut_x, lut_y, DB_WARP_BILINEAR);
+            break;
+        case WARP_RGB:
+            db_WarpImageLutBilinear_rgb(src, dst, w, h, lut_x, lut_y);
+            break;
+        case WARP_YVU:
+            for (int p = 0; p < 3; p++)
+                db_WarpImageLut_u(src + p * h, dst + p * h, w, h, lut_x, lut_y, DB_WARP_BILINEAR);
+            break;
+    }
+}
+
+static void WarpDirect(int warp, unsigned char **src, unsigned char **dst, int w, int h, const double H[9])
+{
+    db_WarpImageHomography(src, dst, w, h, warpLayouts[warp], H,
+            warp == WARP_GRAY_FAST ? DB_WARP_FAST : DB_WARP_BILINEAR);
+}
+
+// Milliseconds per warp
+static double Measure(int warp, bool direct, unsigned char **src, unsigned char **dst, int w, int h,
+        float **lut_x, float **lut_y, const double H[9], int iterations)
+{
+    // Warm the caches and fault in the output
+    if (direct)
+        WarpDirect(warp, src, dst, w, h, H);
+    else
+        WarpLut(warp, src, dst, w, h, lut_x, lut_y, H);
+
+    double t0 = now_ms();
+    for (int i = 0; i < iterations; i++)
+    {
+        if (direct)
+            WarpDirect(warp, src, dst, w, h, H);
+        else
+            WarpLut(warp, src, dst, w, h, lut_x, lut_y, H);
+    }
+    double t1 = now_ms();
+
+    return (t1 - t0) / iterations;
+}
+
+// Largest difference over the pixels whose source position has a full
+// neighbourhood; the two warps treat the outermost pixel differently.
+// Nearest sampling truncates in one and rounds in the other, so only the
+// bilinear warps are compared.
+static int MaxDifference(int warp, unsigned char **a, unsigned char **b, int w, int h,
+        float **lut_x, float **lut_y)
+{
+    if (warp == WARP_GRAY_FAST)
+        return 0;
+
+    int channels = (warp == WARP_RGB) ? 3 : 1;
+    int planes = (warp == WARP_YVU) ? 3 : 1;
+    int max_diff = 0;
+
+    for (int p = 0; p < planes; p++)
+        for (int i = 0; i < h; i++)
+            for (int j = 0; j < w; j++)
+            {
+                if (lut_x[i][j] < 1.0f || lut_y[i][j] < 1.0f || lut_x[i][j] > w - 2 || lut_y[i][j] > h - 2)
+                    continue;
+
+                for (int c = 0; c < channels; c++)
+                    max_diff = db_maxi(max_diff, abs(a[p * h + i][channels * j + c] - b[p * h + i][channels * j + c]));
+            }
+
+    return max_diff;
+}
+
+int main(int argc, char *argv[])
+{
+    int w = 640, h = 480, iterations = 20;
+
+    if (argc >= 3)
+    {
+        w = atoi(argv[1]);
+        h = atoi(argv[2]);
+    }
+    if (argc >= 4)
+        iterations = atoi(argv[3]);
+
+    if (w < 16 || h < 16 || iterations <= 0)
+    {
+        fprintf(stderr, "Usage: %s [width height [iterations]], at least 16 x 16\n", argv[0]);
+        return 1;
+    }
+
+    // Large enough for every layout: 3*w bytes by 3*h rows. The table
+    // warp reads one row and column past positions on the far border.
+    unsigned char **src = db_AllocImage_u(3 * w + 1, 3 * h + 1);
+    unsigned char **dstLut = db_AllocImage_u(3 * w, 3 * h);
+    unsigned char **dstDirect = db_AllocImage_u(3 * w, 3 * h);
+    float **lut_x = db_AllocImage_f(w, h);
+    float **lut_y = db_AllocImage_f(w, h);
+
+    // Smooth texture, so that interpolation differences stay meaningful
+    srand(1);
+    for (int i = 0; i <= 3 * h; i++)
+        for (int j = 0; j <= 3 * w; j++)
+            src[i][j] = (unsigned char) (rand() & 0xff);
+    for (int i = 1; i < 3 * h - 1; i++)
+        for (int j = 1; j < 3 * w - 1; j++)
+            src[i][j] = (unsigned char) ((src[i - 1][j] + src[i + 1][j] + src[i][j - 1] + src[i][j + 1] + 4 * src[i][j]) >> 3);
+
+    // A small rotation and shift, as between neighbouring panorama frames,
+    // and the same with some perspective
+    double H[2][9] =
+    {
+        { 0.9986, -0.0523, 12.3, 0.0523, 0.9986, -7.6, 0.0, 0.0, 1.0 },
+        { 0.9986, -0.0523, 12.3, 0.0523, 0.9986, -7.6, 2.0e-5, -1.5e-5, 1.0 }
+    };
+    const char *homographyNames[2] = { "affine", "projective" };
+
+    printf("%d x %d, %d iterations\n", w, h, iterations);
+    printf("%-11s %-14s %10s %10s %8s %6s\n", "homography", "warp", "lut ms", "direct ms", "speedup", "diff");
+
+    int failures = 0;
+    for (int k = 0; k < 2; k++)
+    {
+        for (int warp = 0; warp < NUM_WARPS; warp++)
+        {
+            double msLut = Measure(warp, false, src, dstLut, w, h, lut_x, lut_y, H[k], iterations);
+            double msDirect = Measure(warp, true, src, dstDirect, w, h, lut_x, lut_y, H[k], iterations);
+            int diff = MaxDifference(warp, dstLut, dstDirect, w, h, lut_x, lut_y);
+            if (diff > MAX_DIFFERENCE)
+                failures++;
+
+            printf("%-11s %-14s %10.2f %10.2f %7.2fx %6d%s\n", homographyNames[k], warpNames[warp],
+                    msLut, msDirect, msLut / msDirect, diff, diff > MAX_DIFFERENCE ? "  MISMATCH" : "");
+        }
+    }
+
+    db_FreeImage_f(lut_y, h);
+    db_FreeImage_f(lut_x, h);
+    db_FreeImage_u(dstDirect, 3 * h);
+    db_FreeImage_u(dstLut, 3 * h);
+    db_FreeImage_u(src, 3 * h + 1);
+
+    return (failures == 0) ? 0 : 1;
+}
@@ -48,6 +48,10 @@ int gPreviewImageHeight[NR];
 // Semaphore to protect simultaneous read/writes from gPreviewImage
 sem_t gPreviewImage_semaphore;
 
+// Planar YVU readback destination and whether it holds an unclaimed frame
+unsigned char* gPreviewPlanarImage[NR] = {NULL, NULL};
+bool gPreviewPlanarReady = false;
+
 // Off-screen preview FBO width (large enough to store the entire
 // preview mosaic).
 int gPreviewFBOWidth;
@@ -77,6 +81,19 @@ YVURenderer gYVURenderer[NR];
 // Off-screen FBOs to store the low-res and high-res YVU textures for processing
 FrameBuffer gBufferInputYVU[NR];
 
+// Shader to convert RGBA textures straight into planar YVU for processing
+YVURenderer gYVUPlanarRenderer[NR];
+// Off-screen FBOs (double-buffered) to store the planar YVU textures. Each
+// frame is read back one transfer after it was drawn, so glReadPixels does
+// not wait on the draw just issued.
+FrameBuffer gBufferInputPlanar[NR][2];
+// Index of the gBufferInputPlanar FBO the next frame is drawn into
+int gPlanarWriteIndex = 0;
+// Whether the other gBufferInputPlanar FBO holds a frame not yet read back
+bool gPlanarPending = false;
+// Whether transferGPUtoCPU() uses the planar path
+bool gPlanarReadback = false;
+
 // Shader to translate the flip-flop FBO - gBuffer[1-current] -> gBuffer[current]
 WarpRenderer gWarper1;
 // Shader to add warped current frame to the flip-flop FBO - gBuffer[current]
@@ -452,6 +469,9 @@ void FreeTextureMemory()
     sem_wait(&gPreviewImage_semaphore);
     ImageUtils::freeImage(gPreviewImage[LR]);
     ImageUtils::freeImage(gPreviewImage[HR]);
+    gPreviewPlanarImage[LR] = NULL;
+    gPreviewPlanarImage[HR] = NULL;
+    gPreviewPlanarReady = false;
     sem_post(&gPreviewImage_semaphore);
 
     sem_destroy(&gPreviewImage_semaphore);
@@ -483,6 +503,12 @@ JNIEXPORT jint JNICALL Java_com_android_camera_panorama_MosaicRenderer_init(
     gSurfTexRenderer[HR].InitializeGLProgram();
     gYVURenderer[LR].InitializeGLProgram();
     gYVURenderer[HR].InitializeGLProgram();
+    gYVUPlanarRenderer[LR].SetPlanarOutput(true);
+    gYVUPlanarRenderer[HR].SetPlanarOutput(true);
+    bool planarProgram = gYVUPlanarRenderer[LR].InitializeGLProgram() &&
+            gYVUPlanarRenderer[HR].InitializeGLProgram();
+    gYVUPlanarRenderer[LR].SetPlanarOutput(planarProgram);
+    gYVUPlanarRenderer[HR].SetPlanarOutput(planarProgram);
     gWarper1.InitializeGLProgram();
     gWarper2.InitializeGLProgram();
     gPreview.InitializeGLProgram();
@@ -492,6 +518,11 @@ JNIEXPORT jint JNICALL Java_com_android_camera_panorama_MosaicRenderer_init(
     gBufferInput[HR].InitializeGLContext();
     gBufferInputYVU[LR].InitializeGLContext();
     gBufferInputYVU[HR].InitializeGLContext();
+    for (int i = 0; i < 2; i++)
+    {
+        gBufferInputPlanar[LR][i].InitializeGLContext();
+        gBufferInputPlanar[HR][i].InitializeGLContext();
+    }
 
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
@@ -566,8 +597,28 @@ JNIEXPORT void JNICALL Java_com_android_camera_panorama_MosaicRenderer_reset(
     sem_wait(&gPreviewImage_semaphore);
     ClearPreviewImage(LR);
     ClearPreviewImage(HR);
+
+    // The planar FBOs pack 4 pixels per texel
+    gPlanarReadback = gYVUPlanarRenderer[LR].IsPlanarOutput() &&
+            gPreviewPlanarImage[LR] != NULL && gPreviewPlanarImage[HR] != NULL &&
+            (gPreviewImageWidth[LR] % 4) == 0 && (gPreviewImageWidth[HR] % 4) == 0;
+
+    for (int mID = 0; mID < NR && gPlanarReadback; mID++)
+    {
+        for (int i = 0; i < 2 && gPlanarReadback; i++)
+        {
+            gPlanarReadback = gBufferInputPlanar[mID][i].Init(
+                    gPreviewImageWidth[mID] / 4, 3 * gPreviewImageHeight[mID],
+                    GL_RGBA);
+        }
+    }
+    gPreviewPlanarReady = false;
     sem_post(&gPreviewImage_semaphore);
 
+    gPlanarWriteIndex = 0;
+    gPlanarPending = false;
+    LOGV("GPU readback: %s", gPlanarReadback ? "planar YVU" : "YVUA");
+
     // bind the surface texture
     bindSurfaceTexture(gSurfaceTextureID[0]);
 
@@ -595,6 +646,15 @@ JNIEXPORT void JNICALL Java_com_android_camera_panorama_MosaicRenderer_reset(
     gYVURenderer[HR].SetInputTextureName(gBufferInput[HR].GetTextureName());
     gYVURenderer[HR].SetInputTextureType(GL_TEXTURE_2D);
 
+    for (int mID = 0; mID < NR; mID++)
+    {
+        gYVUPlanarRenderer[mID].SetInputTextureName(
+                gBufferInput[mID].GetTextureName());
+        gYVUPlanarRenderer[mID].SetInputTextureType(GL_TEXTURE_2D);
+        gYVUPlanarRenderer[mID].SetInputTextureDimensions(
+                gPreviewImageWidth[mID], gPreviewImageHeight[mID]);
+    }
+
     // gBuffer[1-gCurrentFBOIndex] --> gWarper1 --> gBuffer[gCurrentFBOIndex]
     gWarper1.SetupGraphics(&gBuffer[gCurrentFBOIndex]);
     gWarper1.Clear(0.0, 0.0, 0.0, 1.0);
@@ -655,11 +715,55 @@ now_ms(void)
 
 
 
+// Draws the current frame as planar YVU and reads back the one drawn on the
+// previous call, which the GPU has had a whole frame to finish. The readback
+// lands directly in gPreviewPlanarImage, so no RGBA copy is made and the
+// frame processor needs no conversion.
+static void TransferPlanarGPUtoCPU()
+{
+    int write = gPlanarWriteIndex;
+    int read = gPlanarPending ? 1 - write : write;
+
+    for (int mID = 0; mID < NR; mID++)
+    {
+        gYVUPlanarRenderer[mID].SetupGraphics(&gBufferInputPlanar[mID][write]);
+        gYVUPlanarRenderer[mID].DrawTexture();
+    }
+
+    sem_wait(&gPreviewImage_semaphore);
+    for (int mID = 0; mID < NR; mID++)
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER,
+                gBufferInputPlanar[mID][read].GetFrameBufferName());
+        glReadPixels(0,
+                     0,
+                     gBufferInputPlanar[mID][read].GetWidth(),
+                     gBufferInputPlanar[mID][read].GetHeight(),
+                     GL_RGBA,
+                     GL_UNSIGNED_BYTE,
+                     gPreviewPlanarImage[mID]);
+
+        checkGlError("glReadPixels planar");
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    gPreviewPlanarReady = true;
+    sem_post(&gPreviewImage_semaphore);
+
+    gPlanarPending = true;
+    gPlanarWriteIndex = 1 - write;
+}
+
 JNIEXPORT void JNICALL Java_com_android_camera_panorama_MosaicRenderer_transferGPUtoCPU(
         JNIEnv * env, jobject obj)
 {
     double t0, t1, time_c;
 
+    if (gPlanarReadback)
+    {
+        TransferPlanarGPUtoCPU();
+        return;
+    }
+
     gYVURenderer[LR].DrawTexture();
     gYVURenderer[HR].DrawTexture();
 
@@ -746,6 +850,9 @@ JNIEXPORT void JNICALL Java_com_android_camera_panorama_MosaicRenderer_setWarpin
         gPanOffset = 0.0f;
         gPanViewfinder = true;
 
+        // Don't hand a viewfinder frame to the capture
+        gPlanarPending = false;
+
         db_Identity3x3(gThisH1t);
         db_Identity3x3(gLastH1t);
     }
@@ -33,3 +33,13 @@ extern int gPreviewImageWidth[NR];
 extern int gPreviewImageHeight[NR];
 
 extern sem_t gPreviewImage_semaphore;
+
+// Planar YVU destination of the GPU readback, owned by the frame processor.
+// While set, transferGPUtoCPU() reads frames straight into it instead of
+// into gPreviewImage, and sets gPreviewPlanarReady. Both are protected by
+// gPreviewImage_semaphore.
+extern unsigned char* gPreviewPlanarImage[NR];
+extern bool gPreviewPlanarReady;
+// Whether the GPU reads the frames back as planar YVU, in which case
+// gPreviewImage is not written. Set when the texture memory is allocated.
+extern bool gPlanarReadback;
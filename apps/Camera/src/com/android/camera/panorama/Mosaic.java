@@ -96,13 +96,25 @@ public class Mosaic {
         System.loadLibrary("jni_mosaic");
     }
 
+    /**
+     * Set the directory of the scratch file that backs the image frames and
+     * the blending buffers, so they do not all have to stay in memory. Takes
+     * effect on the next allocateMosaicMemory call.
+     *
+     * @param path directory for the scratch file, or null to keep everything
+     *        in memory
+     */
+    public native void setScratchDirectory(String path);
+
     /**
      * Allocate memory for the image frames at the given resolution.
      *
      * @param width width of the input frames in pixels
      * @param height height of the input frames in pixels
+     * @return false if the frames could not be allocated, in which case no
+     *         frame may be passed in
      */
-    public native void allocateMosaicMemory(int width, int height);
+    public native boolean allocateMosaicMemory(int width, int height);
 
     /**
      * Free memory allocated by allocateMosaicMemory.
@@ -116,11 +128,15 @@ public class Mosaic {
      * image to t is computed and returned.
      *
      * @param pixels source image of NV21 format.
-     * @return Float array of length 11; first 9 entries correspond to the 3x3
-     *         transformation matrix between the first frame and the passed frame;
-     *         the 10th entry is the number of the passed frame, where the counting
-     *         starts from 1; and the 11th entry is the returning code, whose value
-     *         is one of those MOSAIC_RET_* returning flags defined above.
+     * @return Float array of length 12; first 9 entries correspond to the 3x3
+     *         transformation matrix between the first frame and the last aligned
+     *         frame; the 10th entry is the number of that frame, where the counting
+     *         starts from 1; the 11th entry is the returning code, whose value
+     *         is one of those MOSAIC_RET_* returning flags defined above; and the
+     *         12th entry is the time that frame was passed in, in milliseconds
+     *         since reset(), or -1 if no frame was aligned yet. Frames are aligned
+     *         in the background, so the last aligned frame may be a few frames
+     *         older than the passed one.
      */
     public native float[] setSourceImage(byte[] pixels);
 
@@ -131,11 +147,15 @@ public class Mosaic {
      * using glReadPixels directly from GPU memory (where it is accessed by
      * an associated SurfaceTexture).
      *
-     * @return Float array of length 11; first 9 entries correspond to the 3x3
-     *         transformation matrix between the first frame and the passed frame;
-     *         the 10th entry is the number of the passed frame, where the counting
-     *         starts from 1; and the 11th entry is the returning code, whose value
-     *         is one of those MOSAIC_RET_* returning flags defined above.
+     * @return Float array of length 12; first 9 entries correspond to the 3x3
+     *         transformation matrix between the first frame and the last aligned
+     *         frame; the 10th entry is the number of that frame, where the counting
+     *         starts from 1; the 11th entry is the returning code, whose value
+     *         is one of those MOSAIC_RET_* returning flags defined above; and the
+     *         12th entry is the time that frame was passed in, in milliseconds
+     *         since reset(), or -1 if no frame was aligned yet. Frames are aligned
+     *         in the background, so the last aligned frame may be a few frames
+     *         older than the passed one.
      */
     public native float[] setSourceImageFromGPU();
 
@@ -203,4 +223,23 @@ public class Mosaic {
      *          computation is 50% done.
      */
     public native int reportProgress(boolean hires, boolean cancelComputation);
+
+    /**
+     * Number of values per frame in the array returned by
+     * {@link #getAlignmentProfile()}.
+     */
+    public static final int ALIGNMENT_PROFILE_FIELDS = 10;
+
+    /**
+     * Get the timings and counters of the preview frame alignments, for the
+     * most recent frames of the current mosaic, oldest first. Each frame
+     * takes {@link #ALIGNMENT_PROFILE_FIELDS} consecutive values: frame
+     * number, corner detection, matching, RANSAC and total time in
+     * milliseconds, then the number of corners, matches, inliers and RANSAC
+     * hypotheses, and 1 if the corners were tracked from the previous frame
+     * rather than detected.
+     *
+     * @return The flattened profiles, empty if no frame has been aligned.
+     */
+    public native float[] getAlignmentProfile();
 }
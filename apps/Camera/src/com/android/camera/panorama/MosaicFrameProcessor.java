@@ -30,18 +30,20 @@ public class MosaicFrameProcessor {
     private static final int FRAME_COUNT_INDEX = 9;
     private static final int X_COORD_INDEX = 2;
     private static final int Y_COORD_INDEX = 5;
+    private static final int FRAME_TIME_INDEX = 11;
     private static final int HR_TO_LR_DOWNSAMPLE_FACTOR = 4;
     private static final int WINDOW_SIZE = 3;
 
     private Mosaic mMosaicer;
     private boolean mIsMosaicMemoryAllocated = false;
-    private final long [] mFrameTimestamp = new long[NUM_FRAMES_IN_BUFFER];
     private float mTranslationLastX;
     private float mTranslationLastY;
 
     private int mFillIn = 0;
     private int mTotalFrameCount = 0;
-    private long mLastProcessedFrameTimestamp = 0;
+    // Capture time of the frame the last transformation was aligned from, in
+    // ms since the mosaicer was reset, or -1 before the first one
+    private float mLastAlignedFrameTime = -1f;
     private int mLastProcessFrameIdx = -1;
     private int mCurrProcessFrameIdx = -1;
 
@@ -63,6 +65,7 @@ public class MosaicFrameProcessor {
     private int mPreviewWidth;
     private int mPreviewHeight;
     private int mPreviewBufferSize;
+    private String mScratchDirectory;
 
     public interface ProgressListener {
         public void onProgress(boolean isFinished, float panningRateX, float panningRateY,
@@ -80,6 +83,10 @@ public class MosaicFrameProcessor {
         mProgressListener = listener;
     }
 
+    public void setScratchDirectory(String path) {
+        mScratchDirectory = path;
+    }
+
     public int reportProgress(boolean hires, boolean cancel) {
         return mMosaicer.reportProgress(hires, cancel);
     }
@@ -103,8 +110,12 @@ public class MosaicFrameProcessor {
 
     private void setupMosaicer(int previewWidth, int previewHeight, int bufSize) {
         Log.v(TAG, "setupMosaicer w, h=" + previewWidth + ',' + previewHeight + ',' + bufSize);
-        mMosaicer.allocateMosaicMemory(previewWidth, previewHeight);
-        mIsMosaicMemoryAllocated = true;
+        mMosaicer.setScratchDirectory(mScratchDirectory);
+        // Without the memory, processFrame() ignores the frames
+        mIsMosaicMemoryAllocated = mMosaicer.allocateMosaicMemory(previewWidth, previewHeight);
+        if (!mIsMosaicMemoryAllocated) {
+            Log.e(TAG, "Could not allocate the mosaic memory");
+        }
 
         mFillIn = 0;
         if  (mMosaicer != null) {
@@ -117,7 +128,7 @@ public class MosaicFrameProcessor {
         // Only counters will be changed.
         mTotalFrameCount = 0;
         mFillIn = 0;
-        mLastProcessedFrameTimestamp = 0;
+        mLastAlignedFrameTime = -1f;
         mTotalTranslationX = 0;
         mTranslationLastX = 0;
         mTotalTranslationY = 0;
@@ -153,9 +164,6 @@ public class MosaicFrameProcessor {
             // are not processed yet and thus the callback may be invoked.
             return;
         }
-        long t1 = System.currentTimeMillis();
-        mFrameTimestamp[mFillIn] = t1;
-
         mCurrProcessFrameIdx = mFillIn;
         mFillIn = ((mFillIn + 1) % NUM_FRAMES_IN_BUFFER);
 
@@ -164,15 +172,12 @@ public class MosaicFrameProcessor {
         if (mCurrProcessFrameIdx != mLastProcessFrameIdx) {
             mLastProcessFrameIdx = mCurrProcessFrameIdx;
 
-            // Access the timestamp associated with it...
-            long timestamp = mFrameTimestamp[mCurrProcessFrameIdx];
-
             // TODO: make the termination condition regarding reaching
             // MAX_NUMBER_OF_FRAMES solely determined in the library.
             if (mTotalFrameCount < MAX_NUMBER_OF_FRAMES) {
                 // If we are still collecting new frames for the current mosaic,
                 // process the new frame.
-                calculateTranslationRate(timestamp);
+                calculateTranslationRate();
 
                 // Publish progress of the ongoing processing
                 if (mProgressListener != null) {
@@ -190,18 +195,26 @@ public class MosaicFrameProcessor {
         }
     }
 
-    public void calculateTranslationRate(long now) {
+    public void calculateTranslationRate() {
         float[] frameData = mMosaicer.setSourceImageFromGPU();
         int ret_code = (int) frameData[MOSAIC_RET_CODE_INDEX];
         mTotalFrameCount  = (int) frameData[FRAME_COUNT_INDEX];
         float translationCurrX = frameData[X_COORD_INDEX];
         float translationCurrY = frameData[Y_COORD_INDEX];
+        // The frames are aligned in the background, so the translation is the
+        // one of a frame captured a few frames ago, at this time.
+        float frameTime = frameData[FRAME_TIME_INDEX];
+
+        if (frameTime == mLastAlignedFrameTime) {
+            // No frame was aligned since the last call.
+            return;
+        }
 
-        if (mLastProcessedFrameTimestamp == 0f) {
+        if (mLastAlignedFrameTime < 0f) {
             // First time: no need to update delta values.
             mTranslationLastX = translationCurrX;
             mTranslationLastY = translationCurrY;
-            mLastProcessedFrameTimestamp = now;
+            mLastAlignedFrameTime = frameTime;
             return;
         }
 
@@ -213,7 +226,7 @@ public class MosaicFrameProcessor {
         mTotalDeltaTime -= mDeltaTime[idx];
         mDeltaX[idx] = Math.abs(translationCurrX - mTranslationLastX);
         mDeltaY[idx] = Math.abs(translationCurrY - mTranslationLastY);
-        mDeltaTime[idx] = (now - mLastProcessedFrameTimestamp) / 1000.0f;
+        mDeltaTime[idx] = (frameTime - mLastAlignedFrameTime) / 1000.0f;
         mTotalTranslationX += mDeltaX[idx];
         mTotalTranslationY += mDeltaY[idx];
         mTotalDeltaTime += mDeltaTime[idx];
@@ -231,7 +244,7 @@ public class MosaicFrameProcessor {
 
         mTranslationLastX = translationCurrX;
         mTranslationLastY = translationCurrY;
-        mLastProcessedFrameTimestamp = now;
+        mLastAlignedFrameTime = frameTime;
         mOldestIdx = (mOldestIdx + 1) % WINDOW_SIZE;
     }
 }
@@ -1004,6 +1004,7 @@ public class PanoramaActivity extends ActivityBase implements
             // Start the activity for the first time.
             mMosaicFrameProcessor = new MosaicFrameProcessor(
                     mPreviewWidth, mPreviewHeight, getPreviewBufSize());
+            mMosaicFrameProcessor.setScratchDirectory(getCacheDir().getPath());
         }
         mMosaicFrameProcessor.initialize();
     }
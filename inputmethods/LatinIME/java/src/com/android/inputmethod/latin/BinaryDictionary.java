@@ -17,6 +17,8 @@
 package com.android.inputmethod.latin;
 
 import android.content.Context;
+import android.content.res.Resources;
+import android.util.Log;
 
 import com.android.inputmethod.keyboard.ProximityInfo;
 
@@ -81,6 +83,11 @@ public class BinaryDictionary extends Dictionary {
 
     private int mFlags = 0;
 
+    // The levels of the trie that are read into memory when a dictionary file is opened, and
+    // the levels that are locked there
+    private final int mWarmUpDepth;
+    private final int mLockDepth;
+
     /**
      * Constructor for the binary dictionary. This is supposed to be called from the
      * dictionary factory.
@@ -100,6 +107,9 @@ public class BinaryDictionary extends Dictionary {
         // TODO: Stop relying on the state of SubtypeSwitcher, get it as a parameter
         mFlags = Flag.initFlags(null == flagArray ? ALL_CONFIG_FLAGS : flagArray, context,
                 SubtypeSwitcher.getInstance());
+        final Resources res = null == context ? null : context.getResources();
+        mWarmUpDepth = null == res ? 0 : res.getInteger(R.integer.config_dictionary_warm_up_depth);
+        mLockDepth = null == res ? 0 : res.getInteger(R.integer.config_dictionary_lock_depth);
         loadDictionary(filename, offset, length);
     }
 
@@ -109,8 +119,11 @@ public class BinaryDictionary extends Dictionary {
 
     private native int openNative(String sourceDir, long dictOffset, long dictSize,
             int typedLetterMultiplier, int fullWordMultiplier, int maxWordLength,
-            int maxWords, int maxAlternatives);
+            int maxWords, int maxAlternatives, int warmUpDepth, int lockDepth);
     private native void closeNative(int dict);
+    private native boolean addDictionaryNative(int dict, String sourceDir, long dictOffset,
+            long dictSize, int warmUpDepth, int lockDepth);
+    private native void getResidencyNative(int dict, int[] outPageCounts);
     private native boolean isValidWordNative(int nativeData, char[] word, int wordLength);
     private native int getSuggestionsNative(int dict, int proximityInfo, int[] xCoordinates,
             int[] yCoordinates, int[] inputCodes, int codesSize, int flags, char[] outputChars,
@@ -122,7 +135,40 @@ public class BinaryDictionary extends Dictionary {
     private final void loadDictionary(String path, long startOffset, long length) {
         mNativeDict = openNative(path, startOffset, length,
                     TYPED_LETTER_MULTIPLIER, FULL_WORD_SCORE_MULTIPLIER,
-                    MAX_WORD_LENGTH, MAX_WORDS, MAX_PROXIMITY_CHARS_SIZE);
+                    MAX_WORD_LENGTH, MAX_WORDS, MAX_PROXIMITY_CHARS_SIZE,
+                    mWarmUpDepth, mLockDepth);
+        if (LatinImeLogger.sDBG && isValidDictionary()) {
+            final int[] pageCounts = getResidency();
+            Log.d(TAG, "Opened " + path + ", " + pageCounts[1] + " of " + pageCounts[0]
+                    + " pages in memory");
+        }
+    }
+
+    /**
+     * Gets how much of the dictionary files is in memory.
+     * @return the count of the pages of the files, then the count of those in memory.
+     */
+    public synchronized int[] getResidency() {
+        final int[] pageCounts = new int[2];
+        if (isValidDictionary()) getResidencyNative(mNativeDict, pageCounts);
+        return pageCounts;
+    }
+
+    /**
+     * Searches another binary dictionary together with this one, in the same native search.
+     *
+     * The input and the correction are only set up once, and this dictionary returns the best
+     * words of both, instead of the best words of each.
+     * @param filename the name of the file to read through native code.
+     * @param offset the offset of the dictionary data within the file.
+     * @param length the length of the binary data.
+     * @return whether the dictionary could be added. If not, this dictionary is unchanged.
+     */
+    public synchronized boolean addDictionary(final String filename, final long offset,
+            final long length) {
+        if (!isValidDictionary()) return false;
+        return addDictionaryNative(mNativeDict, filename, offset, length, mWarmUpDepth,
+                mLockDepth);
     }
 
     @Override
@@ -149,7 +195,8 @@ public class BinaryDictionary extends Dictionary {
                 mOutputChars_bigrams, mBigramScores, MAX_WORD_LENGTH, MAX_BIGRAMS,
                 MAX_PROXIMITY_CHARS_SIZE);
 
-        for (int j = 0; j < count; ++j) {
+        // The count is that of all the bigrams of the word, which may be more than are output
+        for (int j = 0; j < count && j < MAX_BIGRAMS; ++j) {
             if (mBigramScores[j] < 1) break;
             final int start = j * MAX_WORD_LENGTH;
             int len = 0;
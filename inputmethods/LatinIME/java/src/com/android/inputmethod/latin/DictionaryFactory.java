@@ -56,11 +56,19 @@ public class DictionaryFactory {
         final List<AssetFileAddress> assetFileList =
                 BinaryDictionaryGetter.getDictionaryFiles(locale, context, fallbackResId);
         if (null != assetFileList) {
+            // The files are searched together by the first dictionary that could be opened, in
+            // one native search per input. Those that can't be added are searched on their own.
+            BinaryDictionary mergedDictionary = null;
             for (final AssetFileAddress f : assetFileList) {
+                if (null != mergedDictionary
+                        && mergedDictionary.addDictionary(f.mFilename, f.mOffset, f.mLength)) {
+                    continue;
+                }
                 final BinaryDictionary binaryDictionary =
                         new BinaryDictionary(context, f.mFilename, f.mOffset, f.mLength, flagArray);
                 if (binaryDictionary.isValidDictionary()) {
                     dictList.add(binaryDictionary);
+                    if (null == mergedDictionary) mergedDictionary = binaryDictionary;
                 }
             }
         }
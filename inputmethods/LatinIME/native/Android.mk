@@ -1,23 +1,32 @@
 LOCAL_PATH := $(call my-dir)
-include $(CLEAR_VARS)
 
-LOCAL_C_INCLUDES += $(LOCAL_PATH)/src
+# The suggestion code, without the JNI
+LATIN_IME_CORE_SRC_FILES := \
+    src/bigram_dictionary.cpp \
+    src/char_utils.cpp \
+    src/correction.cpp \
+    src/dictionary.cpp \
+    src/dictionary_warm_up.cpp \
+    src/group_parent_index.cpp \
+    src/proximity_info.cpp \
+    src/unigram_dictionary.cpp
 
-LOCAL_CFLAGS += -Werror -Wall
+LATIN_IME_CFLAGS := -Werror -Wall
 
 # To suppress compiler warnings for unused variables/functions used for debug features etc.
-LOCAL_CFLAGS += -Wno-unused-parameter -Wno-unused-function
+LATIN_IME_CFLAGS += -Wno-unused-parameter -Wno-unused-function
+
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/src
+
+LOCAL_CFLAGS += $(LATIN_IME_CFLAGS)
 
 LOCAL_SRC_FILES := \
     jni/com_android_inputmethod_keyboard_ProximityInfo.cpp \
     jni/com_android_inputmethod_latin_BinaryDictionary.cpp \
     jni/jni_common.cpp \
-    src/bigram_dictionary.cpp \
-    src/char_utils.cpp \
-    src/correction.cpp \
-    src/dictionary.cpp \
-    src/proximity_info.cpp \
-    src/unigram_dictionary.cpp
+    $(LATIN_IME_CORE_SRC_FILES)
 
 #FLAG_DBG := true
 #FLAG_DO_PROFILE := true
@@ -58,3 +67,38 @@ endif # FLAG_DBG
 endif # FLAG_DO_PROFILE
 
 include $(BUILD_SHARED_LIBRARY)
+
+# The suggestion code built for the host, to measure it without a device
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/src
+
+LOCAL_CFLAGS += $(LATIN_IME_CFLAGS)
+
+LOCAL_SRC_FILES := $(LATIN_IME_CORE_SRC_FILES)
+
+LOCAL_MODULE := liblatinime_host
+
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_HOST_STATIC_LIBRARY)
+
+# Replays recorded taps through the host library, and reports the latency percentiles, the
+# char groups visited and the accuracy of the suggestions
+include $(CLEAR_VARS)
+
+LOCAL_C_INCLUDES += $(LOCAL_PATH)/src
+
+LOCAL_CFLAGS += $(LATIN_IME_CFLAGS)
+
+LOCAL_SRC_FILES := tools/latinime_replay.cpp
+
+LOCAL_STATIC_LIBRARIES := liblatinime_host
+
+LOCAL_LDLIBS := -lrt
+
+LOCAL_MODULE := latinime_replay
+
+LOCAL_MODULE_TAGS := tests
+
+include $(BUILD_HOST_EXECUTABLE)
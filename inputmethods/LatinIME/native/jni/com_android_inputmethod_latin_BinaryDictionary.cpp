@@ -20,6 +20,7 @@
 #include "binary_format.h"
 #include "com_android_inputmethod_latin_BinaryDictionary.h"
 #include "dictionary.h"
+#include "dictionary_warm_up.h"
 #include "jni.h"
 #include "jni_common.h"
 #include "proximity_info.h"
@@ -27,6 +28,7 @@
 #include <assert.h>
 #include <errno.h>
 #include <stdio.h>
+#include <unistd.h>
 
 #ifdef USE_MMAP_FOR_DICTIONARY
 #include <sys/mman.h>
@@ -41,17 +43,12 @@ namespace latinime {
 
 void releaseDictBuf(void* dictBuf, const size_t length, int fd);
 
-static jint latinime_BinaryDictionary_open(JNIEnv *env, jobject object,
-        jstring sourceDir, jlong dictOffset, jlong dictSize,
-        jint typedLetterMultiplier, jint fullWordMultiplier, jint maxWordLength, jint maxWords,
-        jint maxAlternatives) {
-    PROF_OPEN;
-    PROF_START(66);
-    const char *sourceDirChars = env->GetStringUTFChars(sourceDir, NULL);
-    if (sourceDirChars == NULL) {
-        LOGE("DICT: Can't get sourceDir string");
-        return 0;
-    }
+// Maps or reads the dictionary at dictOffset in the file, and checks its format. Returns NULL if
+// it can't, otherwise outputs what releaseDictBuf() needs into fd and adjust. A mapped
+// dictionary is warmed up to warmUpDepth and locked to lockDepth, see DictionaryWarmUp.
+static void *openDictBuf(const char *sourceDirChars, const jlong dictOffset,
+        const jlong dictSize, const int warmUpDepth, const int lockDepth, int *outFd,
+        int *outAdjust) {
     int fd = 0;
     void *dictBuf = NULL;
     int adjust = 0;
@@ -60,7 +57,7 @@ static jint latinime_BinaryDictionary_open(JNIEnv *env, jobject object,
     fd = open(sourceDirChars, O_RDONLY);
     if (fd < 0) {
         LOGE("DICT: Can't open sourceDir. sourceDirChars=%s errno=%d", sourceDirChars, errno);
-        return 0;
+        return NULL;
     }
     int pagesize = getpagesize();
     adjust = dictOffset % pagesize;
@@ -69,7 +66,7 @@ static jint latinime_BinaryDictionary_open(JNIEnv *env, jobject object,
     dictBuf = mmap(NULL, sizeof(char) * adjDictSize, PROT_READ, MAP_PRIVATE, fd, adjDictOffset);
     if (dictBuf == MAP_FAILED) {
         LOGE("DICT: Can't mmap dictionary. errno=%d", errno);
-        return 0;
+        return NULL;
     }
     dictBuf = (void *)((char *)dictBuf + adjust);
 #else // USE_MMAP_FOR_DICTIONARY
@@ -78,44 +75,72 @@ static jint latinime_BinaryDictionary_open(JNIEnv *env, jobject object,
     file = fopen(sourceDirChars, "rb");
     if (file == NULL) {
         LOGE("DICT: Can't fopen sourceDir. sourceDirChars=%s errno=%d", sourceDirChars, errno);
-        return 0;
+        return NULL;
     }
     dictBuf = malloc(sizeof(char) * dictSize);
     if (!dictBuf) {
         LOGE("DICT: Can't allocate memory region for dictionary. errno=%d", errno);
-        return 0;
+        return NULL;
     }
     int ret = fseek(file, (long)dictOffset, SEEK_SET);
     if (ret != 0) {
         LOGE("DICT: Failure in fseek. ret=%d errno=%d", ret, errno);
-        return 0;
+        return NULL;
     }
     ret = fread(dictBuf, sizeof(char) * dictSize, 1, file);
     if (ret != 1) {
         LOGE("DICT: Failure in fread. ret=%d errno=%d", ret, errno);
-        return 0;
+        return NULL;
     }
     ret = fclose(file);
     if (ret != 0) {
         LOGE("DICT: Failure in fclose. ret=%d errno=%d", ret, errno);
-        return 0;
+        return NULL;
     }
 #endif // USE_MMAP_FOR_DICTIONARY
-    env->ReleaseStringUTFChars(sourceDir, sourceDirChars);
 
     if (!dictBuf) {
         LOGE("DICT: dictBuf is null");
-        return 0;
+        return NULL;
     }
-    Dictionary *dictionary = NULL;
     if (BinaryFormat::UNKNOWN_FORMAT == BinaryFormat::detectFormat((uint8_t*)dictBuf)) {
-        LOGE("DICT: dictionary format is unknown, bad magic number");
+        LOGE("DICT: dictionary format is unknown, bad magic number or version");
 #ifdef USE_MMAP_FOR_DICTIONARY
         releaseDictBuf(((char*)dictBuf) - adjust, adjDictSize, fd);
 #else // USE_MMAP_FOR_DICTIONARY
         releaseDictBuf(dictBuf, 0, 0);
 #endif // USE_MMAP_FOR_DICTIONARY
-    } else {
+        return NULL;
+    }
+#ifdef USE_MMAP_FOR_DICTIONARY
+    DictionaryWarmUp::Stats stats;
+    DictionaryWarmUp::warmUp((uint8_t*)dictBuf, dictSize, ((uint8_t*)dictBuf) - adjust,
+            warmUpDepth, lockDepth, &stats);
+#endif // USE_MMAP_FOR_DICTIONARY
+    *outFd = fd;
+    *outAdjust = adjust;
+    return dictBuf;
+}
+
+static jint latinime_BinaryDictionary_open(JNIEnv *env, jobject object,
+        jstring sourceDir, jlong dictOffset, jlong dictSize,
+        jint typedLetterMultiplier, jint fullWordMultiplier, jint maxWordLength, jint maxWords,
+        jint maxAlternatives, jint warmUpDepth, jint lockDepth) {
+    PROF_OPEN;
+    PROF_START(66);
+    const char *sourceDirChars = env->GetStringUTFChars(sourceDir, NULL);
+    if (sourceDirChars == NULL) {
+        LOGE("DICT: Can't get sourceDir string");
+        return 0;
+    }
+    int fd = 0;
+    int adjust = 0;
+    void *dictBuf = openDictBuf(sourceDirChars, dictOffset, dictSize, warmUpDepth, lockDepth,
+            &fd, &adjust);
+    env->ReleaseStringUTFChars(sourceDir, sourceDirChars);
+
+    Dictionary *dictionary = NULL;
+    if (dictBuf) {
         dictionary = new Dictionary(dictBuf, dictSize, fd, adjust, typedLetterMultiplier,
                 fullWordMultiplier, maxWordLength, maxWords, maxAlternatives);
     }
@@ -124,6 +149,34 @@ static jint latinime_BinaryDictionary_open(JNIEnv *env, jobject object,
     return (jint)dictionary;
 }
 
+static jboolean latinime_BinaryDictionary_addDictionary(JNIEnv *env, jobject object, jint dict,
+        jstring sourceDir, jlong dictOffset, jlong dictSize, jint warmUpDepth, jint lockDepth) {
+    Dictionary *dictionary = (Dictionary*)dict;
+    if (!dictionary) return (jboolean) false;
+    const char *sourceDirChars = env->GetStringUTFChars(sourceDir, NULL);
+    if (sourceDirChars == NULL) {
+        LOGE("DICT: Can't get sourceDir string");
+        return (jboolean) false;
+    }
+    int fd = 0;
+    int adjust = 0;
+    void *dictBuf = openDictBuf(sourceDirChars, dictOffset, dictSize, warmUpDepth, lockDepth,
+            &fd, &adjust);
+    env->ReleaseStringUTFChars(sourceDir, sourceDirChars);
+    if (!dictBuf) return (jboolean) false;
+
+    if (!dictionary->addDictionary(dictBuf, dictSize, fd, adjust)) {
+        LOGE("DICT: Can't search more than %d dictionaries together", MAX_MERGED_DICTIONARIES);
+#ifdef USE_MMAP_FOR_DICTIONARY
+        releaseDictBuf((void *)((char *)dictBuf - adjust), dictSize + adjust, fd);
+#else // USE_MMAP_FOR_DICTIONARY
+        releaseDictBuf(dictBuf, 0, 0);
+#endif // USE_MMAP_FOR_DICTIONARY
+        return (jboolean) false;
+    }
+    return (jboolean) true;
+}
+
 static int latinime_BinaryDictionary_getSuggestions(JNIEnv *env, jobject object, jint dict,
         jint proximityInfo, jintArray xCoordinatesArray, jintArray yCoordinatesArray,
         jintArray inputArray, jint arraySize, jint flags,
@@ -187,9 +240,48 @@ static jboolean latinime_BinaryDictionary_isValidWord(JNIEnv *env, jobject objec
     return result;
 }
 
+// Outputs the count of the pages of all the dictionary files, then how many are in memory
+static void latinime_BinaryDictionary_getResidency(JNIEnv *env, jobject object, jint dict,
+        jintArray outPageCountsArray) {
+    Dictionary *dictionary = (Dictionary*)dict;
+    if (!dictionary) return;
+    int pageCount = 0;
+    int residentPageCount = 0;
+    for (int i = -1; i < dictionary->getAddedDictionaryCount(); ++i) {
+        const uint8_t *dictBuf = (uint8_t*)(i < 0 ? dictionary->getDict()
+                : dictionary->getAddedDict(i));
+        const int dictSize = i < 0 ? dictionary->getDictSize() : dictionary->getAddedDictSize(i);
+#ifdef USE_MMAP_FOR_DICTIONARY
+        const int adjust = i < 0 ? dictionary->getDictBufAdjust()
+                : dictionary->getAddedDictBufAdjust(i);
+        int filePageCount = 0;
+        residentPageCount += DictionaryWarmUp::getResidentPageCount(dictBuf - adjust,
+                dictSize + adjust, &filePageCount);
+        pageCount += filePageCount;
+#else // USE_MMAP_FOR_DICTIONARY
+        // Read into allocated memory
+        const int filePageCount = (dictSize + getpagesize() - 1) / getpagesize();
+        residentPageCount += filePageCount;
+        pageCount += filePageCount;
+#endif // USE_MMAP_FOR_DICTIONARY
+    }
+    jint pageCounts[] = { pageCount, residentPageCount };
+    env->SetIntArrayRegion(outPageCountsArray, 0, 2, pageCounts);
+}
+
 static void latinime_BinaryDictionary_close(JNIEnv *env, jobject object, jint dict) {
     Dictionary *dictionary = (Dictionary*)dict;
     if (!dictionary) return;
+    for (int i = 0; i < dictionary->getAddedDictionaryCount(); ++i) {
+#ifdef USE_MMAP_FOR_DICTIONARY
+        releaseDictBuf((void *)((char *)dictionary->getAddedDict(i)
+                - dictionary->getAddedDictBufAdjust(i)),
+                dictionary->getAddedDictSize(i) + dictionary->getAddedDictBufAdjust(i),
+                dictionary->getAddedMmapFd(i));
+#else // USE_MMAP_FOR_DICTIONARY
+        releaseDictBuf(dictionary->getAddedDict(i), 0, 0);
+#endif // USE_MMAP_FOR_DICTIONARY
+    }
     void *dictBuf = dictionary->getDict();
     if (!dictBuf) return;
 #ifdef USE_MMAP_FOR_DICTIONARY
@@ -217,8 +309,11 @@ void releaseDictBuf(void* dictBuf, const size_t length, int fd) {
 }
 
 static JNINativeMethod sMethods[] = {
-    {"openNative", "(Ljava/lang/String;JJIIIII)I", (void*)latinime_BinaryDictionary_open},
+    {"openNative", "(Ljava/lang/String;JJIIIIIII)I", (void*)latinime_BinaryDictionary_open},
     {"closeNative", "(I)V", (void*)latinime_BinaryDictionary_close},
+    {"addDictionaryNative", "(ILjava/lang/String;JJII)Z",
+            (void*)latinime_BinaryDictionary_addDictionary},
+    {"getResidencyNative", "(I[I)V", (void*)latinime_BinaryDictionary_getResidency},
     {"getSuggestionsNative", "(II[I[I[III[C[I)I", (void*)latinime_BinaryDictionary_getSuggestions},
     {"isValidWordNative", "(I[CI)Z", (void*)latinime_BinaryDictionary_isValidWord},
     {"getBigramsNative", "(I[CI[II[C[IIII)I", (void*)latinime_BinaryDictionary_getBigrams}
@@ -0,0 +1,266 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_ARRAY_TRIE_H
+#define LATINIME_ARRAY_TRIE_H
+
+#include <stdint.h>
+
+#include "defines.h"
+#include "unigram_dictionary.h"
+
+namespace latinime {
+
+// Reads a dictionary in the array format, FORMAT_VERSION_3. The char groups are the same as in
+// FORMAT_VERSION_2, but they are numbered breadth first, which puts the children of every group
+// next to each other, and each of their fields is in an array of its own, at the index of the
+// group. The search reads the first char of all the siblings of a node, and little else of most
+// of them, so these are read from a few consecutive bytes instead of from each group in turn.
+// The children of a group are found by index instead of read from an address, and so is the
+// parent of a group, by a binary search over the first children.
+//
+// After the header, all values are big endian:
+// group count G                          3 bytes
+// root group count                       3 bytes
+// first char of each group               G * 2 bytes
+// flags of each group                    G * 1 byte, with the same meaning as in version 2
+// frequency of each group                G * 1 byte, 0 if not a terminal
+// max descendant frequency of each group G * 1 byte, 0 if no children
+// first child of each group, then G      (G + 1) * 3 bytes, the index of the first child of
+//                                        the group, or of the first child of the groups after
+//                                        it if it has none
+// extra data offset of each group, then  (G + 1) * 3 bytes, the offset of the extra data of the
+// the extra data size                    group, which ends where the one of the next group starts
+// extra data
+//
+// The extra data of a group is, in order and only if its flags say so, the other chars of the
+// group as 2 bytes each then a 0 terminator, and the bigrams, which are 1 byte of frequency and
+// the index of the target group on 3 bytes each.
+class ArrayTrie {
+public:
+    static const int BIGRAM_SIZE = 4;
+    // The arrays after the header, including the extra data
+    static const int ARRAY_COUNT = 7;
+
+    ArrayTrie(const uint8_t* const root)
+            : GROUP_COUNT(readIndex(root)), ROOT_GROUP_COUNT(readIndex(root + INDEX_SIZE)),
+              CHARS(root + HEADER_SIZE), FLAGS(CHARS + GROUP_COUNT * CHAR_SIZE),
+              FREQUENCIES(FLAGS + GROUP_COUNT),
+              MAX_DESCENDANT_FREQUENCIES(FREQUENCIES + GROUP_COUNT),
+              FIRST_CHILDREN(MAX_DESCENDANT_FREQUENCIES + GROUP_COUNT),
+              EXTRA_OFFSETS(FIRST_CHILDREN + (GROUP_COUNT + 1) * INDEX_SIZE),
+              EXTRA_DATA(EXTRA_OFFSETS + (GROUP_COUNT + 1) * INDEX_SIZE) {
+    }
+
+    int getRootGroupCount() const {
+        return ROOT_GROUP_COUNT;
+    }
+
+    int32_t getChar(const int group) const {
+        return (CHARS[group * CHAR_SIZE] << 8) + CHARS[group * CHAR_SIZE + 1];
+    }
+
+    uint8_t getFlags(const int group) const {
+        return FLAGS[group];
+    }
+
+    int getFrequency(const int group) const {
+        return FREQUENCIES[group];
+    }
+
+    int getMaxDescendantFrequency(const int group) const {
+        return MAX_DESCENDANT_FREQUENCIES[group];
+    }
+
+    int getFirstChild(const int group) const {
+        return readIndex(FIRST_CHILDREN + group * INDEX_SIZE);
+    }
+
+    int getChildCount(const int group) const {
+        return getFirstChild(group + 1) - getFirstChild(group);
+    }
+
+    // The other chars of a multiple chars group, then its bigrams, start here
+    int getExtraDataPosition(const int group) const {
+        return readIndex(EXTRA_OFFSETS + group * INDEX_SIZE);
+    }
+
+    // Returns NOT_A_CHARACTER past the last char of the group
+    int32_t getOtherCharAndForwardPointer(int *pos) const {
+        const int32_t character = (EXTRA_DATA[*pos] << 8) + EXTRA_DATA[*pos + 1];
+        *pos += CHAR_SIZE;
+        return 0 == character ? NOT_A_CHARACTER : character;
+    }
+
+    int getBigramsPosition(const int group) const {
+        int pos = getExtraDataPosition(group);
+        if (UnigramDictionary::FLAG_HAS_MULTIPLE_CHARS & getFlags(group)) {
+            while (NOT_A_CHARACTER != getOtherCharAndForwardPointer(&pos)) {}
+        }
+        return pos;
+    }
+
+    int getBigramsEndPosition(const int group) const {
+        return getExtraDataPosition(group + 1);
+    }
+
+    int getBigramFrequency(const int pos) const {
+        return EXTRA_DATA[pos] & UnigramDictionary::MASK_ATTRIBUTE_FREQUENCY;
+    }
+
+    int getBigramTarget(const int pos) const {
+        return readIndex(EXTRA_DATA + pos + 1);
+    }
+
+    int getTerminalPosition(const uint16_t* const inWord, const int length) const;
+    int getWordAtAddress(const int group, const int maxDepth, uint16_t* outWord) const;
+    int getUpperLevelsGroupCount(const int depth) const;
+    void getGroupRanges(const int groupCount, const uint8_t** outStarts, int* outSizes) const;
+
+private:
+    static const int INDEX_SIZE = 3;
+    static const int CHAR_SIZE = 2;
+    static const int HEADER_SIZE = 2 * INDEX_SIZE;
+    static const int NO_PARENT = -1;
+
+    static int readIndex(const uint8_t* const p) {
+        return (p[0] << 16) + (p[1] << 8) + p[2];
+    }
+
+    int getParent(const int group) const;
+
+    const int GROUP_COUNT;
+    const int ROOT_GROUP_COUNT;
+    const uint8_t* const CHARS;
+    const uint8_t* const FLAGS;
+    const uint8_t* const FREQUENCIES;
+    const uint8_t* const MAX_DESCENDANT_FREQUENCIES;
+    const uint8_t* const FIRST_CHILDREN;
+    const uint8_t* const EXTRA_OFFSETS;
+    const uint8_t* const EXTRA_DATA;
+};
+
+// The first children increase with the group, so the parent is the last group whose first child
+// is not after this one. It is before this one, as children are numbered after their parent.
+inline int ArrayTrie::getParent(const int group) const {
+    if (group < ROOT_GROUP_COUNT) return NO_PARENT;
+    int low = 0;
+    int high = group - 1;
+    while (low < high) {
+        const int middle = (low + high + 1) / 2;
+        if (getFirstChild(middle) <= group) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return low;
+}
+
+// Same as BinaryFormat::getTerminalPosition, but the position is the index of the group
+inline int ArrayTrie::getTerminalPosition(const uint16_t* const inWord, const int length) const {
+    int group = 0;
+    int end = ROOT_GROUP_COUNT;
+    int wordPos = 0;
+    while (wordPos < length) {
+        const int32_t wChar = inWord[wordPos];
+        while (group < end && getChar(group) != wChar) ++group;
+        if (group >= end) return NOT_VALID_WORD;
+        ++wordPos;
+        const uint8_t flags = getFlags(group);
+        if (UnigramDictionary::FLAG_HAS_MULTIPLE_CHARS & flags) {
+            int pos = getExtraDataPosition(group);
+            for (int32_t character = getOtherCharAndForwardPointer(&pos);
+                    NOT_A_CHARACTER != character;
+                    character = getOtherCharAndForwardPointer(&pos)) {
+                if (wordPos >= length || inWord[wordPos] != character) return NOT_VALID_WORD;
+                ++wordPos;
+            }
+        }
+        if (wordPos == length) {
+            return (UnigramDictionary::FLAG_IS_TERMINAL & flags) ? group : NOT_VALID_WORD;
+        }
+        end = getFirstChild(group + 1);
+        group = getFirstChild(group);
+    }
+    return NOT_VALID_WORD;
+}
+
+// Same as BinaryFormat::getWordAtAddress, but the address is the index of the group
+inline int ArrayTrie::getWordAtAddress(const int group, const int maxDepth,
+        uint16_t* outWord) const {
+    // The groups of the word, from its last one up. Each group has at least one char.
+    int groups[MAX_WORD_LENGTH_INTERNAL];
+    int groupCount = 0;
+    for (int g = group; NO_PARENT != g; g = getParent(g)) {
+        if (groupCount >= maxDepth || groupCount >= MAX_WORD_LENGTH_INTERNAL) return 0;
+        groups[groupCount++] = g;
+    }
+
+    int wordPos = 0;
+    for (int i = groupCount - 1; i >= 0; --i) {
+        const int g = groups[i];
+        if (wordPos >= maxDepth) return 0;
+        outWord[wordPos++] = getChar(g);
+        if (UnigramDictionary::FLAG_HAS_MULTIPLE_CHARS & getFlags(g)) {
+            int pos = getExtraDataPosition(g);
+            for (int32_t character = getOtherCharAndForwardPointer(&pos);
+                    NOT_A_CHARACTER != character;
+                    character = getOtherCharAndForwardPointer(&pos)) {
+                if (wordPos >= maxDepth) return 0;
+                outWord[wordPos++] = character;
+            }
+        }
+    }
+    return wordPos;
+}
+
+// The groups of the first depth levels are the first ones, as they are numbered breadth first.
+// The children of the groups of a level start after its last group, at the first child of the
+// groups after it.
+inline int ArrayTrie::getUpperLevelsGroupCount(const int depth) const {
+    if (depth <= 0) return 0;
+    int levelEnd = ROOT_GROUP_COUNT;
+    for (int level = 1; level < depth && levelEnd < GROUP_COUNT; ++level) {
+        levelEnd = getFirstChild(levelEnd);
+    }
+    return levelEnd;
+}
+
+// Outputs where the fields of the first groupCount groups are, as one run of bytes in each of
+// the ARRAY_COUNT arrays
+inline void ArrayTrie::getGroupRanges(const int groupCount, const uint8_t** outStarts,
+        int* outSizes) const {
+    outStarts[0] = CHARS;
+    outSizes[0] = groupCount * CHAR_SIZE;
+    outStarts[1] = FLAGS;
+    outSizes[1] = groupCount;
+    outStarts[2] = FREQUENCIES;
+    outSizes[2] = groupCount;
+    outStarts[3] = MAX_DESCENDANT_FREQUENCIES;
+    outSizes[3] = groupCount;
+    // The first child and the extra data offset of the next group end the ones of the last group
+    outStarts[4] = FIRST_CHILDREN;
+    outSizes[4] = (groupCount + 1) * INDEX_SIZE;
+    outStarts[5] = EXTRA_OFFSETS;
+    outSizes[5] = (groupCount + 1) * INDEX_SIZE;
+    outStarts[6] = EXTRA_DATA;
+    outSizes[6] = getExtraDataPosition(groupCount);
+}
+
+} // namespace latinime
+
+#endif // LATINIME_ARRAY_TRIE_H
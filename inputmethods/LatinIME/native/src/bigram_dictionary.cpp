@@ -19,9 +19,11 @@
 
 #define LOG_TAG "LatinIME: bigram_dictionary.cpp"
 
+#include "array_trie.h"
 #include "bigram_dictionary.h"
 #include "dictionary.h"
 #include "binary_format.h"
+#include "group_parent_index.h"
 
 namespace latinime {
 
@@ -30,7 +32,9 @@ BigramDictionary::BigramDictionary(const unsigned char *dict, int maxWordLength,
         Dictionary *parentDictionary)
     : DICT(dict + NEW_DICTIONARY_HEADER_SIZE), MAX_WORD_LENGTH(maxWordLength),
     MAX_ALTERNATIVES(maxAlternatives), IS_LATEST_DICT_VERSION(isLatestDictVersion),
-    HAS_BIGRAM(hasBigram), mParentDictionary(parentDictionary) {
+    HAS_BIGRAM(hasBigram), mParentDictionary(parentDictionary), mGroupParentIndex(0) {
+    mArrayTrie = BinaryFormat::FORMAT_VERSION_3 == BinaryFormat::detectFormat(dict)
+            ? new ArrayTrie(DICT) : 0;
     if (DEBUG_DICT) {
         LOGI("BigramDictionary - constructor");
         LOGI("Has Bigram : %d", hasBigram);
@@ -38,6 +42,8 @@ BigramDictionary::BigramDictionary(const unsigned char *dict, int maxWordLength,
 }
 
 BigramDictionary::~BigramDictionary() {
+    delete mGroupParentIndex;
+    delete mArrayTrie;
 }
 
 bool BigramDictionary::addWordBigram(unsigned short *word, int length, int frequency) {
@@ -50,6 +56,18 @@ bool BigramDictionary::addWordBigram(unsigned short *word, int length, int frequ
 #endif
     }
 
+    // The bigrams of all the merged dictionaries go to the same output, which keeps a word once,
+    // with the higher frequency
+    for (int i = 0; i < mMaxBigrams && mBigramFreq[i] > 0; ++i) {
+        // Both words are null terminated
+        if (0 != memcmp(mBigramChars + i * MAX_WORD_LENGTH, word, (length + 1) * sizeof(word[0]))) {
+            continue;
+        }
+        if (frequency <= mBigramFreq[i]) return false;
+        removeBigramAt(i);
+        break;
+    }
+
     // Find the right insertion point
     int insertAt = 0;
     while (insertAt < mMaxBigrams) {
@@ -83,6 +101,17 @@ bool BigramDictionary::addWordBigram(unsigned short *word, int length, int frequ
     return false;
 }
 
+void BigramDictionary::removeBigramAt(const int index) {
+    memmove((char*) mBigramFreq + index * sizeof(mBigramFreq[0]),
+           (char*) mBigramFreq + (index + 1) * sizeof(mBigramFreq[0]),
+           (mMaxBigrams - index - 1) * sizeof(mBigramFreq[0]));
+    mBigramFreq[mMaxBigrams - 1] = 0;
+    memmove((char*) mBigramChars + index * MAX_WORD_LENGTH * sizeof(short),
+           (char*) mBigramChars + (index + 1) * MAX_WORD_LENGTH * sizeof(short),
+           (mMaxBigrams - index - 1) * sizeof(short) * MAX_WORD_LENGTH);
+    mBigramChars[(mMaxBigrams - 1) * MAX_WORD_LENGTH] = 0;
+}
+
 /* Parameters :
  * prevWord: the word before, the one for which we need to look up bigrams.
  * prevWordLength: its length.
@@ -111,6 +140,8 @@ int BigramDictionary::getBigrams(unsigned short *prevWord, int prevWordLength, i
     mInputCodes = codes;
     mMaxBigrams = maxBigrams;
 
+    if (mArrayTrie) return getBigramsInArrayTrie(prevWord, prevWordLength);
+
     const uint8_t* const root = DICT;
     int pos = BinaryFormat::getTerminalPosition(root, prevWord, prevWordLength);
 
@@ -131,8 +162,7 @@ int BigramDictionary::getBigrams(unsigned short *prevWord, int prevWordLength, i
         uint16_t bigramBuffer[MAX_WORD_LENGTH];
         const int bigramPos = BinaryFormat::getAttributeAddressAndForwardPointer(root, bigramFlags,
                 &pos);
-        const int length = BinaryFormat::getWordAtAddress(root, bigramPos, MAX_WORD_LENGTH,
-                bigramBuffer);
+        const int length = getWordAtAddress(bigramPos, bigramBuffer);
 
         if (checkFirstCharacter(bigramBuffer)) {
             const int frequency = UnigramDictionary::MASK_ATTRIBUTE_FREQUENCY & bigramFlags;
@@ -143,6 +173,39 @@ int BigramDictionary::getBigrams(unsigned short *prevWord, int prevWordLength, i
     return bigramCount;
 }
 
+// Same as getBigrams, for a dictionary in the array format, where the bigrams of a group are in
+// an array and point to the index of their target group.
+int BigramDictionary::getBigramsInArrayTrie(unsigned short *prevWord, int prevWordLength) {
+    const ArrayTrie* const trie = mArrayTrie;
+    const int group = trie->getTerminalPosition(prevWord, prevWordLength);
+    if (NOT_VALID_WORD == group) return 0;
+    if (0 == (trie->getFlags(group) & UnigramDictionary::FLAG_HAS_BIGRAMS)) return 0;
+    const int endPos = trie->getBigramsEndPosition(group);
+    int bigramCount = 0;
+    for (int pos = trie->getBigramsPosition(group); pos < endPos; pos += ArrayTrie::BIGRAM_SIZE) {
+        uint16_t bigramBuffer[MAX_WORD_LENGTH];
+        const int length = trie->getWordAtAddress(trie->getBigramTarget(pos), MAX_WORD_LENGTH,
+                bigramBuffer);
+        if (checkFirstCharacter(bigramBuffer)) {
+            addWordBigram(bigramBuffer, length, trie->getBigramFrequency(pos));
+        }
+        ++bigramCount;
+    }
+    return bigramCount;
+}
+
+// Reads the word ending at the group at address, from the group up. Searching for it from the
+// root costs a scan of a node per char group, and skipping the bigrams of the groups on the way.
+int BigramDictionary::getWordAtAddress(const int address, uint16_t *outWord) {
+    if (!mGroupParentIndex) {
+        mGroupParentIndex = new GroupParentIndex(DICT);
+    }
+    if (!mGroupParentIndex->isValid()) {
+        return BinaryFormat::getWordAtAddress(DICT, address, MAX_WORD_LENGTH, outWord);
+    }
+    return mGroupParentIndex->getWordAtAddress(address, MAX_WORD_LENGTH, outWord);
+}
+
 bool BigramDictionary::checkFirstCharacter(unsigned short *word) {
     // Checks whether this word starts with same character or neighboring characters of
     // what user typed.
@@ -17,9 +17,13 @@
 #ifndef LATINIME_BIGRAM_DICTIONARY_H
 #define LATINIME_BIGRAM_DICTIONARY_H
 
+#include <stdint.h>
+
 namespace latinime {
 
+class ArrayTrie;
 class Dictionary;
+class GroupParentIndex;
 class BigramDictionary {
 public:
     BigramDictionary(const unsigned char *dict, int maxWordLength, int maxAlternatives,
@@ -30,12 +34,15 @@ public:
     ~BigramDictionary();
 private:
     bool addWordBigram(unsigned short *word, int length, int frequency);
+    void removeBigramAt(const int index);
     int getBigramAddress(int *pos, bool advance);
     int getBigramFreq(int *pos);
     void searchForTerminalNode(int addressLookingFor, int frequency);
     bool getFirstBitOfByte(int *pos) { return (DICT[*pos] & 0x80) > 0; }
     bool getSecondBitOfByte(int *pos) { return (DICT[*pos] & 0x40) > 0; }
     bool checkFirstCharacter(unsigned short *word);
+    int getWordAtAddress(const int address, uint16_t *outWord);
+    int getBigramsInArrayTrie(unsigned short *prevWord, int prevWordLength);
 
     const unsigned char *DICT;
     const int MAX_WORD_LENGTH;
@@ -44,6 +51,10 @@ private:
     const bool HAS_BIGRAM;
 
     Dictionary *mParentDictionary;
+    // Only for a dictionary in the array format, NULL otherwise
+    const ArrayTrie *mArrayTrie;
+    // Built the first time a word has bigrams
+    GroupParentIndex *mGroupParentIndex;
     int *mBigramFreq;
     int mMaxBigrams;
     unsigned short *mBigramChars;
@@ -26,10 +26,15 @@ private:
     const static int32_t MINIMAL_ONE_BYTE_CHARACTER_VALUE = 0x20;
     const static int32_t CHARACTER_ARRAY_TERMINATOR = 0x1F;
     const static int MULTIPLE_BYTE_CHARACTER_ADDITIONAL_SIZE = 2;
+    const static int MAX_FREQUENCY = 255;
 
 public:
     const static int UNKNOWN_FORMAT = -1;
     const static int FORMAT_VERSION_1 = 1;
+    // Version 1 with the max descendant frequencies, which older readers would misread
+    const static int FORMAT_VERSION_2 = 2;
+    // The array format read by ArrayTrie
+    const static int FORMAT_VERSION_3 = 3;
     const static uint16_t FORMAT_VERSION_1_MAGIC_NUMBER = 0x78B1;
 
     static int detectFormat(const uint8_t* const dict);
@@ -37,6 +42,8 @@ public:
     static uint8_t getFlagsAndForwardPointer(const uint8_t* const dict, int* pos);
     static int32_t getCharCodeAndForwardPointer(const uint8_t* const dict, int* pos);
     static int readFrequencyWithoutMovingPointer(const uint8_t* const dict, const int pos);
+    static int readMaxDescendantFrequencyWithoutMovingPointer(const uint8_t* const dict,
+            const uint8_t flags, const int pos);
     static int skipOtherCharacters(const uint8_t* const dict, const int pos);
     static int skipAttributes(const uint8_t* const dict, const int pos);
     static int skipChildrenPosition(const uint8_t flags, const int pos);
@@ -56,8 +63,11 @@ public:
 
 inline int BinaryFormat::detectFormat(const uint8_t* const dict) {
     const uint16_t magicNumber = (dict[0] << 8) + dict[1]; // big endian
-    if (FORMAT_VERSION_1_MAGIC_NUMBER == magicNumber) return FORMAT_VERSION_1;
-    return UNKNOWN_FORMAT;
+    if (FORMAT_VERSION_1_MAGIC_NUMBER != magicNumber) return UNKNOWN_FORMAT;
+    // All the versions have the same header
+    const int version = dict[2];
+    if (version < FORMAT_VERSION_1 || version > FORMAT_VERSION_3) return UNKNOWN_FORMAT;
+    return version;
 }
 
 inline int BinaryFormat::getGroupCountAndForwardPointer(const uint8_t* const dict, int* pos) {
@@ -92,6 +102,14 @@ inline int BinaryFormat::readFrequencyWithoutMovingPointer(const uint8_t* const
     return dict[pos];
 }
 
+// Returns an upper bound of the frequencies of the words below the group, from the frequency
+// position. Dictionaries that don't store the highest one give the highest possible frequency.
+inline int BinaryFormat::readMaxDescendantFrequencyWithoutMovingPointer(
+        const uint8_t* const dict, const uint8_t flags, const int pos) {
+    if (!(UnigramDictionary::FLAG_HAS_MAX_DESCENDANT_FREQUENCY & flags)) return MAX_FREQUENCY;
+    return UnigramDictionary::FLAG_IS_TERMINAL & flags ? dict[pos + 1] : dict[pos];
+}
+
 inline int BinaryFormat::skipOtherCharacters(const uint8_t* const dict, const int pos) {
     int currentPos = pos;
     int32_t character = dict[currentPos++];
@@ -139,8 +157,11 @@ inline int BinaryFormat::skipChildrenPosition(const uint8_t flags, const int pos
     return pos + childrenAddressSize(flags);
 }
 
+// Skips the frequency, and the highest frequency of the words below the group that follows it
 inline int BinaryFormat::skipFrequency(const uint8_t flags, const int pos) {
-    return UnigramDictionary::FLAG_IS_TERMINAL & flags ? pos + 1 : pos;
+    const int currentPos = UnigramDictionary::FLAG_IS_TERMINAL & flags ? pos + 1 : pos;
+    return UnigramDictionary::FLAG_HAS_MAX_DESCENDANT_FREQUENCY & flags
+            ? currentPos + 1 : currentPos;
 }
 
 inline int BinaryFormat::skipAllAttributes(const uint8_t* const dict, const uint8_t flags,
@@ -268,7 +289,6 @@ inline int BinaryFormat::getTerminalPosition(const uint8_t* const root,
                     if (wordPos == length) {
                         return charGroupPos;
                     }
-                    pos = BinaryFormat::skipFrequency(UnigramDictionary::FLAG_IS_TERMINAL, pos);
                 }
                 if (UnigramDictionary::FLAG_GROUP_ADDRESS_TYPE_NOADDRESS
                         == (UnigramDictionary::MASK_GROUP_ADDRESS_TYPE & flags)) {
@@ -277,6 +297,7 @@ inline int BinaryFormat::getTerminalPosition(const uint8_t* const root,
                 // We have children and we are still shorter than the word we are searching for, so
                 // we need to traverse children. Put the pointer on the children position, and
                 // break
+                pos = BinaryFormat::skipFrequency(flags, pos);
                 pos = BinaryFormat::readChildrenPosition(root, flags, pos);
                 break;
             } else {
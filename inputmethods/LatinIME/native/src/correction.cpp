@@ -133,6 +133,8 @@ void Correction::initCorrection(const ProximityInfo *pi, const int inputLength,
     mInputLength = inputLength;
     mMaxDepth = maxDepth;
     mMaxEditDistance = mInputLength < 5 ? 2 : mInputLength / 2;
+    // The rows have the width of the input
+    mRestoredWordLength = 0;
 }
 
 void Correction::initCorrectionState(
@@ -191,6 +193,15 @@ int Correction::getFinalFreq(const int freq, unsigned short **word, int *wordLen
             inputIndex, outputIndex, freq, mEditDistanceTable, this);
 }
 
+int Correction::getFinalFreqUpperBound(const int maxFreq) const {
+    // Only the output grows while traversing all nodes, unless the last char may still be
+    // matched by one of the next chars
+    if (!mNeedsToTraverseAllNodes || mLastCharExceeded) {
+        return S_INT_MAX;
+    }
+    return Correction::RankingAlgorithm::calculateFinalFreqUpperBound(maxFreq, this);
+}
+
 bool Correction::initProcessState(const int outputIndex) {
     if (mCorrectionStates[outputIndex].mChildCount <= 0) {
         return false;
@@ -228,6 +239,47 @@ int Correction::goDownTree(
     return mOutputIndex;
 }
 
+void Correction::saveTraversalSnapshot(
+        const int outputIndex, const int groupPos, TraversalSnapshot *snapshot) const {
+    snapshot->mOutputIndex = outputIndex;
+    snapshot->mGroupPos = groupPos;
+    snapshot->mGroupCount = 1;
+    if (outputIndex > 0) {
+        snapshot->mParentState = mCorrectionStates[outputIndex - 1];
+    }
+    snapshot->mState = mCorrectionStates[outputIndex];
+    memcpy(snapshot->mWord, mWord, outputIndex * sizeof(mWord[0]));
+    memcpy(snapshot->mDistances, mDistances, outputIndex * sizeof(mDistances[0]));
+}
+
+int Correction::restoreTraversalSnapshot(const TraversalSnapshot *snapshot) {
+    const int outputIndex = snapshot->mOutputIndex;
+    if (outputIndex > 0) {
+        mCorrectionStates[outputIndex - 1] = snapshot->mParentState;
+    }
+    mCorrectionStates[outputIndex] = snapshot->mState;
+    mCorrectionStates[outputIndex].mParentIndex = -1;
+    mCorrectionStates[outputIndex].mChildCount = snapshot->mGroupCount;
+    mCorrectionStates[outputIndex].mSiblingPos = snapshot->mGroupPos;
+
+    // The search after the last restore only wrote the word and the edit distance rows past
+    // that restored word, so the rows of the prefix it shares with this one are still valid.
+    int validLength = 0;
+    while (validLength < outputIndex && validLength < mRestoredWordLength
+            && mWord[validLength] == snapshot->mWord[validLength]) {
+        ++validLength;
+    }
+    memcpy(mWord + validLength, snapshot->mWord + validLength,
+            (outputIndex - validLength) * sizeof(mWord[0]));
+    memcpy(mDistances, snapshot->mDistances, outputIndex * sizeof(mDistances[0]));
+    const unsigned short *primaryInputWord = mProximityInfo->getPrimaryInputWord();
+    for (int i = validLength; i < outputIndex; ++i) {
+        calcEditDistanceOneStep(mEditDistanceTable, primaryInputWord, mInputLength, mWord, i + 1);
+    }
+    mRestoredWordLength = outputIndex;
+    return outputIndex;
+}
+
 // TODO: remove
 int Correction::getOutputIndex() {
     return mOutputIndex;
@@ -616,6 +668,26 @@ inline static bool isUpperCase(unsigned short c) {
      return false;
 }
 
+inline static float getSweetSpotDistanceFactor(const int squaredDistance) {
+    static const float A = ZERO_DISTANCE_PROMOTION_RATE / 100.0f;
+    static const float B = 1.0f;
+    static const float C = 0.5f;
+    static const float R1 = NEUTRAL_SCORE_SQUARED_RADIUS;
+    static const float R2 = HALF_SCORE_SQUARED_RADIUS;
+    const float x = (float)squaredDistance
+            / ProximityInfo::NORMALIZED_SQUARED_DISTANCE_SCALING_FACTOR;
+    // factor is piecewise linear function like:
+    // A -_                  .
+    //     ^-_               .
+    // B      \              .
+    //         \             .
+    // C        \            .
+    //   0   R1 R2
+    return (x < R1)
+        ? (A * (R1 - x) + B * x) / R1
+        : (B * (R2 - x) + C * (x - R1)) / (R2 - R1);
+}
+
 //////////////////////
 // RankingAlgorithm //
 //////////////////////
@@ -741,23 +813,7 @@ int Correction::RankingAlgorithm::calculateFinalFreq(const int inputIndex, const
             }
             if (squaredDistance >= 0) {
                 // Promote or demote the score according to the distance from the sweet spot
-                static const float A = ZERO_DISTANCE_PROMOTION_RATE / 100.0f;
-                static const float B = 1.0f;
-                static const float C = 0.5f;
-                static const float R1 = NEUTRAL_SCORE_SQUARED_RADIUS;
-                static const float R2 = HALF_SCORE_SQUARED_RADIUS;
-                const float x = (float)squaredDistance
-                        / ProximityInfo::NORMALIZED_SQUARED_DISTANCE_SCALING_FACTOR;
-                const float factor = (x < R1)
-                    ? (A * (R1 - x) + B * x) / R1
-                    : (B * (R2 - x) + C * (x - R1)) / (R2 - R1);
-                // factor is piecewise linear function like:
-                // A -_                  .
-                //     ^-_               .
-                // B      \              .
-                //         \             .
-                // C        \            .
-                //   0   R1 R2
+                const float factor = getSweetSpotDistanceFactor(squaredDistance);
                 if (factor <= 0) {
                     return -1;
                 }
@@ -845,6 +901,114 @@ int Correction::RankingAlgorithm::calculateFinalFreq(const int inputIndex, const
     return finalFreq;
 }
 
+// Follows calculateFinalFreq for words that complete the current word while traversing all nodes:
+// the correction counts and the terminal input index are those of the current state, the words
+// are longer, and their chars past the current word have no distance. Where the result depends on
+// the rest of the word, this takes the highest of the possible rates, and it leaves out all the
+// demotions. As every step keeps the order of frequencies, this is an upper bound.
+// Any change to calculateFinalFreq has to be reflected here.
+/* static */
+int Correction::RankingAlgorithm::calculateFinalFreqUpperBound(const int maxFreq,
+        const Correction* correction) {
+    const int inputLength = correction->mInputLength;
+    const int typedLetterMultiplier = correction->TYPED_LETTER_MULTIPLIER;
+    const int fullWordMultiplier = correction->FULL_WORD_MULTIPLIER;
+    const ProximityInfo *proximityInfo = correction->mProximityInfo;
+    const int skippedCount = correction->mSkippedCount;
+    const int transposedCount = correction->mTransposedCount / 2;
+    const int excessiveCount = correction->mExcessiveCount + correction->mTransposedCount % 2;
+    const int proximityMatchedCount = correction->mProximityCount;
+    const bool useFullEditDistance = correction->mUseFullEditDistance;
+    const int currentLength = correction->mOutputIndex;
+    if (skippedCount >= inputLength || inputLength == 0) {
+        return -1;
+    }
+
+    bool sameLength = (inputLength == correction->mInputIndex + 1);
+    const int matchCount = inputLength - proximityMatchedCount - excessiveCount;
+    const bool skipped = skippedCount > 0;
+
+    // The edit distance, less the quotes in excess, is at least the count of the other chars
+    // past the input length
+    int otherCharCount = 0;
+    for (int i = 0; i < currentLength; ++i) {
+        if (correction->mWord[i] != '\'') ++otherCharCount;
+    }
+    bool canMatchExactly = true;
+
+    int finalFreq = maxFreq;
+
+    if (transposedCount == 0 && (proximityMatchedCount > 0 || skipped || excessiveCount > 0)) {
+        // The edit distance is at least the length difference
+        multiplyIntCapped(powerIntCapped(typedLetterMultiplier, inputLength), &finalFreq);
+        canMatchExactly = otherCharCount <= inputLength;
+        if (otherCharCount <= inputLength + 1) {
+            if (typedLetterMultiplier * 100 >= WORDS_WITH_JUST_ONE_CORRECTION_PROMOTION_RATE) {
+                multiplyIntCapped(typedLetterMultiplier, &finalFreq);
+            } else {
+                multiplyRate(WORDS_WITH_JUST_ONE_CORRECTION_PROMOTION_RATE, &finalFreq);
+            }
+        }
+        sameLength = sameLength || canMatchExactly;
+    } else {
+        const int matchWeight = powerIntCapped(typedLetterMultiplier, matchCount);
+        multiplyIntCapped(matchWeight, &finalFreq);
+    }
+
+    // The adjusted proximity matched count is at most the proximity matched count, which is at
+    // most the current length
+    if (CALIBRATE_SCORE_BY_TOUCH_COORDINATES && proximityInfo->touchPositionCorrectionEnabled()
+            && skippedCount == 0 && excessiveCount == 0 && transposedCount == 0) {
+        for (int i = 0; i < currentLength; ++i) {
+            const int squaredDistance = correction->mDistances[i];
+            if (i < proximityMatchedCount) {
+                multiplyIntCapped(typedLetterMultiplier, &finalFreq);
+            }
+            if (squaredDistance >= 0) {
+                const float factor = getSweetSpotDistanceFactor(squaredDistance);
+                if (factor <= 0) {
+                    return -1;
+                }
+                multiplyRate((int)(factor * 100), &finalFreq);
+            } else if (squaredDistance == PROXIMITY_CHAR_WITHOUT_DISTANCE_INFO) {
+                multiplyRate(WORDS_WITH_PROXIMITY_CHARACTER_DEMOTION_RATE, &finalFreq);
+            }
+        }
+    } else {
+        for (int i = 0; i < proximityMatchedCount; ++i) {
+            multiplyIntCapped(typedLetterMultiplier, &finalFreq);
+            multiplyRate(WORDS_WITH_PROXIMITY_CHARACTER_DEMOTION_RATE, &finalFreq);
+        }
+    }
+
+    if (canMatchExactly && sameLength && transposedCount == 0 && !skipped
+            && excessiveCount == 0) {
+        finalFreq = capped255MultForFullMatchAccentsOrCapitalizationDifference(finalFreq);
+    }
+
+    if (proximityMatchedCount == 0 && transposedCount == 0 && !skipped && excessiveCount == 0) {
+        multiplyRate(FULL_MATCHED_WORDS_PROMOTION_RATE, &finalFreq);
+    }
+
+    if (matchCount == inputLength && matchCount >= 2 && !skipped) {
+        multiplyRate(WORDS_WITH_MATCH_SKIP_PROMOTION_RATE, &finalFreq);
+    }
+
+    if (sameLength) {
+        multiplyIntCapped(fullWordMultiplier, &finalFreq);
+    }
+
+    // The words have at least one more char
+    const int outputLength = currentLength + 1;
+    if (useFullEditDistance && outputLength > inputLength + 1) {
+        const int diff = outputLength - inputLength - 1;
+        const int divider = diff < 31 ? 1 << diff : S_INT_MAX;
+        finalFreq = divider > finalFreq ? 1 : finalFreq / divider;
+    }
+
+    return finalFreq;
+}
+
 /* static */
 int Correction::RankingAlgorithm::calcFreqForSplitTwoWords(
         const int firstFreq, const int secondFreq, const Correction* correction,
@@ -76,6 +76,9 @@ public:
     int getFreqForSplitTwoWords(
             const int firstFreq, const int secondFreq, const unsigned short *word);
     int getFinalFreq(const int freq, unsigned short **word, int* wordLength);
+    // Returns an upper bound of the final frequency of the words that complete the current word,
+    // given the highest of their frequencies, or S_INT_MAX if there is none.
+    int getFinalFreqUpperBound(const int maxFreq) const;
 
     CorrectionType processCharAndCalcState(const int32_t c, const bool isTerminal);
 
@@ -91,9 +94,22 @@ public:
         mCorrectionStates[index].mSiblingPos = pos;
     }
 
+    // Whether there are groups left to process after the current one at this level
+    inline bool hasTreeSiblingsLeft(const int index) const {
+        return mCorrectionStates[index].mChildCount > 0;
+    }
+
     inline int getTreeParentIndex(const int index) const {
         return mCorrectionStates[index].mParentIndex;
     }
+
+    // Saves the search at the group at groupPos, processed from the level outputIndex.
+    void saveTraversalSnapshot(
+            const int outputIndex, const int groupPos, TraversalSnapshot *snapshot) const;
+    // Makes the groups of the snapshot the only ones left to process, for the current input.
+    // Returns the level to resume the depth first search from; it ends when the parent index of
+    // that level, -1, is hit.
+    int restoreTraversalSnapshot(const TraversalSnapshot *snapshot);
 private:
     inline void incrementInputIndex();
     inline void incrementOutputIndex();
@@ -116,6 +132,8 @@ private:
     int mMissingSpacePos;
     int mTerminalInputIndex;
     int mTerminalOutputIndex;
+    // Length of the word whose edit distance rows were recalculated by the last restore
+    int mRestoredWordLength;
 
     // The following arrays are state buffer.
     unsigned short mWord[MAX_WORD_LENGTH_INTERNAL];
@@ -154,6 +172,7 @@ private:
     public:
         static int calculateFinalFreq(const int inputIndex, const int depth,
                 const int freq, int *editDistanceTable, const Correction* correction);
+        static int calculateFinalFreqUpperBound(const int maxFreq, const Correction* correction);
         static int calcFreqForSplitTwoWords(const int firstFreq, const int secondFreq,
                 const Correction* correction, const unsigned short *word);
     };
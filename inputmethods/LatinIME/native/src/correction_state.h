@@ -80,5 +80,19 @@ inline static void initCorrectionState(CorrectionState *state, const int rootPos
 
 }
 
+// The search at the point where a run of sibling character groups is about to be processed: the
+// correction state of their level and of the level above, and the word up to there. Restoring it
+// lets a later search for a longer input process those groups again without traversing the path
+// to them.
+struct TraversalSnapshot {
+    int mOutputIndex;
+    int mGroupPos;
+    int mGroupCount;
+    CorrectionState mParentState;
+    CorrectionState mState;
+    unsigned short mWord[MAX_WORD_LENGTH_INTERNAL];
+    int mDistances[MAX_WORD_LENGTH_INTERNAL];
+};
+
 } // namespace latinime
 #endif // LATINIME_CORRECTION_STATE_H
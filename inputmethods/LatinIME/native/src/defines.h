@@ -211,6 +211,16 @@ static void dumpWord(const unsigned short* word, const int length) {
 #define MIN_USER_TYPED_LENGTH_FOR_MISSING_SPACE_SUGGESTION 3
 #define MIN_USER_TYPED_LENGTH_FOR_EXCESSIVE_CHARACTER_SUGGESTION 3
 
+// The search for an input that extends the previous one resumes from the character groups the
+// previous search entered this many characters or less before the end of its input.
+// Processing a group reads the input up to 3 characters ahead, and checks for the last 2.
+#define INCREMENTAL_SEARCH_INPUT_MARGIN 6
+#define MAX_INCREMENTAL_SEARCH_FRONTIER_SIZE 512
+
+// The binary dictionaries of a locale are searched together by one Dictionary, which shares the
+// input, the correction and the output between them
+#define MAX_MERGED_DICTIONARIES 4
+
 #define min(a,b) ((a)<(b)?(a):(b))
 #define max(a,b) ((a)>(b)?(a):(b))
 
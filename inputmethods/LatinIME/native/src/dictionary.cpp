@@ -30,7 +30,9 @@ Dictionary::Dictionary(void *dict, int dictSize, int mmapFd, int dictBufAdjust,
     : mDict((unsigned char*) dict), mDictSize(dictSize),
     mMmapFd(mmapFd), mDictBufAdjust(dictBufAdjust),
     // Checks whether it has the latest dictionary or the old dictionary
-    IS_LATEST_DICT_VERSION((((unsigned char*) dict)[0] & 0xFF) >= DICTIONARY_VERSION_MIN) {
+    IS_LATEST_DICT_VERSION((((unsigned char*) dict)[0] & 0xFF) >= DICTIONARY_VERSION_MIN),
+    MAX_WORD_LENGTH(maxWordLength), MAX_ALTERNATIVES(maxAlternatives),
+    mAddedDictionaryCount(0) {
     if (DEBUG_DICT) {
         if (MAX_WORD_LENGTH_INTERNAL < maxWordLength) {
             LOGI("Max word length (%d) is greater than %d",
@@ -41,16 +43,46 @@ Dictionary::Dictionary(void *dict, int dictSize, int mmapFd, int dictBufAdjust,
     mUnigramDictionary = new UnigramDictionary(mDict, typedLetterMultiplier, fullWordMultiplier,
             maxWordLength, maxWords, maxAlternatives, IS_LATEST_DICT_VERSION);
     mBigramDictionary = new BigramDictionary(mDict, maxWordLength, maxAlternatives,
-            IS_LATEST_DICT_VERSION, hasBigram(), this);
+            IS_LATEST_DICT_VERSION, hasBigram(mDict), this);
 }
 
 Dictionary::~Dictionary() {
+    for (int i = 0; i < mAddedDictionaryCount; ++i) {
+        delete mAddedDictionaries[i].mBigramDictionary;
+    }
     delete mUnigramDictionary;
     delete mBigramDictionary;
 }
 
-bool Dictionary::hasBigram() {
-    return ((mDict[1] & 0xFF) == 1);
+bool Dictionary::hasBigram(const unsigned char *dict) {
+    return ((dict[1] & 0xFF) == 1);
+}
+
+bool Dictionary::addDictionary(void *dict, int dictSize, int mmapFd, int dictBufAdjust) {
+    if (mAddedDictionaryCount >= MAX_MERGED_DICTIONARIES - 1) return false;
+    if (!mUnigramDictionary->addDictionary((uint8_t*) dict)) return false;
+    AddedDictionary *added = &mAddedDictionaries[mAddedDictionaryCount++];
+    added->mDict = dict;
+    added->mDictSize = dictSize;
+    added->mMmapFd = mmapFd;
+    added->mDictBufAdjust = dictBufAdjust;
+    added->mBigramDictionary = new BigramDictionary((unsigned char*) dict, MAX_WORD_LENGTH,
+            MAX_ALTERNATIVES, IS_LATEST_DICT_VERSION, hasBigram((unsigned char*) dict), this);
+    return true;
+}
+
+// The bigrams of all the dictionaries go into the same sorted output, where a word found in
+// several of them is kept once, with its higher frequency. The count is the sum of theirs.
+int Dictionary::getBigrams(unsigned short *word, int length, int *codes, int codesSize,
+        unsigned short *outWords, int *frequencies, int maxWordLength, int maxBigrams,
+        int maxAlternatives) {
+    int bigramCount = mBigramDictionary->getBigrams(word, length, codes, codesSize, outWords,
+            frequencies, maxWordLength, maxBigrams, maxAlternatives);
+    for (int i = 0; i < mAddedDictionaryCount; ++i) {
+        bigramCount += mAddedDictionaries[i].mBigramDictionary->getBigrams(word, length, codes,
+                codesSize, outWords, frequencies, maxWordLength, maxBigrams, maxAlternatives);
+    }
+    return bigramCount;
 }
 
 bool Dictionary::isValidWord(unsigned short *word, int length) {
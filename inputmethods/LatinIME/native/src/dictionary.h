@@ -35,20 +35,30 @@ public:
         return mUnigramDictionary->getSuggestions(proximityInfo, xcoordinates, ycoordinates, codes,
                 codesSize, flags, outWords, frequencies);
     }
+    int getVisitedGroupCount() const {
+        return mUnigramDictionary->getVisitedGroupCount();
+    }
 
     // TODO: Call mBigramDictionary instead of mUnigramDictionary
     int getBigrams(unsigned short *word, int length, int *codes, int codesSize,
             unsigned short *outWords, int *frequencies, int maxWordLength, int maxBigrams,
-            int maxAlternatives) {
-        return mBigramDictionary->getBigrams(word, length, codes, codesSize, outWords, frequencies,
-                maxWordLength, maxBigrams, maxAlternatives);
-    }
+            int maxAlternatives);
+
+    // Searches another binary dictionary with this one from now on: the suggestions, the bigrams
+    // and the valid words are those of all of them. Returns false if too many were added, in
+    // which case the caller still owns the buffer.
+    bool addDictionary(void *dict, int dictSize, int mmapFd, int dictBufAdjust);
 
     bool isValidWord(unsigned short *word, int length);
     void *getDict() { return (void *)mDict; }
     int getDictSize() { return mDictSize; }
     int getMmapFd() { return mMmapFd; }
     int getDictBufAdjust() { return mDictBufAdjust; }
+    int getAddedDictionaryCount() { return mAddedDictionaryCount; }
+    void *getAddedDict(int index) { return mAddedDictionaries[index].mDict; }
+    int getAddedDictSize(int index) { return mAddedDictionaries[index].mDictSize; }
+    int getAddedMmapFd(int index) { return mAddedDictionaries[index].mMmapFd; }
+    int getAddedDictBufAdjust(int index) { return mAddedDictionaries[index].mDictBufAdjust; }
     ~Dictionary();
 
     // public static utility methods
@@ -66,7 +76,16 @@ public:
     static inline unsigned short toBaseLowerCase(unsigned short c);
 
 private:
-    bool hasBigram();
+    // A dictionary added to the first one. The buffer is released by the owner of this.
+    struct AddedDictionary {
+        void *mDict;
+        int mDictSize;
+        int mMmapFd;
+        int mDictBufAdjust;
+        BigramDictionary *mBigramDictionary;
+    };
+
+    static bool hasBigram(const unsigned char *dict);
 
     const unsigned char *mDict;
 
@@ -77,8 +96,12 @@ private:
     const int mDictBufAdjust;
 
     const bool IS_LATEST_DICT_VERSION;
+    const int MAX_WORD_LENGTH;
+    const int MAX_ALTERNATIVES;
     UnigramDictionary *mUnigramDictionary;
     BigramDictionary *mBigramDictionary;
+    AddedDictionary mAddedDictionaries[MAX_MERGED_DICTIONARIES - 1];
+    int mAddedDictionaryCount;
 };
 
 // public static utility methods
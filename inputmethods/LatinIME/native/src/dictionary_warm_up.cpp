@@ -0,0 +1,210 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <errno.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#define LOG_TAG "LatinIME: dictionary_warm_up.cpp"
+
+#include "array_trie.h"
+#include "binary_format.h"
+#include "dictionary.h"
+#include "dictionary_warm_up.h"
+
+namespace latinime {
+
+DictionaryWarmUp::PageRunner::PageRunner(const uint8_t* const mapStart,
+        const uint8_t* const mapEnd, const PageOperation operation)
+        : MAP_START((uintptr_t)mapStart),
+          // The mapping goes on to the end of the page of the last byte
+          MAP_END(((uintptr_t)mapEnd + getpagesize() - 1) & ~(uintptr_t)(getpagesize() - 1)),
+          SYSTEM_PAGE_SIZE(getpagesize()), OPERATION(operation), mRunStart(0), mRunEnd(0),
+          mPageCount(0) {
+}
+
+void DictionaryWarmUp::PageRunner::addRange(const uint8_t* const start, const int size) {
+    if (size <= 0) return;
+    uintptr_t runStart = (uintptr_t)start & ~(SYSTEM_PAGE_SIZE - 1);
+    uintptr_t runEnd = ((uintptr_t)start + size + SYSTEM_PAGE_SIZE - 1) & ~(SYSTEM_PAGE_SIZE - 1);
+    if (runStart < MAP_START) runStart = MAP_START;
+    if (runEnd > MAP_END) runEnd = MAP_END;
+    if (runStart >= runEnd) return;
+    if (mRunStart < mRunEnd && runStart <= mRunEnd && runEnd >= mRunStart) {
+        // Touches the current run
+        if (runStart < mRunStart) mRunStart = runStart;
+        if (runEnd > mRunEnd) mRunEnd = runEnd;
+        return;
+    }
+    applyRun();
+    mRunStart = runStart;
+    mRunEnd = runEnd;
+}
+
+int DictionaryWarmUp::PageRunner::finish() {
+    applyRun();
+    mRunStart = 0;
+    mRunEnd = 0;
+    return mPageCount;
+}
+
+void DictionaryWarmUp::PageRunner::applyRun() {
+    if (mRunStart >= mRunEnd) return;
+    const size_t length = mRunEnd - mRunStart;
+    if (READ_AHEAD == OPERATION) {
+        if (0 != madvise((void*)mRunStart, length, MADV_WILLNEED)) {
+            LOGE("DICT: Failure in madvise. errno=%d", errno);
+        }
+    } else if (LOCK == OPERATION) {
+        // The lock limit of the process may be low, in which case the rest is only read ahead
+        if (0 != mlock((void*)mRunStart, length)) {
+            LOGE("DICT: Failure in mlock. errno=%d", errno);
+            return;
+        }
+    }
+    mPageCount += length / SYSTEM_PAGE_SIZE;
+}
+
+void DictionaryWarmUp::warmUp(const uint8_t* const dict, const int dictSize,
+        const uint8_t* const mapStart, const int warmUpDepth, const int lockDepth,
+        Stats *outStats) {
+    const int mapSize = dict + dictSize - mapStart;
+    outStats->mResidentPageCount = getResidentPageCount(mapStart, mapSize,
+            &outStats->mPageCount);
+    outStats->mHotPageCount = 0;
+    outStats->mLockedPageCount = 0;
+    if (warmUpDepth <= 0 && lockDepth <= 0) return;
+    if (BinaryFormat::FORMAT_VERSION_3 == BinaryFormat::detectFormat(dict)) {
+        // The pages are read ahead before they are locked, which would read them one at a time
+        outStats->mHotPageCount =
+                applyToUpperLevelArrays(dict, dictSize, mapStart, warmUpDepth, READ_AHEAD);
+        outStats->mLockedPageCount =
+                applyToUpperLevelArrays(dict, dictSize, mapStart, lockDepth, LOCK);
+    } else {
+        // The nodes of the upper levels are spread over the file, and only found by reading
+        // them. The walk would fault their pages in one at a time, so the whole mapping is read
+        // ahead first.
+        if (0 != madvise((void*)mapStart, mapSize, MADV_WILLNEED)) {
+            LOGE("DICT: Failure in madvise. errno=%d", errno);
+        }
+        PageRunner hotRunner(mapStart, dict + dictSize, COUNT_PAGES);
+        PageRunner lockRunner(mapStart, dict + dictSize, LOCK);
+        if (warmUpDepth > 0) hotRunner.addRange(dict, NEW_DICTIONARY_HEADER_SIZE);
+        if (lockDepth > 0) lockRunner.addRange(dict, NEW_DICTIONARY_HEADER_SIZE);
+        addUpperLevelNodes(dict + NEW_DICTIONARY_HEADER_SIZE, warmUpDepth, lockDepth,
+                &hotRunner, &lockRunner);
+        outStats->mHotPageCount = hotRunner.finish();
+        outStats->mLockedPageCount = lockRunner.finish();
+    }
+    if (DEBUG_DICT) {
+        LOGI("Warm up: %d pages, %d resident, %d hot, %d locked", outStats->mPageCount,
+                outStats->mResidentPageCount, outStats->mHotPageCount,
+                outStats->mLockedPageCount);
+    }
+}
+
+int DictionaryWarmUp::getResidentPageCount(const uint8_t* const mapStart, const int mapSize,
+        int *outPageCount) {
+    const int pageSize = getpagesize();
+    const int pageCount = (mapSize + pageSize - 1) / pageSize;
+    *outPageCount = pageCount;
+    if (pageCount <= 0) return 0;
+    unsigned char *residency = new unsigned char[pageCount];
+    int residentPageCount = 0;
+    if (0 == mincore((void*)mapStart, mapSize, residency)) {
+        for (int i = 0; i < pageCount; ++i) {
+            if (residency[i] & 1) ++residentPageCount;
+        }
+    } else {
+        LOGE("DICT: Failure in mincore. errno=%d", errno);
+    }
+    delete[] residency;
+    return residentPageCount;
+}
+
+// Same walk as GroupParentIndex::visitNodes, down to the deeper of the two depths. Each node is
+// added as a whole when the walk enters it, to the runners of the depths it is above. makedict
+// writes a node before the nodes of its children, in the order of this walk, so the ranges
+// mostly follow each other.
+void DictionaryWarmUp::addUpperLevelNodes(const uint8_t* const root, const int warmUpDepth,
+        const int lockDepth, PageRunner *hotRunner, PageRunner *lockRunner) {
+    const int maxDepth = min(max(warmUpDepth, lockDepth), MAX_WORD_LENGTH_INTERNAL);
+    int childCount[MAX_WORD_LENGTH_INTERNAL];
+    int siblingPos[MAX_WORD_LENGTH_INTERNAL];
+    int level = -1;
+    int nodePos = 0;
+    while (true) {
+        if (nodePos >= 0) {
+            // Enters the node at nodePos, and adds it up to the end of its last group
+            ++level;
+            int pos = nodePos;
+            childCount[level] = BinaryFormat::getGroupCountAndForwardPointer(root, &pos);
+            siblingPos[level] = pos;
+            for (int i = 0; i < childCount[level]; ++i) {
+                const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(root, &pos);
+                BinaryFormat::getCharCodeAndForwardPointer(root, &pos);
+                if (UnigramDictionary::FLAG_HAS_MULTIPLE_CHARS & flags) {
+                    pos = BinaryFormat::skipOtherCharacters(root, pos);
+                }
+                pos = BinaryFormat::skipFrequency(flags, pos);
+                pos = BinaryFormat::skipChildrenPosAndAttributes(root, flags, pos);
+            }
+            if (level < warmUpDepth) hotRunner->addRange(root + nodePos, pos - nodePos);
+            if (level < lockDepth) lockRunner->addRange(root + nodePos, pos - nodePos);
+            nodePos = -1;
+            if (level + 1 >= maxDepth) {
+                // The children of this level are not warmed up
+                --level;
+            }
+        }
+        if (level < 0) return;
+        if (childCount[level] <= 0) {
+            --level;
+            continue;
+        }
+        --childCount[level];
+        int pos = siblingPos[level];
+        const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(root, &pos);
+        BinaryFormat::getCharCodeAndForwardPointer(root, &pos);
+        if (UnigramDictionary::FLAG_HAS_MULTIPLE_CHARS & flags) {
+            pos = BinaryFormat::skipOtherCharacters(root, pos);
+        }
+        pos = BinaryFormat::skipFrequency(flags, pos);
+        nodePos = BinaryFormat::readChildrenPosition(root, flags, pos);
+        siblingPos[level] = BinaryFormat::skipChildrenPosAndAttributes(root, flags, pos);
+    }
+}
+
+// The groups of the upper levels are the first ones, so they are at the start of each array, and
+// the level boundaries are read from the first children of a few groups. Returns the count of
+// the pages the operation was applied to.
+int DictionaryWarmUp::applyToUpperLevelArrays(const uint8_t* const dict, const int dictSize,
+        const uint8_t* const mapStart, const int depth, const PageOperation operation) {
+    if (depth <= 0) return 0;
+    PageRunner runner(mapStart, dict + dictSize, operation);
+    const uint8_t* const root = dict + NEW_DICTIONARY_HEADER_SIZE;
+    const ArrayTrie arrayTrie(root);
+    const uint8_t* starts[ArrayTrie::ARRAY_COUNT];
+    int sizes[ArrayTrie::ARRAY_COUNT];
+    arrayTrie.getGroupRanges(arrayTrie.getUpperLevelsGroupCount(depth), starts, sizes);
+    runner.addRange(dict, starts[0] - dict);
+    for (int i = 0; i < ArrayTrie::ARRAY_COUNT; ++i) {
+        runner.addRange(starts[i], sizes[i]);
+    }
+    return runner.finish();
+}
+
+} // namespace latinime
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_DICTIONARY_WARM_UP_H
+#define LATINIME_DICTIONARY_WARM_UP_H
+
+#include <stdint.h>
+
+namespace latinime {
+
+// Brings the upper levels of a mapped dictionary into memory before the first search. Every
+// search starts from the root and goes through the groups of the first few chars for almost
+// every word, so these pages are the ones all searches fault in first. They are small, but in
+// the tree formats, versions 1 and 2, they are spread over the whole file, as the nodes of a
+// level are written between the subtrees of the level above.
+class DictionaryWarmUp {
+public:
+    // The page counts of a dictionary, taken before the warm up reads anything
+    struct Stats {
+        int mPageCount;
+        int mResidentPageCount;
+        // The pages that hold the groups of the warmed up levels
+        int mHotPageCount;
+        int mLockedPageCount;
+    };
+
+    // dict is the dictionary as passed to Dictionary, which is mapped from mapStart on.
+    // Asks the kernel to read ahead the pages of the groups of the first warmUpDepth levels,
+    // and locks those of the first lockDepth levels into memory. Either depth can be 0. In the
+    // tree formats the groups are only found by reading them, so the whole mapping is read
+    // ahead before the walk. The locks are released when the dictionary is unmapped.
+    static void warmUp(const uint8_t* const dict, const int dictSize, const uint8_t* const mapStart,
+            const int warmUpDepth, const int lockDepth, Stats *outStats);
+    // Returns how many of the pages of the dictionary are in memory, and outputs their count
+    static int getResidentPageCount(const uint8_t* const mapStart, const int mapSize,
+            int *outPageCount);
+
+private:
+    enum PageOperation {
+        COUNT_PAGES,
+        READ_AHEAD,
+        LOCK,
+    };
+
+    // The pages of the runs of bytes given to addRange() are gathered, so that adjacent ranges
+    // are applied to the pages with one system call
+    class PageRunner {
+    public:
+        PageRunner(const uint8_t* const mapStart, const uint8_t* const mapEnd,
+                const PageOperation operation);
+        void addRange(const uint8_t* const start, const int size);
+        // Applies the last run, and returns the count of the pages of all the runs
+        int finish();
+
+    private:
+        void applyRun();
+
+        const uintptr_t MAP_START;
+        const uintptr_t MAP_END;
+        const uintptr_t SYSTEM_PAGE_SIZE;
+        const PageOperation OPERATION;
+        uintptr_t mRunStart;
+        uintptr_t mRunEnd;
+        int mPageCount;
+    };
+
+    static void addUpperLevelNodes(const uint8_t* const root, const int warmUpDepth,
+            const int lockDepth, PageRunner *hotRunner, PageRunner *lockRunner);
+    static int applyToUpperLevelArrays(const uint8_t* const dict, const int dictSize,
+            const uint8_t* const mapStart, const int depth, const PageOperation operation);
+};
+} // namespace latinime
+
+#endif // LATINIME_DICTIONARY_WARM_UP_H
@@ -0,0 +1,141 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <stdlib.h>
+
+#define LOG_TAG "LatinIME: group_parent_index.cpp"
+
+#include "dictionary.h"
+#include "group_parent_index.h"
+#include "binary_format.h"
+
+namespace latinime {
+
+// The position is the first member of a node
+static int compareNodePositions(const void *a, const void *b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+GroupParentIndex::GroupParentIndex(const uint8_t* const root)
+        : DICT_ROOT(root), mNodes(0), mNodeCount(0) {
+    const int nodeCount = visitNodes(0);
+    if (nodeCount <= 0) {
+        if (DEBUG_DICT) {
+            LOGI("Could not index the dictionary nodes");
+        }
+        return;
+    }
+    mNodes = new Node[nodeCount];
+    visitNodes(mNodes);
+    // makedict writes the nodes in the order of this walk, but the format doesn't require it
+    qsort(mNodes, nodeCount, sizeof(mNodes[0]), compareNodePositions);
+    mNodeCount = nodeCount;
+    if (DEBUG_DICT) {
+        LOGI("Indexed %d dictionary nodes", nodeCount);
+    }
+}
+
+GroupParentIndex::~GroupParentIndex() {
+    delete[] mNodes;
+}
+
+// Walks all the nodes, and writes each with its parent group to outNodes if it's not NULL.
+// Returns the node count, or -1 if the dictionary is deeper than any word can be.
+int GroupParentIndex::visitNodes(Node *outNodes) const {
+    int childCount[MAX_WORD_LENGTH_INTERNAL];
+    int siblingPos[MAX_WORD_LENGTH_INTERNAL];
+    int depth = 0;
+    int pos = 0;
+    if (outNodes) {
+        outNodes[0].mPos = pos;
+        outNodes[0].mParentGroupPos = NOT_A_PARENT;
+    }
+    int nodeCount = 1;
+    childCount[0] = BinaryFormat::getGroupCountAndForwardPointer(DICT_ROOT, &pos);
+    siblingPos[0] = pos;
+    while (depth >= 0) {
+        if (childCount[depth] <= 0) {
+            --depth;
+            continue;
+        }
+        --childCount[depth];
+        const int groupPos = siblingPos[depth];
+        pos = groupPos;
+        const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(DICT_ROOT, &pos);
+        BinaryFormat::getCharCodeAndForwardPointer(DICT_ROOT, &pos);
+        if (UnigramDictionary::FLAG_HAS_MULTIPLE_CHARS & flags) {
+            pos = BinaryFormat::skipOtherCharacters(DICT_ROOT, pos);
+        }
+        pos = BinaryFormat::skipFrequency(flags, pos);
+        const int childrenPos = BinaryFormat::readChildrenPosition(DICT_ROOT, flags, pos);
+        siblingPos[depth] = BinaryFormat::skipChildrenPosAndAttributes(DICT_ROOT, flags, pos);
+        if (-1 == childrenPos) continue;
+        if (depth + 1 >= MAX_WORD_LENGTH_INTERNAL) return -1;
+        if (outNodes) {
+            outNodes[nodeCount].mPos = childrenPos;
+            outNodes[nodeCount].mParentGroupPos = groupPos;
+        }
+        ++nodeCount;
+        ++depth;
+        pos = childrenPos;
+        childCount[depth] = BinaryFormat::getGroupCountAndForwardPointer(DICT_ROOT, &pos);
+        siblingPos[depth] = pos;
+    }
+    return nodeCount;
+}
+
+// Returns the node the group at groupPos is in, which is the last one that starts before it
+inline const GroupParentIndex::Node *GroupParentIndex::findNode(const int groupPos) const {
+    int low = 0;
+    int high = mNodeCount - 1;
+    while (low < high) {
+        const int middle = (low + high + 1) / 2;
+        if (mNodes[middle].mPos < groupPos) {
+            low = middle;
+        } else {
+            high = middle - 1;
+        }
+    }
+    return &mNodes[low];
+}
+
+int GroupParentIndex::getWordAtAddress(const int address, const int maxDepth,
+        uint16_t* outWord) const {
+    // The groups of the word, from its last one up. Each group has at least one char.
+    int groupPositions[MAX_WORD_LENGTH_INTERNAL];
+    int groupCount = 0;
+    for (int pos = address; NOT_A_PARENT != pos; pos = findNode(pos)->mParentGroupPos) {
+        if (groupCount >= maxDepth || groupCount >= MAX_WORD_LENGTH_INTERNAL) return 0;
+        groupPositions[groupCount++] = pos;
+    }
+
+    int wordPos = 0;
+    for (int i = groupCount - 1; i >= 0; --i) {
+        int pos = groupPositions[i];
+        const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(DICT_ROOT, &pos);
+        int32_t character = BinaryFormat::getCharCodeAndForwardPointer(DICT_ROOT, &pos);
+        do {
+            if (wordPos >= maxDepth) return 0;
+            outWord[wordPos++] = character;
+            character = (UnigramDictionary::FLAG_HAS_MULTIPLE_CHARS & flags)
+                    ? BinaryFormat::getCharCodeAndForwardPointer(DICT_ROOT, &pos)
+                    : NOT_A_CHARACTER;
+        } while (NOT_A_CHARACTER != character);
+    }
+    return wordPos;
+}
+
+} // namespace latinime
@@ -0,0 +1,56 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_GROUP_PARENT_INDEX_H
+#define LATINIME_GROUP_PARENT_INDEX_H
+
+#include <stdint.h>
+
+namespace latinime {
+
+// Maps the position of every node of a dictionary to the position of the group it is the
+// children of, so that the word ending at a group can be read back from the group up, in time
+// proportional to its length, instead of searched for from the root.
+// The dictionary is walked once to build it, which takes 8 bytes per node.
+class GroupParentIndex {
+public:
+    GroupParentIndex(const uint8_t* const root);
+    ~GroupParentIndex();
+    // Whether the dictionary could be indexed. If not, getWordAtAddress() must not be called.
+    bool isValid() const {
+        return mNodeCount > 0;
+    }
+    // Same as BinaryFormat::getWordAtAddress
+    int getWordAtAddress(const int address, const int maxDepth, uint16_t* outWord) const;
+
+private:
+    struct Node {
+        int mPos;
+        int mParentGroupPos;
+    };
+    static const int NOT_A_PARENT = -1;
+
+    int visitNodes(Node *outNodes) const;
+    const Node *findNode(const int groupPos) const;
+
+    const uint8_t* const DICT_ROOT;
+    // Sorted by position
+    Node *mNodes;
+    int mNodeCount;
+};
+} // namespace latinime
+
+#endif // LATINIME_GROUP_PARENT_INDEX_H
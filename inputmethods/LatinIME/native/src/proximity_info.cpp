@@ -62,6 +62,8 @@ ProximityInfo::ProximityInfo(const int maxProximityCharsSize, const int keyboard
     for (int i = 0; i < normalizedSquaredDistancesLength; ++i) {
         mNormalizedSquaredDistances[i] = NOT_A_DISTANCE;
     }
+    mProximitySweetSpots = new float[3 * MAX_PROXIMITY_CHARS_SIZE];
+    mProximitySquaredDistances = new float[MAX_PROXIMITY_CHARS_SIZE];
 
     copyOrFillZero(mKeyXCoordinates, keyXCoordinates, KEY_COUNT * sizeof(mKeyXCoordinates[0]));
     copyOrFillZero(mKeyYCoordinates, keyYCoordinates, KEY_COUNT * sizeof(mKeyYCoordinates[0]));
@@ -75,21 +77,38 @@ ProximityInfo::ProximityInfo(const int maxProximityCharsSize, const int keyboard
     copyOrFillZero(mSweetSpotRadii, sweetSpotRadii, KEY_COUNT * sizeof(mSweetSpotRadii[0]));
 
     initializeCodeToKeyIndex();
+    initializeSweetSpotSquaredRadii();
 }
 
 // Build the reversed look up table from the char code to the index in mKeyXCoordinates,
-// mKeyYCoordinates, mKeyWidths, mKeyHeights, mKeyCharCodes.
+// mKeyYCoordinates, mKeyWidths, mKeyHeights, mKeyCharCodes. The key of a code is that of its
+// lowercase, non-accented version, which is itself for the codes in the table.
 void ProximityInfo::initializeCodeToKeyIndex() {
-    memset(mCodeToKeyIndex, -1, (MAX_CHAR_CODE + 1) * sizeof(mCodeToKeyIndex[0]));
+    int keyIndices[MAX_CHAR_CODE + 1];
+    memset(keyIndices, -1, (MAX_CHAR_CODE + 1) * sizeof(keyIndices[0]));
     for (int i = 0; i < KEY_COUNT; ++i) {
         const int code = mKeyCharCodes[i];
         if (0 <= code && code <= MAX_CHAR_CODE) {
-            mCodeToKeyIndex[code] = i;
+            keyIndices[code] = i;
         }
     }
+    for (int code = 0; code <= MAX_CHAR_CODE; ++code) {
+        const unsigned short baseLowerCode = Dictionary::toBaseLowerCase(code);
+        mCodeToKeyIndex[code] =
+                baseLowerCode <= MAX_CHAR_CODE ? keyIndices[baseLowerCode] : NOT_A_INDEX;
+    }
+}
+
+void ProximityInfo::initializeSweetSpotSquaredRadii() {
+    for (int i = 0; i < KEY_COUNT; ++i) {
+        mSweetSpotSquaredRadii[i] =
+                hasSweetSpotData(i) ? mSweetSpotRadii[i] * mSweetSpotRadii[i] : 1.0f;
+    }
 }
 
 ProximityInfo::~ProximityInfo() {
+    delete[] mProximitySquaredDistances;
+    delete[] mProximitySweetSpots;
     delete[] mNormalizedSquaredDistances;
     delete[] mProximityCharsArray;
 }
@@ -129,37 +148,54 @@ void ProximityInfo::setInputParams(const int* inputCodes, const int inputLength,
     }
     mPrimaryInputWord[inputLength] = 0;
     for (int i = 0; i < mInputLength; ++i) {
-        const int *proximityChars = getProximityCharsAt(i);
-        for (int j = 0; j < MAX_PROXIMITY_CHARS_SIZE && proximityChars[j] > 0; ++j) {
-            const int currentChar = proximityChars[j];
-            const int keyIndex = getKeyIndex(currentChar);
-            const float squaredDistance = calculateNormalizedSquaredDistance(keyIndex, i);
-            if (squaredDistance >= 0.0f) {
-                mNormalizedSquaredDistances[i * MAX_PROXIMITY_CHARS_SIZE + j] =
-                        (int)(squaredDistance * NORMALIZED_SQUARED_DISTANCE_SCALING_FACTOR);
-            } else {
-                mNormalizedSquaredDistances[i * MAX_PROXIMITY_CHARS_SIZE + j] = (j == 0)
-                        ? EQUIVALENT_CHAR_WITHOUT_DISTANCE_INFO
-                        : PROXIMITY_CHAR_WITHOUT_DISTANCE_INFO;
-            }
-        }
+        calculateNormalizedSquaredDistances(i);
     }
 }
 
 inline float square(const float x) { return x * x; }
 
-float ProximityInfo::calculateNormalizedSquaredDistance(
-        const int keyIndex, const int inputIndex) const {
-    static const float NOT_A_DISTANCE_FLOAT = -1.0f;
-    if (keyIndex == NOT_A_INDEX) {
-        return NOT_A_DISTANCE_FLOAT;
+// The distances of the proximity chars of an input index from their sweet spot centers, divided
+// by the squared sweet spot radii. The sweet spots of the chars are gathered first, so that the
+// distances are then computed in a loop without branches or lookups that the compiler can
+// vectorize.
+void ProximityInfo::calculateNormalizedSquaredDistances(const int inputIndex) {
+    const int *proximityChars = getProximityCharsAt(inputIndex);
+    int *distances = mNormalizedSquaredDistances + inputIndex * MAX_PROXIMITY_CHARS_SIZE;
+    float *centerXs = mProximitySweetSpots;
+    float *centerYs = mProximitySweetSpots + MAX_PROXIMITY_CHARS_SIZE;
+    float *squaredRadii = mProximitySweetSpots + 2 * MAX_PROXIMITY_CHARS_SIZE;
+    float *scaledSquaredDistances = mProximitySquaredDistances;
+    int count = 0;
+    for (; count < MAX_PROXIMITY_CHARS_SIZE && proximityChars[count] > 0; ++count) {
+        const int keyIndex = getKeyIndex(proximityChars[count]);
+        if (keyIndex != NOT_A_INDEX && hasSweetSpotData(keyIndex)) {
+            centerXs[count] = mSweetSpotCenterXs[keyIndex];
+            centerYs[count] = mSweetSpotCenterYs[keyIndex];
+            squaredRadii[count] = mSweetSpotSquaredRadii[keyIndex];
+            distances[count] = NOT_A_DISTANCE;
+        } else {
+            centerXs[count] = 0.0f;
+            centerYs[count] = 0.0f;
+            squaredRadii[count] = 1.0f;
+            distances[count] = (count == 0)
+                    ? EQUIVALENT_CHAR_WITHOUT_DISTANCE_INFO
+                    : PROXIMITY_CHAR_WITHOUT_DISTANCE_INFO;
+        }
+    }
+    if (count <= 0 || !mInputXCoordinates || !mInputYCoordinates) return;
+
+    const float inputX = (float)mInputXCoordinates[inputIndex];
+    const float inputY = (float)mInputYCoordinates[inputIndex];
+    for (int j = 0; j < count; ++j) {
+        const float squaredDistance =
+                (square(inputX - centerXs[j]) + square(inputY - centerYs[j])) / squaredRadii[j];
+        scaledSquaredDistances[j] = squaredDistance * NORMALIZED_SQUARED_DISTANCE_SCALING_FACTOR;
     }
-    if (!hasSweetSpotData(keyIndex)) {
-        return NOT_A_DISTANCE_FLOAT;
+    for (int j = 0; j < count; ++j) {
+        if (NOT_A_DISTANCE == distances[j]) {
+            distances[j] = (int)scaledSquaredDistances[j];
+        }
     }
-    const float squaredDistance = calculateSquaredDistanceFromSweetSpotCenter(keyIndex, inputIndex);
-    const float squaredRadius = square(mSweetSpotRadii[keyIndex]);
-    return squaredDistance / squaredRadius;
 }
 
 int ProximityInfo::getKeyIndex(const int c) const {
@@ -167,6 +203,9 @@ int ProximityInfo::getKeyIndex(const int c) const {
         // We do not have the coordinate data
         return NOT_A_INDEX;
     }
+    if (0 <= c && c <= MAX_CHAR_CODE) {
+        return mCodeToKeyIndex[c];
+    }
     const unsigned short baseLowerC = Dictionary::toBaseLowerCase(c);
     if (baseLowerC > MAX_CHAR_CODE) {
         return NOT_A_INDEX;
@@ -174,15 +213,6 @@ int ProximityInfo::getKeyIndex(const int c) const {
     return mCodeToKeyIndex[baseLowerC];
 }
 
-float ProximityInfo::calculateSquaredDistanceFromSweetSpotCenter(
-        const int keyIndex, const int inputIndex) const {
-    const float sweetSpotCenterX = mSweetSpotCenterXs[keyIndex];
-    const float sweetSpotCenterY = mSweetSpotCenterYs[keyIndex];
-    const float inputX = (float)mInputXCoordinates[inputIndex];
-    const float inputY = (float)mInputYCoordinates[inputIndex];
-    return square(inputX - sweetSpotCenterX) + square(inputY - sweetSpotCenterY);
-}
-
 inline const int* ProximityInfo::getProximityCharsAt(const int index) const {
     return mInputCodes + (index * MAX_PROXIMITY_CHARS_SIZE);
 }
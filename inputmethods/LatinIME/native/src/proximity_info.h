@@ -76,9 +76,8 @@ private:
 
     int getStartIndexFromCoordinates(const int x, const int y) const;
     void initializeCodeToKeyIndex();
-    float calculateNormalizedSquaredDistance(const int keyIndex, const int inputIndex) const;
-    float calculateSquaredDistanceFromSweetSpotCenter(
-            const int keyIndex, const int inputIndex) const;
+    void initializeSweetSpotSquaredRadii();
+    void calculateNormalizedSquaredDistances(const int inputIndex);
     int getKeyIndex(const int c) const;
     bool hasSweetSpotData(const int keyIndex) const {
         // When there are no calibration data for a key,
@@ -109,8 +108,16 @@ private:
     float mSweetSpotCenterXs[MAX_KEY_COUNT_IN_A_KEYBOARD];
     float mSweetSpotCenterYs[MAX_KEY_COUNT_IN_A_KEYBOARD];
     float mSweetSpotRadii[MAX_KEY_COUNT_IN_A_KEYBOARD];
+    // 1 for the keys without a sweet spot, which have no distance
+    float mSweetSpotSquaredRadii[MAX_KEY_COUNT_IN_A_KEYBOARD];
+    // The sweet spots of the proximity chars of the input index being set up, see
+    // calculateNormalizedSquaredDistances()
+    float *mProximitySweetSpots;
+    // The scaled distances computed from them, before they are rounded into the distances
+    float *mProximitySquaredDistances;
     int mInputLength;
     unsigned short mPrimaryInputWord[MAX_WORD_LENGTH_INTERNAL];
+    // By char code, before it's lowercased and its accents are removed
     int mCodeToKeyIndex[MAX_CHAR_CODE + 1];
 };
 
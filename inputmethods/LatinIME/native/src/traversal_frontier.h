@@ -0,0 +1,165 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_TRAVERSAL_FRONTIER_H
+#define LATINIME_TRAVERSAL_FRONTIER_H
+
+#include <string.h>
+
+#include "correction_state.h"
+#include "defines.h"
+#include "proximity_info.h"
+
+namespace latinime {
+
+// Lets the search for an input that extends the previous one by a character start from where the
+// previous search stopped being independent of the input length.
+//
+// Processing a character group reads the input at most a few characters past the input index it
+// starts from, and only compares indices against the end of the input past that. So a group that
+// the search enters and leaves more than INCREMENTAL_SEARCH_INPUT_MARGIN characters before the
+// end of the input has the same outcome for any longer input with the same beginning: no word is
+// suggested from it, and it leads to the same groups. The depth first search records every group
+// entered before the threshold that reaches past it, or that could be pruned; these form the
+// frontier. Consecutive siblings share a snapshot, as they are processed from the same state. The
+// groups above the frontier suggest nothing and do not need to be visited again.
+// The search for the next input processes the frontier groups again, in order, from their saved
+// correction states, which gives the same words in the same order as a search from the root.
+class TraversalFrontier {
+public:
+    TraversalFrontier(const int maxProximityChars, const int maxSnapshots)
+            : MAX_PROXIMITY_CHARS(maxProximityChars), MAX_SNAPSHOTS(maxSnapshots),
+              mInputLength(0), mFlags(0), mThreshold(0), mRecordedCount(0),
+              mLastOutputIndex(-1), mLastNextGroupPos(0), mResumeCount(0), mIsValid(false) {
+        mCodes = new int[MAX_WORD_LENGTH_INTERNAL * maxProximityChars];
+        mDistances = new int[MAX_WORD_LENGTH_INTERNAL * maxProximityChars];
+        mRecordedSnapshots = new TraversalSnapshot[maxSnapshots];
+        mResumeSnapshots = new TraversalSnapshot[maxSnapshots];
+    }
+
+    ~TraversalFrontier() {
+        delete[] mResumeSnapshots;
+        delete[] mRecordedSnapshots;
+        delete[] mDistances;
+        delete[] mCodes;
+    }
+
+    // Starts recording the frontier of a search for this input, whose proximity info is already
+    // set. Returns true if the search can resume from the frontier of the previous search instead
+    // of starting from the root: the previous input was this one without its last character.
+    bool startSearch(const ProximityInfo *proximityInfo, const int *codes, const int inputLength,
+            const int flags) {
+        const int previousLength = mInputLength;
+        const bool canResume = mIsValid && previousLength > 0
+                && inputLength == previousLength + 1 && flags == mFlags
+                && inputLength <= MAX_WORD_LENGTH_INTERNAL
+                && hasSameInput(proximityInfo, codes, previousLength);
+
+        // The recorded frontier becomes the one to resume from
+        TraversalSnapshot *snapshots = mResumeSnapshots;
+        mResumeSnapshots = mRecordedSnapshots;
+        mRecordedSnapshots = snapshots;
+        mResumeCount = canResume ? mRecordedCount : 0;
+        mRecordedCount = 0;
+        mLastOutputIndex = -1;
+
+        mIsValid = inputLength <= MAX_WORD_LENGTH_INTERNAL;
+        mInputLength = mIsValid ? inputLength : 0;
+        mFlags = flags;
+        mThreshold = max(1, inputLength - INCREMENTAL_SEARCH_INPUT_MARGIN);
+        for (int i = 0; i < mInputLength; ++i) {
+            for (int j = 0; j < MAX_PROXIMITY_CHARS && codes[i * MAX_PROXIMITY_CHARS + j] > 0;
+                    ++j) {
+                mDistances[i * MAX_PROXIMITY_CHARS + j] =
+                        proximityInfo->getNormalizedSquaredDistance(i, j);
+            }
+        }
+        memcpy(mCodes, codes, mInputLength * MAX_PROXIMITY_CHARS * sizeof(mCodes[0]));
+        return canResume;
+    }
+
+    int getResumeCount() const {
+        return mResumeCount;
+    }
+
+    const TraversalSnapshot *getResumeSnapshot(const int index) const {
+        return &mResumeSnapshots[index];
+    }
+
+    // Groups entered before this input or output index, and left past it, are recorded
+    int getThreshold() const {
+        return mThreshold;
+    }
+
+    // Records the group at groupPos, processed from the level outputIndex. Returns the snapshot
+    // to save the search into, or NULL if the group follows the last recorded one in the same
+    // node, or if the frontier is too large to be kept; the next search then starts from the root.
+    TraversalSnapshot *recordGroup(const int outputIndex, const int groupPos,
+            const int nextGroupPos) {
+        const bool followsLastGroup = outputIndex == mLastOutputIndex
+                && groupPos == mLastNextGroupPos;
+        mLastOutputIndex = outputIndex;
+        mLastNextGroupPos = nextGroupPos;
+        if (followsLastGroup) {
+            ++mRecordedSnapshots[mRecordedCount - 1].mGroupCount;
+            return NULL;
+        }
+        if (mRecordedCount >= MAX_SNAPSHOTS) {
+            mIsValid = false;
+            mLastOutputIndex = -1;
+            return NULL;
+        }
+        return &mRecordedSnapshots[mRecordedCount++];
+    }
+
+private:
+    // Everything the search reads from the input at the given indices: the proximity chars and
+    // their distances, which only exist up to the first missing char
+    bool hasSameInput(const ProximityInfo *proximityInfo, const int *codes,
+            const int length) const {
+        if (memcmp(mCodes, codes, length * MAX_PROXIMITY_CHARS * sizeof(mCodes[0]))) {
+            return false;
+        }
+        for (int i = 0; i < length; ++i) {
+            for (int j = 0; j < MAX_PROXIMITY_CHARS && codes[i * MAX_PROXIMITY_CHARS + j] > 0;
+                    ++j) {
+                if (mDistances[i * MAX_PROXIMITY_CHARS + j]
+                        != proximityInfo->getNormalizedSquaredDistance(i, j)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    const int MAX_PROXIMITY_CHARS;
+    const int MAX_SNAPSHOTS;
+    int *mCodes;
+    int *mDistances;
+    int mInputLength;
+    int mFlags;
+    int mThreshold;
+    TraversalSnapshot *mRecordedSnapshots;
+    int mRecordedCount;
+    int mLastOutputIndex;
+    int mLastNextGroupPos;
+    TraversalSnapshot *mResumeSnapshots;
+    int mResumeCount;
+    bool mIsValid;
+};
+} // namespace latinime
+
+#endif // LATINIME_TRAVERSAL_FRONTIER_H
@@ -20,6 +20,7 @@
 
 #define LOG_TAG "LatinIME: unigram_dictionary.cpp"
 
+#include "array_trie.h"
 #include "char_utils.h"
 #include "dictionary.h"
 #include "unigram_dictionary.h"
@@ -37,24 +38,49 @@ const UnigramDictionary::digraph_t UnigramDictionary::GERMAN_UMLAUT_DIGRAPHS[] =
 UnigramDictionary::UnigramDictionary(const uint8_t* const streamStart, int typedLetterMultiplier,
         int fullWordMultiplier, int maxWordLength, int maxWords, int maxProximityChars,
         const bool isLatestDictVersion)
-    : DICT_ROOT(streamStart + NEW_DICTIONARY_HEADER_SIZE),
-    MAX_WORD_LENGTH(maxWordLength), MAX_WORDS(maxWords),
+    : MAX_WORD_LENGTH(maxWordLength), MAX_WORDS(maxWords),
     MAX_PROXIMITY_CHARS(maxProximityChars), IS_LATEST_DICT_VERSION(isLatestDictVersion),
     TYPED_LETTER_MULTIPLIER(typedLetterMultiplier), FULL_WORD_MULTIPLIER(fullWordMultiplier),
       // TODO : remove this variable.
     ROOT_POS(0),
     BYTES_IN_ONE_CHAR(MAX_PROXIMITY_CHARS * sizeof(int)),
-    MAX_UMLAUT_SEARCH_DEPTH(DEFAULT_MAX_UMLAUT_SEARCH_DEPTH) {
+    MAX_UMLAUT_SEARCH_DEPTH(DEFAULT_MAX_UMLAUT_SEARCH_DEPTH), mTrieCount(0),
+    mVisitedGroupCount(0) {
     if (DEBUG_DICT) {
         LOGI("UnigramDictionary - constructor");
     }
     mCorrection = new Correction(typedLetterMultiplier, fullWordMultiplier);
+    mWordsPriorityQueue = new WordsPriorityQueue(maxWords, maxWordLength);
+    addDictionary(streamStart);
+    selectTrie(0);
 }
 
 UnigramDictionary::~UnigramDictionary() {
+    for (int i = 0; i < mTrieCount; ++i) {
+        delete mTries[i].mTraversalFrontier;
+        delete mTries[i].mArrayTrie;
+    }
+    delete mWordsPriorityQueue;
     delete mCorrection;
 }
 
+bool UnigramDictionary::addDictionary(const uint8_t* const streamStart) {
+    if (mTrieCount >= MAX_MERGED_DICTIONARIES) return false;
+    Trie *trie = &mTries[mTrieCount++];
+    trie->mRoot = streamStart + NEW_DICTIONARY_HEADER_SIZE;
+    trie->mArrayTrie = BinaryFormat::FORMAT_VERSION_3 == BinaryFormat::detectFormat(streamStart)
+            ? new ArrayTrie(trie->mRoot) : NULL;
+    trie->mTraversalFrontier = new TraversalFrontier(MAX_PROXIMITY_CHARS,
+            MAX_INCREMENTAL_SEARCH_FRONTIER_SIZE);
+    return true;
+}
+
+inline void UnigramDictionary::selectTrie(const int index) {
+    mDictRoot = mTries[index].mRoot;
+    mArrayTrie = mTries[index].mArrayTrie;
+    mTraversalFrontier = mTries[index].mTraversalFrontier;
+}
+
 static inline unsigned int getCodesBufferSize(const int* codes, const int codesSize,
         const int MAX_PROXIMITY_CHARS) {
     return sizeof(*codes) * MAX_PROXIMITY_CHARS * codesSize;
@@ -140,6 +166,9 @@ int UnigramDictionary::getSuggestions(ProximityInfo *proximityInfo, const int *x
         const int *ycoordinates, const int *codes, const int codesSize, const int flags,
         unsigned short *outWords, int *frequencies) {
 
+    // Words are collected across all the digraph variants, and written out once at the end
+    mWordsPriorityQueue->clear();
+    mVisitedGroupCount = 0;
     if (REQUIRES_GERMAN_UMLAUT_PROCESSING & flags)
     { // Incrementally tune the word and try all possibilities
         int codesBuffer[getCodesBufferSize(codes, codesSize, MAX_PROXIMITY_CHARS)];
@@ -151,21 +180,17 @@ int UnigramDictionary::getSuggestions(ProximityInfo *proximityInfo, const int *x
     }
 
     PROF_START(20);
-    // Get the word count
-    int suggestedWordsCount = 0;
-    while (suggestedWordsCount < MAX_WORDS && mFrequencies[suggestedWordsCount] > 0) {
-        suggestedWordsCount++;
-    }
+    const int suggestedWordsCount = mWordsPriorityQueue->outputSuggestions(frequencies, outWords);
 
     if (DEBUG_DICT) {
         LOGI("Returning %d words", suggestedWordsCount);
         /// Print the returned words
         for (int j = 0; j < suggestedWordsCount; ++j) {
 #ifdef FLAG_DBG
-            short unsigned int* w = mOutputChars + j * MAX_WORD_LENGTH;
+            short unsigned int* w = outWords + j * MAX_WORD_LENGTH;
             char s[MAX_WORD_LENGTH];
             for (int i = 0; i <= MAX_WORD_LENGTH; i++) s[i] = w[i];
-            LOGI("%s %i", s, mFrequencies[j]);
+            LOGI("%s %i", s, frequencies[j]);
 #endif
         }
     }
@@ -180,8 +205,7 @@ void UnigramDictionary::getWordSuggestions(ProximityInfo *proximityInfo,
 
     PROF_OPEN;
     PROF_START(0);
-    initSuggestions(
-            proximityInfo, xcoordinates, ycoordinates, codes, codesSize, outWords, frequencies);
+    initSuggestions(proximityInfo, xcoordinates, ycoordinates, codes, codesSize);
     if (DEBUG_DICT) assert(codesSize == mInputLength);
 
     const int maxDepth = min(mInputLength * MAX_DEPTH_MULTIPLIER, MAX_WORD_LENGTH);
@@ -191,7 +215,13 @@ void UnigramDictionary::getWordSuggestions(ProximityInfo *proximityInfo,
     const bool useFullEditDistance = USE_FULL_EDIT_DISTANCE & flags;
     // TODO: remove
     PROF_START(1);
-    getSuggestionCandidates(useFullEditDistance);
+    // The words found in a trie raise the frequency threshold for the next ones
+    for (int i = 0; i < mTrieCount; ++i) {
+        selectTrie(i);
+        const bool resumesSearch =
+                mTraversalFrontier->startSearch(mProximityInfo, codes, codesSize, flags);
+        getSuggestionCandidates(useFullEditDistance, resumesSearch);
+    }
     PROF_END(1);
 
     PROF_START(2);
@@ -207,6 +237,7 @@ void UnigramDictionary::getWordSuggestions(ProximityInfo *proximityInfo,
     PROF_END(4);
 
     PROF_START(5);
+    clearSplitWordsLike();
     // Suggestions with missing space
     if (SUGGEST_WORDS_WITH_MISSING_SPACE_CHARACTER
             && mInputLength >= MIN_USER_TYPED_LENGTH_FOR_MISSING_SPACE_SUGGESTION) {
@@ -241,13 +272,10 @@ void UnigramDictionary::getWordSuggestions(ProximityInfo *proximityInfo,
 }
 
 void UnigramDictionary::initSuggestions(ProximityInfo *proximityInfo, const int *xCoordinates,
-        const int *yCoordinates, const int *codes, const int codesSize,
-        unsigned short *outWords, int *frequencies) {
+        const int *yCoordinates, const int *codes, const int codesSize) {
     if (DEBUG_DICT) {
         LOGI("initSuggest");
     }
-    mFrequencies = frequencies;
-    mOutputChars = outWords;
     mInputLength = codesSize;
     proximityInfo->setInputParams(codes, codesSize, xCoordinates, yCoordinates);
     mProximityInfo = proximityInfo;
@@ -259,7 +287,6 @@ static inline void registerNextLetter(unsigned short c, int *nextLetters, int ne
     }
 }
 
-// TODO: We need to optimize addWord by using STL or something
 // TODO: This needs to take an const unsigned short* and not tinker with its contents
 bool UnigramDictionary::addWord(unsigned short *word, int length, int frequency) {
     word[length] = 0;
@@ -276,17 +303,10 @@ bool UnigramDictionary::addWord(unsigned short *word, int length, int frequency)
         }
         return false;
     }
+    // A frequency of 0 marks an empty slot in the output
+    if (frequency <= 0) return false;
 
-    // Find the right insertion point
-    int insertAt = 0;
-    while (insertAt < MAX_WORDS) {
-        // TODO: How should we sort words with the same frequency?
-        if (frequency > mFrequencies[insertAt]) {
-            break;
-        }
-        insertAt++;
-    }
-    if (insertAt < MAX_WORDS) {
+    if (mWordsPriorityQueue->push(frequency, word, length)) {
         if (DEBUG_DICT) {
 #ifdef FLAG_DBG
             char s[length + 1];
@@ -294,21 +314,6 @@ bool UnigramDictionary::addWord(unsigned short *word, int length, int frequency)
             LOGI("Added word = %s, freq = %d, %d", s, frequency, S_INT_MAX);
 #endif
         }
-        memmove((char*) mFrequencies + (insertAt + 1) * sizeof(mFrequencies[0]),
-               (char*) mFrequencies + insertAt * sizeof(mFrequencies[0]),
-               (MAX_WORDS - insertAt - 1) * sizeof(mFrequencies[0]));
-        mFrequencies[insertAt] = frequency;
-        memmove((char*) mOutputChars + (insertAt + 1) * MAX_WORD_LENGTH * sizeof(short),
-               (char*) mOutputChars + insertAt * MAX_WORD_LENGTH * sizeof(short),
-               (MAX_WORDS - insertAt - 1) * sizeof(short) * MAX_WORD_LENGTH);
-        unsigned short *dest = mOutputChars + insertAt * MAX_WORD_LENGTH;
-        while (length--) {
-            *dest++ = *word++;
-        }
-        *dest = 0; // NULL terminate
-        if (DEBUG_DICT) {
-            LOGI("Added word at %d", insertAt);
-        }
         return true;
     }
     return false;
@@ -317,25 +322,70 @@ bool UnigramDictionary::addWord(unsigned short *word, int length, int frequency)
 static const char QUOTE = '\'';
 static const char SPACE = ' ';
 
-void UnigramDictionary::getSuggestionCandidates(const bool useFullEditDistance) {
+void UnigramDictionary::getSuggestionCandidates(const bool useFullEditDistance,
+        const bool resumesSearch) {
     // TODO: Remove setCorrectionParams
     mCorrection->setCorrectionParams(0, 0, 0,
             -1 /* spaceProximityPos */, -1 /* missingSpacePos */, useFullEditDistance);
-    int rootPosition = ROOT_POS;
-    // Get the number of children of root, then increment the position
-    int childCount = Dictionary::getCount(DICT_ROOT, &rootPosition);
-    int outputIndex = 0;
 
+    if (resumesSearch) {
+        // Only the groups on the frontier of the previous search can lead to words
+        const int snapshotCount = mTraversalFrontier->getResumeCount();
+        for (int i = 0; i < snapshotCount; ++i) {
+            getSuggestionCandidatesFrom(mCorrection->restoreTraversalSnapshot(
+                    mTraversalFrontier->getResumeSnapshot(i)));
+        }
+        return;
+    }
+
+    int rootPosition = ROOT_POS;
+    int childCount;
+    if (mArrayTrie) {
+        // The root groups are the first ones
+        childCount = mArrayTrie->getRootGroupCount();
+    } else {
+        // Get the number of children of root, then increment the position
+        childCount = Dictionary::getCount(mDictRoot, &rootPosition);
+    }
     mCorrection->initCorrectionState(rootPosition, childCount, (mInputLength <= 0));
+    getSuggestionCandidatesFrom(0);
+}
+
+void UnigramDictionary::getSuggestionCandidatesFrom(const int startOutputIndex) {
+    const int threshold = mTraversalFrontier->getThreshold();
+    int outputIndex = startOutputIndex;
+    int childCount;
 
     // Depth first search
     while (outputIndex >= 0) {
         if (mCorrection->initProcessState(outputIndex)) {
+            ++mVisitedGroupCount;
             int siblingPos = mCorrection->getTreeSiblingPos(outputIndex);
             int firstChildPos;
 
-            const bool needsToTraverseChildrenNodes = processCurrentNode(siblingPos,
-                    mCorrection, &childCount, &firstChildPos, &siblingPos);
+            const int groupPos = siblingPos;
+            // The group after the last one of a node is not its sibling, even if it's next to it
+            // in the array format
+            const bool hasSiblingsLeft = mCorrection->hasTreeSiblingsLeft(outputIndex);
+            const bool isBeforeThreshold =
+                    max(mCorrection->getInputIndex(), outputIndex) < threshold;
+            const bool needsToTraverseChildrenNodes = mArrayTrie
+                    ? processCurrentGroup(siblingPos, mCorrection, &childCount, &firstChildPos,
+                            &siblingPos)
+                    : processCurrentNode(siblingPos, mCorrection, &childCount, &firstChildPos,
+                            &siblingPos);
+            // Record the groups whose outcome may differ for a longer input: those that reach the
+            // threshold, and those that may have been pruned
+            if (isBeforeThreshold && (threshold <= max(mCorrection->getInputIndex(),
+                    mCorrection->getOutputIndex())
+                    || (!needsToTraverseChildrenNodes && mCorrection->needsToPrune()))) {
+                TraversalSnapshot *snapshot =
+                        mTraversalFrontier->recordGroup(outputIndex, groupPos,
+                                hasSiblingsLeft ? siblingPos : NOT_A_GROUP_POS);
+                if (snapshot) {
+                    mCorrection->saveTraversalSnapshot(outputIndex, groupPos, snapshot);
+                }
+            }
             // Update next sibling pos
             mCorrection->setTreeSiblingPos(outputIndex, siblingPos);
 
@@ -408,19 +458,21 @@ void UnigramDictionary::getSplitTwoWordsSuggestion(
         return;
 
     const int newWordLength = firstWordLength + secondWordLength + 1;
-    // Allocating variable length array on stack
-    unsigned short word[newWordLength];
-    const int firstFreq = getMostFrequentWordLike(firstWordStartPos, firstWordLength, mWord);
+    // Allocating variable length array on stack, with room for the null addWord terminates with
+    unsigned short word[newWordLength + 1];
+    const unsigned short *firstWord;
+    const int firstFreq = getFirstWordLike(firstWordLength, &firstWord);
     if (DEBUG_DICT) {
         LOGI("First freq: %d", firstFreq);
     }
     if (firstFreq <= 0) return;
 
     for (int i = 0; i < firstWordLength; ++i) {
-        word[i] = mWord[i];
+        word[i] = firstWord[i];
     }
 
-    const int secondFreq = getMostFrequentWordLike(secondWordStartPos, secondWordLength, mWord);
+    const unsigned short *secondWord;
+    const int secondFreq = getSecondWordLike(secondWordStartPos, secondWordLength, &secondWord);
     if (DEBUG_DICT) {
         LOGI("Second  freq:  %d", secondFreq);
     }
@@ -428,7 +480,7 @@ void UnigramDictionary::getSplitTwoWordsSuggestion(
 
     word[firstWordLength] = SPACE;
     for (int i = (firstWordLength + 1); i < newWordLength; ++i) {
-        word[i] = mWord[i - firstWordLength - 1];
+        word[i] = secondWord[i - firstWordLength - 1];
     }
 
     const int pairFreq = mCorrection->getFreqForSplitTwoWords(firstFreq, secondFreq, word);
@@ -439,16 +491,65 @@ void UnigramDictionary::getSplitTwoWordsSuggestion(
     return;
 }
 
-// Wrapper for getMostFrequentWordLikeInner, which matches it to the previous
-// interface.
-inline int UnigramDictionary::getMostFrequentWordLike(const int startInputIndex,
-        const int inputLength, unsigned short *word) {
-    uint16_t inWord[inputLength];
+// The split two words suggestions try the space at every position of the input, so they look up
+// the words like every beginning and every end of the input, each more than once. The lookups are
+// kept until the next input. The beginnings are all found along the paths to the longest one, so
+// they are looked up together the first time one is needed.
+void UnigramDictionary::clearSplitWordsLike() {
+    mHasFirstWordsLike = false;
+    for (int i = 0; i < MAX_WORD_LENGTH_INTERNAL; ++i) {
+        mSecondWordLikeFreqs[i] = NOT_LOOKED_UP;
+    }
+}
 
-    for (int i = 0; i < inputLength; ++i) {
+// Returns the highest frequency of the words like the first length chars of the input, and the
+// word in outWord. The input is longer than length.
+int UnigramDictionary::getFirstWordLike(const int length, const unsigned short **outWord) {
+    if (!mHasFirstWordsLike) {
+        getMostFrequentWordsLike(0, 1, mInputLength - 1, mFirstWordLikeFreqs, mFirstWordsLike);
+        mHasFirstWordsLike = true;
+    }
+    *outWord = mFirstWordsLike + (length - 1) * MAX_WORD_LENGTH_INTERNAL;
+    return mFirstWordLikeFreqs[length - 1];
+}
+
+// Returns the highest frequency of the words like the chars of the input from startInputIndex to
+// its end, which is length chars long, and the word in outWord.
+int UnigramDictionary::getSecondWordLike(const int startInputIndex, const int length,
+        const unsigned short **outWord) {
+    unsigned short *word = mSecondWordsLike + startInputIndex * MAX_WORD_LENGTH_INTERNAL;
+    if (NOT_LOOKED_UP == mSecondWordLikeFreqs[startInputIndex]) {
+        getMostFrequentWordsLike(startInputIndex, length, length,
+                &mSecondWordLikeFreqs[startInputIndex], word);
+    }
+    *outWord = word;
+    return mSecondWordLikeFreqs[startInputIndex];
+}
+
+// Wrapper for getMostFrequentWordsLikeInner, which reads the word from the input, and looks it up
+// in all the tries.
+inline void UnigramDictionary::getMostFrequentWordsLike(const int startInputIndex,
+        const int minLength, const int maxLength, int *outFreqs, unsigned short *outWords) {
+    // Terminated, so that a group never matches past the end
+    uint16_t inWord[maxLength + 1];
+
+    for (int i = 0; i < maxLength; ++i) {
         inWord[i] = (uint16_t)mProximityInfo->getPrimaryCharAt(startInputIndex + i);
     }
-    return getMostFrequentWordLikeInner(inWord, inputLength, word);
+    inWord[maxLength] = 0;
+    for (int i = 0; i <= maxLength - minLength; ++i) {
+        outFreqs[i] = -1;
+    }
+    // A word replaces the one of another trie only if it's more frequent
+    for (int i = 0; i < mTrieCount; ++i) {
+        selectTrie(i);
+        if (mArrayTrie) {
+            getMostFrequentWordsLikeInArrayTrie(inWord, minLength, maxLength, outFreqs,
+                    outWords);
+        } else {
+            getMostFrequentWordsLikeInner(inWord, minLength, maxLength, outFreqs, outWords);
+        }
+    }
 }
 
 // This function will take the position of a character array within a CharGroup,
@@ -512,14 +613,16 @@ static inline void onTerminalWordLike(const int freq, int32_t* newWord, const in
     }
 }
 
-// Will find the highest frequency of the words like the one passed as an argument,
-// that is, everything that only differs by case/accents.
-int UnigramDictionary::getMostFrequentWordLikeInner(const uint16_t * const inWord,
-        const int length, short unsigned int* outWord) {
+// Will find the highest frequency of the words like the beginnings of the word passed as an
+// argument that are minLength to length chars long, that is, everything that only differs by
+// case/accents. The one for the beginning of length i goes into outFreqs[i - minLength] if it's
+// higher than the frequency already there, which is -1 if there is none yet, and the word into
+// the row of MAX_WORD_LENGTH_INTERNAL chars of the same index in outWords.
+void UnigramDictionary::getMostFrequentWordsLikeInner(const uint16_t * const inWord,
+        const int minLength, const int length, int *outFreqs, unsigned short *outWords) {
     int32_t newWord[MAX_WORD_LENGTH_INTERNAL];
     int depth = 0;
-    int maxFreq = -1;
-    const uint8_t* const root = DICT_ROOT;
+    const uint8_t* const root = mDictRoot;
 
     mStackChildCount[0] = root[0];
     mStackInputIndex[0] = 0;
@@ -536,9 +639,11 @@ int UnigramDictionary::getMostFrequentWordLikeInner(const uint16_t * const inWor
             // into inputIndex if there is a match.
             const bool isAlike = testCharGroupForContinuedLikeness(flags, root, pos, inWord,
                     inputIndex, newWord, &inputIndex, &pos);
-            if (isAlike && (FLAG_IS_TERMINAL & flags) && (inputIndex == length)) {
+            if (isAlike && (FLAG_IS_TERMINAL & flags) && (inputIndex >= minLength)) {
                 const int frequency = BinaryFormat::readFrequencyWithoutMovingPointer(root, pos);
-                onTerminalWordLike(frequency, newWord, inputIndex, outWord, &maxFreq);
+                const int index = inputIndex - minLength;
+                onTerminalWordLike(frequency, newWord, inputIndex,
+                        outWords + index * MAX_WORD_LENGTH_INTERNAL, &outFreqs[index]);
             }
             pos = BinaryFormat::skipFrequency(flags, pos);
             const int siblingPos = BinaryFormat::skipChildrenPosAndAttributes(root, flags, pos);
@@ -568,11 +673,82 @@ int UnigramDictionary::getMostFrequentWordLikeInner(const uint16_t * const inWor
         }
         --depth;
     }
-    return maxFreq;
+}
+
+// Same as testCharGroupForContinuedLikeness, for a group of a dictionary in the array format
+static inline bool testArrayGroupForContinuedLikeness(const ArrayTrie* const trie,
+        const int group, const uint16_t* const inWord, const int startInputIndex,
+        int32_t* outNewWord, int* outInputIndex) {
+    int32_t character = trie->getChar(group);
+    if (Dictionary::toBaseLowerCase(character)
+            != Dictionary::toBaseLowerCase(inWord[startInputIndex])) {
+        return false;
+    }
+    int inputIndex = startInputIndex;
+    outNewWord[inputIndex] = character;
+    if (UnigramDictionary::FLAG_HAS_MULTIPLE_CHARS & trie->getFlags(group)) {
+        int pos = trie->getExtraDataPosition(group);
+        for (character = trie->getOtherCharAndForwardPointer(&pos); NOT_A_CHARACTER != character;
+                character = trie->getOtherCharAndForwardPointer(&pos)) {
+            if (Dictionary::toBaseLowerCase(inWord[++inputIndex])
+                    != Dictionary::toBaseLowerCase(character)) {
+                return false;
+            }
+            outNewWord[inputIndex] = character;
+        }
+    }
+    *outInputIndex = inputIndex + 1;
+    return true;
+}
+
+// Same as getMostFrequentWordsLikeInner, for a dictionary in the array format. The stacks hold
+// the next group and the count of the groups left at each depth.
+void UnigramDictionary::getMostFrequentWordsLikeInArrayTrie(const uint16_t * const inWord,
+        const int minLength, const int length, int *outFreqs, unsigned short *outWords) {
+    int32_t newWord[MAX_WORD_LENGTH_INTERNAL];
+    int depth = 0;
+    const ArrayTrie* const trie = mArrayTrie;
+
+    mStackChildCount[0] = trie->getRootGroupCount();
+    mStackInputIndex[0] = 0;
+    mStackSiblingPos[0] = 0;
+    while (depth >= 0) {
+        if (mStackChildCount[depth] <= 0) {
+            --depth;
+            continue;
+        }
+        --mStackChildCount[depth];
+        const int group = mStackSiblingPos[depth]++;
+        int inputIndex = mStackInputIndex[depth];
+        if (!testArrayGroupForContinuedLikeness(trie, group, inWord, inputIndex, newWord,
+                &inputIndex)) {
+            continue;
+        }
+        if ((FLAG_IS_TERMINAL & trie->getFlags(group)) && (inputIndex >= minLength)) {
+            const int index = inputIndex - minLength;
+            onTerminalWordLike(trie->getFrequency(group), newWord, inputIndex,
+                    outWords + index * MAX_WORD_LENGTH_INTERNAL, &outFreqs[index]);
+        }
+        // Words longer than the one we are searching for can't match
+        const int childCount = trie->getChildCount(group);
+        if (childCount > 0 && inputIndex < length) {
+            ++depth;
+            mStackChildCount[depth] = childCount;
+            mStackSiblingPos[depth] = trie->getFirstChild(group);
+            mStackInputIndex[depth] = inputIndex;
+        }
+    }
 }
 
 bool UnigramDictionary::isValidWord(const uint16_t* const inWord, const int length) const {
-    return NOT_VALID_WORD != BinaryFormat::getTerminalPosition(DICT_ROOT, inWord, length);
+    for (int i = 0; i < mTrieCount; ++i) {
+        const Trie *trie = &mTries[i];
+        const int pos = trie->mArrayTrie
+                ? trie->mArrayTrie->getTerminalPosition(inWord, length)
+                : BinaryFormat::getTerminalPosition(trie->mRoot, inWord, length);
+        if (NOT_VALID_WORD != pos) return true;
+    }
+    return false;
 }
 
 // TODO: remove this function.
@@ -611,7 +787,7 @@ inline bool UnigramDictionary::processCurrentNode(const int initialPos,
     // - FLAG_HAS_MULTIPLE_CHARS: whether this node has multiple char or not.
     // - FLAG_IS_TERMINAL: whether this node is a terminal or not (it may still have children)
     // - FLAG_HAS_BIGRAMS: whether this node has bigrams or not
-    const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(DICT_ROOT, &pos);
+    const uint8_t flags = BinaryFormat::getFlagsAndForwardPointer(mDictRoot, &pos);
     const bool hasMultipleChars = (0 != (FLAG_HAS_MULTIPLE_CHARS & flags));
     const bool isTerminalNode = (0 != (FLAG_IS_TERMINAL & flags));
 
@@ -622,7 +798,7 @@ inline bool UnigramDictionary::processCurrentNode(const int initialPos,
     // else if FLAG_IS_TERMINAL: the frequency
     // else if MASK_GROUP_ADDRESS_TYPE is not NONE: the children address
     // Note that you can't have a node that both is not a terminal and has no children.
-    int32_t c = BinaryFormat::getCharCodeAndForwardPointer(DICT_ROOT, &pos);
+    int32_t c = BinaryFormat::getCharCodeAndForwardPointer(mDictRoot, &pos);
     assert(NOT_A_CHARACTER != c);
 
     // We are going to loop through each character and make it look like it's a different
@@ -637,7 +813,7 @@ inline bool UnigramDictionary::processCurrentNode(const int initialPos,
         // NOT_A_CHARACTER in the next char. From this we can decide whether this virtual node
         // should behave as a terminal or not and whether we have children.
         const int32_t nextc = hasMultipleChars
-                ? BinaryFormat::getCharCodeAndForwardPointer(DICT_ROOT, &pos) : NOT_A_CHARACTER;
+                ? BinaryFormat::getCharCodeAndForwardPointer(mDictRoot, &pos) : NOT_A_CHARACTER;
         const bool isLastChar = (NOT_A_CHARACTER == nextc);
         // If there are more chars in this nodes, then this virtual node is not a terminal.
         // If we are on the last char, this virtual node is a terminal if this node is.
@@ -657,11 +833,11 @@ inline bool UnigramDictionary::processCurrentNode(const int initialPos,
             // We don't have to output other values because we return false, as in
             // "don't traverse children".
             if (!isLastChar) {
-                pos = BinaryFormat::skipOtherCharacters(DICT_ROOT, pos);
+                pos = BinaryFormat::skipOtherCharacters(mDictRoot, pos);
             }
             pos = BinaryFormat::skipFrequency(flags, pos);
             *nextSiblingPosition =
-                    BinaryFormat::skipChildrenPosAndAttributes(DICT_ROOT, flags, pos);
+                    BinaryFormat::skipChildrenPosAndAttributes(mDictRoot, flags, pos);
             return false;
         }
 
@@ -675,7 +851,7 @@ inline bool UnigramDictionary::processCurrentNode(const int initialPos,
         if (needsToInvokeOnTerminal) {
             // The frequency should be here, because we come here only if this is actually
             // a terminal node, and we are on its last char.
-            const int freq = BinaryFormat::readFrequencyWithoutMovingPointer(DICT_ROOT, pos);
+            const int freq = BinaryFormat::readFrequencyWithoutMovingPointer(mDictRoot, pos);
             onTerminal(freq, mCorrection);
         }
 
@@ -692,7 +868,7 @@ inline bool UnigramDictionary::processCurrentNode(const int initialPos,
         if (!hasChildren) {
             pos = BinaryFormat::skipFrequency(flags, pos);
             *nextSiblingPosition =
-                    BinaryFormat::skipChildrenPosAndAttributes(DICT_ROOT, flags, pos);
+                    BinaryFormat::skipChildrenPosAndAttributes(mDictRoot, flags, pos);
             return false;
         }
 
@@ -700,7 +876,7 @@ inline bool UnigramDictionary::processCurrentNode(const int initialPos,
         if (correction->needsToPrune()) {
             pos = BinaryFormat::skipFrequency(flags, pos);
             *nextSiblingPosition =
-                    BinaryFormat::skipChildrenPosAndAttributes(DICT_ROOT, flags, pos);
+                    BinaryFormat::skipChildrenPosAndAttributes(mDictRoot, flags, pos);
             if (DEBUG_DICT_FULL) {
                 LOGI("Traversing was pruned.");
             }
@@ -708,6 +884,20 @@ inline bool UnigramDictionary::processCurrentNode(const int initialPos,
         }
     }
 
+    // Optimization: Prune out the words below that can't rank high enough to be suggested. When
+    // traversing all nodes, they only add chars to the current word.
+    const int maxDescendantFreq =
+            BinaryFormat::readMaxDescendantFrequencyWithoutMovingPointer(mDictRoot, flags, pos);
+    if (correction->getFinalFreqUpperBound(maxDescendantFreq)
+            <= mWordsPriorityQueue->getFrequencyThreshold()) {
+        pos = BinaryFormat::skipFrequency(flags, pos);
+        *nextSiblingPosition = BinaryFormat::skipChildrenPosAndAttributes(mDictRoot, flags, pos);
+        if (DEBUG_DICT_FULL) {
+            LOGI("Traversing was pruned by frequency.");
+        }
+        return false;
+    }
+
     // Now we finished processing this node, and we want to traverse children. If there are no
     // children, we can't come here.
     assert(BinaryFormat::hasChildrenInFlags(flags));
@@ -719,11 +909,72 @@ inline bool UnigramDictionary::processCurrentNode(const int initialPos,
     // Once this is read, we still need to output the number of nodes in the immediate children of
     // this node, so we read and output it before returning true, as in "please traverse children".
     pos = BinaryFormat::skipFrequency(flags, pos);
-    int childrenPos = BinaryFormat::readChildrenPosition(DICT_ROOT, flags, pos);
-    *nextSiblingPosition = BinaryFormat::skipChildrenPosAndAttributes(DICT_ROOT, flags, pos);
-    *newCount = BinaryFormat::getGroupCountAndForwardPointer(DICT_ROOT, &childrenPos);
+    int childrenPos = BinaryFormat::readChildrenPosition(mDictRoot, flags, pos);
+    *nextSiblingPosition = BinaryFormat::skipChildrenPosAndAttributes(mDictRoot, flags, pos);
+    *newCount = BinaryFormat::getGroupCountAndForwardPointer(mDictRoot, &childrenPos);
     *newChildrenPosition = childrenPos;
     return true;
 }
 
+// Same as processCurrentNode, but the fields of the group are read from the arrays of the
+// dictionary, and only when needed: the first char is always read, and the frequency, the other
+// chars and the children only if the group matches the input so far.
+inline bool UnigramDictionary::processCurrentGroup(const int group, Correction *correction,
+        int *newCount, int *newFirstChild, int *nextSibling) {
+    if (DEBUG_DICT) {
+        correction->checkState();
+    }
+    const ArrayTrie* const trie = mArrayTrie;
+    *nextSibling = group + 1;
+    const uint8_t flags = trie->getFlags(group);
+    const bool hasMultipleChars = (0 != (FLAG_HAS_MULTIPLE_CHARS & flags));
+    const bool isTerminalGroup = (0 != (FLAG_IS_TERMINAL & flags));
+    int pos = hasMultipleChars ? trie->getExtraDataPosition(group) : 0;
+
+    bool needsToInvokeOnTerminal = false;
+    int32_t c = trie->getChar(group);
+    do {
+        const int32_t nextc = hasMultipleChars
+                ? trie->getOtherCharAndForwardPointer(&pos) : NOT_A_CHARACTER;
+        const bool isTerminal = (NOT_A_CHARACTER == nextc) && isTerminalGroup;
+        Correction::CorrectionType stateType = correction->processCharAndCalcState(
+                c, isTerminal);
+        if (stateType == Correction::TRAVERSE_ALL_ON_TERMINAL
+                || stateType == Correction::ON_TERMINAL) {
+            needsToInvokeOnTerminal = true;
+        } else if (stateType == Correction::UNRELATED) {
+            return false;
+        }
+        c = nextc;
+    } while (NOT_A_CHARACTER != c);
+
+    const int childCount = trie->getChildCount(group);
+    if (isTerminalGroup) {
+        if (needsToInvokeOnTerminal) {
+            onTerminal(trie->getFrequency(group), mCorrection);
+        }
+        if (childCount <= 0) return false;
+        // Optimization: Prune out words that are too long compared to how much was typed.
+        if (correction->needsToPrune()) {
+            if (DEBUG_DICT_FULL) {
+                LOGI("Traversing was pruned.");
+            }
+            return false;
+        }
+    }
+
+    // Optimization: Prune out the words below that can't rank high enough to be suggested.
+    if (correction->getFinalFreqUpperBound(trie->getMaxDescendantFrequency(group))
+            <= mWordsPriorityQueue->getFrequencyThreshold()) {
+        if (DEBUG_DICT_FULL) {
+            LOGI("Traversing was pruned by frequency.");
+        }
+        return false;
+    }
+
+    *newCount = childCount;
+    *newFirstChild = trie->getFirstChild(group);
+    return true;
+}
+
 } // namespace latinime
@@ -22,6 +22,8 @@
 #include "correction_state.h"
 #include "defines.h"
 #include "proximity_info.h"
+#include "traversal_frontier.h"
+#include "words_priority_queue.h"
 
 #ifndef NULL
 #define NULL 0
@@ -29,6 +31,7 @@
 
 namespace latinime {
 
+class ArrayTrie;
 class UnigramDictionary {
 
 public:
@@ -46,6 +49,9 @@ public:
     // Flag for terminal groups
     static const int FLAG_IS_TERMINAL = 0x10;
 
+    // Flag for the presence of the highest frequency of the words below a group with children
+    static const int FLAG_HAS_MAX_DESCENDANT_FREQUENCY = 0x08;
+
     // Flag for bigram presence
     static const int FLAG_HAS_BIGRAMS = 0x04;
 
@@ -67,11 +73,18 @@ public:
     UnigramDictionary(const uint8_t* const streamStart, int typedLetterMultipler,
             int fullWordMultiplier, int maxWordLength, int maxWords, int maxProximityChars,
             const bool isLatestDictVersion);
+    // Searches this dictionary too from now on. Returns false if too many were added.
+    bool addDictionary(const uint8_t* const streamStart);
     bool isValidWord(const uint16_t* const inWord, const int length) const;
     int getBigramPosition(int pos, unsigned short *word, int offset, int length) const;
     int getSuggestions(ProximityInfo *proximityInfo, const int *xcoordinates,
             const int *ycoordinates, const int *codes, const int codesSize, const int flags,
             unsigned short *outWords, int *frequencies);
+    // The count of the char groups the correction search of the last getSuggestions() call
+    // went through
+    int getVisitedGroupCount() const {
+        return mVisitedGroupCount;
+    }
     virtual ~UnigramDictionary();
 
 private:
@@ -85,10 +98,11 @@ private:
         const int codesBufferSize, const int flags, const int* codesSrc, const int codesRemain,
         const int currentDepth, int* codesDest, unsigned short* outWords, int* frequencies);
     void initSuggestions(ProximityInfo *proximityInfo, const int *xcoordinates,
-            const int *ycoordinates, const int *codes, const int codesSize,
-            unsigned short *outWords, int *frequencies);
-    void getSuggestionCandidates(const bool useFullEditDistance);
+            const int *ycoordinates, const int *codes, const int codesSize);
+    void getSuggestionCandidates(const bool useFullEditDistance, const bool resumesSearch);
+    void getSuggestionCandidatesFrom(const int outputIndex);
     bool addWord(unsigned short *word, int length, int frequency);
+    void selectTrie(const int index);
     void getSplitTwoWordsSuggestion(const int inputLength, Correction *correction);
     void getMissingSpaceWords(const int inputLength, const int missingSpacePos,
             Correction *correction, const bool useFullEditDistance);
@@ -101,12 +115,20 @@ private:
     bool processCurrentNode(const int initialPos,
             Correction *correction, int *newCount,
             int *newChildPosition, int *nextSiblingPosition);
-    int getMostFrequentWordLike(const int startInputIndex, const int inputLength,
-            unsigned short *word);
-    int getMostFrequentWordLikeInner(const uint16_t* const inWord, const int length,
-            short unsigned int* outWord);
+    // Same as processCurrentNode, for a dictionary in the array format
+    bool processCurrentGroup(const int group, Correction *correction, int *newCount,
+            int *newFirstChild, int *nextSibling);
+    void clearSplitWordsLike();
+    int getFirstWordLike(const int length, const unsigned short **outWord);
+    int getSecondWordLike(const int startInputIndex, const int length,
+            const unsigned short **outWord);
+    void getMostFrequentWordsLike(const int startInputIndex, const int minLength,
+            const int maxLength, int *outFreqs, unsigned short *outWords);
+    void getMostFrequentWordsLikeInner(const uint16_t* const inWord, const int minLength,
+            const int length, int *outFreqs, unsigned short *outWords);
+    void getMostFrequentWordsLikeInArrayTrie(const uint16_t* const inWord, const int minLength,
+            const int length, int *outFreqs, unsigned short *outWords);
 
-    const uint8_t* const DICT_ROOT;
     const int MAX_WORD_LENGTH;
     const int MAX_WORDS;
     const int MAX_PROXIMITY_CHARS;
@@ -126,14 +148,40 @@ private:
         USE_FULL_EDIT_DISTANCE = 0x2
     };
     static const struct digraph_t { int first; int second; } GERMAN_UMLAUT_DIGRAPHS[];
+    static const int NOT_LOOKED_UP = -2;
+    static const int NOT_A_GROUP_POS = -1;
+
+    // A dictionary searched by this one, with the frontier of its last search
+    struct Trie {
+        const uint8_t* mRoot;
+        // Only for a dictionary in the array format, NULL otherwise
+        const ArrayTrie *mArrayTrie;
+        TraversalFrontier *mTraversalFrontier;
+    };
+
+    // The first dictionary is the one this was created with. They are all searched with the same
+    // correction, into the same queue, in order.
+    Trie mTries[MAX_MERGED_DICTIONARIES];
+    int mTrieCount;
+    // The fields of the trie being searched
+    const uint8_t* mDictRoot;
+    const ArrayTrie *mArrayTrie;
+    TraversalFrontier *mTraversalFrontier;
 
-    int *mFrequencies;
-    unsigned short *mOutputChars;
     ProximityInfo *mProximityInfo;
     Correction *mCorrection;
+    WordsPriorityQueue *mWordsPriorityQueue;
     int mInputLength;
+    int mVisitedGroupCount;
+
+    // The words like the beginnings and the ends of the input, for the split two words
+    // suggestions. The beginnings are indexed by length - 1 and the ends by start input index.
     // MAX_WORD_LENGTH_INTERNAL must be bigger than MAX_WORD_LENGTH
-    unsigned short mWord[MAX_WORD_LENGTH_INTERNAL];
+    bool mHasFirstWordsLike;
+    int mFirstWordLikeFreqs[MAX_WORD_LENGTH_INTERNAL];
+    unsigned short mFirstWordsLike[MAX_WORD_LENGTH_INTERNAL * MAX_WORD_LENGTH_INTERNAL];
+    int mSecondWordLikeFreqs[MAX_WORD_LENGTH_INTERNAL];
+    unsigned short mSecondWordsLike[MAX_WORD_LENGTH_INTERNAL * MAX_WORD_LENGTH_INTERNAL];
 
     int mStackChildCount[MAX_WORD_LENGTH_INTERNAL];// TODO: remove
     int mStackInputIndex[MAX_WORD_LENGTH_INTERNAL];// TODO: remove
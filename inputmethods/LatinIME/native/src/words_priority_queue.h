@@ -0,0 +1,245 @@
+/*
+ * Copyright (C) 2011 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LATINIME_WORDS_PRIORITY_QUEUE_H
+#define LATINIME_WORDS_PRIORITY_QUEUE_H
+
+#include <string.h>
+
+#include "defines.h"
+
+namespace latinime {
+
+// Keeps the best MAX_WORDS suggestions found during a search. The words live in a fixed arena
+// and are ordered by a min-heap of arena indices, so that adding a word costs O(log MAX_WORDS)
+// plus one copy of that word. The sorted output is only written once, by outputSuggestions().
+//
+// The result is the same as insertion into a sorted list: higher frequencies first, and words
+// with the same frequency in the order they were found. When the queue is full, a new word has
+// to beat the worst one strictly to get in. A word is only kept once: found again, by another
+// correction or in another of the merged dictionaries, it keeps the higher frequency. The words
+// in the queue are chained in a small hash table, so finding a copy costs a hash of the word and,
+// as a rule, a single comparison.
+class WordsPriorityQueue {
+public:
+    WordsPriorityQueue(int maxWords, int maxWordLength)
+            : MAX_WORDS(maxWords), MAX_WORD_LENGTH(maxWordLength),
+              HASH_MASK(hashTableSize(maxWords) - 1), mSize(0), mSequence(0) {
+        mSuggestedWords = new SuggestedWord[maxWords];
+        mWordBuffer = new unsigned short[maxWords * maxWordLength];
+        mHeap = new int[maxWords];
+        mHashTable = new int[HASH_MASK + 1];
+        clearHashTable();
+    }
+
+    ~WordsPriorityQueue() {
+        delete[] mHashTable;
+        delete[] mHeap;
+        delete[] mWordBuffer;
+        delete[] mSuggestedWords;
+    }
+
+    void clear() {
+        mSize = 0;
+        mSequence = 0;
+        clearHashTable();
+    }
+
+    int size() const {
+        return mSize;
+    }
+
+    // Returns the frequency a new word has to beat to be kept. A word without frequency is never
+    // suggested, so it's at least 0.
+    int getFrequencyThreshold() const {
+        if (MAX_WORDS <= 0) return S_INT_MAX;
+        return mSize < MAX_WORDS ? 0 : mSuggestedWords[mHeap[0]].mFrequency;
+    }
+
+    // Returns false if the word is not good enough to be kept.
+    bool push(const int frequency, const unsigned short *word, const int length) {
+        if (length > MAX_WORD_LENGTH || MAX_WORDS <= 0) return false;
+        const bool isFull = mSize >= MAX_WORDS;
+        // A copy of the word in the queue is at least as good as the worst word
+        if (isFull && frequency <= mSuggestedWords[mHeap[0]].mFrequency) return false;
+        const unsigned int hash = hashWord(word, length);
+        const int found = findWord(word, length, hash);
+        if (found >= 0) {
+            SuggestedWord *suggestedWord = &mSuggestedWords[found];
+            if (frequency <= suggestedWord->mFrequency) return false;
+            suggestedWord->mFrequency = frequency;
+            suggestedWord->mSequence = mSequence++;
+            siftDown(suggestedWord->mHeapPos);
+            return true;
+        }
+        int index;
+        if (!isFull) {
+            index = mSize;
+            mHeap[mSize] = index;
+            mSuggestedWords[index].mHeapPos = mSize++;
+        } else {
+            // Replace the worst word in place
+            index = mHeap[0];
+            unlinkWord(index);
+        }
+        SuggestedWord *suggestedWord = &mSuggestedWords[index];
+        suggestedWord->mFrequency = frequency;
+        suggestedWord->mSequence = mSequence++;
+        suggestedWord->mLength = length;
+        suggestedWord->mHash = hash;
+        memcpy(mWordBuffer + index * MAX_WORD_LENGTH, word, length * sizeof(word[0]));
+        const int bucket = hash & HASH_MASK;
+        suggestedWord->mNext = mHashTable[bucket];
+        mHashTable[bucket] = index;
+        if (isFull) {
+            siftDown(0);
+        } else {
+            siftUp(mSize - 1);
+        }
+        return true;
+    }
+
+    // Writes the words in decreasing order of frequency, each into a row of MAX_WORD_LENGTH
+    // chars, zero-terminated if shorter. The queue is empty afterwards. Returns the word count.
+    int outputSuggestions(int *frequencies, unsigned short *outputChars) {
+        const int count = mSize;
+        // Popping gives the worst word first, which goes to the last row
+        while (mSize > 0) {
+            const int index = mHeap[0];
+            const SuggestedWord *suggestedWord = &mSuggestedWords[index];
+            const int row = mSize - 1;
+            frequencies[row] = suggestedWord->mFrequency;
+            unsigned short *dest = outputChars + row * MAX_WORD_LENGTH;
+            memcpy(dest, mWordBuffer + index * MAX_WORD_LENGTH,
+                    suggestedWord->mLength * sizeof(dest[0]));
+            if (suggestedWord->mLength < MAX_WORD_LENGTH) {
+                dest[suggestedWord->mLength] = 0;
+            }
+            mHeap[0] = mHeap[--mSize];
+            mSuggestedWords[mHeap[0]].mHeapPos = 0;
+            siftDown(0);
+        }
+        mSequence = 0;
+        clearHashTable();
+        return count;
+    }
+
+private:
+    struct SuggestedWord {
+        int mFrequency;
+        unsigned int mSequence;
+        int mLength;
+        unsigned int mHash;
+        // Position in mHeap
+        int mHeapPos;
+        // Next arena index in the same hash bucket, or -1
+        int mNext;
+    };
+
+    // A power of two with at least two buckets per word
+    static int hashTableSize(const int maxWords) {
+        int size = 1;
+        while (size < 2 * maxWords) size <<= 1;
+        return size;
+    }
+
+    static unsigned int hashWord(const unsigned short *word, const int length) {
+        unsigned int hash = 0;
+        for (int i = 0; i < length; ++i) {
+            hash = hash * 31 + word[i];
+        }
+        return hash ^ (hash >> 16);
+    }
+
+    void clearHashTable() {
+        memset(mHashTable, -1, (HASH_MASK + 1) * sizeof(mHashTable[0]));
+    }
+
+    // The worst word is the least frequent one, and the last found among equals
+    inline bool isWorse(const int indexA, const int indexB) const {
+        const SuggestedWord *a = &mSuggestedWords[indexA];
+        const SuggestedWord *b = &mSuggestedWords[indexB];
+        if (a->mFrequency != b->mFrequency) return a->mFrequency < b->mFrequency;
+        return a->mSequence > b->mSequence;
+    }
+
+    // Returns the arena index of the word, or -1 if it's not in the queue
+    int findWord(const unsigned short *word, const int length, const unsigned int hash) const {
+        for (int index = mHashTable[hash & HASH_MASK]; index >= 0;
+                index = mSuggestedWords[index].mNext) {
+            const SuggestedWord *suggestedWord = &mSuggestedWords[index];
+            if (suggestedWord->mHash == hash && suggestedWord->mLength == length && 0 == memcmp(
+                    mWordBuffer + index * MAX_WORD_LENGTH, word, length * sizeof(word[0]))) {
+                return index;
+            }
+        }
+        return -1;
+    }
+
+    // Takes the word at the arena index out of its hash bucket
+    void unlinkWord(const int index) {
+        int *link = &mHashTable[mSuggestedWords[index].mHash & HASH_MASK];
+        while (*link != index) {
+            link = &mSuggestedWords[*link].mNext;
+        }
+        *link = mSuggestedWords[index].mNext;
+    }
+
+    inline void swapHeap(const int posA, const int posB) {
+        const int tmp = mHeap[posA];
+        mHeap[posA] = mHeap[posB];
+        mHeap[posB] = tmp;
+        mSuggestedWords[mHeap[posA]].mHeapPos = posA;
+        mSuggestedWords[mHeap[posB]].mHeapPos = posB;
+    }
+
+    void siftUp(int pos) {
+        while (pos > 0) {
+            const int parent = (pos - 1) / 2;
+            if (!isWorse(mHeap[pos], mHeap[parent])) break;
+            swapHeap(pos, parent);
+            pos = parent;
+        }
+    }
+
+    void siftDown(int pos) {
+        while (true) {
+            int worst = pos;
+            const int left = 2 * pos + 1;
+            const int right = left + 1;
+            if (left < mSize && isWorse(mHeap[left], mHeap[worst])) worst = left;
+            if (right < mSize && isWorse(mHeap[right], mHeap[worst])) worst = right;
+            if (worst == pos) break;
+            swapHeap(pos, worst);
+            pos = worst;
+        }
+    }
+
+    const int MAX_WORDS;
+    const int MAX_WORD_LENGTH;
+    const int HASH_MASK;
+    SuggestedWord *mSuggestedWords;
+    unsigned short *mWordBuffer;
+    // Arena indices, worst word first
+    int *mHeap;
+    // Arena index of the first word in each bucket, or -1
+    int *mHashTable;
+    int mSize;
+    unsigned int mSequence;
+};
+} // namespace latinime
+
+#endif // LATINIME_WORDS_PRIORITY_QUEUE_H
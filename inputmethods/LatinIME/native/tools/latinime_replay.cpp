@@ -0,0 +1,619 @@
+/*
+ * Copyright (C) 2012 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Replays recorded tap sequences through the native suggestion code on the build host, and
+// reports the latency of the queries, the char groups they visited and how often the intended
+// word was suggested. The dictionaries, the layout and the corpus are read before the clock
+// starts, so only Dictionary::getSuggestions is timed. Every keystroke of a word is a query, as
+// while typing, unless -f is given; the accuracy is that of the last one.
+//
+// Usage: latinime_replay [options] dictionary [more dictionaries] < corpus
+//
+// The corpus has one word per line: the word that was meant, then the taps, each one "x,y" or
+// "x,y,code" where code is the key the tap was recorded on. The codes of a tap are that key,
+// or the one under it, then the keys near it, as KeyDetector finds them. A line with only a
+// word is typed at the centers of its keys. Lines starting with # are ignored, and so are lines
+// with a tap off the layout. replay_corpus.txt is a corpus for the default layout.
+//
+// The layout file given with -l has a line "keyboard width height [gridWidth gridHeight]", then
+// one line "key code x y width height [sweetSpotX sweetSpotY sweetSpotRadius]" per key. The
+// default is a QWERTY phone layout without sweet spots.
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "binary_format.h"
+#include "defines.h"
+#include "dictionary.h"
+#include "proximity_info.h"
+
+namespace latinime {
+
+// The values BinaryDictionary and ProximityInfo pass to the native code
+static const int TYPED_LETTER_MULTIPLIER = 2;
+static const int FULL_WORD_SCORE_MULTIPLIER = 2;
+static const int REPLAY_MAX_WORD_LENGTH = 48;
+static const int REPLAY_MAX_WORDS = 18;
+static const int MAX_PROXIMITY_CHARS_SIZE = 16;
+static const int DEFAULT_GRID_WIDTH = 32;
+static const int DEFAULT_GRID_HEIGHT = 16;
+// Key widths from a cell center to search for the keys of the cell, as in ProximityInfo.java
+static const float SEARCH_DISTANCE = 1.2f;
+// As in KeyDetector.java
+static const int MAX_NEARBY_KEYS = 12;
+static const int CODE_SPACE = ' ';
+static const int USE_FULL_EDIT_DISTANCE_FLAG = 0x2;
+
+static const int MAX_KEYS = 128;
+static const int MAX_LINE_LENGTH = 4096;
+static const int NOT_A_KEY = -1;
+
+struct Key {
+    int mCode;
+    int mX;
+    int mY;
+    int mWidth;
+    int mHeight;
+    float mSweetSpotX;
+    float mSweetSpotY;
+    float mSweetSpotRadius;
+};
+
+struct Layout {
+    int mWidth;
+    int mHeight;
+    int mGridWidth;
+    int mGridHeight;
+    bool mHasSweetSpots;
+    int mKeyCount;
+    Key mKeys[MAX_KEYS];
+};
+
+// A word of the corpus, with the codes and the coordinates of its taps
+struct Query {
+    unsigned short mWord[REPLAY_MAX_WORD_LENGTH];
+    int mWordLength;
+    int mTapCount;
+    int mCodes[REPLAY_MAX_WORD_LENGTH * MAX_PROXIMITY_CHARS_SIZE];
+    int mXs[REPLAY_MAX_WORD_LENGTH];
+    int mYs[REPLAY_MAX_WORD_LENGTH];
+};
+
+struct Options {
+    const char *mLayoutPath;
+    int mFlags;
+    int mRepeatCount;
+    bool mFullWordsOnly;
+    bool mVerbose;
+};
+
+static int squaredDistanceToEdge(const Key *key, const int x, const int y) {
+    const int edgeX = x < key->mX ? key->mX : (x > key->mX + key->mWidth
+            ? key->mX + key->mWidth : x);
+    const int edgeY = y < key->mY ? key->mY : (y > key->mY + key->mHeight
+            ? key->mY + key->mHeight : y);
+    return (x - edgeX) * (x - edgeX) + (y - edgeY) * (y - edgeY);
+}
+
+static bool isOnKey(const Key *key, const int x, const int y) {
+    return x >= key->mX && x < key->mX + key->mWidth && y >= key->mY
+            && y < key->mY + key->mHeight;
+}
+
+static int getMostCommonKeyWidth(const Layout *layout) {
+    int bestWidth = 0;
+    int bestCount = 0;
+    for (int i = 0; i < layout->mKeyCount; ++i) {
+        int count = 0;
+        for (int j = 0; j < layout->mKeyCount; ++j) {
+            if (layout->mKeys[j].mWidth == layout->mKeys[i].mWidth) ++count;
+        }
+        if (count > bestCount) {
+            bestCount = count;
+            bestWidth = layout->mKeys[i].mWidth;
+        }
+    }
+    return bestWidth;
+}
+
+static void addKey(Layout *layout, const int code, const int x, const int y, const int width,
+        const int height) {
+    if (layout->mKeyCount >= MAX_KEYS) return;
+    Key *key = &layout->mKeys[layout->mKeyCount++];
+    key->mCode = code;
+    key->mX = x;
+    key->mY = y;
+    key->mWidth = width;
+    key->mHeight = height;
+    key->mSweetSpotX = x + width / 2.0f;
+    key->mSweetSpotY = y + height / 2.0f;
+    key->mSweetSpotRadius = 0;
+}
+
+static void makeDefaultLayout(Layout *layout) {
+    static const char *ROWS[] = { "qwertyuiop", "asdfghjkl", "zxcvbnm'" };
+    static const int KEY_WIDTH = 48;
+    static const int KEY_HEIGHT = 75;
+    layout->mWidth = 480;
+    layout->mHeight = 4 * KEY_HEIGHT;
+    layout->mGridWidth = DEFAULT_GRID_WIDTH;
+    layout->mGridHeight = DEFAULT_GRID_HEIGHT;
+    layout->mHasSweetSpots = false;
+    layout->mKeyCount = 0;
+    for (int row = 0; row < 3; ++row) {
+        const int length = strlen(ROWS[row]);
+        const int left = (layout->mWidth - length * KEY_WIDTH) / 2;
+        for (int i = 0; i < length; ++i) {
+            addKey(layout, ROWS[row][i], left + i * KEY_WIDTH, row * KEY_HEIGHT, KEY_WIDTH,
+                    KEY_HEIGHT);
+        }
+    }
+    addKey(layout, CODE_SPACE, 2 * KEY_WIDTH, 3 * KEY_HEIGHT, 5 * KEY_WIDTH, KEY_HEIGHT);
+}
+
+static bool readLayout(const char *path, Layout *layout) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        fprintf(stderr, "Can't open the layout %s\n", path);
+        return false;
+    }
+    layout->mWidth = 0;
+    layout->mGridWidth = DEFAULT_GRID_WIDTH;
+    layout->mGridHeight = DEFAULT_GRID_HEIGHT;
+    layout->mHasSweetSpots = false;
+    layout->mKeyCount = 0;
+    char line[MAX_LINE_LENGTH];
+    while (fgets(line, sizeof(line), file)) {
+        int code, x, y, width, height;
+        float sweetSpotX, sweetSpotY, sweetSpotRadius;
+        if (1 <= sscanf(line, "keyboard %d %d %d %d", &layout->mWidth, &layout->mHeight,
+                &layout->mGridWidth, &layout->mGridHeight)) {
+            continue;
+        }
+        const int fieldCount = sscanf(line, "key %d %d %d %d %d %f %f %f", &code, &x, &y, &width,
+                &height, &sweetSpotX, &sweetSpotY, &sweetSpotRadius);
+        if (fieldCount < 5) continue;
+        addKey(layout, code, x, y, width, height);
+        if (8 == fieldCount) {
+            Key *key = &layout->mKeys[layout->mKeyCount - 1];
+            key->mSweetSpotX = sweetSpotX;
+            key->mSweetSpotY = sweetSpotY;
+            key->mSweetSpotRadius = sweetSpotRadius;
+            layout->mHasSweetSpots = true;
+        }
+    }
+    fclose(file);
+    if (layout->mWidth <= 0 || layout->mKeyCount <= 0) {
+        fprintf(stderr, "No keyboard or no keys in the layout %s\n", path);
+        return false;
+    }
+    return true;
+}
+
+// Same as ProximityInfo.computeNearestNeighbors and setProximityInfo in ProximityInfo.java
+static ProximityInfo *createProximityInfo(const Layout *layout) {
+    const int gridSize = layout->mGridWidth * layout->mGridHeight;
+    const int cellWidth = (layout->mWidth + layout->mGridWidth - 1) / layout->mGridWidth;
+    const int cellHeight = (layout->mHeight + layout->mGridHeight - 1) / layout->mGridHeight;
+    const int thresholdBase = (int)(getMostCommonKeyWidth(layout) * SEARCH_DISTANCE);
+    const int threshold = thresholdBase * thresholdBase;
+    uint32_t *proximityChars = new uint32_t[gridSize * MAX_PROXIMITY_CHARS_SIZE];
+    for (int cell = 0; cell < gridSize; ++cell) {
+        const int centerX = (cell % layout->mGridWidth) * cellWidth + cellWidth / 2;
+        const int centerY = (cell / layout->mGridWidth) * cellHeight + cellHeight / 2;
+        int count = 0;
+        for (int i = 0; i < layout->mKeyCount && count < MAX_PROXIMITY_CHARS_SIZE; ++i) {
+            if (squaredDistanceToEdge(&layout->mKeys[i], centerX, centerY) < threshold) {
+                proximityChars[cell * MAX_PROXIMITY_CHARS_SIZE + count++] =
+                        layout->mKeys[i].mCode;
+            }
+        }
+        for (; count < MAX_PROXIMITY_CHARS_SIZE; ++count) {
+            proximityChars[cell * MAX_PROXIMITY_CHARS_SIZE + count] = (uint32_t)NOT_A_CHARACTER;
+        }
+    }
+
+    int32_t xs[MAX_KEYS], ys[MAX_KEYS], widths[MAX_KEYS], heights[MAX_KEYS], codes[MAX_KEYS];
+    float sweetSpotXs[MAX_KEYS], sweetSpotYs[MAX_KEYS], sweetSpotRadii[MAX_KEYS];
+    for (int i = 0; i < layout->mKeyCount; ++i) {
+        const Key *key = &layout->mKeys[i];
+        xs[i] = key->mX;
+        ys[i] = key->mY;
+        widths[i] = key->mWidth;
+        heights[i] = key->mHeight;
+        codes[i] = key->mCode;
+        sweetSpotXs[i] = key->mSweetSpotX;
+        sweetSpotYs[i] = key->mSweetSpotY;
+        sweetSpotRadii[i] = key->mSweetSpotRadius;
+    }
+    const bool hasSweetSpots = layout->mHasSweetSpots;
+    ProximityInfo *proximityInfo = new ProximityInfo(MAX_PROXIMITY_CHARS_SIZE, layout->mWidth,
+            layout->mHeight, layout->mGridWidth, layout->mGridHeight, proximityChars,
+            layout->mKeyCount, xs, ys, widths, heights, codes,
+            hasSweetSpots ? sweetSpotXs : NULL, hasSweetSpots ? sweetSpotYs : NULL,
+            hasSweetSpots ? sweetSpotRadii : NULL);
+    delete[] proximityChars;
+    return proximityInfo;
+}
+
+// Same as KeyDetector.getKeyIndexAndNearbyCodes, with the proximity threshold LatinKeyboardView
+// sets. A recorded code goes first, even if the tap is not on its key.
+static void getNearbyCodes(const Layout *layout, const int x, const int y,
+        const int recordedCode, int *outCodes) {
+    const int keyWidth = getMostCommonKeyWidth(layout);
+    const int threshold = keyWidth * keyWidth;
+    int indices[MAX_NEARBY_KEYS];
+    int distances[MAX_NEARBY_KEYS];
+    for (int i = 0; i < MAX_NEARBY_KEYS; ++i) {
+        indices[i] = NOT_A_KEY;
+        distances[i] = S_INT_MAX;
+    }
+    for (int i = 0; i < layout->mKeyCount; ++i) {
+        const Key *key = &layout->mKeys[i];
+        const bool onKey = isOnKey(key, x, y);
+        const int distance = squaredDistanceToEdge(key, x, y);
+        if (!onKey && distance >= threshold) continue;
+        for (int pos = 0; pos < MAX_NEARBY_KEYS; ++pos) {
+            if (distance < distances[pos] || (distance == distances[pos] && onKey)) {
+                memmove(indices + pos + 1, indices + pos,
+                        (MAX_NEARBY_KEYS - pos - 1) * sizeof(indices[0]));
+                memmove(distances + pos + 1, distances + pos,
+                        (MAX_NEARBY_KEYS - pos - 1) * sizeof(distances[0]));
+                indices[pos] = i;
+                distances[pos] = distance;
+                break;
+            }
+        }
+    }
+    int count = 0;
+    if (recordedCode > 0) outCodes[count++] = recordedCode;
+    for (int i = 0; i < MAX_NEARBY_KEYS && count < MAX_PROXIMITY_CHARS_SIZE; ++i) {
+        if (NOT_A_KEY == indices[i]) break;
+        const int code = layout->mKeys[indices[i]].mCode;
+        // Non-letter keys are not nearby keys
+        if (code < CODE_SPACE || code == recordedCode) continue;
+        outCodes[count++] = code;
+    }
+    for (; count < MAX_PROXIMITY_CHARS_SIZE; ++count) {
+        outCodes[count] = NOT_A_CHARACTER;
+    }
+}
+
+// Decodes the UTF-8 word at the start of line into outWord, and returns the rest of the line
+static char *readWord(char *line, unsigned short *outWord, int *outLength) {
+    unsigned char *p = (unsigned char *)line;
+    while (*p == ' ' || *p == '\t') ++p;
+    int length = 0;
+    while (*p > ' ' && length < REPLAY_MAX_WORD_LENGTH - 1) {
+        int c = *p++;
+        if (c >= 0xE0 && p[0] && p[1]) {
+            c = ((c & 0x0F) << 12) | ((p[0] & 0x3F) << 6) | (p[1] & 0x3F);
+            p += 2;
+        } else if (c >= 0xC0 && p[0]) {
+            c = ((c & 0x1F) << 6) | (p[0] & 0x3F);
+            p += 1;
+        }
+        outWord[length++] = c;
+    }
+    outWord[length] = 0;
+    *outLength = length;
+    return (char *)p;
+}
+
+static const Key *findKey(const Layout *layout, const int code) {
+    for (int i = 0; i < layout->mKeyCount; ++i) {
+        if (layout->mKeys[i].mCode == code) return &layout->mKeys[i];
+    }
+    return NULL;
+}
+
+// Returns false for a line without a word, or with taps off the layout
+static bool parseQuery(const Layout *layout, char *line, Query *query) {
+    char *taps = readWord(line, query->mWord, &query->mWordLength);
+    if (query->mWordLength <= 0 || '#' == query->mWord[0]) return false;
+    query->mTapCount = 0;
+    char *token = strtok(taps, " \t\r\n");
+    while (token && query->mTapCount < REPLAY_MAX_WORD_LENGTH - 1) {
+        int x, y;
+        int code = NOT_A_CHARACTER;
+        if (sscanf(token, "%d,%d,%d", &x, &y, &code) < 2) return false;
+        // The proximity grid only covers the layout
+        if (x < 0 || x >= layout->mWidth || y < 0 || y >= layout->mHeight) {
+            fprintf(stderr, "Tap %d,%d is off the layout, skipping the line\n", x, y);
+            return false;
+        }
+        const int i = query->mTapCount++;
+        query->mXs[i] = x;
+        query->mYs[i] = y;
+        getNearbyCodes(layout, x, y, code, query->mCodes + i * MAX_PROXIMITY_CHARS_SIZE);
+        token = strtok(NULL, " \t\r\n");
+    }
+    if (query->mTapCount > 0) return true;
+    // Typed at the centers of the keys
+    for (int i = 0; i < query->mWordLength; ++i) {
+        const Key *key = findKey(layout, query->mWord[i]);
+        if (!key) return false;
+        query->mXs[i] = key->mX + key->mWidth / 2;
+        query->mYs[i] = key->mY + key->mHeight / 2;
+        getNearbyCodes(layout, query->mXs[i], query->mYs[i], key->mCode,
+                query->mCodes + i * MAX_PROXIMITY_CHARS_SIZE);
+    }
+    query->mTapCount = query->mWordLength;
+    return true;
+}
+
+static void *readFile(const char *path, int *outSize) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return NULL;
+    fseek(file, 0, SEEK_END);
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    void *buffer = malloc(size);
+    if (buffer && 1 != fread(buffer, size, 1, file)) {
+        free(buffer);
+        buffer = NULL;
+    }
+    fclose(file);
+    *outSize = size;
+    return buffer;
+}
+
+static double getTimeInMicroseconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+static int compareDoubles(const void *a, const void *b) {
+    const double x = *(const double *)a;
+    const double y = *(const double *)b;
+    return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static double getPercentile(const double *sortedValues, const int count, const int percent) {
+    if (count <= 0) return 0;
+    const int index = (count * percent + 99) / 100 - 1;
+    return sortedValues[index < 0 ? 0 : index];
+}
+
+static bool isSameWord(const unsigned short *word, const int length,
+        const unsigned short *suggestion) {
+    for (int i = 0; i < length; ++i) {
+        if (word[i] != suggestion[i]) return false;
+    }
+    return length >= REPLAY_MAX_WORD_LENGTH || 0 == suggestion[length];
+}
+
+// Whether the keys the taps are on are the intended word
+static bool isTypedWord(const Query *query) {
+    if (query->mTapCount != query->mWordLength) return false;
+    for (int i = 0; i < query->mTapCount; ++i) {
+        if (Dictionary::toBaseLowerCase(query->mCodes[i * MAX_PROXIMITY_CHARS_SIZE])
+                != Dictionary::toBaseLowerCase(query->mWord[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void printWord(const unsigned short *word) {
+    for (int i = 0; i < REPLAY_MAX_WORD_LENGTH && word[i]; ++i) {
+        const int c = word[i];
+        if (c < 0x80) {
+            putchar(c);
+        } else if (c < 0x800) {
+            putchar(0xC0 | (c >> 6));
+            putchar(0x80 | (c & 0x3F));
+        } else {
+            putchar(0xE0 | (c >> 12));
+            putchar(0x80 | ((c >> 6) & 0x3F));
+            putchar(0x80 | (c & 0x3F));
+        }
+    }
+}
+
+static void usage(const char *name) {
+    fprintf(stderr, "Usage: %s [options] dictionary [more dictionaries] < corpus\n"
+            "  -l layout  keyboard layout, QWERTY by default\n"
+            "  -e         use the full edit distance\n"
+            "  -f         query full words only, not every keystroke\n"
+            "  -r count   replay the corpus count times, 1 by default\n"
+            "  -v         print the suggestions of each word\n", name);
+}
+
+static int replay(const Options *options, Dictionary *dictionary,
+        ProximityInfo *proximityInfo, const Query *queries, const int queryCount) {
+    int maxQueryCount = 0;
+    for (int i = 0; i < queryCount; ++i) {
+        maxQueryCount += options->mFullWordsOnly ? 1 : queries[i].mTapCount;
+    }
+    maxQueryCount *= options->mRepeatCount;
+    double *latencies = new double[maxQueryCount > 0 ? maxQueryCount : 1];
+    unsigned short outWords[REPLAY_MAX_WORD_LENGTH * REPLAY_MAX_WORDS];
+    int frequencies[REPLAY_MAX_WORDS];
+    int count = 0;
+    long long visitedGroupCount = 0;
+    int maxVisitedGroupCount = 0;
+    int firstCount = 0;
+    int topThreeCount = 0;
+    int suggestedCount = 0;
+    uint64_t checksum = 14695981039346656037ULL;
+
+    for (int repeat = 0; repeat < options->mRepeatCount; ++repeat) {
+        for (int i = 0; i < queryCount; ++i) {
+            const Query *query = &queries[i];
+            const int firstLength = options->mFullWordsOnly ? query->mTapCount : 1;
+            int suggestionCount = 0;
+            for (int length = firstLength; length <= query->mTapCount; ++length) {
+                const double start = getTimeInMicroseconds();
+                suggestionCount = dictionary->getSuggestions(proximityInfo,
+                        (int *)query->mXs, (int *)query->mYs, (int *)query->mCodes, length,
+                        options->mFlags, outWords, frequencies);
+                latencies[count++] = getTimeInMicroseconds() - start;
+                const int visited = dictionary->getVisitedGroupCount();
+                visitedGroupCount += visited;
+                if (visited > maxVisitedGroupCount) maxVisitedGroupCount = visited;
+            }
+            if (repeat > 0) continue;
+
+            // Words that are the same as typed are not suggested, as the typed word is shown
+            // anyway: that is the intended word coming first
+            int rank = isTypedWord(query) && dictionary->isValidWord(
+                    (unsigned short *)query->mWord, query->mWordLength) ? 0 : -1;
+            for (int j = 0; j < suggestionCount; ++j) {
+                const unsigned short *suggestion = outWords + j * REPLAY_MAX_WORD_LENGTH;
+                for (int k = 0; k < REPLAY_MAX_WORD_LENGTH && suggestion[k]; ++k) {
+                    checksum = (checksum ^ suggestion[k]) * 1099511628211ULL;
+                }
+                checksum = (checksum ^ frequencies[j]) * 1099511628211ULL;
+                if (rank < 0 && isSameWord(query->mWord, query->mWordLength, suggestion)) {
+                    rank = j;
+                }
+            }
+            if (0 == rank) ++firstCount;
+            if (rank >= 0 && rank < 3) ++topThreeCount;
+            if (rank >= 0) ++suggestedCount;
+            if (options->mVerbose) {
+                printWord(query->mWord);
+                printf(":");
+                for (int j = 0; j < suggestionCount && j < 5; ++j) {
+                    printf(" ");
+                    printWord(outWords + j * REPLAY_MAX_WORD_LENGTH);
+                    printf("(%d)", frequencies[j]);
+                }
+                printf("\n");
+            }
+        }
+    }
+
+    double total = 0;
+    for (int i = 0; i < count; ++i) total += latencies[i];
+    qsort(latencies, count, sizeof(latencies[0]), compareDoubles);
+    printf("queries %d, total %.1f ms, mean %.1f us\n", count, total / 1000,
+            count > 0 ? total / count : 0);
+    printf("latency p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us\n",
+            getPercentile(latencies, count, 50), getPercentile(latencies, count, 90),
+            getPercentile(latencies, count, 99), count > 0 ? latencies[count - 1] : 0);
+    printf("groups visited: mean %.1f, max %d\n",
+            count > 0 ? (double)visitedGroupCount / count : 0, maxVisitedGroupCount);
+    printf("words %d: first %.1f%%, top 3 %.1f%%, suggested %.1f%%\n", queryCount,
+            queryCount > 0 ? 100.0 * firstCount / queryCount : 0,
+            queryCount > 0 ? 100.0 * topThreeCount / queryCount : 0,
+            queryCount > 0 ? 100.0 * suggestedCount / queryCount : 0);
+    printf("checksum %016llx\n", (unsigned long long)checksum);
+    delete[] latencies;
+    return 0;
+}
+
+static int runReplay(int argc, char **argv) {
+    Options options;
+    options.mLayoutPath = NULL;
+    options.mFlags = 0;
+    options.mRepeatCount = 1;
+    options.mFullWordsOnly = false;
+    options.mVerbose = false;
+    int argIndex = 1;
+    for (; argIndex < argc && '-' == argv[argIndex][0]; ++argIndex) {
+        const char *option = argv[argIndex];
+        if (0 == strcmp(option, "-l") && argIndex + 1 < argc) {
+            options.mLayoutPath = argv[++argIndex];
+        } else if (0 == strcmp(option, "-e")) {
+            options.mFlags |= USE_FULL_EDIT_DISTANCE_FLAG;
+        } else if (0 == strcmp(option, "-f")) {
+            options.mFullWordsOnly = true;
+        } else if (0 == strcmp(option, "-r") && argIndex + 1 < argc) {
+            options.mRepeatCount = atoi(argv[++argIndex]);
+        } else if (0 == strcmp(option, "-v")) {
+            options.mVerbose = true;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (argIndex >= argc || options.mRepeatCount < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Layout *layout = new Layout;
+    if (options.mLayoutPath) {
+        if (!readLayout(options.mLayoutPath, layout)) return 1;
+    } else {
+        makeDefaultLayout(layout);
+    }
+
+    Dictionary *dictionary = NULL;
+    // The dictionary does not own the buffers
+    void *dicts[MAX_MERGED_DICTIONARIES];
+    int dictCount = 0;
+    for (; argIndex < argc; ++argIndex) {
+        if (dictCount >= MAX_MERGED_DICTIONARIES) {
+            fprintf(stderr, "Can't search more than %d dictionaries\n", MAX_MERGED_DICTIONARIES);
+            return 1;
+        }
+        int dictSize = 0;
+        void *dict = readFile(argv[argIndex], &dictSize);
+        dicts[dictCount++] = dict;
+        if (!dict) {
+            fprintf(stderr, "Can't read the dictionary %s\n", argv[argIndex]);
+            return 1;
+        }
+        if (BinaryFormat::UNKNOWN_FORMAT == BinaryFormat::detectFormat((uint8_t *)dict)) {
+            fprintf(stderr, "The dictionary %s has an unknown format\n", argv[argIndex]);
+            return 1;
+        }
+        if (!dictionary) {
+            dictionary = new Dictionary(dict, dictSize, 0, 0, TYPED_LETTER_MULTIPLIER,
+                    FULL_WORD_SCORE_MULTIPLIER, REPLAY_MAX_WORD_LENGTH, REPLAY_MAX_WORDS,
+                    MAX_PROXIMITY_CHARS_SIZE);
+        } else if (!dictionary->addDictionary(dict, dictSize, 0, 0)) {
+            fprintf(stderr, "Can't add the dictionary %s\n", argv[argIndex]);
+            return 1;
+        }
+    }
+
+    int queryCapacity = 1024;
+    int queryCount = 0;
+    Query *queries = (Query *)malloc(queryCapacity * sizeof(Query));
+    char line[MAX_LINE_LENGTH];
+    while (fgets(line, sizeof(line), stdin)) {
+        if (queryCount >= queryCapacity) {
+            queryCapacity *= 2;
+            queries = (Query *)realloc(queries, queryCapacity * sizeof(Query));
+        }
+        if (parseQuery(layout, line, &queries[queryCount])) ++queryCount;
+    }
+
+    ProximityInfo *proximityInfo = createProximityInfo(layout);
+    const int result = replay(&options, dictionary, proximityInfo, queries, queryCount);
+    delete proximityInfo;
+    delete dictionary;
+    for (int i = 0; i < dictCount; ++i) {
+        free(dicts[i]);
+    }
+    free(queries);
+    delete layout;
+    return result;
+}
+
+} // namespace latinime
+
+int main(int argc, char **argv) {
+    return latinime::runReplay(argc, argv);
+}
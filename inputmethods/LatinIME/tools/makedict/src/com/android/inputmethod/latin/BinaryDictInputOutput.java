@@ -20,6 +20,7 @@ import com.android.inputmethod.latin.FusionDictionary.CharGroup;
 import com.android.inputmethod.latin.FusionDictionary.Node;
 import com.android.inputmethod.latin.FusionDictionary.WeightedString;
 
+import java.io.ByteArrayOutputStream;
 import java.io.FileNotFoundException;
 import java.io.IOException;
 import java.io.OutputStream;
@@ -44,7 +45,7 @@ public class BinaryDictInputOutput {
      * a |                                     11 = 3 bytes     : FLAG_GROUP_ADDRESS_TYPE_THREEBYTES
      * g | has several chars ?         1 bit, 1 = yes, 0 = no   : FLAG_HAS_MULTIPLE_CHARS
      * s | has a terminal ?            1 bit, 1 = yes, 0 = no   : FLAG_IS_TERMINAL
-     *   | reserved                    1 bit, 1 = yes, 0 = no
+     *   | has max descendant freq ?   1 bit, 1 = yes, 0 = no   : FLAG_HAS_MAX_DESCENDANT_FREQUENCY
      *   | has bigrams ?               1 bit, 1 = yes, 0 = no   : FLAG_HAS_BIGRAMS
      *
      * c | IF FLAG_HAS_MULTIPLE_CHARS
@@ -59,6 +60,10 @@ public class BinaryDictInputOutput {
      * e |   frequency                 1 byte
      * q |
      *
+     *   | IF FLAG_HAS_MAX_DESCENDANT_FREQUENCY
+     *   |   highest frequency of the words in the children, 1 byte
+     *   | // Set on all groups that have children
+     *
      * c | IF 00 = FLAG_GROUP_ADDRESS_TYPE_NOADDRESS = addressType
      * h |   // nothing
      * i | ELSIF 01 = FLAG_GROUP_ADDRESS_TYPE_ONEBYTE == addressType
@@ -107,9 +112,44 @@ public class BinaryDictInputOutput {
      *
      */
 
+    /* The array format, ARRAY_VERSION, has the same header, then the same char groups with each
+     * of their fields in an array of its own. The groups are numbered breadth first, so that
+     * the children of a group are consecutive, and a group is referred to by its index. The
+     * search reads the first char of all the groups of a node, and seldom more of most of them,
+     * so these chars are next to each other. All values are big endian.
+     *
+     * group count G                             3 bytes
+     * root group count                          3 bytes
+     * first char of each group                  G * 2 bytes
+     * flags of each group                       G * 1 byte, only FLAG_HAS_MULTIPLE_CHARS,
+     *                                                       FLAG_IS_TERMINAL and FLAG_HAS_BIGRAMS
+     * frequency of each group                   G * 1 byte, 0 if not a terminal
+     * max descendant frequency of each group    G * 1 byte, 0 if no children
+     * first child of each group, then G         (G + 1) * 3 bytes : the children of group i
+     *                                           are the groups from firstChild[i] to
+     *                                           firstChild[i + 1] excluded
+     * extra data offset of each group, then     (G + 1) * 3 bytes : the extra data of group i
+     * the size of the extra data                is from extraOffset[i] to extraOffset[i + 1]
+     * extra data
+     *
+     * The extra data of a group is:
+     *   | IF FLAG_HAS_MULTIPLE_CHARS
+     *   |   the chars after the first one       n * 2 bytes
+     *   |   end                                 2 bytes, = 0
+     *   | IF FLAG_HAS_BIGRAMS
+     *   |   bigram list, each one is:
+     *   |     frequency                         1 byte, 4 bits used
+     *   |     index of the target group         3 bytes
+     *
+     * Chars outside of the BMP can't be stored in this format.
+     */
+
     private static final int MAGIC_NUMBER = 0x78B1;
-    private static final int VERSION = 1;
+    // Version 2 adds the max descendant frequency, which version 1 readers would misread.
+    // Version 1 files have no such byte and read as before.
+    private static final int VERSION = 2;
     private static final int MAXIMUM_SUPPORTED_VERSION = VERSION;
+    private static final int ARRAY_VERSION = 3;
     // No options yet, reserved for future use.
     private static final int OPTIONS = 0;
 
@@ -126,6 +166,7 @@ public class BinaryDictInputOutput {
     private static final int FLAG_HAS_MULTIPLE_CHARS = 0x20;
 
     private static final int FLAG_IS_TERMINAL = 0x10;
+    private static final int FLAG_HAS_MAX_DESCENDANT_FREQUENCY = 0x08;
     private static final int FLAG_HAS_BIGRAMS = 0x04;
 
     private static final int FLAG_ATTRIBUTE_HAS_NEXT = 0x80;
@@ -142,6 +183,7 @@ public class BinaryDictInputOutput {
     private static final int GROUP_TERMINATOR_SIZE = 1;
     private static final int GROUP_FLAGS_SIZE = 1;
     private static final int GROUP_FREQUENCY_SIZE = 1;
+    private static final int GROUP_MAX_DESCENDANT_FREQUENCY_SIZE = 1;
     private static final int GROUP_MAX_ADDRESS_SIZE = 3;
     private static final int GROUP_ATTRIBUTE_FLAGS_SIZE = 1;
     private static final int GROUP_ATTRIBUTE_MAX_ADDRESS_SIZE = 3;
@@ -155,6 +197,12 @@ public class BinaryDictInputOutput {
 
     private static final int MAX_TERMINAL_FREQUENCY = 255;
 
+    private static final int ARRAY_CHAR_SIZE = 2;
+    private static final int ARRAY_INDEX_SIZE = 3;
+    private static final int ARRAY_CHARACTERS_TERMINATOR = 0;
+    private static final int MAX_ARRAY_CHARACTER = 0xFFFF;
+    private static final int MAX_ARRAY_INDEX = 0xFFFFFF;
+
     /**
      * A class grouping utility function for our specific character encoding.
      */
@@ -270,6 +318,8 @@ public class BinaryDictInputOutput {
         int size = getGroupCharactersSize(group) + GROUP_FLAGS_SIZE;
         // If terminal, one byte for the frequency
         if (group.isTerminal()) size += GROUP_FREQUENCY_SIZE;
+        // If it has children, one byte for the highest frequency below it
+        if (null != group.mChildren) size += GROUP_MAX_DESCENDANT_FREQUENCY_SIZE;
         size += GROUP_MAX_ADDRESS_SIZE; // For children address
         if (null != group.mBigrams) {
             for (WeightedString bigram : group.mBigrams) {
@@ -383,6 +433,7 @@ public class BinaryDictInputOutput {
             int groupSize = GROUP_FLAGS_SIZE + getGroupCharactersSize(group);
             if (group.isTerminal()) groupSize += GROUP_FREQUENCY_SIZE;
             if (null != group.mChildren) {
+                groupSize += GROUP_MAX_DESCENDANT_FREQUENCY_SIZE;
                 final int offsetBasePoint= groupSize + node.mCachedAddress + size;
                 final int offset = group.mChildren.mCachedAddress - offsetBasePoint;
                 groupSize += getByteSize(offset);
@@ -545,10 +596,31 @@ public class BinaryDictInputOutput {
                  throw new RuntimeException("Node with a strange address");
              }
         }
+        if (null != group.mChildren) flags |= FLAG_HAS_MAX_DESCENDANT_FREQUENCY;
         if (null != group.mBigrams) flags |= FLAG_HAS_BIGRAMS;
         return flags;
     }
 
+    /**
+     * Computes the highest frequency of the words in a node and below, and caches it in the
+     * 'mCachedMaxFrequency' member of the node and of all the nodes below it.
+     *
+     * @param node the node to compute the highest frequency of.
+     * @return the highest frequency, or 0 if there are no words.
+     */
+    private static int computeMaxFrequencies(Node node) {
+        int maxFrequency = 0;
+        for (CharGroup group : node.mData) {
+            if (group.mFrequency > maxFrequency) maxFrequency = group.mFrequency;
+            if (null != group.mChildren) {
+                final int childrenMaxFrequency = computeMaxFrequencies(group.mChildren);
+                if (childrenMaxFrequency > maxFrequency) maxFrequency = childrenMaxFrequency;
+            }
+        }
+        node.mCachedMaxFrequency = maxFrequency;
+        return maxFrequency;
+    }
+
     /**
      * Makes the flag value for an attribute.
      *
@@ -609,6 +681,7 @@ public class BinaryDictInputOutput {
                         + " : " + group.mFrequency);
             }
             if (group.mFrequency >= 0) groupAddress += GROUP_FREQUENCY_SIZE;
+            if (null != group.mChildren) groupAddress += GROUP_MAX_DESCENDANT_FREQUENCY_SIZE;
             final int childrenOffset = null == group.mChildren
                     ? NO_CHILDREN_ADDRESS : group.mChildren.mCachedAddress - groupAddress;
             byte flags = makeCharGroupFlags(group, groupAddress, childrenOffset);
@@ -620,6 +693,9 @@ public class BinaryDictInputOutput {
             if (group.mFrequency >= 0) {
                 buffer[index++] = (byte) group.mFrequency;
             }
+            if (null != group.mChildren) {
+                buffer[index++] = (byte) group.mChildren.mCachedMaxFrequency;
+            }
             final int shift = writeVariableAddress(buffer, index, childrenOffset);
             index += shift;
             groupAddress += shift;
@@ -745,6 +821,7 @@ public class BinaryDictInputOutput {
 
         MakedictLog.i("Computing addresses...");
         computeAddresses(dict, flatNodes);
+        computeMaxFrequencies(dict.mRoot);
         MakedictLog.i("Checking array...");
         checkFlatNodeArray(flatNodes);
 
@@ -763,6 +840,117 @@ public class BinaryDictInputOutput {
     }
 
 
+    /**
+     * Writes a value on a fixed number of bytes, in big-endian order.
+     *
+     * @param destination the stream to write to.
+     * @param value the value to write.
+     * @param size the number of bytes to write it on.
+     */
+    private static void writeFixedSize(final ByteArrayOutputStream destination, final int value,
+            final int size) {
+        for (int shift = (size - 1) * 8; shift >= 0; shift -= 8) {
+            destination.write(0xFF & (value >> shift));
+        }
+    }
+
+    /**
+     * Dumps a FusionDictionary to a file in the array format.
+     *
+     * This is the public entry point to write a dictionary in the array format. See the
+     * description of the format at the top of this file.
+     *
+     * @param destination the stream to write the binary data to.
+     * @param dict the dictionary to write.
+     */
+    public static void writeDictionaryArrays(OutputStream destination, FusionDictionary dict)
+            throws IOException {
+        MakedictLog.i("Numbering the groups...");
+        final ArrayList<CharGroup> groups = new ArrayList<CharGroup>(dict.mRoot.mData);
+        for (int i = 0; i < groups.size(); ++i) {
+            final CharGroup group = groups.get(i);
+            group.mCachedAddress = i;
+            if (null != group.mChildren) groups.addAll(group.mChildren.mData);
+        }
+        final int groupCount = groups.size();
+        if (groupCount > MAX_ARRAY_INDEX) {
+            throw new RuntimeException("Too many groups for the array format : " + groupCount);
+        }
+        computeMaxFrequencies(dict.mRoot);
+
+        MakedictLog.i("Writing the arrays...");
+        final ByteArrayOutputStream chars = new ByteArrayOutputStream();
+        final ByteArrayOutputStream flags = new ByteArrayOutputStream();
+        final ByteArrayOutputStream frequencies = new ByteArrayOutputStream();
+        final ByteArrayOutputStream maxFrequencies = new ByteArrayOutputStream();
+        final ByteArrayOutputStream firstChildren = new ByteArrayOutputStream();
+        final ByteArrayOutputStream extraOffsets = new ByteArrayOutputStream();
+        final ByteArrayOutputStream extraData = new ByteArrayOutputStream();
+        int nextChild = dict.mRoot.mData.size();
+        for (CharGroup group : groups) {
+            for (int character : group.mChars) {
+                if (character > MAX_ARRAY_CHARACTER) {
+                    throw new RuntimeException("The array format can't store the character "
+                            + character);
+                }
+            }
+            if (group.mFrequency > MAX_TERMINAL_FREQUENCY) {
+                throw new RuntimeException("A node has a frequency > " + MAX_TERMINAL_FREQUENCY
+                        + " : " + group.mFrequency);
+            }
+            writeFixedSize(chars, group.mChars[0], ARRAY_CHAR_SIZE);
+            int groupFlags = 0;
+            if (group.hasSeveralChars()) groupFlags |= FLAG_HAS_MULTIPLE_CHARS;
+            if (group.mFrequency >= 0) groupFlags |= FLAG_IS_TERMINAL;
+            if (null != group.mBigrams) groupFlags |= FLAG_HAS_BIGRAMS;
+            flags.write(groupFlags);
+            frequencies.write(group.mFrequency >= 0 ? group.mFrequency : 0);
+            maxFrequencies.write(null != group.mChildren ? group.mChildren.mCachedMaxFrequency : 0);
+            writeFixedSize(firstChildren, nextChild, ARRAY_INDEX_SIZE);
+            if (null != group.mChildren) nextChild += group.mChildren.mData.size();
+
+            writeFixedSize(extraOffsets, extraData.size(), ARRAY_INDEX_SIZE);
+            if (group.hasSeveralChars()) {
+                for (int i = 1; i < group.mChars.length; ++i) {
+                    writeFixedSize(extraData, group.mChars[i], ARRAY_CHAR_SIZE);
+                }
+                writeFixedSize(extraData, ARRAY_CHARACTERS_TERMINATOR, ARRAY_CHAR_SIZE);
+            }
+            if (null != group.mBigrams) {
+                for (WeightedString bigram : group.mBigrams) {
+                    extraData.write(bigram.mFrequency & FLAG_ATTRIBUTE_FREQUENCY);
+                    writeFixedSize(extraData, findAddressOfWord(dict, bigram.mWord),
+                            ARRAY_INDEX_SIZE);
+                }
+            }
+        }
+        writeFixedSize(firstChildren, nextChild, ARRAY_INDEX_SIZE);
+        writeFixedSize(extraOffsets, extraData.size(), ARRAY_INDEX_SIZE);
+        if (extraData.size() > MAX_ARRAY_INDEX) {
+            throw new RuntimeException("Too much extra data for the array format : "
+                    + extraData.size());
+        }
+
+        final ByteArrayOutputStream header = new ByteArrayOutputStream();
+        writeFixedSize(header, MAGIC_NUMBER, 2);
+        header.write(ARRAY_VERSION);
+        writeFixedSize(header, OPTIONS, 2);
+        writeFixedSize(header, groupCount, ARRAY_INDEX_SIZE);
+        writeFixedSize(header, dict.mRoot.mData.size(), ARRAY_INDEX_SIZE);
+
+        header.writeTo(destination);
+        chars.writeTo(destination);
+        flags.writeTo(destination);
+        frequencies.writeTo(destination);
+        maxFrequencies.writeTo(destination);
+        firstChildren.writeTo(destination);
+        extraOffsets.writeTo(destination);
+        extraData.writeTo(destination);
+        destination.close();
+        MakedictLog.i("Done : " + groupCount + " groups");
+    }
+
+
     // Input methods: Read a binary dictionary to memory.
     // readDictionaryBinary is the public entry point for them.
 
@@ -795,6 +983,11 @@ public class BinaryDictInputOutput {
         } else {
             frequency = CharGroup.NOT_A_TERMINAL;
         }
+        if (0 != (FLAG_HAS_MAX_DESCENDANT_FREQUENCY & flags)) {
+            // Only useful to the native lookup, the dictionary is read in whole
+            ++addressPointer;
+            source.readUnsignedByte();
+        }
         int childrenAddress = addressPointer;
         switch (flags & MASK_GROUP_ADDRESS_TYPE) {
         case FLAG_GROUP_ADDRESS_TYPE_ONEBYTE:
@@ -37,6 +37,7 @@ public class DictionaryMaker {
 
     static class Arguments {
         private final static String OPTION_VERSION_2 = "-2";
+        private final static String OPTION_ARRAY_FORMAT = "-a";
         private final static String OPTION_INPUT_SOURCE = "-s";
         private final static String OPTION_INPUT_BIGRAM_XML = "-b";
         private final static String OPTION_OUTPUT_BINARY = "-d";
@@ -47,6 +48,7 @@ public class DictionaryMaker {
         public final String mInputBigramXml;
         public final String mOutputBinary;
         public final String mOutputXml;
+        public final boolean mOutputArrayFormat;
 
         private void checkIntegrity() {
             checkHasExactlyOneInput();
@@ -73,14 +75,16 @@ public class DictionaryMaker {
         private void displayHelp() {
             MakedictLog.i("Usage: makedict "
                     + "[-s <unigrams.xml> [-b <bigrams.xml>] | -s <binary input>] "
-                    + " [-d <binary output>] [-x <xml output>] [-2]\n"
+                    + " [-d <binary output> [-a]] [-x <xml output>] [-2]\n"
                     + "\n"
                     + "  Converts a source dictionary file to one or several outputs.\n"
                     + "  Source can be an XML file, with an optional XML bigrams file, or a\n"
                     + "  binary dictionary file.\n"
                     + "  Both binary and XML outputs are supported. Both can be output at\n"
                     + "  the same time but outputting several files of the same type is not\n"
-                    + "  supported.");
+                    + "  supported.\n"
+                    + "  With -a, the binary output is in the array format, which a binary\n"
+                    + "  input can also be converted to.");
         }
 
         public Arguments(String[] argsArray) {
@@ -93,6 +97,7 @@ public class DictionaryMaker {
             String inputBigramXml = null;
             String outputBinary = null;
             String outputXml = null;
+            boolean outputArrayFormat = false;
 
             while (!args.isEmpty()) {
                 final String arg = args.get(0);
@@ -100,6 +105,8 @@ public class DictionaryMaker {
                 if (arg.charAt(0) == '-') {
                     if (OPTION_VERSION_2.equals(arg)) {
                         // Do nothing, this is the default
+                    } else if (OPTION_ARRAY_FORMAT.equals(arg)) {
+                        outputArrayFormat = true;
                     } else if (OPTION_HELP.equals(arg)) {
                         displayHelp();
                     } else {
@@ -143,6 +150,7 @@ public class DictionaryMaker {
             mInputBigramXml = inputBigramXml;
             mOutputBinary = outputBinary;
             mOutputXml = outputXml;
+            mOutputArrayFormat = outputArrayFormat;
             checkIntegrity();
         }
     }
@@ -220,7 +228,7 @@ public class DictionaryMaker {
     private static void writeOutputToParsedArgs(final Arguments args, final FusionDictionary dict)
             throws FileNotFoundException, IOException {
         if (null != args.mOutputBinary) {
-            writeBinaryDictionary(args.mOutputBinary, dict);
+            writeBinaryDictionary(args.mOutputBinary, dict, args.mOutputArrayFormat);
         }
         if (null != args.mOutputXml) {
             writeXmlDictionary(args.mOutputXml, dict);
@@ -232,13 +240,21 @@ public class DictionaryMaker {
      *
      * @param outputFilename the name of the file to write to.
      * @param dict the dictionary to write.
+     * @param arrayFormat whether to write it in the array format.
      * @throws FileNotFoundException if the output file can't be created.
      * @throws IOException if the output file can't be written to.
      */
     private static void writeBinaryDictionary(final String outputFilename,
-            final FusionDictionary dict) throws FileNotFoundException, IOException {
+            final FusionDictionary dict, final boolean arrayFormat)
+            throws FileNotFoundException, IOException {
         final File outputFile = new File(outputFilename);
-        BinaryDictInputOutput.writeDictionaryBinary(new FileOutputStream(outputFilename), dict);
+        if (arrayFormat) {
+            BinaryDictInputOutput.writeDictionaryArrays(new FileOutputStream(outputFilename),
+                    dict);
+        } else {
+            BinaryDictInputOutput.writeDictionaryBinary(new FileOutputStream(outputFilename),
+                    dict);
+        }
     }
 
     /**
@@ -41,15 +41,18 @@ public class FusionDictionary implements Iterable<Word> {
         // To help with binary generation
         int mCachedSize;
         int mCachedAddress;
+        int mCachedMaxFrequency;
         public Node() {
             mData = new ArrayList<CharGroup>();
             mCachedSize = Integer.MIN_VALUE;
             mCachedAddress = Integer.MIN_VALUE;
+            mCachedMaxFrequency = Integer.MIN_VALUE;
         }
         public Node(ArrayList<CharGroup> data) {
             mData = data;
             mCachedSize = Integer.MIN_VALUE;
             mCachedAddress = Integer.MIN_VALUE;
+            mCachedMaxFrequency = Integer.MIN_VALUE;
         }
     }
 